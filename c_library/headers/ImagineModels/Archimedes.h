@@ -11,16 +11,17 @@
 //simple archimdeean sprial, implementation based on CRPropa
 
 
-class ArchimedeanMagneticField : public RegularVectorField  {
+class ArchimedeanMagneticField : public RegularVectorFieldModel<ArchimedeanMagneticField>  {
     protected:
 
-    vector _at_position(const double &x, const double &y, const double &z, const ArchimedeanMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const ArchimedeanMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, ArchimedeanMagneticField &p) const;
 #endif
     public:
-        using RegularVectorField :: RegularVectorField;
+        using RegularVectorFieldModel<ArchimedeanMagneticField>::RegularVectorFieldModel;
 
         number R_0 = 3; 
         number Omega = 1.;
@@ -37,9 +38,11 @@ class ArchimedeanMagneticField : public RegularVectorField  {
         return _jac(x, y, z, *this);
     }
 #endif
-        vector at_position(const double &x, const double &y, const double &z) const {
-            return _at_position(x, y, z, *this);
+        vector_t<double> at_position(const double &x, const double &y, const double &z) const {
+            return _at_position<double>(x, y, z, *this);
         }
  };
 
- #endif
+extern template class RegularVectorFieldModel<ArchimedeanMagneticField>;
+
+#endif
@@ -9,17 +9,18 @@
 
 // Fauvet magnetic field
 
-class FauvetMagneticField : public RegularVectorField
+class FauvetMagneticField : public RegularVectorFieldModel<FauvetMagneticField>
 {
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const FauvetMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const FauvetMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, FauvetMagneticField &p) const;
 #endif
 
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<FauvetMagneticField>::RegularVectorFieldModel;
 
     double b_r_max = 20.; // kpc
     double b_r_min = 3.;  // kpc
@@ -46,10 +47,12 @@ public:
     }
 #endif
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 };
 
+extern template class RegularVectorFieldModel<FauvetMagneticField>;
+
 #endif
\ No newline at end of file
@@ -7,8 +7,15 @@
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <cstddef>
+#include <type_traits>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 #include "exceptions.h"
+#include "ParallelExceptions.h"
 
 #if autodiff_FOUND
     #include <autodiff/forward/real.hpp>
@@ -22,6 +29,16 @@
     typedef std::array<double, 3> vector;
 #endif
 
+// The models are evaluated with plain doubles, number and vector are only used for the (differentiable) model parameters and for derivatives. 
+// Model bodies are templates over their scalar type T (double for evaluation, number for derivatives), vector_t<T> is the matching vector type.
+#if autodiff_FOUND
+    template <typename T>
+    using vector_t = typename std::conditional<std::is_same<T, double>::value, std::array<double, 3>, vector>::type;
+#else
+    template <typename T>
+    using vector_t = vector;
+#endif
+
 
 template<typename POSTYPE, typename GRIDTYPE>
 class Field {
@@ -65,13 +82,30 @@ public:
   std::vector<double> internal_grid_y;
   std::vector<double> internal_grid_z;
 
+  // Number of threads used when evaluating functions on grids. 
+  // Values smaller than one select the OpenMP default, 1 evaluates serially.
+  int grid_threads = 0;
+  // Number of grid lines along the first two axes that are grouped into one work item of the parallel grid evaluation
+  std::array<int, 2> grid_tile{{1, 16}};
+
   // -----METHODS-----
 
+  bool has_internal_grid() const {
+    return initialized_with_grid;
+  }
+
   // -----Interface functions-----
 
   // Evaluate the model at Galactic position (x, y, z). 
   virtual POSTYPE at_position(const double &x, const double &y, const double &z) const = 0;
 
+  // Evaluate the model at n arbitrary positions, given as three coordinate arrays of length n. 
+  // The output (one array for scalar fields, one array per component for vector fields) has to be allocated by the caller.
+  virtual void at_positions(const double *x, const double *y, const double *z, const size_t n, GRIDTYPE out) const {
+    evaluate_function_at_positions<POSTYPE, GRIDTYPE>(out, x, y, z, n, [this](double xx, double yy, double zz)
+                                                  { return at_position(xx, yy, zz); });
+  }
+
    // Evaluate the model on a grid. 
    //The grid may be provided as three vectors containting the x, y and z coordinates (useful for irregular grids) or via providing the zeropoint, increment and number of pixels along each axis (thereby defining a regular grid). 
    // Each of the options maybe provided in the initialization of the class (thereby potentially allowing precomputation) 
@@ -93,30 +127,30 @@ public:
   }
 
 
-  void initialize_field_value(double* fval, number eval, const int idx) {
-    fval[idx] = static_cast<double>(eval);
+  static void initialize_field_value(double* fval, double eval, const std::ptrdiff_t idx) {
+    fval[idx] = eval;
   }
 
-  void initialize_field_value(std::array<double*, 3> fval, number eval,  const int idx) {
-    fval[0][idx] = static_cast<double>(eval);
-    fval[1][idx] = static_cast<double>(eval);
-    fval[2][idx] = static_cast<double>(eval);
+  static void initialize_field_value(std::array<double*, 3> fval, double eval,  const std::ptrdiff_t idx) {
+    fval[0][idx] = eval;
+    fval[1][idx] = eval;
+    fval[2][idx] = eval;
   }
 
-  void initialize_field_value(std::array<double*, 3> fval, vector eval, const int idx) {
-    fval[0][idx] = static_cast<double>(eval[0]);
-    fval[1][idx] = static_cast<double>(eval[1]);
-    fval[2][idx] = static_cast<double>(eval[2]);
+  static void initialize_field_value(std::array<double*, 3> fval, const vector_t<double> &eval, const std::ptrdiff_t idx) {
+    fval[0][idx] = eval[0];
+    fval[1][idx] = eval[1];
+    fval[2][idx] = eval[2];
   }
 
   // The update_field_value functions are not yet usable with autodiff, as they are only used for random fields
-  void update_field_value(double* fval, std::function<double(double &, const double, const double, const double)> func, const int idx, const double xx, const double yy, const double zz) {
+  void update_field_value(double* fval, std::function<double(double &, const double, const double, const double)> func, const size_t idx, const double xx, const double yy, const double zz) {
     double fval_at_inx = fval[idx];
     double eval = func(fval_at_inx, xx, yy, zz);
     fval[idx] = static_cast<double>(eval);
   }
 
-  void update_field_value(std::array<double *, 3> fval, std::function<std::array<double, 3>(std::array<double, 3> &, double, double, double)> func, const int idx, const double xx, const double yy, const double zz) {
+  void update_field_value(std::array<double *, 3> fval, std::function<std::array<double, 3>(std::array<double, 3> &, double, double, double)> func, const size_t idx, const double xx, const double yy, const double zz) {
     std::array<double, 3> val = {fval[0][idx], fval[1][idx], fval[2][idx]};
     std::array<double, 3> eval = func(val, xx, yy, zz); 
     fval[0][idx] = static_cast<double>(eval[0]);
@@ -124,66 +158,211 @@ public:
     fval[2][idx] = static_cast<double>(eval[2]);
   }
 
+  // Number of threads the grid routines will run on
+  int grid_thread_count() const {
+#ifdef _OPENMP
+    return grid_threads > 0 ? grid_threads : omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+  // Calls line(i, j) for every line along the last axis of a grid with the given size. 
+  // Lines are grouped into tiles of grid_tile[0] x grid_tile[1] lines, which are distributed dynamically over the threads.
+  // Each line is visited exactly once, hence the result does not depend on the number of threads. 
+  // An exception thrown by line is rethrown after all threads have finished (the remaining tiles are skipped).
+  template <typename LINEFUNC>
+  void for_each_grid_line(const std::array<int, 3> &size, LINEFUNC &&line) const {
+    const long ti = std::max(1, grid_tile[0]);
+    const long tj = std::max(1, grid_tile[1]);
+    const long ntiles_i = (size[0] + ti - 1) / ti;
+    const long ntiles_j = (size[1] + tj - 1) / tj;
+    const long ntiles = ntiles_i * ntiles_j;
+    const int nthreads = grid_thread_count();
+    ParallelExceptions exceptions;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads) if(nthreads > 1 && ntiles > 1)
+#endif
+    for (long t = 0; t < ntiles; ++t) {
+      exceptions.capture([&]() {
+        const int i_start = (t / ntiles_j) * ti;
+        const int j_start = (t % ntiles_j) * tj;
+        const int i_stop = std::min<long>(i_start + ti, size[0]);
+        const int j_stop = std::min<long>(j_start + tj, size[1]);
+        for (int i = i_start; i < i_stop; i++) {
+          for (int j = j_start; j < j_stop; j++) {
+            line(i, j);
+          }
+        }
+      });
+    }
+    exceptions.rethrow();
+  }
+
+  // Coordinates along the three axes of a regular grid
+  static std::array<std::vector<double>, 3> grid_coordinates(const std::array<int, 3> &size, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) {
+    std::array<std::vector<double>, 3> grid;
+    for (int d = 0; d < 3; ++d) {
+      grid[d].resize(size[d]);
+      for (int i = 0; i < size[d]; ++i) {
+        grid[d][i] = rpt[d] + i*inc[d];
+      }
+    }
+    return grid;
+  }
+
+  // Memory layout of a grid, i.e. the distance (in elements) between neighbouring voxels along each axis. 
+  // All zero strides denote the default (C-contiguous) layout. 
+  static std::array<std::ptrdiff_t, 3> grid_strides(const std::array<int, 3> &size, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0}) {
+    if (strides[0] == 0 && strides[1] == 0 && strides[2] == 0) {
+      return {static_cast<std::ptrdiff_t>(size[1])*size[2], size[2], 1};
+    }
+    return strides;
+  }
+
   // Initialize functions on regular grids
-  template <typename FRTYPE, typename GTYPE> 
-  void evaluate_function_on_grid(GTYPE fval, const std::array<int, 3> &size, const std::array<double, 3> &rpt,  const std::array<double, 3> &inc, std::function<FRTYPE(double, double, double)> func) {
-    for (int i=0; i < size[0]; i++) {
-      int m = i*size[1]*size[2];
-      for (int j=0; j < size[1]; j++) {
-        int n = j*size[2];
-        for (int k=0; k < size[2]; k++) {
-          FRTYPE v = func(rpt[0] + i*inc[0], rpt[1] + j*inc[1], rpt[2] + k*inc[2]);
-          initialize_field_value(fval, v, m + n + k);
-        }   
+  // The function is passed as template parameter, so that no type erasure happens, and the function body may be inlined into the loop. 
+  template <typename FRTYPE, typename GTYPE, typename FUNC> 
+  void evaluate_function_on_grid(GTYPE fval, const std::array<int, 3> &size, const std::array<double, 3> &rpt,  const std::array<double, 3> &inc, FUNC &&func, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0}) {
+    const std::array<std::ptrdiff_t, 3> st = grid_strides(size, strides);
+    for_each_grid_line(size, [&](const int i, const int j) {
+      const std::ptrdiff_t n = i*st[0] + j*st[1];
+      for (int k=0; k < size[2]; k++) {
+        FRTYPE v = func(rpt[0] + i*inc[0], rpt[1] + j*inc[1], rpt[2] + k*inc[2]);
+        initialize_field_value(fval, v, n + k*st[2]);
       }   
-    }
+    });
   } 
 
 // Initialze functions on irregular grids
-  template <typename FRTYPE, typename GTYPE> 
-  void evaluate_function_on_grid(GTYPE fval, const std::vector<double> &ggx, const std::vector<double> &ggy, const std::vector<double> &ggz, std::function<FRTYPE(double, double, double)> func) {
-    std::vector<int> size{(int)ggx.size(), (int)ggy.size(), (int)ggz.size()};
-    for (int i=0; i < size[0]; i++) {
-      int m = i*size[1]*size[2];
-      for (int j=0; j < size[1]; j++) {
-        int n = j*size[2];
-        for (int k=0; k < size[2]; k++) {
-          FRTYPE v = func(ggx.at(i), ggy.at(j), ggz.at(k));
-          initialize_field_value(fval, v, m + n + k);
-        }   
+  template <typename FRTYPE, typename GTYPE, typename FUNC> 
+  void evaluate_function_on_grid(GTYPE fval, const std::vector<double> &ggx, const std::vector<double> &ggy, const std::vector<double> &ggz, FUNC &&func, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0}) {
+    std::array<int, 3> size{(int)ggx.size(), (int)ggy.size(), (int)ggz.size()};
+    const std::array<std::ptrdiff_t, 3> st = grid_strides(size, strides);
+    for_each_grid_line(size, [&](const int i, const int j) {
+      const std::ptrdiff_t n = i*st[0] + j*st[1];
+      for (int k=0; k < size[2]; k++) {
+        FRTYPE v = func(ggx[i], ggy[j], ggz[k]);
+        initialize_field_value(fval, v, n + k*st[2]);
+      }   
+    });
+  }
+
+  // Copy a C-contiguous grid into a possibly strided one (of double or float)
+  template <typename REAL>
+  void copy_grid(REAL* dst, const double* src, const std::array<int, 3> &size, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0}) const {
+    const std::array<std::ptrdiff_t, 3> st = grid_strides(size, strides);
+    for_each_grid_line(size, [&](const int i, const int j) {
+      const std::ptrdiff_t n = i*st[0] + j*st[1];
+      const size_t m = (static_cast<size_t>(i)*size[1] + j)*size[2];
+      for (int k=0; k < size[2]; k++) {
+        dst[n + k*st[2]] = src[m + k];
       }   
+    });
+  }
+
+  template <typename REAL>
+  void copy_grid(std::array<REAL*, 3> dst, const std::array<double*, 3> src, const std::array<int, 3> &size, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0}) const {
+    for (int d = 0; d < 3; ++d) {
+      copy_grid(dst[d], src[d], size, strides);
     }
   }
 
+  // Evaluate a grid of another precision (float* or std::array<float*, 3>) in slabs along the first axis: eval_slab(buffer, i0, n) 
+  // evaluates the planes i0 to i0 + n - 1 in double precision into a C-contiguous buffer, which is then copied into the (strided) output. 
+  // The slabs hold about 2^18 voxels, so that the double precision buffer stays small compared to the output.
+  template <typename OUTTYPE, typename EVAL>
+  void evaluate_in_slabs(OUTTYPE out, const std::array<int, 3> &size, const std::array<std::ptrdiff_t, 3> &strides, EVAL &&eval_slab) {
+    const std::array<std::ptrdiff_t, 3> st = grid_strides(size, strides);
+    const size_t plane_size = std::max<size_t>(static_cast<size_t>(size[1])*size[2], 1);
+    const int slab = static_cast<int>(std::max<size_t>(1, std::min<size_t>(size[0], (static_cast<size_t>(1) << 18) / plane_size)));
+    GRIDTYPE buffer = allocate_memory({slab, size[1], size[2]});
+    try {
+      for (int i0 = 0; i0 < size[0]; i0 += slab) {
+        const int n = std::min(slab, size[0] - i0);
+        eval_slab(buffer, i0, n);
+        copy_grid(offset_grid(out, i0*st[0]), buffer, {n, size[1], size[2]}, st);
+      }
+    }
+    catch (...) {
+      free_memory(buffer);
+      throw;
+    }
+    free_memory(buffer);
+  }
 
+  template <typename REAL>
+  static REAL* offset_grid(REAL* grid, const std::ptrdiff_t offset) {
+    return grid + offset;
+  }
+
+  template <typename REAL>
+  static std::array<REAL*, 3> offset_grid(std::array<REAL*, 3> grid, const std::ptrdiff_t offset) {
+    return {grid[0] + offset, grid[1] + offset, grid[2] + offset};
+  }
+
+  // Weighted sum dst = src[0] + sum_a weights[a]*src[a+1] of C-contiguous grids, written into a possibly strided grid.
+  // The sum is done line by line, so each output line stays in cache while the inputs are streamed through once.
+  void weighted_grid_sum(double* dst, const std::vector<const double*> &src, const std::vector<double> &weights, const std::array<int, 3> &size, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0}) const {
+    const std::array<std::ptrdiff_t, 3> st = grid_strides(size, strides);
+    for_each_grid_line(size, [&](const int i, const int j) {
+      double *out = dst + i*st[0] + j*st[1];
+      const size_t m = (static_cast<size_t>(i)*size[1] + j)*size[2];
+      const double *s = src[0] + m;
+      for (int k=0; k < size[2]; k++) {
+        out[k*st[2]] = s[k];
+      }
+      for (size_t a = 0; a < weights.size(); ++a) {
+        const double w = weights[a];
+        s = src[a + 1] + m;
+        for (int k=0; k < size[2]; k++) {
+          out[k*st[2]] += w*s[k];
+        }
+      }
+    });
+  }
+
+
+
+  // Initialize functions on arbitrary positions
+  template <typename FRTYPE, typename GTYPE, typename FUNC> 
+  void evaluate_function_at_positions(GTYPE fval, const double *x, const double *y, const double *z, const size_t n, FUNC &&func) const {
+    const long nn = static_cast<long>(n);
+    const int nthreads = grid_thread_count();
+    ParallelExceptions exceptions;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+#endif
+    for (long s = 0; s < nn; s++) {
+      exceptions.capture([&]() {
+        FRTYPE v = func(x[s], y[s], z[s]);
+        initialize_field_value(fval, v, s);
+      });
+    }
+    exceptions.rethrow();
+  }
 
   // Apply functions on regular grids
   template <typename GTYPE, typename FRTYPE> 
   void apply_function_to_field(GTYPE fval, const std::array<int, 3> &size, const std::array<double, 3> &rpt,  const std::array<double, 3> &inc, std::function<FRTYPE(FRTYPE &, double, double, double)> func) {
-    for (int i=0; i < size[0]; i++) {
-      int m = i*size[1]*size[2];
-      for (int j=0; j < size[1]; j++) {
-        int n = j*size[2];
-        for (int k=0; k < size[2]; k++) {
-          update_field_value(fval, func, m + n + k, rpt[0] + i*inc[0], rpt[1] + j*inc[1], rpt[2] + k*inc[2]);
-        }   
+    for_each_grid_line(size, [&](const int i, const int j) {
+      const size_t n = (static_cast<size_t>(i)*size[1] + j)*size[2];
+      for (int k=0; k < size[2]; k++) {
+        update_field_value(fval, func, n + k, rpt[0] + i*inc[0], rpt[1] + j*inc[1], rpt[2] + k*inc[2]);
       }   
-    }
+    });
   } 
 
 // Apply functions on irregular grids
   template <typename FRTYPE, typename GTYPE> 
   void apply_function_to_field(GTYPE fval, const std::vector<double> &ggx, const std::vector<double> &ggy, const std::vector<double> &ggz, std::function<FRTYPE(FRTYPE &, double, double, double)> func) {
-    std::vector<int> size{(int)ggx.size(), (int)ggy.size(), (int)ggz.size()};
-    for (int i=0; i < size[0]; i++) {
-      int m = i*size[1]*size[2];
-      for (int j=0; j < size[1]; j++) {
-        int n = j*size[2];
-        for (int k=0; k < size[2]; k++) {
-          update_field_value(fval, func, m + n + k, ggx.at(i), ggy.at(j), ggz.at(k));
-        }   
+    std::array<int, 3> size{(int)ggx.size(), (int)ggy.size(), (int)ggz.size()};
+    for_each_grid_line(size, [&](const int i, const int j) {
+      const size_t n = (static_cast<size_t>(i)*size[1] + j)*size[2];
+      for (int k=0; k < size[2]; k++) {
+        update_field_value(fval, func, n + k, ggx[i], ggy[j], ggz[k]);
       }   
-    }
+    });
   }
 };
 
@@ -0,0 +1,125 @@
+#ifndef GRIDINTERPOLATOR_H
+#define GRIDINTERPOLATOR_H
+
+#include <array>
+#include <cstddef>
+
+enum class InterpolationKernel
+{
+  trilinear, // 2 x 2 x 2 voxels, continuous, exact for linear fields
+  tricubic   // 4 x 4 x 4 voxels, cubic convolution (Catmull-Rom, Keys 1981), continuous first derivatives, exact for quadratic fields
+};
+
+enum class GridBoundary
+{
+  clamp,   // positions outside of the grid take the value at the nearest face
+  periodic // the grid is continued periodically (as the realizations of random fields are)
+};
+
+// Interpolation of a field evaluated on a regular grid (e.g. a realization of a random field, or a tabulated regular model),
+// for many evaluations at arbitrary positions, e.g. along lines of sight.
+// The grid is copied into cubic bricks of brick_size^3 voxels. Each brick is stored contiguously, together with the apron
+// of neighbouring voxels the kernel needs (one voxel above for trilinear, one below and two above for tricubic),
+// and with the components of a voxel next to each other. Hence every position reads from a single brick,
+// and close positions (e.g. consecutive samples of a ray) read the same few cache lines.
+class GridInterpolator
+{
+public:
+  // Scalar grids, strides as in Field::grid_strides (all zero for C-contiguous grids)
+  GridInterpolator(const double *grid, const std::array<int, 3> &shape, const std::array<double, 3> &rpt, const std::array<double, 3> &inc,
+                   const InterpolationKernel kernel = InterpolationKernel::trilinear, const GridBoundary boundary = GridBoundary::clamp,
+                   const int brick_size = 8, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  // Vector grids, one grid per component
+  GridInterpolator(const std::array<double *, 3> &grid, const std::array<int, 3> &shape, const std::array<double, 3> &rpt, const std::array<double, 3> &inc,
+                   const InterpolationKernel kernel = InterpolationKernel::trilinear, const GridBoundary boundary = GridBoundary::clamp,
+                   const int brick_size = 8, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  GridInterpolator(const GridInterpolator &) = delete;
+  GridInterpolator &operator=(const GridInterpolator &) = delete;
+
+  ~GridInterpolator();
+
+  int components() const {
+    return ncomp;
+  }
+
+  const std::array<int, 3> &shape() const {
+    return shp;
+  }
+
+  const std::array<double, 3> &reference_point() const {
+    return rpt;
+  }
+
+  const std::array<double, 3> &increment() const {
+    return inc;
+  }
+
+  InterpolationKernel kernel() const {
+    return kern;
+  }
+
+  GridBoundary boundary() const {
+    return bound;
+  }
+
+  // Number of bytes of the bricks (the grid and the aprons)
+  size_t memory_size() const {
+    return sizeof(double) * brick_count * brick_stride;
+  }
+
+  // All components at (x, y, z)
+  void interpolate(const double x, const double y, const double z, double *values) const;
+
+  // The (first) component at (x, y, z)
+  double at_position(const double x, const double y, const double z) const;
+
+  // All components at (x, y, z), unused components are zero
+  std::array<double, 3> vector_at_position(const double x, const double y, const double z) const;
+
+  // Batched evaluation at n positions on nthreads threads (values smaller than one select the OpenMP default),
+  // the kernel and the number of components are dispatched once per batch
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, double *out, const int nthreads = 0) const;
+
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, std::array<double *, 3> out, const int nthreads = 0) const;
+
+private:
+  std::array<int, 3> shp;
+  std::array<double, 3> rpt;
+  std::array<double, 3> inc;
+  InterpolationKernel kern;
+  GridBoundary bound;
+  int ncomp;
+  int brick;
+  // voxels of the apron below and above a brick along each axis
+  int apron_lo;
+  int apron_hi;
+  // edge of a stored brick, brick + apron_lo + apron_hi
+  int edge;
+  std::array<int, 3> bricks_per_axis;
+  size_t brick_count;
+  // doubles per stored brick, ncomp*edge^3
+  size_t brick_stride;
+  double *bricks = nullptr;
+
+  void build(const std::array<const double *, 3> &grid, const std::array<std::ptrdiff_t, 3> &strides);
+
+  // The voxel of the grid an index (possibly outside of the grid) refers to
+  int wrap(const int d, const int i) const;
+
+  // The brick and the offset of the lower corner voxel of the kernel within it,
+  // and the fractional position within the voxel along each axis
+  const double *locate(const double x, const double y, const double z, std::array<int, 3> &offset, std::array<double, 3> &t) const;
+
+  template <int K, int NCOMP>
+  void sample(const double x, const double y, const double z, double *values) const;
+
+  template <int K, int NCOMP, typename STORE>
+  void sample_batch(const double *x, const double *y, const double *z, const size_t n, const int nthreads, STORE &&store) const;
+
+  template <typename STORE>
+  void dispatch_batch(const double *x, const double *y, const double *z, const size_t n, const int nthreads, STORE &&store) const;
+};
+
+#endif /* GRIDINTERPOLATOR_H */
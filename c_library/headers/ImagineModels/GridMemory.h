@@ -0,0 +1,90 @@
+#ifndef GRIDMEMORY_H
+#define GRIDMEMORY_H
+
+#include <cstddef>
+#include <string>
+
+// Memory for evaluated grids.
+// All grids handed out by the library (on_grid, profile_on_grid, random_numbers_on_grid, ...) are allocated here,
+// and have to be released via free_grid_memory (the python capsules do so automatically).
+// Blocks are aligned to 64 bytes (one cache line, sufficient for all SIMD instruction sets and FFTW),
+// large blocks are additionally aligned to 2 MB and may be backed by transparent huge pages (Linux only).
+// Released blocks are kept in a pool keyed by size, so that repeated evaluations of grids with the same shape
+// do not go back to the operating system.
+
+const size_t grid_memory_alignment = 64;
+
+// Allocate memory for n doubles.
+double* allocate_grid_memory(const size_t n);
+
+// Release memory obtained from allocate_grid_memory (nullptr is ignored).
+void free_grid_memory(double* ptr);
+
+// Allocate memory for n floats (single precision grids), from the same pool as the double grids.
+float* allocate_float_grid_memory(const size_t n);
+
+// Release memory obtained from allocate_float_grid_memory (nullptr is ignored).
+void free_grid_memory(float* ptr);
+
+// Grid memory of either precision, for code templated on the floating point type.
+template <typename REAL>
+REAL* allocate_grid_memory(const size_t n);
+
+template <>
+inline double* allocate_grid_memory<double>(const size_t n) {
+  return allocate_grid_memory(n);
+}
+
+template <>
+inline float* allocate_grid_memory<float>(const size_t n) {
+  return allocate_float_grid_memory(n);
+}
+
+// Maximal number of bytes kept in the pool, released blocks exceeding this limit are returned to the system.
+// A limit of zero disables the pool.
+void set_grid_memory_pool_limit(const size_t bytes);
+
+// Request transparent huge pages for blocks of at least 2 MB (default true, no effect on non-Linux systems).
+void set_grid_memory_huge_pages(const bool use_huge_pages);
+
+// Return all pooled (i.e. currently unused) blocks to the system.
+void clear_grid_memory_pool();
+
+// Number of bytes currently held in the pool.
+size_t grid_memory_pool_size();
+
+// A grid of n doubles backed by a file and mapped into memory (POSIX mmap), for grids larger than the memory 
+// (see RandomField::on_grid_to_file). The file is created, or truncated, to n doubles in native byte order. 
+// Modified pages are written back to the file by the operating system, hence only the pages in use occupy memory. 
+// Temporary files (scratch space) are removed when the grid is destroyed. Throws std::runtime_error if the file can not be mapped, 
+// and on systems without mmap.
+class MappedGridFile {
+public:
+  MappedGridFile(const std::string &path, const size_t n, const bool temporary = false);
+
+  MappedGridFile(const MappedGridFile &) = delete;
+  MappedGridFile &operator=(const MappedGridFile &) = delete;
+
+  ~MappedGridFile();
+
+  double* data() const {
+    return ptr;
+  }
+
+  size_t size() const {
+    return n;
+  }
+
+  const std::string &path() const {
+    return file_path;
+  }
+
+private:
+  std::string file_path;
+  size_t n;
+  bool temporary;
+  double *ptr = nullptr;
+  int fd = -1;
+};
+
+#endif /* GRIDMEMORY_H */
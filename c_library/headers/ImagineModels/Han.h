@@ -11,16 +11,17 @@
 //J. L. Han et al 2018 ApJS 234 11
 
 
-class HanMagneticField : public RegularVectorField  {
+class HanMagneticField : public RegularVectorFieldModel<HanMagneticField>  {
     protected:
 
-    vector _at_position(const double &x, const double &y, const double &z, const HanMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const HanMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, HanMagneticField &p) const;
 #endif
     public:
-        using RegularVectorField :: RegularVectorField;
+        using RegularVectorFieldModel<HanMagneticField>::RegularVectorFieldModel;
 
         number B_p = 11; // pitch angle 
         number A = 5.;
@@ -44,9 +45,11 @@ class HanMagneticField : public RegularVectorField  {
         return _jac(x, y, z, *this);
     }
 #endif
-        vector at_position(const double &x, const double &y, const double &z) const {
-            return _at_position(x, y, z, *this);
+        vector_t<double> at_position(const double &x, const double &y, const double &z) const {
+            return _at_position<double>(x, y, z, *this);
         }
  };
 
- #endif
+extern template class RegularVectorFieldModel<HanMagneticField>;
+
+#endif
@@ -9,16 +9,17 @@
 
 // Harari, Mollerach, Roulet (HMR) see https://arxiv.org/abs/astro-ph/9906309, implementation of https://arxiv.org/pdf/astro-ph/0510444.pdf
 
-class HMRMagneticField : public RegularVectorField
+class HMRMagneticField : public RegularVectorFieldModel<HMRMagneticField>
 {
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const HMRMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const HMRMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, HMRMagneticField &p) const;
 #endif
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<HMRMagneticField>::RegularVectorFieldModel;
 
     double b_r_max = 20.; // kpc
 
@@ -38,10 +39,12 @@ public:
     }
 #endif
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 };
 
+extern template class RegularVectorFieldModel<HMRMagneticField>;
+
 #endif
\ No newline at end of file
@@ -7,17 +7,18 @@
 #include "Field.h"
 #include "RegularField.h"
 
-class HelixMagneticField : public RegularVectorField
+class HelixMagneticField : public RegularVectorFieldModel<HelixMagneticField>
 {
 protected:
-    vector _at_position(const double &xx, const double &yy, const double &zz, const HelixMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &xx, const double &yy, const double &zz, const HelixMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &xx, const double &yy, const double &zz, HelixMagneticField &p) const;
 #endif
 
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<HelixMagneticField>::RegularVectorFieldModel;
 
     // differentiable parameters
     number ampx = 1.;
@@ -29,13 +30,23 @@ public:
         std::set<std::string> active_diff{"ampx", "ampy", "ampz"};
     #endif
 
+    std::vector<std::pair<std::string, number *>> linear_parameters() override
+    {
+        return {{"ampx", &ampx}, {"ampy", &ampy}, {"ampz", &ampz}};
+    }
+
     // non_differentiable parameters
     double rmax = 20.;
     double rmin = 1.;
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    std::vector<double> nonlinear_parameter_values() const override
     {
-        return _at_position(x, y, z, *this);
+        return {rmax, rmin};
+    }
+
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
+    {
+        return _at_position<double>(x, y, z, *this);
     }
 
 #if autodiff_FOUND
@@ -46,21 +57,6 @@ public:
 #endif
 };
 
-/*THIS IS A ALTERNATIVE IMPLEMENTATION, WHICH COMPILES, BUT WHICH I DONT KNOW HOW TO BIND TO PYTHON IF WE WANT TO BE ABLE TO CHANGE THE PARAMETERS WRT DIFFERENTIATE AT RUNTIME. THE PROBLEM IS THAT AUTODIFF WANTS TO KNOW THIS AT COMPILE TIME. IF IT WOULD WORK, THE DERIVATIVE OWULD LIKELY BE FASTER, SINCE WE WOULDN'T NEED TO "FILTER".
-            template<typename... Params>
-            Eigen::MatrixXd _derivative_alt(const double &x, const double &y, const double &z,  HelixMagneticFields &p, Params... parameters) {
-                vector out;
-
-                Eigen::MatrixXd deriv = ad::jacobian([&](auto _x, auto _y, auto _z, auto _p) {return this->_at_position(_x, _y, _z, _p);},
-                    ad::wrt(parameters...), ad::at(x, y, z, p), out);
-                    return deriv;
-                }
-
-                        template<typename... Params>
-            Eigen::MatrixXd derivative(const double &x, const double &y, const double &z, Params... parameters) {
-                return _derivative_alt(x, y, z, this->param, parameters...);
-            }
-
-*/
+extern template class RegularVectorFieldModel<HelixMagneticField>;
 
 #endif
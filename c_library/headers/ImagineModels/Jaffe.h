@@ -8,17 +8,18 @@
 #include "Field.h"
 #include "RegularField.h"
 
-class JaffeMagneticField : public RegularVectorField
+class JaffeMagneticField : public RegularVectorFieldModel<JaffeMagneticField>
 {
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, JaffeMagneticField &p) const;
 #endif
 
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<JaffeMagneticField>::RegularVectorFieldModel;
 
     bool quadruple = false; // quadruple pattern in halo
     bool bss = false;       // bi-symmetric
@@ -77,26 +78,36 @@ public:
     }
 #endif
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 
-    vector orientation(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
+    template <typename T>
+    vector_t<T> orientation(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
 
-    number radial_scaling(const double &x, const double &y, const JaffeMagneticField &p) const;
+    template <typename T>
+    T radial_scaling(const double &x, const double &y, const JaffeMagneticField &p) const;
 
-    std::vector<number> arm_compress(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
+    template <typename T>
+    std::vector<T> arm_compress(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
 
-    std::vector<number> arm_compress_dust(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
+    template <typename T>
+    std::vector<T> arm_compress_dust(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const;
 
-    std::vector<number> dist2arm(const double &x, const double &y, const JaffeMagneticField &p) const;
+    template <typename T>
+    std::vector<T> dist2arm(const double &x, const double &y, const JaffeMagneticField &p) const;
 
-    number arm_scaling(const double &z, const JaffeMagneticField &p) const;
+    template <typename T>
+    T arm_scaling(const double &z, const JaffeMagneticField &p) const;
 
-    number disk_scaling(const double &z, const JaffeMagneticField &p) const;
+    template <typename T>
+    T disk_scaling(const double &z, const JaffeMagneticField &p) const;
 
-    number halo_scaling(const double &z, const JaffeMagneticField &p) const;
+    template <typename T>
+    T halo_scaling(const double &z, const JaffeMagneticField &p) const;
 };
 
+extern template class RegularVectorFieldModel<JaffeMagneticField>;
+
 #endif
\ No newline at end of file
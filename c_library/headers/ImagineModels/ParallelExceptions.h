@@ -0,0 +1,46 @@
+#ifndef PARALLELEXCEPTIONS_H
+#define PARALLELEXCEPTIONS_H
+
+#include <atomic>
+#include <exception>
+
+// An exception leaving an OpenMP region terminates the program. Parallel loops over code the library does not control
+// (e.g. at_position or spatial_profile overridden in python, which raise error_already_set) run each iteration through capture,
+// which keeps the first exception and skips the remaining iterations, and call rethrow after the parallel region.
+class ParallelExceptions
+{
+public:
+  template <typename FUNC>
+  void capture(FUNC &&func) {
+    if (failed.load(std::memory_order_relaxed)) {
+      return;
+    }
+    try {
+      func();
+    }
+    catch (...) {
+#ifdef _OPENMP
+      #pragma omp critical(imagine_parallel_exceptions)
+#endif
+      {
+        if (not first) {
+          first = std::current_exception();
+        }
+      }
+      failed.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  // Rethrow the first captured exception (if any), outside of the parallel region
+  void rethrow() {
+    if (first) {
+      std::rethrow_exception(first);
+    }
+  }
+
+private:
+  std::atomic<bool> failed{false};
+  std::exception_ptr first;
+};
+
+#endif /* PARALLELEXCEPTIONS_H */
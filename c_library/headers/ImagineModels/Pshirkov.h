@@ -7,17 +7,18 @@
 #include "Field.h"
 #include "RegularField.h"
 
-class PshirkovMagneticField : public RegularVectorField
+class PshirkovMagneticField : public RegularVectorFieldModel<PshirkovMagneticField>
 {
 protected:
-    vector _at_position(const double &xx, const double &yy, const double &zz, const PshirkovMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &xx, const double &yy, const double &zz, const PshirkovMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &xx, const double &yy, const double &zz, PshirkovMagneticField &p) const;
 #endif
 
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<PshirkovMagneticField>::RegularVectorFieldModel;
 
 	bool useASS = false;  // switch for axisymmetric spiral field (ASS)
 	bool useBSS = true;  // switch for bisymmetric spiral field (BSS)
@@ -47,9 +48,9 @@ public:
         std::set<std::string> active_diff{"pitch", "d", "R_sun","z0_D", "B0_D", "z0_H", "R0_H", "B0_Hn", "B0_Hs", "z11_H", "z12_H"};
     #endif
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 
 #if autodiff_FOUND
@@ -60,4 +61,6 @@ public:
 #endif
 };
 
+extern template class RegularVectorFieldModel<PshirkovMagneticField>;
+
 #endif
@@ -8,11 +8,35 @@
 #include <iostream>
 #include <algorithm>
 #include <set>
+#include <memory>
+#include <string>
+#include <utility>
 
 #include "exceptions.h"
 #include "Field.h"
+#include "GridMemory.h"
+#include "GridInterpolator.h"
 
-class RegularScalarField : public Field<number, double *>
+// Grids of a model that is linear in some of its parameters, B = B_0 + sum_a p_a B_a (see build_linear_basis). 
+// grids holds B_0 followed by the B_a, each as one C-contiguous grid per component. 
+// The basis is never modified after it has been built, hence copies of a model may share it.
+struct LinearParameterBasis
+{
+  std::array<int, 3> shape;
+  std::vector<double *> grids;
+  // nonlinear_parameter_values of the model the basis was built for
+  std::vector<double> nonlinear_values;
+
+  ~LinearParameterBasis()
+  {
+    for (double *grid : grids)
+    {
+      free_grid_memory(grid);
+    }
+  }
+};
+
+class RegularScalarField : public Field<double, double *>
 {
 protected:
   // Fields
@@ -22,13 +46,32 @@ protected:
   double *allocate_memory(std::array<int, 3> shp)
   {
     size_t arr_sz = grid_size(shp);
-    double *grid_eval = new double[arr_sz];
+    double *grid_eval = allocate_grid_memory(arr_sz);
     return grid_eval;
   }
 
   void free_memory(double *grid_eval)
   {
-    delete grid_eval;
+    free_grid_memory(grid_eval);
+  }
+
+  float *allocate_float_memory(std::array<int, 3> shp)
+  {
+    return allocate_float_grid_memory(grid_size(shp));
+  }
+
+  // Fill an allocated grid with model evaluations. This generic version calls the virtual at_position for each voxel, 
+  // RegularScalarFieldModel overrides it with a loop specialized to the concrete model.
+  virtual void _evaluate_on_grid(double *grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides)
+  {
+    evaluate_function_on_grid<double, double *>(grid_eval, shape, reference_point, increment, [this](double xx, double yy, double zz)
+                                      { return at_position(xx, yy, zz); }, strides);
+  }
+
+  virtual void _evaluate_on_grid(double *grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides)
+  {
+    evaluate_function_on_grid<double, double *>(grid_eval, grid_x, grid_y, grid_z, [this](double xx, double yy, double zz)
+                                      { return at_position(xx, yy, zz); }, strides);
   }
 
 public:
@@ -36,11 +79,11 @@ public:
 
   ~RegularScalarField(){};
 
-  RegularScalarField() : Field<number, double *>(){};
+  RegularScalarField() : Field<double, double *>(){};
 
-  RegularScalarField(std::array<int, 3> shape, std::array<double, 3> reference_point, std::array<double, 3> increment) : Field<number, double *>(shape, reference_point, increment){};
+  RegularScalarField(std::array<int, 3> shape, std::array<double, 3> reference_point, std::array<double, 3> increment) : Field<double, double *>(shape, reference_point, increment){};
 
-  RegularScalarField(std::vector<double> grid_x, std::vector<double> grid_y, std::vector<double> grid_z) : Field<number, double *>(grid_x, grid_y, grid_z){};
+  RegularScalarField(std::vector<double> grid_x, std::vector<double> grid_y, std::vector<double> grid_z) : Field<double, double *>(grid_x, grid_y, grid_z){};
 
   // Fields
   const int ndim = 1;
@@ -57,62 +100,352 @@ public:
       throw GridException();
     }
     double *grid_eval = allocate_memory(internal_shape);
+    on_grid_into(grid_eval);
+    return grid_eval;
+  }
+
+  double *on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, int seed = 0)
+  {
+    std::array<int, 3> shp = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    double *grid_eval = allocate_memory(shp);
+    on_grid_into(grid_eval, grid_x, grid_y, grid_z);
+    return grid_eval;
+  }
+
+  double *on_grid(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, int seed = 0)
+  {
+    double *grid_eval = allocate_memory(shape);
+    on_grid_into(grid_eval, shape, reference_point, increment);
+    return grid_eval;
+  }
+
+  // Evaluate the field into memory owned by the caller. strides are given in elements (not bytes) and describe the 
+  // layout of the output grid(s), all zero strides (the default) denote a C-contiguous grid of the requested shape.
+  void on_grid_into(double *grid_eval, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
     if (regular_grid)
     {
-      evaluate_function_on_grid<number, double*>(grid_eval, internal_shape, internal_ref_point, internal_increment, [this](double xx, double yy, double zz)
-                                        { return at_position(xx, yy, zz); });
+      _evaluate_on_grid(grid_eval, internal_shape, internal_ref_point, internal_increment, strides);
     }
     else
     {
-      evaluate_function_on_grid<number, double*>(grid_eval, internal_grid_x, internal_grid_y, internal_grid_z, [this](double xx, double yy, double zz)
-                                        { return at_position(xx, yy, zz); });
+      _evaluate_on_grid(grid_eval, internal_grid_x, internal_grid_y, internal_grid_z, strides);
+    }
+  }
+
+  void on_grid_into(double *grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    _evaluate_on_grid(grid_eval, grid_x, grid_y, grid_z, strides);
+  }
+
+  void on_grid_into(double *grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    _evaluate_on_grid(grid_eval, shape, reference_point, increment, strides);
+  }
+
+  // Single precision versions of on_grid and on_grid_into. The model is evaluated in double precision (in slabs, 
+  // see evaluate_in_slabs) and rounded, only the output grid is float, e.g. to halve the memory of large grids.
+  float *on_grid_float()
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
     }
+    float *grid_eval = allocate_float_memory(internal_shape);
+    on_grid_into(grid_eval);
     return grid_eval;
   }
 
-  double *on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, int seed = 0)
+  float *on_grid_float(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
   {
-    std::array<int, 3> shp = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
-    double *grid_eval = allocate_memory(shp);
-    evaluate_function_on_grid<number, double*>(grid_eval, grid_x, grid_y, grid_z,
-                                      [this](double xx, double yy, double zz)
-                                      { return at_position(xx, yy, zz); });
+    float *grid_eval = allocate_float_memory({(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()});
+    on_grid_into(grid_eval, grid_x, grid_y, grid_z);
     return grid_eval;
   }
 
-  double *on_grid(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, int seed = 0)
+  float *on_grid_float(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
   {
-    double *grid_eval = allocate_memory(shape);
-    evaluate_function_on_grid<number, double*>(grid_eval, shape, reference_point, increment,
-                                      [this](double xx, double yy, double zz)
-                                      { return at_position(xx, yy, zz); });
+    float *grid_eval = allocate_float_memory(shape);
+    on_grid_into(grid_eval, shape, reference_point, increment);
     return grid_eval;
   }
 
-#if autodiff_FOUND
+  void on_grid_into(float *grid_eval, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    if (regular_grid)
+    {
+      on_grid_into(grid_eval, internal_shape, internal_ref_point, internal_increment, strides);
+    }
+    else
+    {
+      on_grid_into(grid_eval, internal_grid_x, internal_grid_y, internal_grid_z, strides);
+    }
+  }
+
+  void on_grid_into(float *grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    const std::array<int, 3> shape = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    evaluate_in_slabs(grid_eval, shape, strides, [&](double * slab, const int i0, const int n)
+                      { _evaluate_on_grid(slab, std::vector<double>(grid_x.begin() + i0, grid_x.begin() + i0 + n), grid_y, grid_z, {0, 0, 0}); });
+  }
+
+  void on_grid_into(float *grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    evaluate_in_slabs(grid_eval, shape, strides, [&](double * slab, const int i0, const int n)
+                      { _evaluate_on_grid(slab, {n, shape[1], shape[2]}, {reference_point[0] + i0*increment[0], reference_point[1], reference_point[2]}, increment, {0, 0, 0}); });
+  }
+
+  // The model evaluated once on a regular grid, for interpolated evaluations at many positions (see GridInterpolator), 
+  // e.g. of expensive models along lines of sight. Positions outside of the grid take the values at its faces.
+  std::shared_ptr<GridInterpolator> tabulate(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const InterpolationKernel kernel = InterpolationKernel::trilinear, const int brick_size = 8)
+  {
+    double * grid_eval = allocate_memory(shape);
+    std::shared_ptr<GridInterpolator> interpolator;
+    try
+    {
+      on_grid_into(grid_eval, shape, reference_point, increment);
+      interpolator = std::make_shared<GridInterpolator>(grid_eval, shape, reference_point, increment, kernel, GridBoundary::clamp, brick_size);
+    }
+    catch (...)
+    {
+      free_memory(grid_eval);
+      throw;
+    }
+    free_memory(grid_eval);
+    return interpolator;
+  }
+
+  // -----Linear parameter basis-----
+  // Parameters the model depends on linearly, B = B_0 + sum_a p_a B_a with B_0 and the B_a independent of all p_a, 
+  // given as pairs of name and member. Models with such amplitude parameters override this, by default there are none.
+  virtual std::vector<std::pair<std::string, number *>> linear_parameters()
+  {
+    return {};
+  }
+
+  // Values of all other parameters the field depends on (e.g. scale heights and switches), the basis is only valid as long as they 
+  // do not change. Models with linear parameters override this.
+  virtual std::vector<double> nonlinear_parameter_values() const
+  {
+    return {};
+  }
+
+  std::vector<std::string> linear_parameter_names()
+  {
+    std::vector<std::string> names;
+    for (const auto &par : linear_parameters())
+    {
+      names.push_back(par.first);
+    }
+    return names;
+  }
+
+  // Evaluate B_0 and the B_a on a grid and keep them (n+1 grid evaluations for n linear parameters). Afterwards on_linear_basis 
+  // returns the field on this grid for the current values of the linear parameters as weighted sum of the kept grids. 
+  // The basis has to be rebuilt after any other parameter has been changed, on_linear_basis throws a LinearBasisException otherwise.
+  void build_linear_basis()
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    _build_linear_basis(internal_shape, [this]()
+                        { return on_grid(); });
+  }
+
+  void build_linear_basis(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
+  {
+    std::array<int, 3> shp = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    _build_linear_basis(shp, [&]()
+                        { return on_grid(grid_x, grid_y, grid_z); });
+  }
+
+  void build_linear_basis(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
+  {
+    _build_linear_basis(shape, [&]()
+                        { return on_grid(shape, reference_point, increment); });
+  }
+
+  bool has_linear_basis() const
+  {
+    return linear_basis != nullptr;
+  }
 
-  Eigen::VectorXd _filter_diff(Eigen::VectorXd inp) const
+  std::array<int, 3> linear_basis_shape() const
   {
-    if (active_diff.size() != all_diff.size())
+    if (not linear_basis)
     {
-      std::vector<int> i_to_keep;
-      for (std::string s : active_diff)
+      throw LinearBasisException();
+    }
+    return linear_basis->shape;
+  }
+
+  void clear_linear_basis()
+  {
+    linear_basis.reset();
+  }
+
+  double *on_linear_basis()
+  {
+    check_linear_basis();
+    double *grid_eval = allocate_memory(linear_basis->shape);
+    on_linear_basis_into(grid_eval);
+    return grid_eval;
+  }
+
+  // Same as on_linear_basis, into memory owned by the caller (see on_grid_into for strides)
+  void on_linear_basis_into(double *grid_eval, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    check_linear_basis();
+    weighted_grid_sum(grid_eval, {linear_basis->grids.begin(), linear_basis->grids.end()}, linear_parameter_values(), linear_basis->shape, strides);
+  }
+
+protected:
+  std::shared_ptr<LinearParameterBasis> linear_basis;
+
+  // The basis exists and was built for the current values of the nonlinear parameters (it may be shared with a copy of the model)
+  void check_linear_basis() const
+  {
+    if (not linear_basis)
+    {
+      throw LinearBasisException();
+    }
+    if (nonlinear_parameter_values() != linear_basis->nonlinear_values)
+    {
+      throw LinearBasisException("Nonlinear parameters changed since build_linear_basis, rebuild the linear parameter basis.");
+    }
+  }
+
+  std::vector<double> linear_parameter_values()
+  {
+    std::vector<double> values;
+    for (const auto &par : linear_parameters())
+    {
+      values.push_back(static_cast<double>(*par.second));
+    }
+    return values;
+  }
+
+  // Evaluates B_0 with all linear parameters set to zero, and each B_a with p_a set to one minus B_0. 
+  // The parameter values are restored afterwards, also if an evaluation throws.
+  template <typename EVAL>
+  void _build_linear_basis(const std::array<int, 3> &shp, EVAL &&eval)
+  {
+    std::vector<std::pair<std::string, number *>> parameters = linear_parameters();
+    std::vector<number> values;
+    for (auto &par : parameters)
+    {
+      values.push_back(*par.second);
+      *par.second = 0.;
+    }
+    auto restore = [&]()
+    {
+      for (size_t a = 0; a < parameters.size(); ++a)
       {
-        if (auto search = all_diff.find(s); search != all_diff.end())
-        {
-          int index = std::distance(all_diff.begin(), search);
-          i_to_keep.push_back(index);
-        }
+        *parameters[a].second = values[a];
       }
-      return inp(Eigen::all, i_to_keep);
+    };
+    auto basis = std::make_shared<LinearParameterBasis>();
+    basis->shape = shp;
+    basis->nonlinear_values = nonlinear_parameter_values();
+    try
+    {
+      push_grid(basis->grids, eval());
+      for (auto &par : parameters)
+      {
+        *par.second = 1.;
+        push_grid(basis->grids, eval());
+        *par.second = 0.;
+        double *grid = basis->grids.back();
+        weighted_grid_sum(grid, {grid, basis->grids[0]}, {-1.}, shp);
+      }
+    }
+    catch (...)
+    {
+      restore();
+      throw;
+    }
+    restore();
+    linear_basis = basis;
+  }
+
+  static void push_grid(std::vector<double *> &grids, double *grid)
+  {
+    grids.push_back(grid);
+  }
+
+public:
+#if autodiff_FOUND
+  // Number of parameters derivatives are computed for, i.e. the entries of active_diff that are differentiable parameters of the model
+  virtual size_t n_active_diff() const
+  {
+    return 0;
+  }
+
+  // Derivatives with respect to the parameters in active_diff on a grid, returned as C-contiguous array of shape 
+  // (n_active_diff(), nx, ny, nz). The memory is allocated with allocate_grid_memory. Implemented by RegularScalarFieldModel.
+  virtual double *derivative_on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
+  {
+    throw NotImplementedException();
+  }
+
+  double *derivative_on_grid(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
+  {
+    const std::array<std::vector<double>, 3> grid = grid_coordinates(shape, reference_point, increment);
+    return derivative_on_grid(grid[0], grid[1], grid[2]);
+  }
+
+  double *derivative_on_grid()
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
     }
-    return inp;
+    if (regular_grid)
+    {
+      return derivative_on_grid(internal_shape, internal_ref_point, internal_increment);
+    }
+    return derivative_on_grid(internal_grid_x, internal_grid_y, internal_grid_z);
   }
 
+  // Gradient of an objective L, which is a sum over the grid, with respect to the parameters in active_diff. 
+  // adjoint holds dL/dB on the grid (a C-contiguous grid), the result is J^T adjoint accumulated over all voxels, 
+  // without storing the Jacobian of the grid. Implemented by RegularScalarFieldModel.
+  virtual Eigen::VectorXd gradient_on_grid(const double * adjoint, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
+  {
+    throw NotImplementedException();
+  }
+
+  Eigen::VectorXd gradient_on_grid(const double * adjoint, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
+  {
+    const std::array<std::vector<double>, 3> grid = grid_coordinates(shape, reference_point, increment);
+    return gradient_on_grid(adjoint, grid[0], grid[1], grid[2]);
+  }
+
+  Eigen::VectorXd gradient_on_grid(const double * adjoint)
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    if (regular_grid)
+    {
+      return gradient_on_grid(adjoint, internal_shape, internal_ref_point, internal_increment);
+    }
+    return gradient_on_grid(adjoint, internal_grid_x, internal_grid_y, internal_grid_z);
+  }
 #endif
 };
 
-class RegularVectorField : public Field<vector, std::array<double *, 3>>
+class RegularVectorField : public Field<vector_t<double>, std::array<double *, 3>>
 {
 protected:
   // Fields
@@ -123,28 +456,48 @@ protected:
   {
     std::array<double *, 3> grid_eval;
     size_t arr_sz = grid_size(shp);
-    grid_eval[0] = new double[arr_sz];
-    grid_eval[1] = new double[arr_sz];
-    grid_eval[2] = new double[arr_sz];
+    grid_eval[0] = allocate_grid_memory(arr_sz);
+    grid_eval[1] = allocate_grid_memory(arr_sz);
+    grid_eval[2] = allocate_grid_memory(arr_sz);
     return grid_eval;
   }
 
   void free_memory(std::array<double *, 3> grid_eval) override
   {
-    delete grid_eval[0];
-    delete grid_eval[1];
-    delete grid_eval[2];
+    free_grid_memory(grid_eval[0]);
+    free_grid_memory(grid_eval[1]);
+    free_grid_memory(grid_eval[2]);
+  }
+
+  std::array<float *, 3> allocate_float_memory(std::array<int, 3> shp)
+  {
+    size_t arr_sz = grid_size(shp);
+    return {allocate_float_grid_memory(arr_sz), allocate_float_grid_memory(arr_sz), allocate_float_grid_memory(arr_sz)};
+  }
+
+  // Fill allocated grids with model evaluations. This generic version calls the virtual at_position for each voxel, 
+  // RegularVectorFieldModel overrides it with a loop specialized to the concrete model.
+  virtual void _evaluate_on_grid(std::array<double *, 3> grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides)
+  {
+    evaluate_function_on_grid<vector_t<double>, std::array<double *, 3>>(grid_eval, shape, reference_point, increment, [this](double xx, double yy, double zz)
+                                      { return at_position(xx, yy, zz); }, strides);
+  }
+
+  virtual void _evaluate_on_grid(std::array<double *, 3> grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides)
+  {
+    evaluate_function_on_grid<vector_t<double>, std::array<double *, 3>>(grid_eval, grid_x, grid_y, grid_z, [this](double xx, double yy, double zz)
+                                      { return at_position(xx, yy, zz); }, strides);
   }
 
 public:
   ~RegularVectorField(){};
 
   // Constructors
-  RegularVectorField() : Field<vector, std::array<double *, 3>>(){};
+  RegularVectorField() : Field<vector_t<double>, std::array<double *, 3>>(){};
 
-  RegularVectorField(std::array<int, 3> shape, std::array<double, 3> reference_point, std::array<double, 3> grid_increment) : Field<vector, std::array<double *, 3>>(shape, reference_point, grid_increment){};
+  RegularVectorField(std::array<int, 3> shape, std::array<double, 3> reference_point, std::array<double, 3> grid_increment) : Field<vector_t<double>, std::array<double *, 3>>(shape, reference_point, grid_increment){};
 
-  RegularVectorField(std::vector<double> grid_x, std::vector<double> grid_y, std::vector<double> grid_z) : Field<vector, std::array<double *, 3>>(grid_x, grid_y, grid_z){};
+  RegularVectorField(std::vector<double> grid_x, std::vector<double> grid_y, std::vector<double> grid_z) : Field<vector_t<double>, std::array<double *, 3>>(grid_x, grid_y, grid_z){};
 
   // Fields
 
@@ -163,60 +516,664 @@ public:
       throw GridException();
     }
     std::array<double *, 3> grid_eval = allocate_memory(internal_shape);
-    ;
+    on_grid_into(grid_eval);
+    return grid_eval;
+  }
+
+  std::array<double *, 3> on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, int seed = 0)
+  {
+    std::array<int, 3> shp = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    std::array<double *, 3> grid_eval = allocate_memory(shp);
+    on_grid_into(grid_eval, grid_x, grid_y, grid_z);
+    return grid_eval;
+  }
+
+  std::array<double *, 3> on_grid(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, int seed = 0)
+  {
+    std::array<double *, 3> grid_eval = allocate_memory(shape);
+    on_grid_into(grid_eval, shape, reference_point, increment);
+    return grid_eval;
+  }
+
+  // Evaluate the field into memory owned by the caller. strides are given in elements (not bytes) and describe the 
+  // layout of the output grid(s), all zero strides (the default) denote a C-contiguous grid of the requested shape.
+  void on_grid_into(std::array<double *, 3> grid_eval, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
     if (regular_grid)
     {
-      evaluate_function_on_grid<vector, std::array<double *, 3>>(grid_eval, internal_shape, internal_ref_point, internal_increment, [this](double xx, double yy, double zz)
-                                        { return at_position(xx, yy, zz); });
+      _evaluate_on_grid(grid_eval, internal_shape, internal_ref_point, internal_increment, strides);
     }
     else
     {
-      evaluate_function_on_grid<vector, std::array<double *, 3>>(grid_eval, internal_grid_x, internal_grid_y, internal_grid_z, [this](double xx, double yy, double zz)
-                                        { return at_position(xx, yy, zz); });
+      _evaluate_on_grid(grid_eval, internal_grid_x, internal_grid_y, internal_grid_z, strides);
     }
+  }
+
+  void on_grid_into(std::array<double *, 3> grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    _evaluate_on_grid(grid_eval, grid_x, grid_y, grid_z, strides);
+  }
+
+  void on_grid_into(std::array<double *, 3> grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    _evaluate_on_grid(grid_eval, shape, reference_point, increment, strides);
+  }
+
+  // Single precision versions of on_grid and on_grid_into. The model is evaluated in double precision (in slabs, 
+  // see evaluate_in_slabs) and rounded, only the output grid is float, e.g. to halve the memory of large grids.
+  std::array<float *, 3> on_grid_float()
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    std::array<float *, 3> grid_eval = allocate_float_memory(internal_shape);
+    on_grid_into(grid_eval);
     return grid_eval;
   }
 
-  std::array<double *, 3> on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, int seed = 0)
+  std::array<float *, 3> on_grid_float(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
   {
-    std::array<int, 3> shp = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
-    std::array<double *, 3> grid_eval = allocate_memory(shp);
-    evaluate_function_on_grid<vector, std::array<double *, 3>>(grid_eval, grid_x, grid_y, grid_z,
-                                      [this](double xx, double yy, double zz)
-                                      { return at_position(xx, yy, zz); });
+    std::array<float *, 3> grid_eval = allocate_float_memory({(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()});
+    on_grid_into(grid_eval, grid_x, grid_y, grid_z);
     return grid_eval;
   }
 
-  std::array<double *, 3> on_grid(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, int seed = 0)
+  std::array<float *, 3> on_grid_float(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
+  {
+    std::array<float *, 3> grid_eval = allocate_float_memory(shape);
+    on_grid_into(grid_eval, shape, reference_point, increment);
+    return grid_eval;
+  }
+
+  void on_grid_into(std::array<float *, 3> grid_eval, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    if (regular_grid)
+    {
+      on_grid_into(grid_eval, internal_shape, internal_ref_point, internal_increment, strides);
+    }
+    else
+    {
+      on_grid_into(grid_eval, internal_grid_x, internal_grid_y, internal_grid_z, strides);
+    }
+  }
+
+  void on_grid_into(std::array<float *, 3> grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    const std::array<int, 3> shape = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    evaluate_in_slabs(grid_eval, shape, strides, [&](std::array<double *, 3> slab, const int i0, const int n)
+                      { _evaluate_on_grid(slab, std::vector<double>(grid_x.begin() + i0, grid_x.begin() + i0 + n), grid_y, grid_z, {0, 0, 0}); });
+  }
+
+  void on_grid_into(std::array<float *, 3> grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    evaluate_in_slabs(grid_eval, shape, strides, [&](std::array<double *, 3> slab, const int i0, const int n)
+                      { _evaluate_on_grid(slab, {n, shape[1], shape[2]}, {reference_point[0] + i0*increment[0], reference_point[1], reference_point[2]}, increment, {0, 0, 0}); });
+  }
+
+  // The model evaluated once on a regular grid, for interpolated evaluations at many positions (see GridInterpolator), 
+  // e.g. of expensive models along lines of sight. Positions outside of the grid take the values at its faces.
+  std::shared_ptr<GridInterpolator> tabulate(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const InterpolationKernel kernel = InterpolationKernel::trilinear, const int brick_size = 8)
   {
     std::array<double *, 3> grid_eval = allocate_memory(shape);
-    evaluate_function_on_grid<vector, std::array<double *, 3>>(grid_eval, shape, reference_point, increment,
-                                      [this](double xx, double yy, double zz)
-                                      { return at_position(xx, yy, zz); });
+    std::shared_ptr<GridInterpolator> interpolator;
+    try
+    {
+      on_grid_into(grid_eval, shape, reference_point, increment);
+      interpolator = std::make_shared<GridInterpolator>(grid_eval, shape, reference_point, increment, kernel, GridBoundary::clamp, brick_size);
+    }
+    catch (...)
+    {
+      free_memory(grid_eval);
+      throw;
+    }
+    free_memory(grid_eval);
+    return interpolator;
+  }
+
+  // -----Linear parameter basis-----
+  // Parameters the model depends on linearly, B = B_0 + sum_a p_a B_a with B_0 and the B_a independent of all p_a, 
+  // given as pairs of name and member. Models with such amplitude parameters override this, by default there are none.
+  virtual std::vector<std::pair<std::string, number *>> linear_parameters()
+  {
+    return {};
+  }
+
+  // Values of all other parameters the field depends on (e.g. scale heights and switches), the basis is only valid as long as they 
+  // do not change. Models with linear parameters override this.
+  virtual std::vector<double> nonlinear_parameter_values() const
+  {
+    return {};
+  }
+
+  std::vector<std::string> linear_parameter_names()
+  {
+    std::vector<std::string> names;
+    for (const auto &par : linear_parameters())
+    {
+      names.push_back(par.first);
+    }
+    return names;
+  }
+
+  // Evaluate B_0 and the B_a on a grid and keep them (n+1 grid evaluations for n linear parameters). Afterwards on_linear_basis 
+  // returns the field on this grid for the current values of the linear parameters as weighted sum of the kept grids. 
+  // The basis has to be rebuilt after any other parameter has been changed, on_linear_basis throws a LinearBasisException otherwise.
+  void build_linear_basis()
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    _build_linear_basis(internal_shape, [this]()
+                        { return on_grid(); });
+  }
+
+  void build_linear_basis(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
+  {
+    std::array<int, 3> shp = {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    _build_linear_basis(shp, [&]()
+                        { return on_grid(grid_x, grid_y, grid_z); });
+  }
+
+  void build_linear_basis(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
+  {
+    _build_linear_basis(shape, [&]()
+                        { return on_grid(shape, reference_point, increment); });
+  }
+
+  bool has_linear_basis() const
+  {
+    return linear_basis != nullptr;
+  }
+
+  std::array<int, 3> linear_basis_shape() const
+  {
+    if (not linear_basis)
+    {
+      throw LinearBasisException();
+    }
+    return linear_basis->shape;
+  }
+
+  void clear_linear_basis()
+  {
+    linear_basis.reset();
+  }
+
+  std::array<double *, 3> on_linear_basis()
+  {
+    check_linear_basis();
+    std::array<double *, 3> grid_eval = allocate_memory(linear_basis->shape);
+    on_linear_basis_into(grid_eval);
     return grid_eval;
   }
 
-#if autodiff_FOUND
+  // Same as on_linear_basis, into memory owned by the caller (see on_grid_into for strides)
+  void on_linear_basis_into(std::array<double *, 3> grid_eval, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0})
+  {
+    check_linear_basis();
+    const std::vector<double> weights = linear_parameter_values();
+    for (int c = 0; c < 3; ++c)
+    {
+      std::vector<const double *> component;
+      for (size_t e = c; e < linear_basis->grids.size(); e += 3)
+      {
+        component.push_back(linear_basis->grids[e]);
+      }
+      weighted_grid_sum(grid_eval[c], component, weights, linear_basis->shape, strides);
+    }
+  }
+
+protected:
+  std::shared_ptr<LinearParameterBasis> linear_basis;
+
+  // The basis exists and was built for the current values of the nonlinear parameters (it may be shared with a copy of the model)
+  void check_linear_basis() const
+  {
+    if (not linear_basis)
+    {
+      throw LinearBasisException();
+    }
+    if (nonlinear_parameter_values() != linear_basis->nonlinear_values)
+    {
+      throw LinearBasisException("Nonlinear parameters changed since build_linear_basis, rebuild the linear parameter basis.");
+    }
+  }
+
+  std::vector<double> linear_parameter_values()
+  {
+    std::vector<double> values;
+    for (const auto &par : linear_parameters())
+    {
+      values.push_back(static_cast<double>(*par.second));
+    }
+    return values;
+  }
 
-  Eigen::MatrixXd _filter_diff(Eigen::MatrixXd inp) const
+  // Evaluates B_0 with all linear parameters set to zero, and each B_a with p_a set to one minus B_0. 
+  // The parameter values are restored afterwards, also if an evaluation throws.
+  template <typename EVAL>
+  void _build_linear_basis(const std::array<int, 3> &shp, EVAL &&eval)
   {
-    if (active_diff.size() != all_diff.size())
+    std::vector<std::pair<std::string, number *>> parameters = linear_parameters();
+    std::vector<number> values;
+    for (auto &par : parameters)
     {
-      std::vector<int> i_to_keep;
-      for (std::string s : active_diff)
+      values.push_back(*par.second);
+      *par.second = 0.;
+    }
+    auto restore = [&]()
+    {
+      for (size_t a = 0; a < parameters.size(); ++a)
       {
-        if (auto search = all_diff.find(s); search != all_diff.end())
+        *parameters[a].second = values[a];
+      }
+    };
+    auto basis = std::make_shared<LinearParameterBasis>();
+    basis->shape = shp;
+    basis->nonlinear_values = nonlinear_parameter_values();
+    try
+    {
+      push_grid(basis->grids, eval());
+      for (auto &par : parameters)
+      {
+        *par.second = 1.;
+        push_grid(basis->grids, eval());
+        *par.second = 0.;
+        for (size_t c = 0; c < 3; ++c)
         {
-          int index = std::distance(all_diff.begin(), search);
-          i_to_keep.push_back(index);
+          double *grid = basis->grids[basis->grids.size() - 3 + c];
+          weighted_grid_sum(grid, {grid, basis->grids[c]}, {-1.}, shp);
         }
       }
-      return inp(Eigen::all, i_to_keep);
     }
-    return inp;
+    catch (...)
+    {
+      restore();
+      throw;
+    }
+    restore();
+    linear_basis = basis;
+  }
+
+  static void push_grid(std::vector<double *> &grids, std::array<double *, 3> grid)
+  {
+    grids.insert(grids.end(), grid.begin(), grid.end());
+  }
+
+public:
+#if autodiff_FOUND
+  // Number of parameters derivatives are computed for, i.e. the entries of active_diff that are differentiable parameters of the model
+  virtual size_t n_active_diff() const
+  {
+    return 0;
+  }
+
+  // Derivatives with respect to the parameters in active_diff on a grid, returned as C-contiguous array of shape 
+  // (n_active_diff(), 3, nx, ny, nz). The memory is allocated with allocate_grid_memory. Implemented by RegularVectorFieldModel.
+  virtual double *derivative_on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
+  {
+    throw NotImplementedException();
+  }
+
+  double *derivative_on_grid(const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
+  {
+    const std::array<std::vector<double>, 3> grid = grid_coordinates(shape, reference_point, increment);
+    return derivative_on_grid(grid[0], grid[1], grid[2]);
+  }
+
+  double *derivative_on_grid()
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    if (regular_grid)
+    {
+      return derivative_on_grid(internal_shape, internal_ref_point, internal_increment);
+    }
+    return derivative_on_grid(internal_grid_x, internal_grid_y, internal_grid_z);
+  }
+
+  // Gradient of an objective L, which is a sum over the grid, with respect to the parameters in active_diff. 
+  // adjoint holds dL/dB on the grid (one C-contiguous grid per component), the result is J^T adjoint accumulated over all voxels, 
+  // without storing the Jacobian of the grid. Implemented by RegularVectorFieldModel.
+  virtual Eigen::VectorXd gradient_on_grid(const std::array<const double *, 3> & adjoint, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z)
+  {
+    throw NotImplementedException();
+  }
+
+  Eigen::VectorXd gradient_on_grid(const std::array<const double *, 3> & adjoint, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment)
+  {
+    const std::array<std::vector<double>, 3> grid = grid_coordinates(shape, reference_point, increment);
+    return gradient_on_grid(adjoint, grid[0], grid[1], grid[2]);
   }
 
+  Eigen::VectorXd gradient_on_grid(const std::array<const double *, 3> & adjoint)
+  {
+    if (not initialized_with_grid)
+    {
+      throw GridException();
+    }
+    if (regular_grid)
+    {
+      return gradient_on_grid(adjoint, internal_shape, internal_ref_point, internal_increment);
+    }
+    return gradient_on_grid(adjoint, internal_grid_x, internal_grid_y, internal_grid_z);
+  }
 #endif
 };
 
+// The model classes derive from the following two templates, passing themselves as template argument (CRTP). 
+// This way the grid loop calls the at_position of the concrete model directly (no virtual call, no std::function), 
+// so the compiler can inline the model into the loop. The loop is instantiated in the source file of each model 
+// (see the explicit instantiations at the end of the source files), where the model body is visible.
+
+template <typename MODEL>
+class RegularScalarFieldModel : public RegularScalarField
+{
+protected:
+  void _evaluate_on_grid(double *grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides) override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    evaluate_function_on_grid<double, double *>(grid_eval, shape, reference_point, increment, [&model](double xx, double yy, double zz)
+                                      { return model.MODEL::at_position(xx, yy, zz); }, strides);
+  }
+
+  void _evaluate_on_grid(double *grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides) override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    evaluate_function_on_grid<double, double *>(grid_eval, grid_x, grid_y, grid_z, [&model](double xx, double yy, double zz)
+                                      { return model.MODEL::at_position(xx, yy, zz); }, strides);
+  }
+
+public:
+  using RegularScalarField ::RegularScalarField;
+
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, double *out) const override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    evaluate_function_at_positions<double, double *>(out, x, y, z, n, [&model](double xx, double yy, double zz)
+                                               { return model.MODEL::at_position(xx, yy, zz); });
+  }
+
+#if autodiff_FOUND
+protected:
+  // active_diff of the model resolved to member pointers, rebuilt only when active_diff changes
+  std::set<std::string> seeded_diff;
+  std::vector<number MODEL::*> seeded_parameters;
+
+  void _update_seeded_parameters(const std::vector<std::pair<std::string, number MODEL::*>> &parameters)
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    if (seeded_diff == model.active_diff)
+    {
+      return;
+    }
+    seeded_parameters.clear();
+    for (const std::pair<std::string, number MODEL::*> &parameter : parameters)
+    {
+      if (model.active_diff.count(parameter.first) > 0)
+      {
+        seeded_parameters.push_back(parameter.second);
+      }
+    }
+    seeded_diff = model.active_diff;
+  }
+
+  // Forward mode derivative with respect to the parameters in active_diff, in the order of parameters. 
+  // parameters lists the names in all_diff with the model members, in the order in which the model declares them 
+  // (the columns of derivative()), eval evaluates the model with dual numbers. 
+  // Only the active parameters are seeded, so the cost scales with the size of active_diff, not of all_diff.
+  template <typename F>
+  Eigen::VectorXd _active_jacobian(const std::vector<std::pair<std::string, number MODEL::*>> &parameters, F eval)
+  {
+    _update_seeded_parameters(parameters);
+    MODEL &model = static_cast<MODEL &>(*this);
+    Eigen::VectorXd jac(seeded_parameters.size());
+    for (size_t j = 0; j < seeded_parameters.size(); ++j)
+    {
+      number &par = model.*seeded_parameters[j];
+      par[1] = 1.;
+      number val = eval();
+      par[1] = 0.;
+      jac(j) = val[1];
+    }
+    return jac;
+  }
+
+  // Calls line(model, i, j) for every line along the last axis of the grid, distributed over the grid threads like for_each_grid_line. 
+  // derivative() seeds the parameters of the model it is called on, hence every thread differentiates its own copy of the model.
+  template <typename LINEFUNC>
+  void _for_each_derivative_line(const std::array<int, 3> &shp, LINEFUNC &&line)
+  {
+    std::vector<MODEL> models(grid_thread_count(), static_cast<const MODEL &>(*this));
+    for_each_grid_line(shp, [&](const int i, const int j)
+                       {
+#ifdef _OPENMP
+      MODEL &model = models[omp_get_thread_num()];
+#else
+      MODEL &model = models[0];
 #endif
+      line(model, i, j); });
+  }
+
+public:
+  using RegularScalarField::derivative_on_grid;
+  using RegularScalarField::gradient_on_grid;
+
+  size_t n_active_diff() const override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    return std::count_if(model.active_diff.begin(), model.active_diff.end(), [&model](const std::string &name)
+                         { return model.all_diff.count(name) > 0; });
+  }
+
+  double *derivative_on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z) override
+  {
+    const std::array<int, 3> shp{(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    const size_t gsz = grid_size(shp);
+    const size_t nact = n_active_diff();
+    double *grid_eval = allocate_grid_memory(nact * gsz);
+    _for_each_derivative_line(shp, [&](MODEL &model, const int i, const int j)
+                              {
+      const size_t n = (static_cast<size_t>(i) * shp[1] + j) * shp[2];
+      for (int k = 0; k < shp[2]; k++)
+      {
+        Eigen::VectorXd jac = model.MODEL::derivative(grid_x[i], grid_y[j], grid_z[k]);
+        for (size_t a = 0; a < nact; ++a)
+        {
+          grid_eval[a * gsz + n + k] = jac(a);
+        }
+      } });
+    return grid_eval;
+  }
+
+  // The voxels are summed per grid line first and the lines in a fixed order afterwards, 
+  // so the result does not depend on the number of threads. Voxels with vanishing adjoint are skipped.
+  Eigen::VectorXd gradient_on_grid(const double * adjoint, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z) override
+  {
+    const std::array<int, 3> shp{(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    const size_t nact = n_active_diff();
+    Eigen::MatrixXd line_sums = Eigen::MatrixXd::Zero(nact, static_cast<size_t>(shp[0]) * shp[1]);
+    _for_each_derivative_line(shp, [&](MODEL &model, const int i, const int j)
+                              {
+      const size_t l = static_cast<size_t>(i) * shp[1] + j;
+      const size_t n = l * shp[2];
+      for (int k = 0; k < shp[2]; k++)
+      {
+        const double v = adjoint[n + k];
+        if (v == 0.)
+        {
+          continue;
+        }
+        Eigen::VectorXd jac = model.MODEL::derivative(grid_x[i], grid_y[j], grid_z[k]);
+        line_sums.col(l) += v * jac;
+      } });
+    return line_sums.rowwise().sum();
+  }
+#endif
+};
+
+template <typename MODEL>
+class RegularVectorFieldModel : public RegularVectorField
+{
+protected:
+  void _evaluate_on_grid(std::array<double *, 3> grid_eval, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, const std::array<std::ptrdiff_t, 3> &strides) override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    evaluate_function_on_grid<vector_t<double>, std::array<double *, 3>>(grid_eval, shape, reference_point, increment, [&model](double xx, double yy, double zz)
+                                      { return model.MODEL::at_position(xx, yy, zz); }, strides);
+  }
+
+  void _evaluate_on_grid(std::array<double *, 3> grid_eval, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const std::array<std::ptrdiff_t, 3> &strides) override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    evaluate_function_on_grid<vector_t<double>, std::array<double *, 3>>(grid_eval, grid_x, grid_y, grid_z, [&model](double xx, double yy, double zz)
+                                      { return model.MODEL::at_position(xx, yy, zz); }, strides);
+  }
+
+public:
+  using RegularVectorField ::RegularVectorField;
+
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, std::array<double *, 3> out) const override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    evaluate_function_at_positions<vector_t<double>, std::array<double *, 3>>(out, x, y, z, n, [&model](double xx, double yy, double zz)
+                                                               { return model.MODEL::at_position(xx, yy, zz); });
+  }
+
+#if autodiff_FOUND
+protected:
+  // active_diff of the model resolved to member pointers, rebuilt only when active_diff changes
+  std::set<std::string> seeded_diff;
+  std::vector<number MODEL::*> seeded_parameters;
+
+  void _update_seeded_parameters(const std::vector<std::pair<std::string, number MODEL::*>> &parameters)
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    if (seeded_diff == model.active_diff)
+    {
+      return;
+    }
+    seeded_parameters.clear();
+    for (const std::pair<std::string, number MODEL::*> &parameter : parameters)
+    {
+      if (model.active_diff.count(parameter.first) > 0)
+      {
+        seeded_parameters.push_back(parameter.second);
+      }
+    }
+    seeded_diff = model.active_diff;
+  }
+
+  // Forward mode derivative with respect to the parameters in active_diff, in the order of parameters. 
+  // parameters lists the names in all_diff with the model members, in the order in which the model declares them 
+  // (the columns of derivative()), eval evaluates the model with dual numbers. 
+  // Only the active parameters are seeded, so the cost scales with the size of active_diff, not of all_diff.
+  template <typename F>
+  Eigen::MatrixXd _active_jacobian(const std::vector<std::pair<std::string, number MODEL::*>> &parameters, F eval)
+  {
+    _update_seeded_parameters(parameters);
+    MODEL &model = static_cast<MODEL &>(*this);
+    Eigen::MatrixXd jac(3, seeded_parameters.size());
+    for (size_t j = 0; j < seeded_parameters.size(); ++j)
+    {
+      number &par = model.*seeded_parameters[j];
+      par[1] = 1.;
+      vector val = eval();
+      par[1] = 0.;
+      for (int i = 0; i < 3; ++i)
+      {
+        jac(i, j) = val[i][1];
+      }
+    }
+    return jac;
+  }
+
+  // Calls line(model, i, j) for every line along the last axis of the grid, distributed over the grid threads like for_each_grid_line. 
+  // derivative() seeds the parameters of the model it is called on, hence every thread differentiates its own copy of the model.
+  template <typename LINEFUNC>
+  void _for_each_derivative_line(const std::array<int, 3> &shp, LINEFUNC &&line)
+  {
+    std::vector<MODEL> models(grid_thread_count(), static_cast<const MODEL &>(*this));
+    for_each_grid_line(shp, [&](const int i, const int j)
+                       {
+#ifdef _OPENMP
+      MODEL &model = models[omp_get_thread_num()];
+#else
+      MODEL &model = models[0];
+#endif
+      line(model, i, j); });
+  }
+
+public:
+  using RegularVectorField::derivative_on_grid;
+  using RegularVectorField::gradient_on_grid;
+
+  size_t n_active_diff() const override
+  {
+    const MODEL &model = static_cast<const MODEL &>(*this);
+    return std::count_if(model.active_diff.begin(), model.active_diff.end(), [&model](const std::string &name)
+                         { return model.all_diff.count(name) > 0; });
+  }
+
+  double *derivative_on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z) override
+  {
+    const std::array<int, 3> shp{(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    const size_t gsz = grid_size(shp);
+    const size_t nact = n_active_diff();
+    double *grid_eval = allocate_grid_memory(nact * 3 * gsz);
+    _for_each_derivative_line(shp, [&](MODEL &model, const int i, const int j)
+                              {
+      const size_t n = (static_cast<size_t>(i) * shp[1] + j) * shp[2];
+      for (int k = 0; k < shp[2]; k++)
+      {
+        Eigen::MatrixXd jac = model.MODEL::derivative(grid_x[i], grid_y[j], grid_z[k]);
+        for (size_t a = 0; a < nact; ++a)
+        {
+          for (int c = 0; c < 3; ++c)
+          {
+            grid_eval[(a * 3 + c) * gsz + n + k] = jac(c, a);
+          }
+        }
+      } });
+    return grid_eval;
+  }
+
+  // The voxels are summed per grid line first and the lines in a fixed order afterwards, 
+  // so the result does not depend on the number of threads. Voxels with vanishing adjoint are skipped.
+  Eigen::VectorXd gradient_on_grid(const std::array<const double *, 3> & adjoint, const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z) override
+  {
+    const std::array<int, 3> shp{(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()};
+    const size_t nact = n_active_diff();
+    Eigen::MatrixXd line_sums = Eigen::MatrixXd::Zero(nact, static_cast<size_t>(shp[0]) * shp[1]);
+    _for_each_derivative_line(shp, [&](MODEL &model, const int i, const int j)
+                              {
+      const size_t l = static_cast<size_t>(i) * shp[1] + j;
+      const size_t n = l * shp[2];
+      for (int k = 0; k < shp[2]; k++)
+      {
+        const Eigen::Vector3d v(adjoint[0][n + k], adjoint[1][n + k], adjoint[2][n + k]);
+        if (v.isZero(0.))
+        {
+          continue;
+        }
+        Eigen::MatrixXd jac = model.MODEL::derivative(grid_x[i], grid_y[j], grid_z[k]);
+        line_sums.col(l) += jac.transpose() * v;
+      } });
+    return line_sums.rowwise().sum();
+  }
+#endif
+};
+
+#endif
\ No newline at end of file
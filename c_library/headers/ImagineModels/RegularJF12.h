@@ -8,17 +8,18 @@
 
 #include "RegularField.h"
 
-class JF12MagneticField : public RegularVectorField
+class JF12MagneticField : public RegularVectorFieldModel<JF12MagneticField>
 {
 protected:
-  vector _at_position(const double &x, const double &y, const double &z, const JF12MagneticField &p) const;
+  template <typename T>
+  vector_t<T> _at_position(const double &x, const double &y, const double &z, const JF12MagneticField &p) const;
 
 #if autodiff_FOUND
   Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, JF12MagneticField &p) const;
 #endif
 
 public:
-  using RegularVectorField ::RegularVectorField;
+  using RegularVectorFieldModel<JF12MagneticField>::RegularVectorFieldModel;
 
   // define fixed parameters
   const double Rmax = 20;   // outer boundary of GMF
@@ -29,7 +30,7 @@ public:
   const double rmin = 5.;  // outer boundary of the molecular ring region
   const double rcent = 3.; // inner boundary of the molecular ring region (field is
                            // zero within this region)
-  const number f[8] = {
+  const double f[8] = {
       0.130, 0.165, 0.094, 0.122,
       0.13, 0.118, 0.084, 0.156}; // fractions of circumference spanned by each
                                   // spiral, sums to unity
@@ -62,6 +63,18 @@ public:
   number Xtheta_const = 49.;
   number rpc_X = 4.8;
   number r0_X = 2.9;
+
+  // the field is linear in the amplitudes of the disk, the toroidal halo and the X-field (b_arm_8 is a linear combination of the others)
+  std::vector<std::pair<std::string, number *>> linear_parameters() override
+  {
+    return {{"b_arm_1", &b_arm_1}, {"b_arm_2", &b_arm_2}, {"b_arm_3", &b_arm_3}, {"b_arm_4", &b_arm_4}, {"b_arm_5", &b_arm_5}, {"b_arm_6", &b_arm_6}, {"b_arm_7", &b_arm_7}, {"b_ring", &b_ring}, {"Bn", &Bn}, {"Bs", &Bs}, {"B0_X", &B0_X}};
+  }
+
+  std::vector<double> nonlinear_parameter_values() const override
+  {
+    return {static_cast<double>(h_disk), static_cast<double>(w_disk), static_cast<double>(do_halo), static_cast<double>(rn), static_cast<double>(rs), 
+            static_cast<double>(wh), static_cast<double>(z0), static_cast<double>(do_X), static_cast<double>(Xtheta_const), static_cast<double>(rpc_X), static_cast<double>(r0_X)};
+  }
   
 #if autodiff_FOUND
   const std::set<std::string> all_diff{"b_arm_1", "b_arm_2", "b_arm_3", "b_arm_4", "b_arm_5", "b_arm_6", "b_arm_7", "b_ring", "h_disk", "w_disk", "Bn", "Bs", "rn", "rs", "wh", "z0", "B0_X", "Xtheta_const", "rpc_X", "r0_X"};
@@ -73,10 +86,12 @@ public:
   }
 #endif
 
-  vector at_position(const double &x, const double &y, const double &z) const
+  vector_t<double> at_position(const double &x, const double &y, const double &z) const
   {
-    return _at_position(x, y, z, *this);
+    return _at_position<double>(x, y, z, *this);
   }
 };
 
+extern template class RegularVectorFieldModel<JF12MagneticField>;
+
 #endif
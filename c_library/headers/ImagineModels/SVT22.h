@@ -8,17 +8,18 @@
 
 #include "RegularField.h"
 
-class SVT22MagneticField : public RegularVectorField
+class SVT22MagneticField : public RegularVectorFieldModel<SVT22MagneticField>
 {
 protected:
-  vector _at_position(const double &x, const double &y, const double &z, const SVT22MagneticField &p) const;
+  template <typename T>
+  vector_t<T> _at_position(const double &x, const double &y, const double &z, const SVT22MagneticField &p) const;
 
 #if autodiff_FOUND
   Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, SVT22MagneticField &p) const;
 #endif
 
 public:
-  using RegularVectorField ::RegularVectorField;
+  using RegularVectorFieldModel<SVT22MagneticField>::RegularVectorFieldModel;
 
   bool do_halo = true;
 
@@ -39,10 +40,12 @@ public:
   }
 #endif
 
-  vector at_position(const double &x, const double &y, const double &z) const
+  vector_t<double> at_position(const double &x, const double &y, const double &z) const
   {
-    return _at_position(x, y, z, *this);
+    return _at_position<double>(x, y, z, *this);
   }
 };
 
+extern template class RegularVectorFieldModel<SVT22MagneticField>;
+
 #endif
@@ -11,16 +11,17 @@
 
 // StanevBSS (HMR) see https://arxiv.org/abs/astro-ph/9607086
 
-class StanevBSSMagneticField : public RegularVectorField  {
+class StanevBSSMagneticField : public RegularVectorFieldModel<StanevBSSMagneticField>  {
     protected:
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const StanevBSSMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const StanevBSSMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, StanevBSSMagneticField &p) const;
 #endif
     public:
-        using RegularVectorField :: RegularVectorField;
+        using RegularVectorFieldModel<StanevBSSMagneticField>::RegularVectorFieldModel;
 
         double b_r_max = 20.; // kpc
         double b_r_min = 4.; // kpc
@@ -35,8 +36,8 @@ protected:
         number b_phi0 = M_PI; // radians
     
 #if autodiff_FOUND
-    const std::set<std::string> all_diff{"b_Rsun", "b_b0", "b_z0", "b_r0", "b_p", "b_phi0"};
-    std::set<std::string> active_diff{"b_Rsun", "b_b0", "b_z0", "b_r0", "b_p", "b_phi0"};
+    const std::set<std::string> all_diff{"b_Rsun", "b_z01", "b_z02", "b_z0_border", "b_r0", "b_p", "b_phi0"};
+    std::set<std::string> active_diff{"b_Rsun", "b_z01", "b_z02", "b_z0_border", "b_r0", "b_p", "b_phi0"};
 
     Eigen::MatrixXd derivative(const double &x, const double &y, const double &z)
     {
@@ -44,10 +45,12 @@ protected:
     }
 #endif
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
  };
 
- #endif
\ No newline at end of file
+extern template class RegularVectorFieldModel<StanevBSSMagneticField>;
+
+#endif
\ No newline at end of file
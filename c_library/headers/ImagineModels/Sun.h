@@ -11,16 +11,17 @@
 //Sun et al. A&A V.477 2008 ASS+RING model magnetic field
 
 
-class SunMagneticField : public RegularVectorField  {
+class SunMagneticField : public RegularVectorFieldModel<SunMagneticField>  {
     protected:
 
-    vector _at_position(const double &x, const double &y, const double &z, const SunMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const SunMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, SunMagneticField &p) const;
 #endif
     public:
-        using RegularVectorField :: RegularVectorField;
+        using RegularVectorFieldModel<SunMagneticField>::RegularVectorFieldModel;
 
         number b_Rsun = 8.5; 
         number b_R0 = 8.5;
@@ -45,9 +46,11 @@ class SunMagneticField : public RegularVectorField  {
         return _jac(x, y, z, *this);
     }
 #endif
-        vector at_position(const double &x, const double &y, const double &z) const {
-            return _at_position(x, y, z, *this);
+        vector_t<double> at_position(const double &x, const double &y, const double &z) const {
+            return _at_position<double>(x, y, z, *this);
         }
  };
 
- #endif
+extern template class RegularVectorFieldModel<SunMagneticField>;
+
+#endif
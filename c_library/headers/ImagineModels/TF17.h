@@ -9,16 +9,17 @@
 
 // Terral, Ferriere 2017 - Constraints from Faraday rotation on the magnetic field structure in the galactic halo, DOI: 10.1051/0004-6361/201629572, arXiv:1611.10222, implementation adapted from CRPRopa
 
-class TFMagneticField : public RegularVectorField
+class TFMagneticField : public RegularVectorFieldModel<TFMagneticField>
 {
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const TFMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const TFMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, TFMagneticField &p) const;
 #endif
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<TFMagneticField>::RegularVectorFieldModel;
 
     std::string activeDiskModel = "Ad1";
     const std::array<std::string, 3> possibleDiskModels{"Ad1", "Bd1", "Dd1"};
@@ -58,24 +59,32 @@ public:
         return _jac(x, y, z, *this);
     }
 #endif
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 
-    vector getDiskField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const;
+    template <typename T>
+    vector_t<T> getDiskField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const;
 
-    vector getHaloField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const;
+    template <typename T>
+    vector_t<T> getHaloField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const;
 
-    number azimuthalFieldComponent(const double &r, const double &z, const number &B_r, const number &B_z, const number &cp0, const TFMagneticField &p) const;
+    template <typename T>
+    T azimuthalFieldComponent(const double &r, const double &z, const T &B_r, const T &B_z, const T &cp0, const TFMagneticField &p) const;
 
-    number radialFieldScale(const number &B1, const number &phi_star, const number &z1, const double &phi, const double &r, const double &z, const number &cp0, const TFMagneticField &p) const;
+    template <typename T>
+    T radialFieldScale(const T &B1, const T &phi_star, const T &z1, const double &phi, const double &r, const double &z, const T &cp0, const TFMagneticField &p) const;
 
-    number shiftedWindingFunction(const number &r, const double &z, const number &cp0, const TFMagneticField &p) const;
+    template <typename T>
+    T shiftedWindingFunction(const T &r, const double &z, const T &cp0, const TFMagneticField &p) const;
 
-    number zscale(const double &z, const TFMagneticField &p) const;
+    template <typename T>
+    T zscale(const double &z, const TFMagneticField &p) const;
 
     void set_params(std::string dtype, std::string htype);
 };
 
+extern template class RegularVectorFieldModel<TFMagneticField>;
+
 #endif
\ No newline at end of file
@@ -8,16 +8,17 @@
 #include "RegularField.h"
 
 // Tinyakov and Tkachev (TT) https://arxiv.org/abs/astro-ph/0111305, implementation of https://arxiv.org/pdf/astro-ph/0510444.pdf (Kachelriess et al.)
-class TTMagneticField : public RegularVectorField
+class TTMagneticField : public RegularVectorFieldModel<TTMagneticField>
 {
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const TTMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const TTMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, TTMagneticField &p) const;
 #endif
 public:
-    using RegularVectorField::RegularVectorField;
+    using RegularVectorFieldModel<TTMagneticField>::RegularVectorFieldModel;
 
     double b_r_max = 20.; // kpc
     double b_r_min = 4.;  // kpc
@@ -38,10 +39,12 @@ public:
     }
 #endif
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 };
 
+extern template class RegularVectorFieldModel<TTMagneticField>;
+
 #endif
@@ -32,6 +32,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define UNGERFARRAR_H
 
 #include <functional>
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <cassert>
@@ -40,17 +41,18 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "RegularField.h"
 #include "units.h"
 
-class UFMagneticField : public RegularVectorField
+class UFMagneticField : public RegularVectorFieldModel<UFMagneticField>
 {
 protected:
-  vector _at_position(const double &x, const double &y, const double &z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> _at_position(const double &x, const double &y, const double &z, const UFMagneticField &p) const;
 
 #if autodiff_FOUND
   Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, UFMagneticField &p) const;
 #endif
 
 public:
-  using RegularVectorField ::RegularVectorField;
+  using RegularVectorFieldModel<UFMagneticField>::RegularVectorFieldModel;
 
 public:
   /// model variations (see Tab.2 of UF23 paper)
@@ -266,13 +268,31 @@ public:
      }}, 
     };
 
-  vector at_position(const double &x, const double &y, const double &z) const
+  vector_t<double> at_position(const double &x, const double &y, const double &z) const
   {
-    return _at_position(x, y, z, *this);
+    return _at_position<double>(x, y, z, *this);
   }
 
   void set_parameters(const std::string &model_choice);
 
+  // the field is linear in the disk, toroidal and poloidal amplitudes for all model choices
+  std::vector<std::pair<std::string, number *>> linear_parameters() override
+  {
+    return {{"fDiskB1", &fDiskB1}, {"fDiskB2", &fDiskB2}, {"fDiskB3", &fDiskB3}, {"fPoloidalB", &fPoloidalB}, {"fToroidalBN", &fToroidalBN}, {"fToroidalBS", &fToroidalBS}};
+  }
+
+  // the model variation enters through its index in possibleModels
+  std::vector<double> nonlinear_parameter_values() const override
+  {
+    std::vector<double> values{static_cast<double>(std::find(possibleModels.begin(), possibleModels.end(), activeModel) - possibleModels.begin()), fMaxRadius};
+    for (const number *par : {&fPoloidalA, &fDiskH, &fDiskPhase1, &fDiskPhase2, &fDiskPhase3, &fDiskPitch, &fDiskW, &fPoloidalP, &fPoloidalR, &fPoloidalW, &fPoloidalZ, 
+                              &fStriation, &fToroidalR, &fToroidalW, &fToroidalZ, &fSpurCenter, &fSpurLength, &fSpurWidth, &fTwistingTime})
+    {
+      values.push_back(static_cast<double>(*par));
+    }
+    return values;
+  }
+
 
 #if autodiff_FOUND
   const std::set<std::string> all_diff{"fDiskB1", "fDiskB2", "fDiskB3", "fDiskH", "fDiskPhase1", "fDiskPhase2", "fDiskPhase3", "fDiskPitch", "fDiskW", "fPoloidalA", "fPoloidalB", "fPoloidalP", "fPoloidalR", "fPoloidalW", "fPoloidalZ", "fSpurCenter", "fSpurLength", "fSpurWidth", "fStriation", "fToroidalBN", "fToroidalBS", "fToroidalR", "fToroidalW", "fToroidalZ", "fTwistingTime"};
@@ -287,22 +307,31 @@ public:
 private:
 
   /// major field components
-  vector GetDiskField(const double &x, const double &y, const double &z, const UFMagneticField &p) const;
-  vector GetHaloField(const double &x, const double &y, const double &z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> GetDiskField(const double &x, const double &y, const double &z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> GetHaloField(const double &x, const double &y, const double &z, const UFMagneticField &p) const;
 
   /// sub-components depending on model type
   /// -- Sec. 5.2.2
-  vector GetSpiralField(const double x, const double y, const double z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> GetSpiralField(const double x, const double y, const double z, const UFMagneticField &p) const;
   /// -- Sec. 5.2.3
-  vector GetSpurField(const double x, const double y, const double z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> GetSpurField(const double x, const double y, const double z, const UFMagneticField &p) const;
   /// -- Sec. 5.3.1
-  vector GetToroidalHaloField(const double x, const double y, const double z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> GetToroidalHaloField(const double x, const double y, const double z, const UFMagneticField &p) const;
   /// -- Sec. 5.3.2
-  vector GetPoloidalHaloField(const double x, const double y, const double z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> GetPoloidalHaloField(const double x, const double y, const double z, const UFMagneticField &p) const;
   /// -- Sec. 5.3.3
-  vector GetTwistedHaloField(const double x, const double y, const double z, const UFMagneticField &p) const;
+  template <typename T>
+  vector_t<T> GetTwistedHaloField(const double x, const double y, const double z, const UFMagneticField &p) const;
 
   
 };
 
+extern template class RegularVectorFieldModel<UFMagneticField>;
+
 #endif
@@ -7,26 +7,35 @@
 #include "Field.h"
 #include "RegularField.h"
 
-class UniformMagneticField : public RegularVectorField
+class UniformMagneticField : public RegularVectorFieldModel<UniformMagneticField>
 {
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const UniformMagneticField &p) const
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const UniformMagneticField &p) const
     {
-        return vector{{p.bx, p.by, p.bz}};
+        return vector_t<T>{{T(p.bx), T(p.by), T(p.bz)}};
     }
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, UniformMagneticField &p) const
     {
-        return Eigen::MatrixXd::Identity(3, 3);
+        static const std::vector<std::pair<std::string, number UniformMagneticField::*>> parameters{
+            {"bx", &UniformMagneticField::bx}, {"by", &UniformMagneticField::by}, {"bz", &UniformMagneticField::bz}};
+        return p._active_jacobian(parameters, [&]()
+                                  { return p._at_position<number>(x, y, z, p); });
     }
 #endif
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<UniformMagneticField>::RegularVectorFieldModel;
 
     number bx = 0.;
     number by = 0.;
     number bz = 0.;
+
+    std::vector<std::pair<std::string, number *>> linear_parameters() override
+    {
+        return {{"bx", &bx}, {"by", &by}, {"bz", &bz}};
+    }
 #if autodiff_FOUND
     const std::set<std::string> all_diff{"bx", "by", "bz"};
     std::set<std::string> active_diff{"bx", "by", "bz"};
@@ -36,44 +45,52 @@ public:
         return _jac(x, y, z, *this);
     }
 #endif
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 };
 
 
-class UniformDensityField : public RegularScalarField
+class UniformDensityField : public RegularScalarFieldModel<UniformDensityField>
 {
 protected:
-    number _at_position(const double &x, const double &y, const double &z, const UniformDensityField &p) const
+    template <typename T>
+    T _at_position(const double &x, const double &y, const double &z, const UniformDensityField &p) const
     {
-        return p.n0;
+        return T(p.n0);
     }
 
 #if autodiff_FOUND
-    Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, UniformDensityField &p) const
+    Eigen::VectorXd _jac(const double &x, const double &y, const double &z, UniformDensityField &p) const
     {
-        return Eigen::MatrixXd::Identity(1, 1);
+        static const std::vector<std::pair<std::string, number UniformDensityField::*>> parameters{{"n0", &UniformDensityField::n0}};
+        return p._active_jacobian(parameters, [&]()
+                                  { return p._at_position<number>(x, y, z, p); });
     }
 #endif
 public:
-    using RegularScalarField ::RegularScalarField;
+    using RegularScalarFieldModel<UniformDensityField>::RegularScalarFieldModel;
 
     number n0 = 0.;
 
+    std::vector<std::pair<std::string, number *>> linear_parameters() override
+    {
+        return {{"n0", &n0}};
+    }
+
 #if autodiff_FOUND
     const std::set<std::string> all_diff{"n0"};
     std::set<std::string> active_diff{"n0"};
 
-    Eigen::MatrixXd derivative(const double &x, const double &y, const double &z)
+    Eigen::VectorXd derivative(const double &x, const double &y, const double &z)
     {
         return _jac(x, y, z, *this);
     }
 #endif
-    number at_position(const double &x, const double &y, const double &z) const
+    double at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 };
 
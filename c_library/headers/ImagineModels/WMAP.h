@@ -9,16 +9,17 @@
 
 // WMAP magnetic field
 
-class WMAPMagneticField : public RegularVectorField
+class WMAPMagneticField : public RegularVectorFieldModel<WMAPMagneticField>
 {
 protected:
-    vector _at_position(const double &x, const double &y, const double &z, const WMAPMagneticField &p) const;
+    template <typename T>
+    vector_t<T> _at_position(const double &x, const double &y, const double &z, const WMAPMagneticField &p) const;
 
 #if autodiff_FOUND
     Eigen::MatrixXd _jac(const double &x, const double &y, const double &z, WMAPMagneticField &p) const;
 #endif
 public:
-    using RegularVectorField ::RegularVectorField;
+    using RegularVectorFieldModel<WMAPMagneticField>::RegularVectorFieldModel;
 
     double b_r_max = 20.; // kpc
     double b_r_min = 3.;  // kpc
@@ -43,10 +44,12 @@ public:
     }
 #endif
 
-    vector at_position(const double &x, const double &y, const double &z) const
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const
     {
-        return _at_position(x, y, z, *this);
+        return _at_position<double>(x, y, z, *this);
     }
 };
 
+extern template class RegularVectorFieldModel<WMAPMagneticField>;
+
 #endif
\ No newline at end of file
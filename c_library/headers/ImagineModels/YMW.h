@@ -10,16 +10,17 @@
 #include "Field.h"
 #include "RegularField.h"
 
-class YMW16 : public RegularScalarField
+class YMW16 : public RegularScalarFieldModel<YMW16>
 {
 protected:
-  number _at_position(const double &x, const double &y, const double &z, const YMW16 &p) const;
+  template <typename T>
+  T _at_position(const double &x, const double &y, const double &z, const YMW16 &p) const;
 
 #if autodiff_FOUND
   Eigen::VectorXd _jac(const double &x, const double &y, const double &z, YMW16 &p) const;
 #endif
 public:
-  using RegularScalarField ::RegularScalarField;
+  using RegularScalarFieldModel<YMW16>::RegularScalarFieldModel;
 
   number r0 = 8.3;     // kpc, Galactic earth position
 
@@ -142,24 +143,35 @@ public:
   }
 #endif
 
-  auto _z_scaling(const double &rr, const number &k, const double &h0, const double &h1, const double &h2) const;
-  auto _cosh_scaling(const double &s, const number &a, const number &b = 0. ) const;
-
-  number thick(const double &zz, const double &rr, const YMW16 &p) const;
-  number thin(const double &zz, const double &rr, const YMW16 &p) const;
-  number spiral(const double &xx, const double &yy, const double &zz,
+  template <typename T>
+  auto _z_scaling(const double &rr, const T &k, const double &h0, const double &h1, const double &h2) const;
+  template <typename T>
+  auto _cosh_scaling(const double &s, const T &a, const T &b = 0. ) const;
+
+  template <typename T>
+  T thick(const double &zz, const double &rr, const YMW16 &p) const;
+  template <typename T>
+  T thin(const double &zz, const double &rr, const YMW16 &p) const;
+  template <typename T>
+  T spiral(const double &xx, const double &yy, const double &zz,
                 const double &rr, const YMW16 &p) const;
-  number galcen(const double &xx, const double &yy, const double &zz, const YMW16 &p) const;
-  number gum(const double &xx, const double &yy, const double &zz, const YMW16 &p) const;
-  number localbubble(const double &xx, const double &yy,
+  template <typename T>
+  T galcen(const double &xx, const double &yy, const double &zz, const YMW16 &p) const;
+  template <typename T>
+  T gum(const double &xx, const double &yy, const double &zz, const YMW16 &p) const;
+  template <typename T>
+  T localbubble(const double &xx, const double &yy,
                      const double &zz, const double &ll,
                      const double &Rlb, const YMW16 &p) const;
-  number nps(const double &xx, const double &yy, const double &zz, const YMW16 &p) const;
+  template <typename T>
+  T nps(const double &xx, const double &yy, const double &zz, const YMW16 &p) const;
 
-  number at_position(const double &x, const double &y, const double &z) const
+  double at_position(const double &x, const double &y, const double &z) const
   {
-    return _at_position(x, y, z, *this);
+    return _at_position<double>(x, y, z, *this);
   }
 };
 
+extern template class RegularScalarFieldModel<YMW16>;
+
 #endif
@@ -2,6 +2,7 @@
 #define EXCEPTION_H
 
 #include <stdexcept>
+#include <string>
 
 class GridException : public std::invalid_argument
 {
@@ -23,6 +24,14 @@ public:
 };
 
 
+class LinearBasisException : public std::logic_error
+{
+public:
+    LinearBasisException () : std::logic_error{"No linear parameter basis available, call build_linear_basis first."} {}
+    explicit LinearBasisException (const std::string &what) : std::logic_error{what} {}
+};
+
+
 class DivergenceException : public std::logic_error
 {
 public:
@@ -0,0 +1,97 @@
+#ifndef FFTWPLANCACHE_H
+#define FFTWPLANCACHE_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fftw3.h>
+
+#ifndef FFTW_THREADS_FOUND
+  #define FFTW_THREADS_FOUND 0
+#endif
+
+#ifndef FFTW_FLOAT_FOUND
+  #define FFTW_FLOAT_FOUND 0
+#endif
+
+// FFTW plans for the in-place transforms of padded real grids (see RandomField::allocate_memory), shared by all random fields.
+// Plans are created once per (shape, number of transforms, buffer alignment, direction, thread count, planning rigor) and are executed with the
+// new-array interface (fftw_execute_dft_r2c/c2r), so repeated realizations at a fixed shape never plan twice,
+// whatever buffer they are generated in. Planning is done on scratch buffers, hence also FFTW_MEASURE and FFTW_PATIENT
+// plans never overwrite the data of the caller.
+// Plans are kept until clear_fftw_plan_cache is called (the cache is never destroyed, like the grid memory pool).
+//
+// Optionally, the FFTW wisdom (the result of measure/patient planning) is kept in a file shared between processes: 
+// it is imported before the first plan is created, and every measure/patient plan adds its wisdom to the file. 
+// Access to the file is serialized by an advisory lock (flock on <file>.lock), so many workers may start at once.
+
+enum class FFTWPlanningRigor
+{
+  estimate, // FFTW_ESTIMATE, no measurements, fast planning
+  measure,  // FFTW_MEASURE, planning takes some seconds for large grids
+  patient   // FFTW_PATIENT, slow planning, occasionally faster transforms
+};
+
+// Plan for the in-place forward (real to complex) transform of a padded grid of (unpadded) shape shp.
+// buffer is only used to determine the alignment, it is not modified.
+fftw_plan fftw_r2c_plan(const std::array<int, 3> &shp, double *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+// Plan for the in-place backward (complex to real) transform, see fftw_r2c_plan.
+fftw_plan fftw_c2r_plan(const std::array<int, 3> &shp, double *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+// Plans for howmany transforms at once, of consecutive padded grids (the grid n starts at buffer + n*padded size),
+// as used for the components of random vector fields.
+fftw_plan fftw_r2c_many_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+fftw_plan fftw_c2r_many_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+// Plans for the out-of-core generation (see RandomField::on_grid_to_file), which splits the 3D transform of a grid of shape shp
+// into 2D transforms of x planes and 1D transforms along x.
+// In-place 2D transforms over (y, z) of howmany consecutive padded x planes (i.e. of a slab of a padded grid).
+fftw_plan fftw_r2c_planes_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+fftw_plan fftw_c2r_planes_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+// In-place complex transforms along x (length shp[0]) of a block of `lines` modes per x plane, stored x-major
+// (the mode m of plane i at buffer + 2*(i*lines + m)). direction is FFTW_FORWARD or FFTW_BACKWARD.
+fftw_plan fftw_c2c_lines_plan(const std::array<int, 3> &shp, const int lines, const int direction, double *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+#if FFTW_FLOAT_FOUND
+// Single precision (fftw3f) versions of the above, for the float grids of the random fields.
+// Their wisdom is kept in <wisdom file>.float.
+fftwf_plan fftwf_r2c_plan(const std::array<int, 3> &shp, float *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+fftwf_plan fftwf_c2r_plan(const std::array<int, 3> &shp, float *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+fftwf_plan fftwf_r2c_many_plan(const std::array<int, 3> &shp, const int howmany, float *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+
+fftwf_plan fftwf_c2r_many_plan(const std::array<int, 3> &shp, const int howmany, float *buffer, const FFTWPlanningRigor rigor = FFTWPlanningRigor::estimate, const int nthreads = 1);
+#endif
+
+// Whether the library is linked against the single precision FFTW (fftw3f), i.e. whether random fields can be generated as float grids.
+bool fftw_float_available();
+
+// Whether the library is linked against a threaded FFTW (fftw3_omp or fftw3_threads). 
+// Without, the thread count of the plans is ignored and all transforms run on a single thread.
+bool fftw_threads_available();
+
+// Destroy all cached plans.
+void clear_fftw_plan_cache();
+
+// Number of plans currently held in the cache.
+size_t fftw_plan_cache_size();
+
+// Path of the wisdom file, an empty path (the default, unless the environment variable IMAGINE_FFTW_WISDOM is set) disables it.
+void set_fftw_wisdom_file(const std::string &path);
+
+std::string fftw_wisdom_file();
+
+// Plan the transforms for the given (unpadded) grid shapes and store the wisdom in the wisdom file, 
+// e.g. once before starting many short-lived workers on the same grids. For every number of components 
+// (1 for scalar fields, 3 for the batched transforms of vector fields) the double precision transforms are planned, 
+// and the single precision ones if fftw3f is available.
+void generate_fftw_wisdom(const std::vector<std::array<int, 3>> &shapes, const FFTWPlanningRigor rigor = FFTWPlanningRigor::measure, const int nthreads = 1, 
+                          const std::vector<int> &components = {1, 3});
+
+#endif /* FFTWPLANCACHE_H */
@@ -23,6 +23,10 @@ class GaussianScalarField : public RandomScalarField {
 
     double calculate_fourier_sigma(const double &abs_k, const double &dk) const override;
 
+    std::optional<std::vector<double>> spectral_parameters() const override {
+        return std::vector<double>{spectral_offset, spectral_slope};
+    }
+
     double spatial_profile(const double &x, const double &y, const double &z) const override {
         return 1.;
     }; 
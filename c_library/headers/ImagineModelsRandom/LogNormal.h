@@ -9,6 +9,19 @@
 class LogNormalScalarField : public RandomScalarField {
   protected:
     bool DEBUG = false;
+
+    template <typename REAL>
+    void generate_log_normal(REAL* val, const std::array<int, 3> &grid_shape, const std::array<double, 3> &grid_increment, const int seed, REAL* out, const std::array<std::ptrdiff_t, 3> &strides);
+
+    // the rows [0, n) of the padded grid val, normalized, shifted by log_mean and exponentiated, written to out
+    template <typename REAL>
+    void exponentiate_slab(const REAL* val, REAL* out, const int n, const std::array<std::ptrdiff_t, 3> &st, const std::array<int, 3> &shp);
+
+    void finish_slab(const double* val, double* out, const int i0, const int n, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) override;
+
+    double finish_point(const double val, const double x, const double y, const double z) const override {
+      return std::exp(val + log_mean);
+    }
   public:
     using RandomScalarField :: RandomScalarField;
 
@@ -17,10 +30,18 @@ class LogNormalScalarField : public RandomScalarField {
     double spectral_offset = 1.;
     double spectral_slope = 2.;
 
-    void _on_grid(double* val, const std::array<int, 3> &grid_shape, const std::array<double, 3> &grid_zeropoint, const std::array<double, 3> &grid_increment, const int seed) override;
+    void _on_grid(double* val, const std::array<int, 3> &grid_shape, const std::array<double, 3> &grid_zeropoint, const std::array<double, 3> &grid_increment, const int seed, double* out, const std::array<std::ptrdiff_t, 3> &strides) override;
+
+#if FFTW_FLOAT_FOUND
+    void _on_grid(float* val, const std::array<int, 3> &grid_shape, const std::array<double, 3> &grid_zeropoint, const std::array<double, 3> &grid_increment, const int seed, float* out, const std::array<std::ptrdiff_t, 3> &strides) override;
+#endif
 
     double calculate_fourier_sigma(const double &abs_k, const double &dk) const override;
 
+    std::optional<std::vector<double>> spectral_parameters() const override {
+        return std::vector<double>{spectral_offset, spectral_slope};
+    }
+
     double spatial_profile(const double &x, const double &y, const double &z) const override {
         return 1.;
     }; 
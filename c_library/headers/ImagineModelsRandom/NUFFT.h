@@ -0,0 +1,75 @@
+#ifndef NUFFT_H
+#define NUFFT_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <fftw3.h>
+
+// Evaluation of the Fourier series of real grids at arbitrary positions, by a type 2 non-uniform FFT with a Gaussian kernel
+// (Dutt & Rokhlin 1993; Greengard & Lee 2004, "Accelerating the nonuniform fast Fourier transform").
+// The modes of a grid (the half spectrum of its in-place r2c transform) are divided by the Fourier transform of the kernel
+// and placed on a grid oversampled by a factor of two along each axis, which is transformed back to real space once
+// (by the caller, an in-place c2r transform of fine_shape, see RandomField::execute_nufft). The series at a position is then
+// the sum of the 2*width nearest values of the fine grid along each axis, weighted with the kernel, i.e. O(N log N + width^3) per position.
+// The relative error is about exp(-pi*width/sqrt(2)), the width is chosen from the tolerance (at most max_width).
+// Modes at the Nyquist frequency of an axis with an even number of voxels are split evenly between +N/2 and -N/2,
+// so that the series is real, and equals the (c2r transformed) grid at its voxels. In between, it is the trigonometric interpolation of the grid.
+class GaussianNUFFT
+{
+public:
+  static const int max_width = 16;
+
+  // For ncomp grids of the given shape (e.g. the components of a vector field)
+  GaussianNUFFT(const std::array<int, 3> &shape, const double tolerance, const int ncomp = 1);
+
+  GaussianNUFFT(const GaussianNUFFT &) = delete;
+  GaussianNUFFT &operator=(const GaussianNUFFT &) = delete;
+
+  ~GaussianNUFFT();
+
+  const std::array<int, 3> &fine_shape() const {
+    return fine;
+  }
+
+  int width() const {
+    return spread;
+  }
+
+  int components() const {
+    return ncomp;
+  }
+
+  // The padded fine grid of the component c, the components follow each other (for batched transforms)
+  double *fine_grid(const int c = 0) const {
+    return grid + c*fine_padded_size;
+  }
+
+  // Places the modes of the component c (layout of the in-place r2c transform of shape), divided by the Fourier transform of the kernel,
+  // on its fine grid, on nthreads threads. The remaining modes of the fine grid are set to zero.
+  void load_modes(const int c, const fftw_complex *modes, const int nthreads);
+
+  // The series of all components (once the fine grids are transformed) at the position u,
+  // in units of the increments of the grid relative to its reference point (the series is periodic, with the shape as period)
+  void interpolate(const std::array<double, 3> &u, double *values) const;
+
+private:
+  std::array<int, 3> shape;
+  std::array<int, 3> fine;
+  int ncomp;
+  int spread;
+  // variance of the kernel exp(-t^2/(4 tau)), in fine voxels
+  double tau;
+  size_t fine_padded_size;
+  double *grid = nullptr;
+
+  // factors of the modes of the grid along each axis (the inverse Fourier transform of the kernel, halved at the Nyquist frequency)
+  std::array<std::vector<double>, 3> deconvolution;
+  // exp(-t^2/(4 tau)) for t = -width + 1, ..., width, see interpolate
+  std::vector<double> kernel_offsets;
+
+  // The fine indices of the mode i of axis d (two at the Nyquist frequency of an even axis), returns their number
+  int fine_indices(const int d, const int i, std::array<int, 2> &idx) const;
+};
+
+#endif /* NUFFT_H */
@@ -0,0 +1,53 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstdint>
+#include <cmath>
+
+// Counter based random number generator Philox4x32-10 (Salmon et al. 2011, "Parallel random numbers: as easy as 1, 2, 3").
+// The output is a pure function of a 128 bit counter and a 64 bit key, hence every Fourier mode can draw its
+// random numbers from its own counter (the mode index), in any order and on any number of threads.
+
+class Philox4x32
+{
+public:
+  typedef std::array<uint32_t, 4> counter_type;
+  typedef std::array<uint32_t, 2> key_type;
+
+  static counter_type generate(counter_type ctr, key_type key)
+  {
+    ctr = round(ctr, key);
+    for (int r = 1; r < 10; ++r)
+    {
+      key[0] += 0x9E3779B9;
+      key[1] += 0xBB67AE85;
+      ctr = round(ctr, key);
+    }
+    return ctr;
+  }
+
+  // Two independent standard normal numbers for the given key and counter (Box-Muller transform of two 53 bit uniforms)
+  static std::array<double, 2> normal_pair(const uint64_t key, const uint64_t counter)
+  {
+    const counter_type out = generate({static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0, 0},
+                                      {static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32)});
+    // uniforms in (0, 1], so that the logarithm is finite
+    const double u1 = (static_cast<double>(((static_cast<uint64_t>(out[0]) << 32) | out[1]) >> 11) + 1.) * 0x1.0p-53;
+    const double u2 = (static_cast<double>(((static_cast<uint64_t>(out[2]) << 32) | out[3]) >> 11) + 1.) * 0x1.0p-53;
+    const double r = std::sqrt(-2. * std::log(u1));
+    const double phi = 2. * 3.141592653589793 * u2;
+    return {r * std::cos(phi), r * std::sin(phi)};
+  }
+
+private:
+  static counter_type round(const counter_type &ctr, const key_type &key)
+  {
+    const uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * ctr[0];
+    const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * ctr[2];
+    return {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(p1),
+            static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(p0)};
+  }
+};
+
+#endif /* PHILOX_H */
@@ -11,20 +11,281 @@
 #include <random>
 #include <memory>
 #include <initializer_list>
+#include <optional>
+#include <type_traits>
 
 #include "exceptions.h"
 #include "Field.h"
+#include "GridMemory.h"
+#include "GridInterpolator.h"
+#include "Philox.h"
+#include "FFTWPlanCache.h"
+#include "NUFFT.h"
 
 
+// The FFTW complex type of real grids of type REAL (double or float)
+template <typename REAL>
+using fftw_complex_of = typename std::conditional<std::is_same<REAL, float>::value, fftwf_complex, fftw_complex>::type;
+
+
+// Standard deviations of the Fourier modes of a grid. Sigma only depends on |k|, hence the modes i and shape[0] - i 
+// (and j and shape[1] - j) share one entry, and the table holds (shape[0]/2 + 1) x (shape[1]/2 + 1) x (shape[2]/2 + 1) values.
+struct FourierSigmaTable
+{
+  std::array<int, 3> shape;
+  std::array<double, 3> increment;
+  // the spectral parameters the table was computed with, see RandomField::spectral_parameters
+  std::optional<std::vector<double>> parameters;
+
+  std::array<int, 3> size;
+  std::vector<double> sigma;
+
+  double at(const int i, const int j, const int l) const
+  {
+    return line(i, j)[l];
+  }
+
+  // the standard deviations of the modes l = 0, ..., shape[2]/2 of the Fourier line (i, j)
+  const double *line(const int i, const int j) const
+  {
+    const int fi = std::min(i, shape[0] - i);
+    const int fj = std::min(j, shape[1] - j);
+    return sigma.data() + (static_cast<size_t>(fi) * size[1] + fj) * size[2];
+  }
+
+  bool matches(const std::array<int, 3> &shp, const std::array<double, 3> &inc, const std::optional<std::vector<double>> &par) const
+  {
+    return shape == shp && increment == inc && parameters.has_value() && parameters == par;
+  }
+};
+
+
+// Wave numbers of the Fourier modes of a grid along its axes, as they enter derivatives (the divergence): of all modes along x and y 
+// (negative above the Nyquist frequency), and of the modes 0, ..., shape[2]/2 of the real transforms along z. 
+// The wave vector of the mode (i, j, l) is (k[0][i], k[1][j], k[2][l]). The Nyquist mode of an even axis stands for +k_N and -k_N alike, 
+// its wave number is 0 (as for spectral first derivatives). So k of the mirror (-i, -j) of a mode of a real z plane is -k, 
+// and operations which are even in k (the projection of the divergence) keep the Hermitian symmetry of the modes.
+struct FourierWaveNumbers
+{
+  std::array<std::vector<double>, 3> k;
+
+  FourierWaveNumbers(const std::array<int, 3> &shp, const std::array<double, 3> &inc)
+  {
+    const std::array<int, 3> size{shp[0], shp[1], shp[2]/2 + 1};
+    for (int d = 0; d < 3; ++d)
+    {
+      k[d].resize(size[d]);
+      for (int i = 0; i < size[d]; ++i)
+      {
+        k[d][i] = i / (shp[d]*inc[d]);
+        if (d < 2 && i >= (shp[d] + 1) / 2)
+          k[d][i] -= 1. / inc[d];
+        if (2*i == shp[d])
+          k[d][i] = 0.;
+      }
+    }
+  }
+};
+
+
+// Work done by the realizations of a random field, see RandomField::generation_stats
+struct GenerationStats
+{
+  size_t realizations = 0;
+  // Full 3D transforms (forward or backward) of a grid, a batched transform of n grids counts n times. 
+  // The slab-wise transforms of on_grid_to_file are not counted.
+  size_t transforms = 0;
+
+  double transforms_per_realization() const
+  {
+    return realizations > 0 ? static_cast<double>(transforms) / realizations : 0.;
+  }
+};
+
+
+// Everything of a realization that does not depend on the seed, computed once by on_grid_many and shared by its realizations
+struct RealizationCache
+{
+  std::array<int, 3> shape;
+  std::array<double, 3> reference_point;
+  std::array<double, 3> increment;
+
+  // standard deviations of the Fourier modes
+  std::shared_ptr<const FourierSigmaTable> sigma;
+  // spatial profile on the (unpadded) grid
+  double *profile = nullptr;
+  // anisotropy direction on the (unpadded) grid, vector fields only
+  std::array<double *, 3> direction{{nullptr, nullptr, nullptr}};
+
+  RealizationCache(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) : shape(shp), reference_point(rpt), increment(inc) {}
+
+  RealizationCache(const RealizationCache &) = delete;
+  RealizationCache &operator=(const RealizationCache &) = delete;
+
+  ~RealizationCache()
+  {
+    free_grid_memory(profile);
+    for (double *d : direction)
+    {
+      free_grid_memory(d);
+    }
+  }
+
+  bool matches(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) const
+  {
+    return shape == shp && reference_point == rpt && increment == inc;
+  }
+};
+
 
 template<typename POSTYPE, typename GRIDTYPE>
 class RandomField : public Field<POSTYPE, GRIDTYPE>  {
 protected:
 
-  bool created_fftw_plans = false;
-  bool has_fftw_wisdom = false;
   bool no_profile = false;
 
+  // set while on_grid_many runs
+  const RealizationCache *realization_cache = nullptr;
+
+  // the sigma table of the last grid, kept as long as the spectral parameters do not change
+  std::shared_ptr<const FourierSigmaTable> sigma_table;
+
+  // The sigma table for the grid, from on_grid_many or the last call if still valid, otherwise newly computed
+  std::shared_ptr<const FourierSigmaTable> fourier_sigma_table(const std::array<int, 3> &shp, const std::array<double, 3> &inc);
+
+  // The cache of the running on_grid_many call, if it has been computed for this grid, otherwise nullptr
+  const RealizationCache *cached(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) const {
+    if (realization_cache != nullptr && realization_cache->matches(shp, rpt, inc)) {
+      return realization_cache;
+    }
+    return nullptr;
+  }
+
+  // counted by the transforms below and the generation of a realization
+  mutable GenerationStats stats;
+
+  // Fills the seed independent parts of the cache, child classes add their own (e.g. the anisotropy direction)
+  virtual void fill_realization_cache(RealizationCache &cache);
+
+  // Padded buffer owned by the field, reused between calls on the same grid
+  virtual GRIDTYPE get_workspace(const std::array<int, 3> &shp) = 0;
+
+  // Pointer to the realization n of an output holding consecutive unpadded grids (per component)
+  static double* realization_in(double* out, const size_t n, const size_t gs) {
+    return out + n*gs;
+  }
+
+  static std::array<double*, 3> realization_in(std::array<double*, 3> out, const size_t n, const size_t gs) {
+    return {out[0] + n*gs, out[1] + n*gs, out[2] + n*gs};
+  }
+
+  // Generates the realizations of on_grid_many, the realization n is written to output(n) and then passed to done(n, output(n))
+  template <typename OUTPUT, typename DONE>
+  void generate_many(const std::vector<int> &seeds, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, OUTPUT &&output, DONE &&done);
+
+  // In-place transforms of a padded grid, the plans are taken from the shared plan cache (see FFTWPlanCache.h)
+  void execute_r2c(double* val, const std::array<int, 3> &shp) const {
+    ++stats.transforms;
+    fftw_execute_dft_r2c(fftw_r2c_plan(shp, val, fftw_planning_rigor, fftw_thread_count()), val, reinterpret_cast<fftw_complex*>(val));
+  }
+
+  void execute_c2r(double* val, const std::array<int, 3> &shp) const {
+    ++stats.transforms;
+    fftw_execute_dft_c2r(fftw_c2r_plan(shp, val, fftw_planning_rigor, fftw_thread_count()), reinterpret_cast<fftw_complex*>(val), val);
+  }
+
+  // Batched transforms of howmany consecutive padded grids starting at val
+  void execute_r2c_many(double* val, const int howmany, const std::array<int, 3> &shp) const {
+    stats.transforms += howmany;
+    fftw_execute_dft_r2c(fftw_r2c_many_plan(shp, howmany, val, fftw_planning_rigor, fftw_thread_count()), val, reinterpret_cast<fftw_complex*>(val));
+  }
+
+  void execute_c2r_many(double* val, const int howmany, const std::array<int, 3> &shp) const {
+    stats.transforms += howmany;
+    fftw_execute_dft_c2r(fftw_c2r_many_plan(shp, howmany, val, fftw_planning_rigor, fftw_thread_count()), reinterpret_cast<fftw_complex*>(val), val);
+  }
+
+  // Out-of-core generation (see on_grid_to_file). The 3D transforms are split into 1D transforms along x of blocks of y lines 
+  // (all x, nj lines of y, all z modes, stored x-major) and 2D transforms over (y, z) of slabs of consecutive x planes, 
+  // in between the spectrum is kept in a file, in the layout of the padded grid.
+
+  // Number of y lines per block and of x planes per slab, such that the buffers of ncomp components fit into out_of_core_memory
+  int out_of_core_lines(const std::array<int, 3> &shp, const int ncomp) const;
+  int out_of_core_planes(const std::array<int, 3> &shp, const int ncomp) const;
+
+  // Copies the y lines [j0, j0 + nj) between the spectrum and the block
+  void copy_line_block(double* spectrum, double* block, const std::array<int, 3> &shp, const int j0, const int nj, const bool to_spectrum) const;
+
+  // Draws the modes of the y lines [j0, j0 + nj) into the block, the same modes seed_complex_random_numbers draws for them
+  void seed_line_block(double* block, const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed, const int j0, const int nj);
+
+  void execute_c2c_lines(double* block, const int lines, const int direction, const std::array<int, 3> &shp) const {
+    fftw_complex *modes = reinterpret_cast<fftw_complex*>(block);
+    fftw_execute_dft(fftw_c2c_lines_plan(shp, lines, direction, block, fftw_planning_rigor, fftw_thread_count()), modes, modes);
+  }
+
+  void execute_r2c_planes(double* slab, const int howmany, const std::array<int, 3> &shp) const {
+    fftw_execute_dft_r2c(fftw_r2c_planes_plan(shp, howmany, slab, fftw_planning_rigor, fftw_thread_count()), slab, reinterpret_cast<fftw_complex*>(slab));
+  }
+
+  void execute_c2r_planes(double* slab, const int howmany, const std::array<int, 3> &shp) const {
+    fftw_execute_dft_c2r(fftw_c2r_planes_plan(shp, howmany, slab, fftw_planning_rigor, fftw_thread_count()), reinterpret_cast<fftw_complex*>(slab), slab);
+  }
+
+  // Transforms the fine grids of a non-uniform FFT to real space, in one batched transform for several components
+  void execute_nufft(GaussianNUFFT &nufft) const {
+    if (nufft.components() == 1) {
+      execute_c2r(nufft.fine_grid(), nufft.fine_shape());
+    }
+    else {
+      execute_c2r_many(nufft.fine_grid(), nufft.components(), nufft.fine_shape());
+    }
+  }
+
+  // The coordinates of the voxels of an irregular grid (in C order), as positions for at_positions
+  static std::array<std::vector<double>, 3> grid_positions(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z) {
+    const size_t n = grid_x.size()*grid_y.size()*grid_z.size();
+    std::array<std::vector<double>, 3> pos{std::vector<double>(n), std::vector<double>(n), std::vector<double>(n)};
+    size_t s = 0;
+    for (const double xx : grid_x) {
+      for (const double yy : grid_y) {
+        for (const double zz : grid_z) {
+          pos[0][s] = xx;
+          pos[1][s] = yy;
+          pos[2][s] = zz;
+          ++s;
+        }
+      }
+    }
+    return pos;
+  }
+
+#if FFTW_FLOAT_FOUND
+  // Single precision versions, for the float grids
+  void execute_r2c(float* val, const std::array<int, 3> &shp) const {
+    ++stats.transforms;
+    fftwf_execute_dft_r2c(fftwf_r2c_plan(shp, val, fftw_planning_rigor, fftw_thread_count()), val, reinterpret_cast<fftwf_complex*>(val));
+  }
+
+  void execute_c2r(float* val, const std::array<int, 3> &shp) const {
+    ++stats.transforms;
+    fftwf_execute_dft_c2r(fftwf_c2r_plan(shp, val, fftw_planning_rigor, fftw_thread_count()), reinterpret_cast<fftwf_complex*>(val), val);
+  }
+
+  void execute_r2c_many(float* val, const int howmany, const std::array<int, 3> &shp) const {
+    stats.transforms += howmany;
+    fftwf_execute_dft_r2c(fftwf_r2c_many_plan(shp, howmany, val, fftw_planning_rigor, fftw_thread_count()), val, reinterpret_cast<fftwf_complex*>(val));
+  }
+
+  void execute_c2r_many(float* val, const int howmany, const std::array<int, 3> &shp) const {
+    stats.transforms += howmany;
+    fftwf_execute_dft_c2r(fftwf_c2r_many_plan(shp, howmany, val, fftw_planning_rigor, fftw_thread_count()), reinterpret_cast<fftwf_complex*>(val), val);
+  }
+#endif
+
+  // The realization at_position and at_positions (without seed) interpolate, see interpolate_realization
+  std::shared_ptr<const GridInterpolator> interpolator;
+
 public:
   // Constructors
   using Field<POSTYPE, GRIDTYPE> :: Field;
@@ -33,26 +294,160 @@ public:
 
   bool apply_spectrum = true;
 
+  // Rigor of the FFTW planner. Plans are created once per grid shape and kept, so the additional planning time 
+  // of measure or patient only pays off if many realizations are generated on the same grid.
+  FFTWPlanningRigor fftw_planning_rigor = FFTWPlanningRigor::estimate;
+
+  // Number of threads of the Fourier transforms, 0 (the default) uses the thread count of the grid evaluation. 
+  // Ignored (single-threaded) if FFTW was found without its threads library, see fftw_threads_available.
+  int fftw_threads = 0;
+
+  int fftw_thread_count() const {
+    return fftw_threads > 0 ? fftw_threads : this->grid_thread_count();
+  }
+
+  // Draw the Fourier modes sequentially from a single std::mt19937 stream (the behaviour of earlier versions), 
+  // instead of the counter based generator. Only needed to reproduce fields generated with earlier versions, 
+  // the sequential stream can not be parallelized.
+  bool legacy_random_numbers = false;
+
+  // Memory (in bytes) of the buffers of the out-of-core generation (on_grid_to_file), which transforms slabs of the grid one at a time. 
+  // At least one x plane (or line of y modes along x) per component is held, whatever the limit.
+  size_t out_of_core_memory = size_t(1) << 30;
+
+  // Relative accuracy of the evaluation at arbitrary positions (at_positions with a seed, on_grid on irregular grids), 
+  // which sets the width of the kernel of the non-uniform FFT, see GaussianNUFFT
+  double nufft_tolerance = 1e-6;
+
+  // Realizations and 3D Fourier transforms since the construction of the field or the last reset, 
+  // e.g. to compare the generation engines of random vector fields
+  const GenerationStats &generation_stats() const {
+    return stats;
+  }
+
+  void reset_generation_stats() {
+    stats = GenerationStats();
+  }
+
+
+  // Keep the realization of the seed on the internal grid as a GridInterpolator (periodic, as the realization), 
+  // which at_position and at_positions (without seed) evaluate from then on, without further Fourier transforms. 
+  // The grid itself is released again.
+  void interpolate_realization(const int seed, const InterpolationKernel kernel = InterpolationKernel::trilinear, const int brick_size = 8) {
+    if (not this->initialized_with_grid or not this->regular_grid) {
+      throw GridException();
+    }
+    GRIDTYPE grid = static_cast<Field<POSTYPE, GRIDTYPE>*>(this)->on_grid(seed);
+    try {
+      set_interpolator(std::make_shared<const GridInterpolator>(grid, this->internal_shape, this->internal_ref_point, this->internal_increment, kernel, GridBoundary::periodic, brick_size));
+    }
+    catch (...) {
+      this->free_memory(grid);
+      throw;
+    }
+    this->free_memory(grid);
+  }
+
+  // Evaluate at_position and at_positions (without seed) with an interpolator of a grid evaluated elsewhere, 
+  // e.g. shared between copies of the field, or a realization read from disk
+  void set_interpolator(std::shared_ptr<const GridInterpolator> grid_interpolator) {
+    if (grid_interpolator and grid_interpolator->components() != (std::is_same<GRIDTYPE, double*>::value ? 1 : 3)) {
+      throw std::invalid_argument("The interpolator has the wrong number of components for this field.");
+    }
+    interpolator = std::move(grid_interpolator);
+  }
+
+  std::shared_ptr<const GridInterpolator> get_interpolator() const {
+    return interpolator;
+  }
+
+  void clear_interpolator() {
+    interpolator.reset();
+  }
 
   // methods
+  // A realization depends on a seed, see at_positions of the child classes for the evaluation at positions. 
+  // Without seed, the realization kept by interpolate_realization (or set_interpolator) is interpolated.
   POSTYPE at_position(const double &x, const double &y, const double &z) const {
-    throw NotImplementedException();
-    // Here comes the interpolator
+    if (not interpolator) {
+      throw NotImplementedException();
+    }
+    std::array<double, 3> val{0., 0., 0.};
+    interpolator->interpolate(x, y, z, val.data());
+    if constexpr (std::is_same<POSTYPE, double>::value) {
+      return val[0];
+    }
+    else {
+      return POSTYPE{{val[0], val[1], val[2]}};
+    }
+  }
+
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, GRIDTYPE out) const {
+    if (not interpolator) {
+      throw NotImplementedException();
+    }
+    interpolator->at_positions(x, y, z, n, out, this->grid_thread_count());
   }
   
   virtual double spatial_profile(const double &x, const double &y, const double &z) const = 0;
 
   virtual double calculate_fourier_sigma(const double &abs_k, const double &dk) const = 0;
 
+  // Parameters calculate_fourier_sigma depends on (besides |k| and dk). The standard deviations of the Fourier modes 
+  // are tabulated once per grid, and the table is reused until one of the parameters changes. 
+  // Without parameters (the default, e.g. for spectra depending on further state), the table is recomputed for every realization.
+  virtual std::optional<std::vector<double>> spectral_parameters() const {
+    return std::nullopt;
+  }
+
     // This function is the place where the global routine should be implemented, i.e. how the spatial profile modifies the random field, and if divergence cleaning needs to be performed. 
-  virtual void _on_grid(GRIDTYPE val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) = 0;
+    // The field is generated in the padded buffer val (e.g. the workspace), and written unpadded to out (strides in elements, all zero strides denote C-contiguous grids), 
+    // ideally in a single pass which also applies the profile and the normalization.
+  virtual void _on_grid(GRIDTYPE val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, GRIDTYPE out, const std::array<std::ptrdiff_t, 3> &strides) = 0;
+
+  // Draws the Fourier modes of a Gaussian random field (Hermitian symmetric, with standard deviation calculate_fourier_sigma). 
+  // The modes are generated by a counter based generator keyed with the seed, in parallel on grid_threads threads. 
+  // The result only depends on the seed and the grid, not on the number of threads. 
+  // All modes are drawn in one pass without branches, the real z planes are made Hermitian symmetric in a second pass. 
+  // COMPLEX is fftw_complex or fftwf_complex, the numbers are drawn in double precision in both cases, 
+  // so that single precision fields are the rounded double precision ones (up to the rounding of the transforms).
+  template <typename COMPLEX>
+  void seed_complex_random_numbers(COMPLEX* vec,  const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed); 
+
+  // Makes the real z planes (z = 0 and the Nyquist plane) of the modes Hermitian symmetric and sets the monopole to zero
+  template <typename COMPLEX>
+  void hermitian_symmetrize(COMPLEX* vec, const std::array<int, 3> &shp) const;
+
+  // Draws the modes (all l) of the Fourier line (i, j), sigma_of(i, j, l) is the standard deviation of a mode of the (non conjugate) half
+  template <typename COMPLEX, typename SIGMA>
+  void seed_mode_line(COMPLEX* vec, const int i, const int j, const std::array<int, 3> &shp, const uint64_t key, SIGMA &&sigma_of) const;
 
-  void seed_complex_random_numbers(fftw_complex* vec,  const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed); 
+  // Standard deviation of the mode (i, j, l) for i <= shp[0]/2 and j <= shp[1]/2, the entries of the FourierSigmaTable
+  double mode_sigma(const int i, const int j, const int l, const std::array<int, 3> &shp, const std::array<double, 3> &inc) const;
+
+  template <typename COMPLEX>
+  void seed_complex_random_numbers_legacy(COMPLEX* vec,  const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed); 
 
   GRIDTYPE on_grid(const std::vector<double>  &grid_x, const std::vector<double>  &grid_y, const std::vector<double>  &grid_z, const int seed) {
     throw NotImplementedException();
   }
 
+  // Called by on_grid_many for every realization, with the position of its seed and the (unpadded, C-contiguous) field. 
+  // The field lives in a buffer of the call, and is only valid until the consumer returns.
+  typedef std::function<void(const size_t, GRIDTYPE)> RealizationConsumer;
+
+  // Generate one realization per seed on the same grid, each identical to on_grid(..., seed). 
+  // The spatial profile, the anisotropy direction and the standard deviations of the Fourier modes are evaluated once, 
+  // and all realizations are generated in the same workspace. The parameters of the field must not change during the call.
+  void on_grid_many(const std::vector<int> &seeds, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const RealizationConsumer &consume);
+
+  void on_grid_many(const std::vector<int> &seeds, const RealizationConsumer &consume);
+
+  // Same as on_grid_many, writing the realization n to out + n*grid_size (per component) in memory owned by the caller
+  void on_grid_many_into(GRIDTYPE out, const std::vector<int> &seeds, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc);
+
+  void on_grid_many_into(GRIDTYPE out, const std::vector<int> &seeds);
+
   virtual double* profile_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rfp, const std::array<double, 3> &inc) = 0;
 
   void remove_padding(double* val, const std::array<int, 3> &shp, const int pad);
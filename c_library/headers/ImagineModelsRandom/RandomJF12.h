@@ -44,17 +44,19 @@ class JF12RandomField : public RandomVectorField {
     double spectral_offset = 1.; 
     double spectral_slope = 2.;
 
-    double anisotropy_rho = 1.;
-
     JF12MagneticField regular_base = JF12MagneticField();
 
     //void _on_grid(std::array<double*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const //std::array<double, 3> &inc, const int seed) override;
 
     double calculate_fourier_sigma(const double &abs_k, const double &dk) const override;
 
+    std::optional<std::vector<double>> spectral_parameters() const override {
+        return std::vector<double>{spectral_offset, spectral_slope};
+    }
+
     double spatial_profile(const double &x, const double &y, const double &z) const override;
 
-    vector anisotropy_direction(const double &x, const double &y, const double &z) const; 
+    vector_t<double> anisotropy_direction(const double &x, const double &y, const double &z) const override; 
 };
 
 #endif
\ No newline at end of file
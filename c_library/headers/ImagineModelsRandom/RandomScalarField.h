@@ -11,26 +11,55 @@
 #include <random>
 #include <memory>
 #include <initializer_list>
+#include <string>
 
 #include "exceptions.h"
 #include "RandomField.h"
 
-class RandomScalarField : public RandomField<number, double*>  {
+class RandomScalarField : public RandomField<double, double*>  {
 protected:
-    // Fields
-    fftw_plan c2r;
-    fftw_plan r2c;
-
   double* allocate_memory(const std::array<int, 3> shp);
 
   void free_memory(double* grid_eval);
 
-  fftw_complex* construct_plans(double* grid_eval, const std::array<int, 3> shp);
+  // padded buffer used by on_grid_into, kept between calls so that repeated evaluations on the same grid do not allocate
+  double* workspace = nullptr;
+  std::array<int, 3> workspace_shape{{0, 0, 0}};
+
+  double* get_workspace(const std::array<int, 3> &shp) override;
+
+  // Gaussian realization with the spatial profile applied, in either precision (see _on_grid)
+  template <typename REAL>
+  void generate_on_grid(REAL* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, REAL* out, const std::array<std::ptrdiff_t, 3> &strides);
+
+  // Applies the spatial profile (read from the unpadded grid profile if given, otherwise evaluated) and the normalization 
+  // to the rows [i0, i0 + n) of the padded grid, and writes them to out (with strides st). val, out and profile point to the row i0.
+  // Without apply_profile only the normalization is applied, as for no_profile.
+  template <typename REAL>
+  void profile_slab(const REAL* val, REAL* out, const int i0, const int n, const std::array<std::ptrdiff_t, 3> &st, const double norm, 
+                    const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const double *profile, 
+                    const bool apply_profile = true) const;
+
+  // The last pass of on_grid_to_file over the rows [i0, i0 + n) of the (transformed, padded) grid, val and out point to the row i0. 
+  // Applies the spatial profile and the normalization, child classes with another transformation in real space override it.
+  virtual void finish_slab(const double* val, double* out, const int i0, const int n, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc);
 
-  void destroy_plans();
+  // The last step of at_positions, for the normalized Gaussian field val at the position (x, y, z). 
+  // Applies the spatial profile, child classes with another transformation in real space override it (as finish_slab).
+  virtual double finish_point(const double val, const double x, const double y, const double z) const {
+    return no_profile ? val : val * spatial_profile(x, y, z);
+  }
+
+#if FFTW_FLOAT_FOUND
+  // padded single precision buffer used by the float versions of on_grid_into
+  float* workspace_float = nullptr;
+  std::array<int, 3> workspace_float_shape{{0, 0, 0}};
+
+  float* get_workspace_float(const std::array<int, 3> &shp);
+#endif
 
 public:
-  RandomScalarField() : RandomField<number, double*>() {};
+  RandomScalarField() : RandomField<double, double*>() {};
 
   RandomScalarField(std::array<int, 3>  shape, std::array<double, 3>  reference_point, std::array<double, 3>  increment);
 
@@ -50,7 +79,48 @@ public:
 
   double* on_grid(const int seed);
 
-  void _on_grid(double* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed);
+  // evaluate the field into memory owned by the caller (unpadded, strides in elements, all zero strides denote a C-contiguous grid)
+  void on_grid_into(double* grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  void on_grid_into(double* grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  // Evaluate the realization of the seed on the grid (shp, rpt, inc) at n arbitrary positions, without evaluating it on the grid: 
+  // The Fourier modes are drawn as for on_grid, and their series is evaluated at the positions by a non-uniform FFT (see GaussianNUFFT, 
+  // accurate to nufft_tolerance), i.e. the Gaussian field is the trigonometric interpolation of the grid, and periodic beyond it. 
+  // The spatial profile is evaluated at the positions. At the voxels of the grid, the result is the field on_grid returns.
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, double* out, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed);
+
+  // The same, for the realization on the internal grid
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, double* out, const int seed);
+
+  using RandomField<double, double*>::at_positions;
+
+  // Evaluate the realization on the internal grid at the voxels of an irregular grid, see at_positions
+  double* on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const int seed) override;
+
+  // Out-of-core evaluation, for grids larger than the memory: the field is written (unpadded, C-contiguous doubles in native byte order) 
+  // to the file path, e.g. to be opened with numpy.memmap. The transforms are done slab by slab with buffers of out_of_core_memory bytes, 
+  // and the spectrum is kept in the scratch file <path>.spectrum (of the size of the field), which is removed afterwards. 
+  // The result is the field on_grid returns for the seed (up to the rounding of the transforms), legacy_random_numbers is not supported.
+  void on_grid_to_file(const std::string &path, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed);
+
+  void on_grid_to_file(const std::string &path, const int seed);
+
+  void _on_grid(double* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, double* out, const std::array<std::ptrdiff_t, 3> &strides) override;
+
+#if FFTW_FLOAT_FOUND
+  // Single precision versions: the Fourier modes are drawn as in double precision, transformed with fftw3f 
+  // and the field is returned as float grid (e.g. to halve the memory of large grids).
+  float* on_grid_float(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed);
+
+  float* on_grid_float(const int seed);
+
+  void on_grid_into(float* grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  void on_grid_into(float* grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  virtual void _on_grid(float* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, float* out, const std::array<std::ptrdiff_t, 3> &strides);
+#endif
   
   double* profile_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rfp, const std::array<double, 3> &inc);
 };
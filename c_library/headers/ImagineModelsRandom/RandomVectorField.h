@@ -11,24 +11,136 @@
 #include <random>
 #include <memory>
 #include <initializer_list>
+#include <string>
 
 #include "exceptions.h"
 #include "RandomField.h"
 #include "RegularField.h"
 
 
-class RandomVectorField : public RandomField<vector, std::array<double*, 3>>  {
+// Direction of the anisotropy on a regular grid, e.g. a regular field evaluated once with on_grid
+struct AnisotropyGrid
+{
+  std::array<int, 3> shape;
+  std::array<double, 3> reference_point;
+  std::array<double, 3> increment;
+  std::array<double *, 3> direction{{nullptr, nullptr, nullptr}};
+
+  AnisotropyGrid(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) : shape(shp), reference_point(rpt), increment(inc)
+  {
+    const size_t gs = static_cast<size_t>(shp[0]) * shp[1] * shp[2];
+    for (double *&d : direction)
+    {
+      d = allocate_grid_memory(gs);
+    }
+  }
+
+  AnisotropyGrid(const AnisotropyGrid &) = delete;
+  AnisotropyGrid &operator=(const AnisotropyGrid &) = delete;
+
+  ~AnisotropyGrid()
+  {
+    for (double *d : direction)
+    {
+      free_grid_memory(d);
+    }
+  }
+
+  bool matches(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) const
+  {
+    return shape == shp && reference_point == rpt && increment == inc;
+  }
+};
+
+
+// How RandomVectorField generates a realization (see RandomVectorField::engine), in order of the number of 3D Fourier transforms. 
+// With a constant spatial profile and without anisotropy, standard and spectral draw the same field (up to rounding), 
+// modulated_noise draws another realization with the same statistics (the seed draws white noise in real space instead of the modes).
+enum class VectorFieldEngine
+{
+  // Draw the modes with the spectral amplitude, transform to real space and apply the profile and the anisotropy. 
+  // With divergence cleaning, transform forward, project out the divergence and transform back: 9 transforms (3 without cleaning). 
+  // Divergence free whatever the profile.
+  standard,
+  // Draw the modes, and scale them with the spectral amplitude and project out the divergence in the same pass over the modes, 
+  // transform to real space and apply the profile and the anisotropy: 3 transforms. 
+  // The profile and the anisotropy act after the projection, hence the field is divergence free only where they are constant.
+  spectral,
+  // Draw white noise in real space and apply the profile and the anisotropy, transform forward, scale the modes with 
+  // the spectral amplitude and project out the divergence in one pass, and transform back: 6 transforms. 
+  // Divergence free whatever the profile, the profile and the anisotropy are smoothed over the correlation length of the spectrum.
+  modulated_noise
+};
+
+
+class RandomVectorField : public RandomField<vector_t<double>, std::array<double*, 3>>  {
 protected:
   // protected fields
 
-  std::array<fftw_plan, 3> r2c;
-  std::array<fftw_plan, 3> c2r;
+  // set by set_anisotropy_grid, used instead of anisotropy_direction on its grid
+  std::shared_ptr<const AnisotropyGrid> anisotropy_grid;
+
+  // The precomputed anisotropy directions for the grid (from set_anisotropy_grid or on_grid_many), nullptr if there are none
+  const std::array<double*, 3> *anisotropy_directions(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const RealizationCache *cache) const;
+
+  // padded buffers used by on_grid_into, kept between calls so that repeated evaluations on the same grid do not allocate
+  std::array<double*, 3> workspace{{nullptr, nullptr, nullptr}};
+  std::array<int, 3> workspace_shape{{0, 0, 0}};
+
+  // the components of the workspace are consecutive in one block, so that they can be transformed in one batched call
+  std::array<double*, 3> get_workspace(const std::array<int, 3> &shp) override;
+
+  void fill_realization_cache(RealizationCache &cache) override;
+
+  // true if the three (padded) components follow each other in memory
+  template <typename REAL>
+  bool contiguous_components(const std::array<REAL*, 3> &val, const std::array<int, 3> &shp) const;
+
+  // transforms of all three components, batched if they are contiguous
+  template <typename REAL>
+  void execute_r2c_components(std::array<REAL*, 3> val, const std::array<int, 3> &shp) const;
+  template <typename REAL>
+  void execute_c2r_components(std::array<REAL*, 3> val, const std::array<int, 3> &shp) const;
+
+  // scales a random vector by the spatial profile sp and applies the anisotropy with respect to b_reg
+  void apply_profile(std::array<double, 3> &b_rand_val, const double sp, const vector_t<double> &b_reg_val) const;
+
+  // Applies the profile and the normalization norm to the line (i, j) of the padded components val, and writes it to out 
+  // (with strides st), or back to val if out is val. Profile and directions are read from the (unpadded) grids if given, otherwise evaluated.
+  // For a slab of the grid starting at row i0 (see on_grid_to_file), val, out, profile and direction point to the row i0, and i is the row in the grid.
+  template <typename REAL>
+  void profile_line(const std::array<REAL*, 3> &val, const std::array<REAL*, 3> &out, const int i, const int j, const int i0, const std::array<std::ptrdiff_t, 3> &st, const double norm, 
+                    const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, 
+                    const double *profile, const std::array<double*, 3> *direction) const;
+
+  // The realization (see _on_grid) in either precision
+  template <typename REAL>
+  void generate_on_grid(std::array<REAL*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, std::array<REAL*, 3> out, const std::array<std::ptrdiff_t, 3> &strides);
+
+  // The seeds of the three components of the realization of seed
+  std::array<int, 3> component_seeds(const int seed) const;
+
+  // Multiplies the modes of the three components by their standard deviations (if apply_spectrum) and projects out 
+  // the divergence (if clean_divergence), in one pass over the modes, and sets the monopole to zero. If keys is given, the modes 
+  // are first drawn with variance 1 in the same pass (from the counters of seed_complex_random_numbers) and made Hermitian symmetric afterwards.
+  template <typename COMPLEX>
+  void shape_modes(const std::array<COMPLEX*, 3> &modes, const std::array<int, 3> &shp, const std::array<double, 3> &inc, const std::array<uint64_t, 3> *keys);
 
-  // protected member functions 
+  // Draws white noise with variance 1 into the padded components val, the voxel pair (k, k + 1) of the line (i, j) from the counter (i*shp[1] + j)*(shp[2] + 1)/2 + k/2
+  template <typename REAL>
+  void seed_white_noise_line(const std::array<REAL*, 3> &val, const int i, const int j, const std::array<int, 3> &shp, const std::array<uint64_t, 3> &keys) const;
 
-  // fftw plan (con/de)struction
-  std::array<fftw_complex*, 3> construct_plans(std::array<double*, 3> grid_eval, std::array<int, 3> shp);
-  void destroy_plans();
+  // Writes the unpadded components of val, multiplied by norm, to out (with strides st)
+  template <typename REAL>
+  void normalize_components(const std::array<REAL*, 3> &val, const std::array<REAL*, 3> &out, const std::array<std::ptrdiff_t, 3> &st, const double norm, const std::array<int, 3> &shp) const;
+
+#if FFTW_FLOAT_FOUND
+  // single precision workspace of the float versions of on_grid_into, one block as the double workspace
+  std::array<float*, 3> workspace_float{{nullptr, nullptr, nullptr}};
+  std::array<int, 3> workspace_float_shape{{0, 0, 0}};
+
+  std::array<float*, 3> get_workspace_float(const std::array<int, 3> &shp);
+#endif
 
 public:
   // constructors
@@ -47,6 +159,11 @@ public:
 
   double anisotropy_rho = 1.;
 
+  // Stages and number of Fourier transforms of the generation of a realization, see VectorFieldEngine. 
+  // The engines other than standard draw from the counter based generator, and do not support legacy_random_numbers. 
+  // on_grid_to_file always uses the standard engine.
+  VectorFieldEngine engine = VectorFieldEngine::standard;
+
   // METHODS
 
   // memory (de-)allocation
@@ -56,21 +173,49 @@ public:
   // implemented/hidden in child classes, rms amplitude and anisotropy direction
   virtual double spatial_profile(const double &x, const double &y, const double &z) const = 0;
   
-  vector anisotropy_direction(const double &x, const double &y, const double &z) const {
-    vector a{{0., 0., 0.}}; 
+  virtual vector_t<double> anisotropy_direction(const double &x, const double &y, const double &z) const {
+    vector_t<double> a{{0., 0., 0.}}; 
     return a;
   }
 
-  // interpolator (TBD)
-  vector at_position(const double &x, const double &y, const double &z) const {
-    throw NotImplementedException();
+  // Use the given directions (C-contiguous grids, e.g. a regular field evaluated with on_grid) as anisotropy directions 
+  // whenever the field is generated on this grid, instead of evaluating anisotropy_direction for every voxel and realization. 
+  // The grids are copied.
+  void set_anisotropy_grid(const std::array<const double*, 3> &direction, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc);
+
+  // Evaluate the regular field once on the grid and use it as anisotropy direction, see above
+  void set_anisotropy_grid(RegularVectorField &regular_field, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc);
+
+  void set_anisotropy_grid(RegularVectorField &regular_field);
+
+  bool has_anisotropy_grid() const {
+    return anisotropy_grid != nullptr;
+  }
+
+  void clear_anisotropy_grid() {
+    anisotropy_grid.reset();
   }
 
   // internal on_grid function, combining seeding of random numbers, applying the spatial profile and divergence cleaning
-  void _on_grid(std::array<double*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed); 
+  void _on_grid(std::array<double*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, std::array<double*, 3> out, const std::array<std::ptrdiff_t, 3> &strides) override; 
+
+#if FFTW_FLOAT_FOUND
+  virtual void _on_grid(std::array<float*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, std::array<float*, 3> out, const std::array<std::ptrdiff_t, 3> &strides); 
+#endif
 
-  // divergence cleaner
-  void divergence_cleaner(fftw_complex* bx, fftw_complex* by, fftw_complex* bz,  const std::array<int, 3> &shp, const std::array<double, 3> &inc) const;
+  // divergence cleaner, for fftw_complex and fftwf_complex modes
+  template <typename COMPLEX>
+  void divergence_cleaner(COMPLEX* bx, COMPLEX* by, COMPLEX* bz,  const std::array<int, 3> &shp, const std::array<double, 3> &inc) const;
+
+  // Removes the component parallel to k from the modes l = 0, ..., size_z - 1 of a Fourier line with the wave vectors (kx, ky, kz[l]), 
+  // and multiplies them by sqrt(3/2) (to keep the power of the mode) and scale[l] (if given, e.g. the standard deviations of the modes, to fuse the projection with the spectral amplitude). 
+  // The components are separate arrays, and the loop over the line has no branches, so that it can be vectorized.
+  template <typename COMPLEX>
+  void divergence_clean_line(COMPLEX* bx, COMPLEX* by, COMPLEX* bz, const int size_z, const double kx, const double ky, const double *kz, const double *scale = nullptr) const;
+
+  // The divergence cleaning of the modes of all lines, on grid_threads threads
+  template <typename COMPLEX>
+  void divergence_clean_modes(COMPLEX* bx, COMPLEX* by, COMPLEX* bz, const std::array<int, 3> &shp, const FourierWaveNumbers &wave_numbers) const;
 
   std::array<double*, 3> random_numbers_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed);
 
@@ -78,6 +223,43 @@ public:
 
   std::array<double*, 3> on_grid(const int seed);
 
+  // evaluate the field into memory owned by the caller (unpadded, strides in elements, all zero strides denote C-contiguous grids)
+  void on_grid_into(std::array<double*, 3> grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  void on_grid_into(std::array<double*, 3> grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  // Evaluate the realization of the seed on the grid (shp, rpt, inc) at n arbitrary positions by a non-uniform FFT, 
+  // see RandomScalarField::at_positions. This is the realization of on_grid for the engine: the spectral engine (and the standard engine 
+  // without divergence cleaning) evaluate profile and anisotropy at the positions, the others apply them on the grid before the last 
+  // correlation in Fourier space and hence take as many transforms as on_grid.
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, std::array<double*, 3> out, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed);
+
+  // The same, for the realization on the internal grid
+  void at_positions(const double *x, const double *y, const double *z, const size_t n, std::array<double*, 3> out, const int seed);
+
+  using RandomField<vector_t<double>, std::array<double*, 3>>::at_positions;
+
+  // Evaluate the realization on the internal grid at the voxels of an irregular grid, see at_positions
+  std::array<double*, 3> on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const int seed) override;
+
+  // Out-of-core evaluation, see RandomScalarField::on_grid_to_file. The file holds the three components one after the other 
+  // (i.e. a C-contiguous array of shape (3, nx, ny, nz)), the scratch file <path>.spectrum is three times the size of a component.
+  // With divergence cleaning the spectrum is transformed four times slab by slab (twice without).
+  void on_grid_to_file(const std::string &path, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed);
+
+  void on_grid_to_file(const std::string &path, const int seed);
+
+#if FFTW_FLOAT_FOUND
+  // Single precision versions, see RandomScalarField::on_grid_float
+  std::array<float*, 3> on_grid_float(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed);
+
+  std::array<float*, 3> on_grid_float(const int seed);
+
+  void on_grid_into(std::array<float*, 3> grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+
+  void on_grid_into(std::array<float*, 3> grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides = {0, 0, 0});
+#endif
+
   double* profile_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rfp, const std::array<double, 3> &inc);
 };
 
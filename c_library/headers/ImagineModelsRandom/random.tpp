@@ -38,7 +38,291 @@ void RandomField<POSTYPE, GRIDTYPE>::remove_padding(double* val, const std::arra
 
 
 template<typename POSTYPE, typename GRIDTYPE>
-void RandomField<POSTYPE, GRIDTYPE>::seed_complex_random_numbers(fftw_complex* vec,  const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed)  {
+template <typename COMPLEX>
+void RandomField<POSTYPE, GRIDTYPE>::seed_complex_random_numbers(COMPLEX* vec,  const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed)  {
+  if (legacy_random_numbers) {
+    seed_complex_random_numbers_legacy(vec, shp, inc, seed);
+    return;
+  }
+
+  const int size_z = shp[2]/2 + 1;
+  const uint64_t key = static_cast<uint32_t>(seed);
+  std::shared_ptr<const FourierSigmaTable> table;
+  if (apply_spectrum) {
+    table = fourier_sigma_table(shp, inc);
+  }
+
+  // Phase 1: every mode draws from the counter given by its own index, without distinguishing free, real and conjugate modes. 
+  // The standard deviations are taken from the table, where mirrored modes share one entry.
+  this->for_each_grid_line({shp[0], shp[1], size_z}, [&](const int i, const int j) {
+    const size_t idx_line = (static_cast<size_t>(i) * shp[1] + j) * size_z;
+    COMPLEX *v = vec + idx_line;
+    if (table) {
+      const double *sigma = table->line(i, j);
+      for (int l = 0; l < size_z; ++l) {
+        const std::array<double, 2> g = Philox4x32::normal_pair(key, idx_line + l);
+        v[l][0] = sigma[l] * g[0];
+        v[l][1] = sigma[l] * g[1];
+      }
+    }
+    else {
+      for (int l = 0; l < size_z; ++l) {
+        const std::array<double, 2> g = Philox4x32::normal_pair(key, idx_line + l);
+        v[l][0] = g[0];
+        v[l][1] = g[1];
+      }
+    }
+  });
+
+  // Phase 2: Hermitian symmetry of the real z planes
+  hermitian_symmetrize(vec, shp);
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+template <typename COMPLEX>
+void RandomField<POSTYPE, GRIDTYPE>::hermitian_symmetrize(COMPLEX* vec, const std::array<int, 3> &shp) const {
+  const int size_z = shp[2]/2 + 1;
+  // the z plane 0, and the Nyquist plane for an even number of voxels
+  const std::array<int, 2> planes{0, shp[2]/2};
+  const int n_planes = (shp[2] % 2 == 0) ? 2 : 1;
+
+  // The mode (i, j) of a real plane is the complex conjugate of its mirror (-i, -j). Modes which are their own mirror are real, 
+  // of the other pairs the mode whose mirror comes first (in row major order) is replaced by the conjugate of the mirror. 
+  // The mirrors themselves are never written, hence the lines can be processed in any order.
+  this->for_each_grid_line({shp[0], shp[1], 1}, [&](const int i, const int j) {
+    const int mi = (shp[0] - i) % shp[0];
+    const int mj = (shp[1] - j) % shp[1];
+    const bool real = (mi == i and mj == j);
+    const bool conjugate = (mi < i or (mi == i and mj < j));
+    if (not real and not conjugate) {
+      return;
+    }
+    const size_t idx_line = (static_cast<size_t>(i) * shp[1] + j) * size_z;
+    const size_t mirror_line = (static_cast<size_t>(mi) * shp[1] + mj) * size_z;
+    for (int p = 0; p < n_planes; ++p) {
+      COMPLEX &v = vec[idx_line + planes[p]];
+      if (real) {
+        v[1] = 0.;
+      }
+      else {
+        v[0] = vec[mirror_line + planes[p]][0];
+        v[1] = -vec[mirror_line + planes[p]][1];
+      }
+    }
+  });
+
+  // Full Monopole is set to zero
+  vec[0][0] = 0.;
+  vec[0][1] = 0.;
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+template <typename COMPLEX, typename SIGMA>
+void RandomField<POSTYPE, GRIDTYPE>::seed_mode_line(COMPLEX* vec, const int i, const int j, const std::array<int, 3> &shp, const uint64_t key, SIGMA &&sigma_of) const {
+  const float nyquist_x = shp[0]/2.;
+  const float nyquist_y = shp[1]/2.;
+  const float nyquist_z = shp[2]/2.;
+  const int size_z = static_cast<int>(nyquist_z) + 1;
+
+  // Every mode draws from the counter given by its own index, modes on the conjugate half of a real plane 
+  // draw from the index of their mirror mode and conjugate. Hence the line does not depend on any other line, 
+  // and yields the modes of seed_complex_random_numbers.
+
+  const bool j_is_zero_or_nyquist = (j == 0 or j == nyquist_y);
+  const bool i_is_zero_or_nyquist = (i == 0 or i == nyquist_x);
+  for (int l = 0; l < size_z; ++l) {
+    if (l == 0 and j == 0 and i == 0) {
+      // Full Monopole is set to zero, dealt with seperately in the outer scope
+      vec[0][0] = 0.;
+      vec[0][1] = 0.;
+      continue;
+    }
+    int src_i = i;
+    int src_j = j;
+    bool real = false;
+    if (l == 0 or l == nyquist_z) { // real z planes
+      if (j_is_zero_or_nyquist) {
+        if (i_is_zero_or_nyquist) {   // line monopole or nyquist
+          real = true;
+        }
+        else if (i > nyquist_x) {     // complex conjugate on line
+          src_i = shp[0] - i;
+        }
+      }
+      else if (i_is_zero_or_nyquist) {
+        if (j > nyquist_y) {
+          src_j = shp[1] - j;
+        }
+      }
+      else if (i > nyquist_x) {
+        src_i = shp[0] - i;
+        src_j = shp[1] - j;
+      }
+    }
+    const bool conjugate = (src_i != i or src_j != j);
+    const uint64_t src_idx = (static_cast<uint64_t>(src_i) * shp[1] + src_j) * size_z + l;
+    const double sigma = sigma_of(src_i, src_j, l);
+    const std::array<double, 2> g = Philox4x32::normal_pair(key, src_idx);
+    vec[l][0] = sigma * g[0];
+    vec[l][1] = real ? 0. : (conjugate ? -sigma * g[1] : sigma * g[1]);
+  }
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+std::shared_ptr<const FourierSigmaTable> RandomField<POSTYPE, GRIDTYPE>::fourier_sigma_table(const std::array<int, 3> &shp, const std::array<double, 3> &inc) {
+  if (realization_cache != nullptr && realization_cache->sigma && realization_cache->shape == shp && realization_cache->increment == inc) {
+    return realization_cache->sigma;
+  }
+  std::optional<std::vector<double>> parameters = spectral_parameters();
+  if (sigma_table && sigma_table->matches(shp, inc, parameters)) {
+    return sigma_table;
+  }
+
+  auto table = std::make_shared<FourierSigmaTable>();
+  table->shape = shp;
+  table->increment = inc;
+  table->parameters = parameters;
+  table->size = {shp[0]/2 + 1, shp[1]/2 + 1, shp[2]/2 + 1};
+  table->sigma.resize(static_cast<size_t>(table->size[0]) * table->size[1] * table->size[2]);
+
+  const std::array<int, 3> &size = table->size;
+  this->for_each_grid_line(size, [&](const int i, const int j) {
+    double *sigma = table->sigma.data() + (static_cast<size_t>(i) * size[1] + j) * size[2];
+    for (int l = 0; l < size[2]; ++l) {
+      sigma[l] = mode_sigma(i, j, l, shp, inc);
+    }
+  });
+  sigma_table = table;
+  return table;
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+double RandomField<POSTYPE, GRIDTYPE>::mode_sigma(const int i, const int j, const int l, const std::array<int, 3> &shp, const std::array<double, 3> &inc) const {
+  if (l == 0 and j == 0 and i == 0) {
+    return 0.; // the monopole is not drawn
+  }
+  const double lx = shp[0]*inc[0];
+  const double ly = shp[1]*inc[1];
+  const double lz = shp[2]*inc[2];
+  const double kx = (double)i / lx;
+  const double ky = (double)j / ly;
+  const double kz = (double)l / lz;
+  const double ks = std::sqrt(kx * kx + ky * ky + kz * kz);
+  return calculate_fourier_sigma(ks, 1./(lx*ly*lz));
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+int RandomField<POSTYPE, GRIDTYPE>::out_of_core_lines(const std::array<int, 3> &shp, const int ncomp) const {
+  const size_t line_bytes = static_cast<size_t>(ncomp)*shp[0]*(shp[2]/2 + 1)*sizeof(fftw_complex);
+  return static_cast<int>(std::max<size_t>(1, std::min<size_t>(shp[1], out_of_core_memory / line_bytes)));
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+int RandomField<POSTYPE, GRIDTYPE>::out_of_core_planes(const std::array<int, 3> &shp, const int ncomp) const {
+  const size_t plane_bytes = static_cast<size_t>(ncomp)*shp[1]*2*(shp[2]/2 + 1)*sizeof(double);
+  return static_cast<int>(std::max<size_t>(1, std::min<size_t>(shp[0], out_of_core_memory / plane_bytes)));
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+void RandomField<POSTYPE, GRIDTYPE>::copy_line_block(double* spectrum, double* block, const std::array<int, 3> &shp, const int j0, const int nj, const bool to_spectrum) const {
+  const size_t line = 2*static_cast<size_t>(shp[2]/2 + 1);
+  this->for_each_grid_line({shp[0], 1, 1}, [&](const int i, const int) {
+    double *s = spectrum + (static_cast<size_t>(i)*shp[1] + j0)*line;
+    double *b = block + static_cast<size_t>(i)*nj*line;
+    if (to_spectrum) {
+      std::copy(b, b + nj*line, s);
+    }
+    else {
+      std::copy(s, s + nj*line, b);
+    }
+  });
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+void RandomField<POSTYPE, GRIDTYPE>::seed_line_block(double* block, const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed, const int j0, const int nj) {
+  if (legacy_random_numbers) {
+    throw std::invalid_argument("The out-of-core generation draws every Fourier mode from its own counter, legacy_random_numbers is not supported.");
+  }
+  const int size_z = shp[2]/2 + 1;
+  const uint64_t key = static_cast<uint32_t>(seed);
+  fftw_complex *modes = reinterpret_cast<fftw_complex*>(block);
+  // no sigma table, it would hold an eighth of the grid
+  this->for_each_grid_line({shp[0], nj, size_z}, [&](const int i, const int jj) {
+    seed_mode_line(modes + (static_cast<size_t>(i)*nj + jj)*size_z, i, j0 + jj, shp, key, [&](const int si, const int sj, const int l) {
+      return apply_spectrum ? mode_sigma(std::min(si, shp[0] - si), std::min(sj, shp[1] - sj), l, shp, inc) : 1.;
+    });
+  });
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+void RandomField<POSTYPE, GRIDTYPE>::fill_realization_cache(RealizationCache &cache) {
+  const std::array<int, 3> &shp = cache.shape;
+  const std::array<double, 3> &inc = cache.increment;
+  if (apply_spectrum && !legacy_random_numbers) {
+    cache.sigma = fourier_sigma_table(shp, inc);
+  }
+  if (!no_profile) {
+    cache.profile = profile_on_grid(shp, cache.reference_point, inc);
+  }
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+template <typename OUTPUT, typename DONE>
+void RandomField<POSTYPE, GRIDTYPE>::generate_many(const std::vector<int> &seeds, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, OUTPUT &&output, DONE &&done) {
+  RealizationCache cache(shp, rpt, inc);
+  fill_realization_cache(cache);
+  GRIDTYPE val = get_workspace(shp);
+  realization_cache = &cache;
+  try {
+    for (size_t n = 0; n < seeds.size(); ++n) {
+      GRIDTYPE out = output(n);
+      _on_grid(val, shp, rpt, inc, seeds[n], out, {0, 0, 0});
+      done(n, out);
+    }
+  }
+  catch (...) {
+    realization_cache = nullptr;
+    throw;
+  }
+  realization_cache = nullptr;
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+void RandomField<POSTYPE, GRIDTYPE>::on_grid_many(const std::vector<int> &seeds, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const RealizationConsumer &consume) {
+  GRIDTYPE out = this->allocate_memory(shp);
+  try {
+    generate_many(seeds, shp, rpt, inc, [&](const size_t n) { return out; }, consume);
+  }
+  catch (...) {
+    this->free_memory(out);
+    throw;
+  }
+  this->free_memory(out);
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+void RandomField<POSTYPE, GRIDTYPE>::on_grid_many(const std::vector<int> &seeds, const RealizationConsumer &consume) {
+  if (not this->initialized_with_grid) 
+    throw GridException();
+  on_grid_many(seeds, this->internal_shape, this->internal_ref_point, this->internal_increment, consume);
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+void RandomField<POSTYPE, GRIDTYPE>::on_grid_many_into(GRIDTYPE out, const std::vector<int> &seeds, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) {
+  const size_t gs = this->grid_size(shp);
+  generate_many(seeds, shp, rpt, inc, [&](const size_t n) { return realization_in(out, n, gs); }, [](const size_t n, GRIDTYPE val) {});
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+void RandomField<POSTYPE, GRIDTYPE>::on_grid_many_into(GRIDTYPE out, const std::vector<int> &seeds) {
+  if (not this->initialized_with_grid) 
+    throw GridException();
+  on_grid_many_into(out, seeds, this->internal_shape, this->internal_ref_point, this->internal_increment);
+}
+
+template<typename POSTYPE, typename GRIDTYPE>
+template <typename COMPLEX>
+void RandomField<POSTYPE, GRIDTYPE>::seed_complex_random_numbers_legacy(COMPLEX* vec,  const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed)  {
 
   bool debug_random = false;
   auto gen = std::mt19937(seed);
@@ -1,10 +1,11 @@
 #include "Archimedes.h"
 
 // J. L. Han et al 2018 ApJS 234 11
-vector ArchimedeanMagneticField::_at_position(const double &x, const double &y, const double &z, const ArchimedeanMagneticField &p) const
+template <typename T>
+vector_t<T> ArchimedeanMagneticField::_at_position(const double &x, const double &y, const double &z, const ArchimedeanMagneticField &p) const
 {
 
-    vector B_cart{{0., 0., 0.}};
+    vector_t<T> B_cart{{0., 0., 0.}};
     const double r = sqrt(x * x + y * y + z * z);
 
 	double theta = atan2(sqrt(x * x + y * y), z);
@@ -16,18 +17,18 @@ vector ArchimedeanMagneticField::_at_position(const double &x, const double &y,
 	double sin_theta = sin(theta);
 
 	// radial direction
-	auto c1 = p.R_0*p.R_0/r/r;
+	auto c1 = T(p.R_0)*T(p.R_0)/r/r;
 	B_cart[0] += c1 * cos_phi * sin_theta;
 	B_cart[1] += c1 * sin_phi * sin_theta;
 	B_cart[2] += c1 * cos_theta;
 	
 	// azimuthal direction	
-	auto c2 = - (p.Omega*p.R_0*p.R_0*sin_theta) / (r*p.v_w);
+	auto c2 = - (T(p.Omega)*T(p.R_0)*T(p.R_0)*sin_theta) / (r*T(p.v_w));
 	B_cart[0] += c2 * (-sin_phi);
 	B_cart[1] += c2 * cos_phi;
 
 	// magnetic field switch at z = 0
-	auto B_0 = p.B_0;
+	auto B_0 = T(p.B_0);
 
 	if (z<0.) {
 		B_0 *= -1;
@@ -46,13 +47,14 @@ vector ArchimedeanMagneticField::_at_position(const double &x, const double &y,
 
 Eigen::MatrixXd ArchimedeanMagneticField::_jac(const double &x, const double &y, const double &z, ArchimedeanMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, ArchimedeanMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.R_0, p.Omega, p.v_w, p.B_0), ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number ArchimedeanMagneticField::*>> parameters{
+      {"R_0", &ArchimedeanMagneticField::R_0}, {"Omega", &ArchimedeanMagneticField::Omega},
+      {"v_w", &ArchimedeanMagneticField::v_w}, {"B_0", &ArchimedeanMagneticField::B_0}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
 #endif
 
-
+template vector_t<double> ArchimedeanMagneticField::_at_position<double>(const double &, const double &, const double &, const ArchimedeanMagneticField &) const;
+template class RegularVectorFieldModel<ArchimedeanMagneticField>;
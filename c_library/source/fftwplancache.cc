@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/file.h>
+  #include <unistd.h>
+  #define HAVE_FLOCK 1
+#endif
+
+#include "FFTWPlanCache.h"
+#include "GridMemory.h"
+
+namespace {
+
+// The transforms held in the cache: 3D transforms of padded grids, 2D transforms of padded x planes 
+// and 1D complex transforms along x (the latter two for the out-of-core generation)
+enum class TransformKind {grid, planes, lines};
+
+// kind, shape, number of transforms, alignment of the buffer, direction, number of threads, planning rigor
+typedef std::tuple<TransformKind, std::array<int, 3>, int, int, int, int, FFTWPlanningRigor> PlanKey;
+
+std::string default_wisdom_file() {
+  const char *env = std::getenv("IMAGINE_FFTW_WISDOM");
+  return env == nullptr ? "" : env;
+}
+
+// The FFTW interface of one precision (fftw_* for double, fftwf_* for float)
+template <typename REAL>
+struct FFTWInterface;
+
+template <>
+struct FFTWInterface<double> {
+  typedef fftw_plan plan_type;
+  typedef fftw_complex complex_type;
+
+  static void init_threads() {
+#if FFTW_THREADS_FOUND
+    fftw_init_threads();
+#endif
+  }
+  static void plan_with_nthreads(const int nthreads) {
+#if FFTW_THREADS_FOUND
+    fftw_plan_with_nthreads(nthreads);
+#endif
+  }
+  static int alignment_of(double *p) {return fftw_alignment_of(p);}
+  static int import_wisdom(const char *f) {return fftw_import_wisdom_from_filename(f);}
+  static int export_wisdom(const char *f) {return fftw_export_wisdom_to_filename(f);}
+  static std::string wisdom_suffix() {return "";}
+  static void destroy(plan_type p) {fftw_destroy_plan(p);}
+  static plan_type r2c_3d(const std::array<int, 3> &shp, double *r, complex_type *c, unsigned flags) {
+    return fftw_plan_dft_r2c_3d(shp[0], shp[1], shp[2], r, c, flags);
+  }
+  static plan_type c2r_3d(const std::array<int, 3> &shp, complex_type *c, double *r, unsigned flags) {
+    return fftw_plan_dft_c2r_3d(shp[0], shp[1], shp[2], c, r, flags);
+  }
+  static plan_type r2c_many(const int rank, const int *n, int howmany, double *r, const int *rembed, int rdist, complex_type *c, const int *cembed, int cdist, unsigned flags) {
+    return fftw_plan_many_dft_r2c(rank, n, howmany, r, rembed, 1, rdist, c, cembed, 1, cdist, flags);
+  }
+  static plan_type c2r_many(const int rank, const int *n, int howmany, complex_type *c, const int *cembed, int cdist, double *r, const int *rembed, int rdist, unsigned flags) {
+    return fftw_plan_many_dft_c2r(rank, n, howmany, c, cembed, 1, cdist, r, rembed, 1, rdist, flags);
+  }
+  // in-place transforms of howmany interleaved lines of length n (element m of line h at c[m*howmany + h])
+  static plan_type c2c_lines(const int n, int howmany, complex_type *c, int sign, unsigned flags) {
+    return fftw_plan_many_dft(1, &n, howmany, c, nullptr, howmany, 1, c, nullptr, howmany, 1, sign, flags);
+  }
+};
+
+#if FFTW_FLOAT_FOUND
+template <>
+struct FFTWInterface<float> {
+  typedef fftwf_plan plan_type;
+  typedef fftwf_complex complex_type;
+
+  static void init_threads() {
+#if FFTW_THREADS_FOUND
+    fftwf_init_threads();
+#endif
+  }
+  static void plan_with_nthreads(const int nthreads) {
+#if FFTW_THREADS_FOUND
+    fftwf_plan_with_nthreads(nthreads);
+#endif
+  }
+  static int alignment_of(float *p) {return fftwf_alignment_of(p);}
+  static int import_wisdom(const char *f) {return fftwf_import_wisdom_from_filename(f);}
+  static int export_wisdom(const char *f) {return fftwf_export_wisdom_to_filename(f);}
+  // single and double precision wisdom can not be stored in the same file
+  static std::string wisdom_suffix() {return ".float";}
+  static void destroy(plan_type p) {fftwf_destroy_plan(p);}
+  static plan_type r2c_3d(const std::array<int, 3> &shp, float *r, complex_type *c, unsigned flags) {
+    return fftwf_plan_dft_r2c_3d(shp[0], shp[1], shp[2], r, c, flags);
+  }
+  static plan_type c2r_3d(const std::array<int, 3> &shp, complex_type *c, float *r, unsigned flags) {
+    return fftwf_plan_dft_c2r_3d(shp[0], shp[1], shp[2], c, r, flags);
+  }
+  static plan_type r2c_many(const int rank, const int *n, int howmany, float *r, const int *rembed, int rdist, complex_type *c, const int *cembed, int cdist, unsigned flags) {
+    return fftwf_plan_many_dft_r2c(rank, n, howmany, r, rembed, 1, rdist, c, cembed, 1, cdist, flags);
+  }
+  static plan_type c2r_many(const int rank, const int *n, int howmany, complex_type *c, const int *cembed, int cdist, float *r, const int *rembed, int rdist, unsigned flags) {
+    return fftwf_plan_many_dft_c2r(rank, n, howmany, c, cembed, 1, cdist, r, rembed, 1, rdist, flags);
+  }
+  // in-place transforms of howmany interleaved lines of length n (element m of line h at c[m*howmany + h])
+  static plan_type c2c_lines(const int n, int howmany, complex_type *c, int sign, unsigned flags) {
+    return fftwf_plan_many_dft(1, &n, howmany, c, nullptr, howmany, 1, c, nullptr, howmany, 1, sign, flags);
+  }
+};
+#endif
+
+// Plans and wisdom state of one precision
+template <typename REAL>
+struct PrecisionCache {
+  std::map<PlanKey, typename FFTWInterface<REAL>::plan_type> plans;
+  bool imported_wisdom = false;
+
+  void clear() {
+    for (auto &[key, plan] : plans) {
+      FFTWInterface<REAL>::destroy(plan);
+    }
+    plans.clear();
+  }
+};
+
+struct FFTWPlanCache {
+  FFTWPlanCache() {
+    FFTWInterface<double>::init_threads();
+#if FFTW_FLOAT_FOUND
+    FFTWInterface<float>::init_threads();
+#endif
+  }
+
+  // the FFTW planner is not thread safe, plan execution is
+  std::mutex mutex;
+  PrecisionCache<double> double_plans;
+#if FFTW_FLOAT_FOUND
+  PrecisionCache<float> float_plans;
+#endif
+  std::string wisdom_file = default_wisdom_file();
+
+  template <typename REAL>
+  PrecisionCache<REAL> &of();
+};
+
+template <>
+PrecisionCache<double> &FFTWPlanCache::of<double>() {
+  return double_plans;
+}
+
+#if FFTW_FLOAT_FOUND
+template <>
+PrecisionCache<float> &FFTWPlanCache::of<float>() {
+  return float_plans;
+}
+#endif
+
+// never destroyed, see GridMemory
+FFTWPlanCache &cache() {
+  static FFTWPlanCache *c = new FFTWPlanCache();
+  return *c;
+}
+
+unsigned rigor_flag(const FFTWPlanningRigor rigor) {
+  switch (rigor) {
+    case FFTWPlanningRigor::measure:
+      return FFTW_MEASURE;
+    case FFTWPlanningRigor::patient:
+      return FFTW_PATIENT;
+    default:
+      return FFTW_ESTIMATE;
+  }
+}
+
+// Advisory lock on <wisdom file>.lock, held while the wisdom file is read (shared) or written (exclusive). 
+// Without flock (non-POSIX systems) access is not serialized between processes.
+class WisdomFileLock {
+public:
+  WisdomFileLock(const std::string &wisdom_file, const bool exclusive) {
+#ifdef HAVE_FLOCK
+    fd = open((wisdom_file + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0) {
+      flock(fd, exclusive ? LOCK_EX : LOCK_SH);
+    }
+#endif
+  }
+
+  ~WisdomFileLock() {
+#ifdef HAVE_FLOCK
+    if (fd >= 0) {
+      flock(fd, LOCK_UN);
+      close(fd);
+    }
+#endif
+  }
+
+private:
+  int fd = -1;
+};
+
+// The following are called with the mutex of the cache held.
+
+template <typename REAL>
+void import_wisdom(FFTWPlanCache &pc) {
+  PrecisionCache<REAL> &prec = pc.of<REAL>();
+  if (prec.imported_wisdom || pc.wisdom_file.empty()) {
+    return;
+  }
+  const std::string wisdom_file = pc.wisdom_file + FFTWInterface<REAL>::wisdom_suffix();
+  WisdomFileLock lock(wisdom_file, false);
+  FFTWInterface<REAL>::import_wisdom(wisdom_file.c_str()); // a missing file just means there is no wisdom yet
+  prec.imported_wisdom = true;
+}
+
+template <typename REAL>
+void export_wisdom(FFTWPlanCache &pc) {
+  if (pc.wisdom_file.empty()) {
+    return;
+  }
+  const std::string wisdom_file = pc.wisdom_file + FFTWInterface<REAL>::wisdom_suffix();
+  WisdomFileLock lock(wisdom_file, true);
+  // merge the wisdom other processes have stored in the meantime, then replace the file atomically
+  FFTWInterface<REAL>::import_wisdom(wisdom_file.c_str());
+  const std::string tmp_file = wisdom_file + ".tmp";
+  if (FFTWInterface<REAL>::export_wisdom(tmp_file.c_str())) {
+    std::rename(tmp_file.c_str(), wisdom_file.c_str());
+  }
+}
+
+template <typename REAL>
+typename FFTWInterface<REAL>::plan_type get_plan(const TransformKind kind, const std::array<int, 3> &shp, const int howmany, const int alignment, const int direction, const FFTWPlanningRigor rigor, int nthreads) {
+  typedef FFTWInterface<REAL> FI;
+#if FFTW_THREADS_FOUND
+  nthreads = std::max(nthreads, 1);
+#else
+  nthreads = 1;
+#endif
+  FFTWPlanCache &pc = cache();
+  PrecisionCache<REAL> &prec = pc.of<REAL>();
+  const PlanKey key{kind, shp, howmany, alignment, direction, nthreads, rigor};
+  std::lock_guard<std::mutex> lock(pc.mutex);
+  auto search = prec.plans.find(key);
+  if (search != prec.plans.end()) {
+    return search->second;
+  }
+  import_wisdom<REAL>(pc);
+  // plan on a scratch buffer with the same alignment (offset to the 64 byte aligned grid memory)
+  const size_t padded_plane = static_cast<size_t>(shp[1])*2*(shp[2]/2 + 1);
+  size_t scratch_size;
+  switch (kind) {
+    case TransformKind::grid:
+      scratch_size = static_cast<size_t>(howmany)*shp[0]*padded_plane;
+      break;
+    case TransformKind::planes:
+      scratch_size = howmany*padded_plane;
+      break;
+    default:
+      scratch_size = static_cast<size_t>(howmany)*shp[0]*2;
+  }
+  const int offset = alignment / sizeof(REAL);
+  REAL *scratch_memory = allocate_grid_memory<REAL>(scratch_size + offset);
+  REAL *scratch = scratch_memory + offset;
+  typename FI::complex_type *scratch_comp = reinterpret_cast<typename FI::complex_type*>(scratch);
+  FI::plan_with_nthreads(nthreads);
+  typename FI::plan_type plan;
+  if (kind == TransformKind::lines) {
+    plan = FI::c2c_lines(shp[0], howmany, scratch_comp, direction, rigor_flag(rigor));
+  }
+  else if (kind == TransformKind::grid && howmany == 1) {
+    if (direction == FFTW_FORWARD) {
+      plan = FI::r2c_3d(shp, scratch, scratch_comp, rigor_flag(rigor));
+    }
+    else {
+      plan = FI::c2r_3d(shp, scratch_comp, scratch, rigor_flag(rigor));
+    }
+  }
+  else {
+    // consecutive padded grids (or x planes), the real data is embedded in the padded last axis
+    const int rank = kind == TransformKind::grid ? 3 : 2;
+    const int *n = shp.data() + 3 - rank;
+    const int real_embed[3] = {shp[0], shp[1], 2*(shp[2]/2 + 1)};
+    const int comp_embed[3] = {shp[0], shp[1], shp[2]/2 + 1};
+    const int real_dist = static_cast<int>(scratch_size / howmany);
+    const int comp_dist = real_dist / 2;
+    if (direction == FFTW_FORWARD) {
+      plan = FI::r2c_many(rank, n, howmany, scratch, real_embed + 3 - rank, real_dist, scratch_comp, comp_embed + 3 - rank, comp_dist, rigor_flag(rigor));
+    }
+    else {
+      plan = FI::c2r_many(rank, n, howmany, scratch_comp, comp_embed + 3 - rank, comp_dist, scratch, real_embed + 3 - rank, real_dist, rigor_flag(rigor));
+    }
+  }
+  free_grid_memory(scratch_memory);
+  prec.plans[key] = plan;
+  if (rigor != FFTWPlanningRigor::estimate) {
+    export_wisdom<REAL>(pc);
+  }
+  return plan;
+}
+
+}
+
+fftw_plan fftw_r2c_plan(const std::array<int, 3> &shp, double *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<double>(TransformKind::grid, shp, 1, fftw_alignment_of(buffer), FFTW_FORWARD, rigor, nthreads);
+}
+
+fftw_plan fftw_c2r_plan(const std::array<int, 3> &shp, double *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<double>(TransformKind::grid, shp, 1, fftw_alignment_of(buffer), FFTW_BACKWARD, rigor, nthreads);
+}
+
+fftw_plan fftw_r2c_many_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<double>(TransformKind::grid, shp, howmany, fftw_alignment_of(buffer), FFTW_FORWARD, rigor, nthreads);
+}
+
+fftw_plan fftw_c2r_many_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<double>(TransformKind::grid, shp, howmany, fftw_alignment_of(buffer), FFTW_BACKWARD, rigor, nthreads);
+}
+
+fftw_plan fftw_r2c_planes_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<double>(TransformKind::planes, shp, howmany, fftw_alignment_of(buffer), FFTW_FORWARD, rigor, nthreads);
+}
+
+fftw_plan fftw_c2r_planes_plan(const std::array<int, 3> &shp, const int howmany, double *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<double>(TransformKind::planes, shp, howmany, fftw_alignment_of(buffer), FFTW_BACKWARD, rigor, nthreads);
+}
+
+fftw_plan fftw_c2c_lines_plan(const std::array<int, 3> &shp, const int lines, const int direction, double *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<double>(TransformKind::lines, {shp[0], 0, 0}, lines, fftw_alignment_of(buffer), direction, rigor, nthreads);
+}
+
+#if FFTW_FLOAT_FOUND
+fftwf_plan fftwf_r2c_plan(const std::array<int, 3> &shp, float *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<float>(TransformKind::grid, shp, 1, fftwf_alignment_of(buffer), FFTW_FORWARD, rigor, nthreads);
+}
+
+fftwf_plan fftwf_c2r_plan(const std::array<int, 3> &shp, float *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<float>(TransformKind::grid, shp, 1, fftwf_alignment_of(buffer), FFTW_BACKWARD, rigor, nthreads);
+}
+
+fftwf_plan fftwf_r2c_many_plan(const std::array<int, 3> &shp, const int howmany, float *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<float>(TransformKind::grid, shp, howmany, fftwf_alignment_of(buffer), FFTW_FORWARD, rigor, nthreads);
+}
+
+fftwf_plan fftwf_c2r_many_plan(const std::array<int, 3> &shp, const int howmany, float *buffer, const FFTWPlanningRigor rigor, const int nthreads) {
+  return get_plan<float>(TransformKind::grid, shp, howmany, fftwf_alignment_of(buffer), FFTW_BACKWARD, rigor, nthreads);
+}
+#endif
+
+void clear_fftw_plan_cache() {
+  FFTWPlanCache &pc = cache();
+  std::lock_guard<std::mutex> lock(pc.mutex);
+  pc.double_plans.clear();
+#if FFTW_FLOAT_FOUND
+  pc.float_plans.clear();
+#endif
+}
+
+bool fftw_threads_available() {
+  return FFTW_THREADS_FOUND;
+}
+
+bool fftw_float_available() {
+  return FFTW_FLOAT_FOUND;
+}
+
+size_t fftw_plan_cache_size() {
+  FFTWPlanCache &pc = cache();
+  std::lock_guard<std::mutex> lock(pc.mutex);
+#if FFTW_FLOAT_FOUND
+  return pc.double_plans.plans.size() + pc.float_plans.plans.size();
+#else
+  return pc.double_plans.plans.size();
+#endif
+}
+
+void set_fftw_wisdom_file(const std::string &path) {
+  FFTWPlanCache &pc = cache();
+  std::lock_guard<std::mutex> lock(pc.mutex);
+  pc.wisdom_file = path;
+  pc.double_plans.imported_wisdom = false;
+#if FFTW_FLOAT_FOUND
+  pc.float_plans.imported_wisdom = false;
+#endif
+}
+
+std::string fftw_wisdom_file() {
+  FFTWPlanCache &pc = cache();
+  std::lock_guard<std::mutex> lock(pc.mutex);
+  return pc.wisdom_file;
+}
+
+void generate_fftw_wisdom(const std::vector<std::array<int, 3>> &shapes, const FFTWPlanningRigor rigor, const int nthreads, const std::vector<int> &components) {
+  // grids are allocated with allocate_grid_memory, i.e. aligned
+  for (const std::array<int, 3> &shp : shapes) {
+    for (const int howmany : components) {
+      get_plan<double>(TransformKind::grid, shp, howmany, 0, FFTW_FORWARD, rigor, nthreads);
+      get_plan<double>(TransformKind::grid, shp, howmany, 0, FFTW_BACKWARD, rigor, nthreads);
+#if FFTW_FLOAT_FOUND
+      get_plan<float>(TransformKind::grid, shp, howmany, 0, FFTW_FORWARD, rigor, nthreads);
+      get_plan<float>(TransformKind::grid, shp, howmany, 0, FFTW_BACKWARD, rigor, nthreads);
+#endif
+    }
+  }
+}
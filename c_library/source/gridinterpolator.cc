@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#include "GridMemory.h"
+#include "GridInterpolator.h"
+
+namespace {
+
+int thread_count(const int nthreads) {
+#ifdef _OPENMP
+  return nthreads > 0 ? nthreads : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// Weights of the K voxels of the kernel at the fractional position t within the voxel
+template <int K>
+inline void kernel_weights(const double t, double *w);
+
+template <>
+inline void kernel_weights<2>(const double t, double *w) {
+  w[0] = 1. - t;
+  w[1] = t;
+}
+
+template <>
+inline void kernel_weights<4>(const double t, double *w) {
+  // cubic convolution with a = -1/2 (Catmull-Rom spline)
+  const double t2 = t*t;
+  w[0] = ((-0.5*t + 1.)*t - 0.5)*t;
+  w[1] = (1.5*t - 2.5)*t2 + 1.;
+  w[2] = ((-1.5*t + 2.)*t + 0.5)*t;
+  w[3] = (0.5*t - 0.5)*t2;
+}
+
+} // namespace
+
+GridInterpolator::GridInterpolator(const double *grid, const std::array<int, 3> &shape, const std::array<double, 3> &rpt, const std::array<double, 3> &inc,
+                                   const InterpolationKernel kernel, const GridBoundary boundary, const int brick_size, const std::array<std::ptrdiff_t, 3> &strides)
+    : shp(shape), rpt(rpt), inc(inc), kern(kernel), bound(boundary), ncomp(1), brick(brick_size) {
+  build({grid, nullptr, nullptr}, strides);
+}
+
+GridInterpolator::GridInterpolator(const std::array<double *, 3> &grid, const std::array<int, 3> &shape, const std::array<double, 3> &rpt, const std::array<double, 3> &inc,
+                                   const InterpolationKernel kernel, const GridBoundary boundary, const int brick_size, const std::array<std::ptrdiff_t, 3> &strides)
+    : shp(shape), rpt(rpt), inc(inc), kern(kernel), bound(boundary), ncomp(3), brick(brick_size) {
+  build({grid[0], grid[1], grid[2]}, strides);
+}
+
+GridInterpolator::~GridInterpolator() {
+  free_grid_memory(bricks);
+}
+
+void GridInterpolator::build(const std::array<const double *, 3> &grid, const std::array<std::ptrdiff_t, 3> &strides) {
+  for (int d = 0; d < 3; ++d) {
+    if (shp[d] < 1) {
+      throw std::invalid_argument("GridInterpolator: the grid needs at least one voxel along each axis.");
+    }
+    if (inc[d] <= 0.) {
+      throw std::invalid_argument("GridInterpolator: the increments of the grid have to be positive.");
+    }
+  }
+  if (brick < 1) {
+    throw std::invalid_argument("GridInterpolator: the brick size has to be positive.");
+  }
+
+  apron_lo = (kern == InterpolationKernel::tricubic) ? 1 : 0;
+  apron_hi = (kern == InterpolationKernel::tricubic) ? 2 : 1;
+  edge = brick + apron_lo + apron_hi;
+  for (int d = 0; d < 3; ++d) {
+    bricks_per_axis[d] = (shp[d] + brick - 1) / brick;
+  }
+  brick_count = static_cast<size_t>(bricks_per_axis[0])*bricks_per_axis[1]*bricks_per_axis[2];
+  brick_stride = static_cast<size_t>(ncomp)*edge*edge*edge;
+  bricks = allocate_grid_memory(brick_count*brick_stride);
+
+  std::array<std::ptrdiff_t, 3> st = strides;
+  if (st[0] == 0 && st[1] == 0 && st[2] == 0) {
+    st = {static_cast<std::ptrdiff_t>(shp[1])*shp[2], shp[2], 1};
+  }
+
+#ifdef _OPENMP
+  const int nthreads = thread_count(0);
+  #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1 && brick_count > 1)
+#endif
+  for (long n = 0; n < static_cast<long>(brick_count); ++n) {
+    const int bi = n / (static_cast<long>(bricks_per_axis[1])*bricks_per_axis[2]);
+    const int bj = (n / bricks_per_axis[2]) % bricks_per_axis[1];
+    const int bk = n % bricks_per_axis[2];
+    double *dst = bricks + n*brick_stride;
+    for (int a = 0; a < edge; ++a) {
+      const std::ptrdiff_t si = wrap(0, bi*brick + a - apron_lo)*st[0];
+      for (int b = 0; b < edge; ++b) {
+        const std::ptrdiff_t sij = si + wrap(1, bj*brick + b - apron_lo)*st[1];
+        for (int c = 0; c < edge; ++c) {
+          const std::ptrdiff_t s = sij + wrap(2, bk*brick + c - apron_lo)*st[2];
+          for (int m = 0; m < ncomp; ++m) {
+            *dst++ = grid[m][s];
+          }
+        }
+      }
+    }
+  }
+}
+
+int GridInterpolator::wrap(const int d, const int i) const {
+  if (bound == GridBoundary::periodic) {
+    const int j = i % shp[d];
+    return j < 0 ? j + shp[d] : j;
+  }
+  return std::min(std::max(i, 0), shp[d] - 1);
+}
+
+const double *GridInterpolator::locate(const double x, const double y, const double z, std::array<int, 3> &offset, std::array<double, 3> &t) const {
+  const std::array<double, 3> pos{x, y, z};
+  std::array<int, 3> b;
+  for (int d = 0; d < 3; ++d) {
+    double u = (pos[d] - rpt[d]) / inc[d];
+    if (bound == GridBoundary::periodic) {
+      u -= std::floor(u / shp[d]) * shp[d];
+    } else {
+      u = std::min(std::max(u, 0.), static_cast<double>(shp[d] - 1));
+    }
+    const int i = std::min(static_cast<int>(u), shp[d] - 1);
+    t[d] = u - i;
+    b[d] = i / brick;
+    // the lower corner of the kernel (voxel i - apron_lo) is stored at i - apron_lo - (b*brick - apron_lo)
+    offset[d] = i - b[d]*brick;
+  }
+  return bricks + ((static_cast<size_t>(b[0])*bricks_per_axis[1] + b[1])*bricks_per_axis[2] + b[2])*brick_stride;
+}
+
+template <int K, int NCOMP>
+void GridInterpolator::sample(const double x, const double y, const double z, double *values) const {
+  std::array<int, 3> o;
+  std::array<double, 3> t;
+  const double *b = locate(x, y, z, o, t);
+  double w[3][K];
+  for (int d = 0; d < 3; ++d) {
+    kernel_weights<K>(t[d], w[d]);
+  }
+
+  double acc[NCOMP] = {};
+  for (int a = 0; a < K; ++a) {
+    for (int c = 0; c < K; ++c) {
+      const double wab = w[0][a] * w[1][c];
+      const double *line = b + ((static_cast<size_t>(o[0] + a)*edge + o[1] + c)*edge + o[2])*NCOMP;
+      for (int e = 0; e < K; ++e) {
+        const double wabe = wab * w[2][e];
+        for (int m = 0; m < NCOMP; ++m) {
+          acc[m] += wabe * line[e*NCOMP + m];
+        }
+      }
+    }
+  }
+  for (int m = 0; m < NCOMP; ++m) {
+    values[m] = acc[m];
+  }
+}
+
+template <int K, int NCOMP, typename STORE>
+void GridInterpolator::sample_batch(const double *x, const double *y, const double *z, const size_t n, const int nthreads, STORE &&store) const {
+  // static scheduling hands out consecutive positions, which (along rays) fall into the same bricks
+  // (sample and the stores of at_positions only do arithmetic and assignments, hence no ParallelExceptions in the hot loop)
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1 && n > 1024)
+#endif
+  for (long s = 0; s < static_cast<long>(n); ++s) {
+    double v[NCOMP];
+    sample<K, NCOMP>(x[s], y[s], z[s], v);
+    store(s, v);
+  }
+}
+
+template <typename STORE>
+void GridInterpolator::dispatch_batch(const double *x, const double *y, const double *z, const size_t n, const int nthreads, STORE &&store) const {
+  const int nt = thread_count(nthreads);
+  if (kern == InterpolationKernel::tricubic) {
+    if (ncomp == 1) {
+      sample_batch<4, 1>(x, y, z, n, nt, store);
+    } else {
+      sample_batch<4, 3>(x, y, z, n, nt, store);
+    }
+  } else {
+    if (ncomp == 1) {
+      sample_batch<2, 1>(x, y, z, n, nt, store);
+    } else {
+      sample_batch<2, 3>(x, y, z, n, nt, store);
+    }
+  }
+}
+
+void GridInterpolator::interpolate(const double x, const double y, const double z, double *values) const {
+  if (kern == InterpolationKernel::tricubic) {
+    if (ncomp == 1) {
+      sample<4, 1>(x, y, z, values);
+    } else {
+      sample<4, 3>(x, y, z, values);
+    }
+  } else {
+    if (ncomp == 1) {
+      sample<2, 1>(x, y, z, values);
+    } else {
+      sample<2, 3>(x, y, z, values);
+    }
+  }
+}
+
+double GridInterpolator::at_position(const double x, const double y, const double z) const {
+  std::array<double, 3> v;
+  interpolate(x, y, z, v.data());
+  return v[0];
+}
+
+std::array<double, 3> GridInterpolator::vector_at_position(const double x, const double y, const double z) const {
+  std::array<double, 3> v{0., 0., 0.};
+  interpolate(x, y, z, v.data());
+  return v;
+}
+
+void GridInterpolator::at_positions(const double *x, const double *y, const double *z, const size_t n, double *out, const int nthreads) const {
+  if (ncomp != 1) {
+    throw std::invalid_argument("GridInterpolator: a vector grid needs one output array per component.");
+  }
+  dispatch_batch(x, y, z, n, nthreads, [out](const long s, const double *v) { out[s] = v[0]; });
+}
+
+void GridInterpolator::at_positions(const double *x, const double *y, const double *z, const size_t n, std::array<double *, 3> out, const int nthreads) const {
+  if (ncomp != 3) {
+    throw std::invalid_argument("GridInterpolator: a scalar grid needs a single output array.");
+  }
+  dispatch_batch(x, y, z, n, nthreads, [out](const long s, const double *v) {
+    out[0][s] = v[0];
+    out[1][s] = v[1];
+    out[2][s] = v[2];
+  });
+}
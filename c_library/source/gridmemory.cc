@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cassert>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+  #define HAVE_MMAP 1
+#endif
+
+#include "GridMemory.h"
+
+namespace {
+
+const size_t huge_page_size = 2*1024*1024;
+
+struct GridMemoryPool {
+  std::mutex mutex;
+  // released blocks, keyed by their (rounded) size in bytes
+  std::unordered_map<size_t, std::vector<void*>> free_blocks;
+  // size of the blocks currently in use
+  std::unordered_map<void*, size_t> used_blocks;
+  size_t pooled_bytes = 0;
+  size_t pool_limit = size_t(1) << 30;
+  bool use_huge_pages = true;
+};
+
+// never destroyed, since python may release arrays after static destruction has started
+GridMemoryPool &pool() {
+  static GridMemoryPool *p = new GridMemoryPool();
+  return *p;
+}
+
+size_t round_up(const size_t n, const size_t m) {
+  return ((n + m - 1) / m) * m;
+}
+
+}
+
+double* allocate_grid_memory(const size_t n) {
+  GridMemoryPool &gm = pool();
+  size_t bytes = round_up(std::max<size_t>(n, 1)*sizeof(double), grid_memory_alignment);
+  const bool huge = bytes >= huge_page_size;
+  if (huge) {
+    bytes = round_up(bytes, huge_page_size);
+  }
+  {
+    std::lock_guard<std::mutex> lock(gm.mutex);
+    auto search = gm.free_blocks.find(bytes);
+    if (search != gm.free_blocks.end() && !search->second.empty()) {
+      void *ptr = search->second.back();
+      search->second.pop_back();
+      gm.pooled_bytes -= bytes;
+      gm.used_blocks[ptr] = bytes;
+      return static_cast<double*>(ptr);
+    }
+  }
+  void *ptr = std::aligned_alloc(huge ? huge_page_size : grid_memory_alignment, bytes);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  std::lock_guard<std::mutex> lock(gm.mutex);
+#ifdef MADV_HUGEPAGE
+  if (huge && gm.use_huge_pages) {
+    madvise(ptr, bytes, MADV_HUGEPAGE); // only a hint, failure is harmless
+  }
+#endif
+  gm.used_blocks[ptr] = bytes;
+  return static_cast<double*>(ptr);
+}
+
+void free_grid_memory(double* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  GridMemoryPool &gm = pool();
+  std::lock_guard<std::mutex> lock(gm.mutex);
+  auto search = gm.used_blocks.find(ptr);
+  assert(search != gm.used_blocks.end() && "pointer was not allocated by allocate_grid_memory");
+  if (search == gm.used_blocks.end()) {
+    return;
+  }
+  const size_t bytes = search->second;
+  gm.used_blocks.erase(search);
+  if (gm.pooled_bytes + bytes > gm.pool_limit) {
+    std::free(ptr);
+    return;
+  }
+  gm.free_blocks[bytes].push_back(ptr);
+  gm.pooled_bytes += bytes;
+}
+
+float* allocate_float_grid_memory(const size_t n) {
+  return reinterpret_cast<float*>(allocate_grid_memory((n + 1) / 2));
+}
+
+void free_grid_memory(float* ptr) {
+  free_grid_memory(reinterpret_cast<double*>(ptr));
+}
+
+void set_grid_memory_pool_limit(const size_t bytes) {
+  GridMemoryPool &gm = pool();
+  {
+    std::lock_guard<std::mutex> lock(gm.mutex);
+    gm.pool_limit = bytes;
+    if (gm.pooled_bytes <= bytes) {
+      return;
+    }
+  }
+  clear_grid_memory_pool();
+}
+
+void set_grid_memory_huge_pages(const bool use_huge_pages) {
+  GridMemoryPool &gm = pool();
+  std::lock_guard<std::mutex> lock(gm.mutex);
+  gm.use_huge_pages = use_huge_pages;
+}
+
+void clear_grid_memory_pool() {
+  GridMemoryPool &gm = pool();
+  std::lock_guard<std::mutex> lock(gm.mutex);
+  for (auto &[bytes, blocks] : gm.free_blocks) {
+    for (void *ptr : blocks) {
+      std::free(ptr);
+    }
+  }
+  gm.free_blocks.clear();
+  gm.pooled_bytes = 0;
+}
+
+size_t grid_memory_pool_size() {
+  GridMemoryPool &gm = pool();
+  std::lock_guard<std::mutex> lock(gm.mutex);
+  return gm.pooled_bytes;
+}
+
+MappedGridFile::MappedGridFile(const std::string &path, const size_t n, const bool temporary) : file_path(path), n(n), temporary(temporary) {
+#ifdef HAVE_MMAP
+  const size_t bytes = std::max<size_t>(n, 1)*sizeof(double);
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Could not create the grid file " + path + ".");
+  }
+  if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    close(fd);
+    unlink(path.c_str());
+    throw std::runtime_error("Could not resize the grid file " + path + ", not enough disk space?");
+  }
+  void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    close(fd);
+    unlink(path.c_str());
+    throw std::runtime_error("Could not map the grid file " + path + " into memory.");
+  }
+  ptr = static_cast<double*>(p);
+#else
+  throw std::runtime_error("Grid files can not be mapped into memory on this system.");
+#endif
+}
+
+MappedGridFile::~MappedGridFile() {
+#ifdef HAVE_MMAP
+  munmap(ptr, std::max<size_t>(n, 1)*sizeof(double));
+  close(fd);
+  if (temporary) {
+    unlink(file_path.c_str());
+  }
+#endif
+}
@@ -3,23 +3,24 @@
 #include "helpers.h"
 
 // J. L. Han et al 2018 ApJS 234 11
-vector HanMagneticField::_at_position(const double &x, const double &y, const double &z, const HanMagneticField &p) const
+template <typename T>
+vector_t<T> HanMagneticField::_at_position(const double &x, const double &y, const double &z, const HanMagneticField &p) const
 {
-  vector B_cyl{{0., 0., 0.}};
+  vector_t<T> B_cyl{{0., 0., 0.}};
   const double r = sqrt(x * x + y * y);
   const double phi = atan2(y, x);
 
   if (r < p.R_min || r > p.R_max)
     return B_cyl;
 
-  number B_0 = 0.;
+  T B_0 = 0.;
 
-  auto p_ang = p.B_p * M_PI / 180.;
+  auto p_ang = T(p.B_p) * M_PI / 180.;
   const double phi_han = -(phi + M_PI); // nneeded to fix different coordinate system convention
   
-  number R_0 = r * exp(phi_han * tan(p_ang));  // eq. 4 is wrong, need to change psi and phi!
+  T R_0 = r * exp(phi_han * tan(p_ang));  // eq. 4 is wrong, need to change psi and phi!
 
-  std::array<number, 6> B_s = {p.B_s1, p.B_s2, p.B_s3, p.B_s4, p.B_s5, p.B_s6};  // table 5
+  std::array<T, 6> B_s = {T(p.B_s1), T(p.B_s2), T(p.B_s3), T(p.B_s4), T(p.B_s5), T(p.B_s6)};  // table 5
 
   if (R_0 < p.R_s[0])
   {
@@ -42,12 +43,12 @@ vector HanMagneticField::_at_position(const double &x, const double &y, const do
     }
   }
 
-  number B_r = B_0 * exp(-r / p.A) * exp(-std::abs(z) / p.H);  // eq. 3
+  T B_r = B_0 * exp(-r / T(p.A)) * exp(-std::abs(z) / T(p.H));  // eq. 3
 
   B_cyl[0] = B_r * sin(p_ang);
   B_cyl[1] = B_r * cos(p_ang);
 
-  vector B_vec3 = Cyl2Cart<vector>(phi, B_cyl);
+  vector_t<T> B_vec3 = Cyl2Cart<vector_t<T>>(phi, B_cyl);
   return B_vec3;
 }
 
@@ -55,11 +56,15 @@ vector HanMagneticField::_at_position(const double &x, const double &y, const do
 
 Eigen::MatrixXd HanMagneticField::_jac(const double &x, const double &y, const double &z, HanMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, HanMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.B_p, p.A, p.H, p.B_s1, p.B_s2, p.B_s3, p.B_s4, p.B_s4, p.B_s5, p.B_s6), ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number HanMagneticField::*>> parameters{
+      {"B_p", &HanMagneticField::B_p}, {"A", &HanMagneticField::A}, {"H", &HanMagneticField::H},
+      {"B_s1", &HanMagneticField::B_s1}, {"B_s2", &HanMagneticField::B_s2}, {"B_s3", &HanMagneticField::B_s3},
+      {"B_s4", &HanMagneticField::B_s4}, {"B_s5", &HanMagneticField::B_s5}, {"B_s6", &HanMagneticField::B_s6}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
 #endif
+
+template vector_t<double> HanMagneticField::_at_position<double>(const double &, const double &, const double &, const HanMagneticField &) const;
+template class RegularVectorFieldModel<HanMagneticField>;
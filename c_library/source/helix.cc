@@ -2,17 +2,18 @@
 #include "units.h"
 #include "Helix.h"
 
-vector HelixMagneticField::_at_position(const double &x, const double &y, const double &z, const HelixMagneticField &p) const
+template <typename T>
+vector_t<T> HelixMagneticField::_at_position(const double &x, const double &y, const double &z, const HelixMagneticField &p) const
 {
 
   const double phi = std::atan2(y, x);         // azimuthal angle in cylindrical coordinates
   const double r = std::sqrt(x * x + y * y); // radius in cylindrical coordinates
-  vector b{{0.0, 0.0, 0.0}};
+  vector_t<T> b{{0.0, 0.0, 0.0}};
   if ((r > rmin) && (r < rmax))
   {
-    b[0] = std::cos(phi) * p.ampx;
-    b[1] = std::sin(phi) * p.ampy;
-    b[2] = p.ampz;
+    b[0] = std::cos(phi) * T(p.ampx);
+    b[1] = std::sin(phi) * T(p.ampy);
+    b[2] = T(p.ampz);
   }
   return b;
 }
@@ -21,11 +22,13 @@ vector HelixMagneticField::_at_position(const double &x, const double &y, const
 
 Eigen::MatrixXd HelixMagneticField::_jac(const double &x, const double &y, const double &z, HelixMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, HelixMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.ampx, p.ampy, p.ampz), ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number HelixMagneticField::*>> parameters{
+      {"ampx", &HelixMagneticField::ampx}, {"ampy", &HelixMagneticField::ampy}, {"ampz", &HelixMagneticField::ampz}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
 #endif
+
+template vector_t<double> HelixMagneticField::_at_position<double>(const double &, const double &, const double &, const HelixMagneticField &) const;
+template class RegularVectorFieldModel<HelixMagneticField>;
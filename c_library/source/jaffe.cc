@@ -4,28 +4,29 @@
 #include "units.h"
 #include "Jaffe.h"
 
-vector JaffeMagneticField::_at_position(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
+template <typename T>
+vector_t<T> JaffeMagneticField::_at_position(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
 {
   if (x == 0. && y == 0. && z == 0.)
   {
-    return vector{{0., 0., 0.}};
+    return vector_t<T>{{0., 0., 0.}};
   }
-  number inner_b{0};
+  T inner_b{0};
   if (p.ring)
   {
-    inner_b = p.ring_amp;
+    inner_b = T(p.ring_amp);
   }
   else if (p.bar)
   {
-    inner_b = p.bar_amp;
+    inner_b = T(p.bar_amp);
   }
 
-  vector bhat = orientation(x, y, z, p);
-  vector btot{{0., 0., 0.}};
+  vector_t<T> bhat = orientation<T>(x, y, z, p);
+  vector_t<T> btot{{0., 0., 0.}};
 
-  auto scaling = radial_scaling(x, y, p) *
-                 (p.disk_amp * disk_scaling(z, p) +
-                  p.halo_amp * halo_scaling(z, p));
+  auto scaling = radial_scaling<T>(x, y, p) *
+                 (T(p.disk_amp) * disk_scaling<T>(z, p) +
+                  T(p.halo_amp) * halo_scaling<T>(z, p));
 
   for (int i = 0; i < bhat.size(); ++i)
   {
@@ -36,7 +37,7 @@ vector JaffeMagneticField::_at_position(const double &x, const double &y, const
 
 
   // compress factor for each arm or for ring/bar
-  std::vector<number> arm = arm_compress(x, y, z, p);
+  std::vector<T> arm = arm_compress<T>(x, y, z, p);
   // only inner region
   if (arm.size() == 1)
   {
@@ -50,7 +51,7 @@ vector JaffeMagneticField::_at_position(const double &x, const double &y, const
   // spiral arm region
   else
   {
-    std::array<number, 4> arm_amp = {p.arm_amp1, p.arm_amp2, p.arm_amp3, p.arm_amp4};
+    std::array<T, 4> arm_amp = {T(p.arm_amp1), T(p.arm_amp2), T(p.arm_amp3), T(p.arm_amp4)};
     for (decltype(arm.size()) i = 0; i < arm.size(); ++i)
     {
       for (int j = 0; j < bhat.size(); ++j)
@@ -64,26 +65,27 @@ vector JaffeMagneticField::_at_position(const double &x, const double &y, const
 
 
 
-vector JaffeMagneticField::orientation(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
+template <typename T>
+vector_t<T> JaffeMagneticField::orientation(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
 {
   if (x == 0. && y == 0.)
   {
-    return vector{{0., 0., 0.}};
+    return vector_t<T>{{0., 0., 0.}};
   }
 
   const double r{
       sqrt(x * x + y * y)}; // cylindrical frame
-  const auto r_lim = p.ring_r;
-  const auto bar_lim{p.bar_a + 0.5 * p.comp_d};
-  auto arm_pitch = p.arm_pitch * M_PI /180;
+  const auto r_lim = T(p.ring_r);
+  const auto bar_lim{T(p.bar_a) + 0.5 * T(p.comp_d)};
+  auto arm_pitch = T(p.arm_pitch) * M_PI /180;
   const auto cos_p = cos(arm_pitch);
   const auto sin_p = sin(arm_pitch); // pitch angle
 
-  vector tmp{{0., 0., 0.}};
-  number quadruple{1.};
+  vector_t<T> tmp{{0., 0., 0.}};
+  T quadruple{1.};
   if (r < 0.5) // forbidden region
     return tmp;
-  if (z > p.disk_z0)
+  if (z > T(p.disk_z0))
     quadruple = (1 - 2 * p.quadruple);
   // molecular ring
   if (p.ring)
@@ -104,8 +106,8 @@ vector JaffeMagneticField::orientation(const double &x, const double &y, const d
   // elliptical bar (replace molecular ring)
   else if (p.bar)
   {
-    const auto cos_phi = cos(p.bar_phi0);
-    const auto sin_phi = sin(p.bar_phi0);
+    const auto cos_phi = cos(T(p.bar_phi0));
+    const auto sin_phi = sin(T(p.bar_phi0));
     auto new_x = cos_phi * x - sin_phi * y;
     auto new_y = sin_phi * x + cos_phi * y;
     double sgn_nx = 1.;
@@ -127,7 +129,7 @@ vector JaffeMagneticField::orientation(const double &x, const double &y, const d
     { if (new_y!= 0) 
       {
       new_x = sgn_ny;
-      new_y = -sgn_ny * (new_x / new_y) * p.bar_b * p.bar_b / (p.bar_a * p.bar_a);
+      new_y = -sgn_ny * (new_x / new_y) * T(p.bar_b) * T(p.bar_b) / (T(p.bar_a) * T(p.bar_a));
       tmp[0] = (cos_phi * new_x + sin_phi * new_y) * (1 - 2 * p.bss);
       tmp[1] = (-sin_phi * new_x + cos_phi * new_y) * (1 - 2 * p.bss);
         // versor
@@ -150,30 +152,32 @@ vector JaffeMagneticField::orientation(const double &x, const double &y, const d
   return tmp;
 }
 
-number JaffeMagneticField::radial_scaling(const double &x, const double &y, const JaffeMagneticField &p) const
+template <typename T>
+T JaffeMagneticField::radial_scaling(const double &x, const double &y, const JaffeMagneticField &p) const
 {
   const double r2 = x * x + y * y;
   // separate into 3 parts for better view
-  const auto s1{1. - exp(-r2 / (p.r_inner * p.r_inner))};
-  const auto s2{exp(-r2 / (p.r_scale * p.r_scale))};
-  const auto s3 = p.r_peak == 0 ? 1. : exp(-r2 * r2 / (p.r_peak * p.r_peak * p.r_peak * p.r_peak));
+  const auto s1{1. - exp(-r2 / (T(p.r_inner) * T(p.r_inner)))};
+  const auto s2{exp(-r2 / (T(p.r_scale) * T(p.r_scale)))};
+  const auto s3 = T(p.r_peak) == 0 ? 1. : exp(-r2 * r2 / (T(p.r_peak) * T(p.r_peak) * T(p.r_peak) * T(p.r_peak)));
   return s1 * (s2 + s3);
 }
 
-std::vector<number> JaffeMagneticField::arm_compress(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
+template <typename T>
+std::vector<T> JaffeMagneticField::arm_compress(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
 {
-  const auto r{sqrt(x * x + y * y) / p.comp_r};
-  const auto c0{1. / p.comp_c - 1.};
-  std::vector<number> a0 = dist2arm(x, y, p);
+  const auto r{sqrt(x * x + y * y) / T(p.comp_r)};
+  const auto c0{1. / T(p.comp_c) - 1.};
+  std::vector<T> a0 = dist2arm<T>(x, y, p);
 
-  const auto r_scaling{radial_scaling(x, y, p)};
-  const auto z_scaling{arm_scaling(z, p)};
+  const auto r_scaling{radial_scaling<T>(x, y, p)};
+  const auto z_scaling{arm_scaling<T>(z, p)};
   // for saving computing time
-  const auto d0_inv{(r_scaling * z_scaling) / p.comp_d};
+  const auto d0_inv{(r_scaling * z_scaling) / T(p.comp_d)};
   auto factor{c0 * r_scaling * z_scaling};
   if (r > 1.)
   {
-    auto cdrop{pow(r, -p.comp_p)};
+    auto cdrop{pow(r, -T(p.comp_p))};
     for (decltype(a0.size()) i = 0; i < a0.size(); ++i)
     {
       a0[i] = factor * cdrop * exp(-a0[i] * a0[i] * cdrop * cdrop * d0_inv * d0_inv);
@@ -189,19 +193,20 @@ std::vector<number> JaffeMagneticField::arm_compress(const double &x, const doub
   return a0;
 }
 
-std::vector<number> JaffeMagneticField::arm_compress_dust(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
+template <typename T>
+std::vector<T> JaffeMagneticField::arm_compress_dust(const double &x, const double &y, const double &z, const JaffeMagneticField &p) const
 {
-  const auto r{sqrt(x * x + y * y) / p.comp_r};
-  const auto c0{1. / p.comp_c - 1.};
-  std::vector<number> a0 = dist2arm(x, y, p);
-  const auto r_scaling{radial_scaling(x, y, p)};
-  const auto z_scaling{arm_scaling(z, p)};
+  const auto r{sqrt(x * x + y * y) / T(p.comp_r)};
+  const auto c0{1. / T(p.comp_c) - 1.};
+  std::vector<T> a0 = dist2arm<T>(x, y, p);
+  const auto r_scaling{radial_scaling<T>(x, y, p)};
+  const auto z_scaling{arm_scaling<T>(z, p)};
   // only difference from normal arm_compress
-  const auto d0_inv{(r_scaling) / p.comp_d};
+  const auto d0_inv{(r_scaling) / T(p.comp_d)};
   auto factor{c0 * r_scaling * z_scaling};
   if (r > 1)
   {
-    auto cdrop{pow(r, -p.comp_p)};
+    auto cdrop{pow(r, -T(p.comp_p))};
     for (decltype(a0.size()) i = 0; i < a0.size(); ++i)
     {
       a0[i] = factor * cdrop * exp(-a0[i] * a0[i] * cdrop * cdrop * d0_inv * d0_inv);
@@ -217,12 +222,13 @@ std::vector<number> JaffeMagneticField::arm_compress_dust(const double &x, const
   return a0;
 }
 
-std::vector<number> JaffeMagneticField::dist2arm(const double &x, const double &y, const JaffeMagneticField &p) const
+template <typename T>
+std::vector<T> JaffeMagneticField::dist2arm(const double &x, const double &y, const JaffeMagneticField &p) const
 {
   const double r{sqrt(x * x + y * y)};
-  const auto r_lim{p.ring_r};
-  const auto bar_lim{p.bar_a + 0.5 * p.comp_d};
-  auto arm_pitch = p.arm_pitch * M_PI /180;
+  const auto r_lim{T(p.ring_r)};
+  const auto bar_lim{T(p.bar_a) + 0.5 * T(p.comp_d)};
+  auto arm_pitch = T(p.arm_pitch) * M_PI /180;
   const auto cos_p = cos(arm_pitch);
   const auto sin_p = sin(arm_pitch); // pitch angle
   const auto beta_inv{-sin_p / cos_p};
@@ -245,7 +251,7 @@ std::vector<number> JaffeMagneticField::dist2arm(const double &x, const double &
     }
   }
 
-  std::vector<number> d;
+  std::vector<T> d;
 
   if (theta < 0)
     theta += 2 * M_PI;
@@ -255,22 +261,22 @@ std::vector<number> JaffeMagneticField::dist2arm(const double &x, const double &
     // in molecular ring, return oly first element of d is used
     if (r < r_lim)
     {
-      d.push_back(abs(p.ring_r - r));
+      d.push_back(abs(T(p.ring_r) - r));
     }
-    // in spiral arm, return vector with arm_num elements
+    // in spiral arm, return vector_t<T> with arm_num elements
     else
     {
       // loop through arms
-      std::vector<number> arm_phi{p.arm_phi1, p.arm_phi2, p.arm_phi3, p.arm_phi4};
+      std::vector<T> arm_phi{T(p.arm_phi1), T(p.arm_phi2), T(p.arm_phi3), T(p.arm_phi4)};
       for (int i = 0; i < p.arm_num; ++i)
       {
         auto d_ang{arm_phi[i]*M_PI/180 - theta};
         auto d_rad{
-            abs(p.arm_r0 * exp(d_ang * beta_inv) - r)};
+            abs(T(p.arm_r0) * exp(d_ang * beta_inv) - r)};
         auto d_rad_p{
-            abs(p.arm_r0 * exp((d_ang + 2 * M_PI) * beta_inv) - r)};
+            abs(T(p.arm_r0) * exp((d_ang + 2 * M_PI) * beta_inv) - r)};
         auto d_rad_m{
-            abs(p.arm_r0 * exp((d_ang - 2 * M_PI) * beta_inv) - r)};
+            abs(T(p.arm_r0) * exp((d_ang - 2 * M_PI) * beta_inv) - r)};
         d.push_back(std::min(std::min(d_rad, d_rad_p), d_rad_m) * cos_p);
       }
     }
@@ -281,26 +287,26 @@ std::vector<number> JaffeMagneticField::dist2arm(const double &x, const double &
       d.push_back(0.);
     }
     else {
-      const auto cos_tmp{cos(p.bar_phi0) * x / r - sin(p.bar_phi0) * y / r};
+      const auto cos_tmp{cos(T(p.bar_phi0)) * x / r - sin(T(p.bar_phi0)) * y / r};
       // cos(phi)cos(phi0) - sin(phi)sin(phi0)
-      const auto sin_tmp{cos(p.bar_phi0) * y / r + sin(p.bar_phi0) * x / r};
+      const auto sin_tmp{cos(T(p.bar_phi0)) * y / r + sin(T(p.bar_phi0)) * x / r};
       // sin(phi)cos(phi0) + cos(phi)sin(phi0)
-      // in bar, return single element vector
+      // in bar, return single element vector_t<T>
       if (r < bar_lim)
       {
-        d.push_back(abs(p.bar_a * p.bar_b / sqrt(p.bar_a * p.bar_a * sin_tmp * sin_tmp + p.bar_b * p.bar_b * cos_tmp * cos_tmp) - r));
+        d.push_back(abs(T(p.bar_a) * T(p.bar_b) / sqrt(T(p.bar_a) * T(p.bar_a) * sin_tmp * sin_tmp + T(p.bar_b) * T(p.bar_b) * cos_tmp * cos_tmp) - r));
       }
-      // in spiral arm, return vector with arm_num elements
+      // in spiral arm, return vector_t<T> with arm_num elements
       else
       {
         // loop through arms
-        std::vector<number> arm_phi{p.arm_phi1, p.arm_phi2, p.arm_phi3, p.arm_phi4};
+        std::vector<T> arm_phi{T(p.arm_phi1), T(p.arm_phi2), T(p.arm_phi3), T(p.arm_phi4)};
         for (int i = 0; i < p.arm_num; ++i)
         {
           auto d_ang{arm_phi[i]*M_PI/180 - theta};
-          auto d_rad{abs(p.arm_r0 * exp(d_ang * beta_inv) - r)};
-          auto d_rad_p{abs(p.arm_r0 * exp((d_ang + 2* M_PI) * beta_inv) - r)};
-          auto d_rad_m{abs(p.arm_r0 * exp((d_ang - 2 * M_PI) * beta_inv) - r)};
+          auto d_rad{abs(T(p.arm_r0) * exp(d_ang * beta_inv) - r)};
+          auto d_rad_p{abs(T(p.arm_r0) * exp((d_ang + 2* M_PI) * beta_inv) - r)};
+          auto d_rad_m{abs(T(p.arm_r0) * exp((d_ang - 2 * M_PI) * beta_inv) - r)};
           d.push_back(std::min(std::min(d_rad, d_rad_p), d_rad_m) * cos_p);
         }
       }
@@ -309,38 +315,51 @@ std::vector<number> JaffeMagneticField::dist2arm(const double &x, const double &
   return d;
 }
 
-number JaffeMagneticField::arm_scaling(const double &z, const JaffeMagneticField &p) const
+template <typename T>
+T JaffeMagneticField::arm_scaling(const double &z, const JaffeMagneticField &p) const
 {
-  return 1. / (cosh(z / p.arm_z0) *
-               cosh(z / p.arm_z0));
+  return 1. / (cosh(z / T(p.arm_z0)) *
+               cosh(z / T(p.arm_z0)));
 }
 
-number JaffeMagneticField::disk_scaling(const double &z, const JaffeMagneticField &p) const
+template <typename T>
+T JaffeMagneticField::disk_scaling(const double &z, const JaffeMagneticField &p) const
 {
-  return 1. / (cosh(z / p.disk_z0) *
-               cosh(z / p.disk_z0));
+  return 1. / (cosh(z / T(p.disk_z0)) *
+               cosh(z / T(p.disk_z0)));
 }
 
-number JaffeMagneticField::halo_scaling(const double &z, const JaffeMagneticField &p) const
+template <typename T>
+T JaffeMagneticField::halo_scaling(const double &z, const JaffeMagneticField &p) const
 {
-  return 1. / (cosh(z / p.halo_z0) *
-               cosh(z / p.halo_z0));
+  return 1. / (cosh(z / T(p.halo_z0)) *
+               cosh(z / T(p.halo_z0)));
 }
 
 #if autodiff_FOUND
 
 Eigen::MatrixXd JaffeMagneticField::_jac(const double &x, const double &y, const double &z, JaffeMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, JaffeMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.disk_amp, p.disk_z0, p.halo_amp, p.halo_z0, p.r_inner, p.r_scale, p.r_peak,
-                                                p.ring_amp, p.ring_r, p.bar_amp, p.bar_a, p.bar_b, p.bar_phi0,
-                                                p.arm_r0, p.arm_z0, p.arm_phi1, p.arm_phi2, p.arm_phi3, p.arm_phi4,
-                                                p.arm_amp1, p.arm_amp2, p.arm_amp3, p.arm_amp4, p.arm_pitch,
-                                                p.comp_c, p.comp_d, p.comp_r, p.comp_p),
-                                        ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number JaffeMagneticField::*>> parameters{
+      {"disk_amp", &JaffeMagneticField::disk_amp}, {"disk_z0", &JaffeMagneticField::disk_z0},
+      {"halo_amp", &JaffeMagneticField::halo_amp}, {"halo_z0", &JaffeMagneticField::halo_z0},
+      {"r_inner", &JaffeMagneticField::r_inner}, {"r_scale", &JaffeMagneticField::r_scale},
+      {"r_peak", &JaffeMagneticField::r_peak}, {"ring_amp", &JaffeMagneticField::ring_amp},
+      {"ring_r", &JaffeMagneticField::ring_r}, {"bar_amp", &JaffeMagneticField::bar_amp},
+      {"bar_a", &JaffeMagneticField::bar_a}, {"bar_b", &JaffeMagneticField::bar_b},
+      {"bar_phi0", &JaffeMagneticField::bar_phi0}, {"arm_r0", &JaffeMagneticField::arm_r0},
+      {"arm_z0", &JaffeMagneticField::arm_z0}, {"arm_phi1", &JaffeMagneticField::arm_phi1},
+      {"arm_phi2", &JaffeMagneticField::arm_phi2}, {"arm_phi3", &JaffeMagneticField::arm_phi3},
+      {"arm_phi4", &JaffeMagneticField::arm_phi4}, {"arm_amp1", &JaffeMagneticField::arm_amp1},
+      {"arm_amp2", &JaffeMagneticField::arm_amp2}, {"arm_amp3", &JaffeMagneticField::arm_amp3},
+      {"arm_amp4", &JaffeMagneticField::arm_amp4}, {"arm_pitch", &JaffeMagneticField::arm_pitch},
+      {"comp_c", &JaffeMagneticField::comp_c}, {"comp_d", &JaffeMagneticField::comp_d},
+      {"comp_r", &JaffeMagneticField::comp_r}, {"comp_p", &JaffeMagneticField::comp_p}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
 #endif
+
+template vector_t<double> JaffeMagneticField::_at_position<double>(const double &, const double &, const double &, const JaffeMagneticField &) const;
+template class RegularVectorFieldModel<JaffeMagneticField>;
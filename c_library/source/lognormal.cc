@@ -4,22 +4,45 @@
 #include "units.h"
 #include "LogNormal.h"
 
-void LogNormalScalarField::_on_grid(double* val, const std::array<int, 3> &shp, const std::array<double, 3> &grid_zeropoint, const std::array<double, 3> &grid_increment, const int seed) {
+template <typename REAL>
+void LogNormalScalarField::generate_log_normal(REAL* val, const std::array<int, 3> &shp, const std::array<double, 3> &grid_increment, const int seed, REAL* out, const std::array<std::ptrdiff_t, 3> &strides) {
 
-      fftw_complex* val_comp = construct_plans(val, shp);;
+      fftw_complex_of<REAL>* val_comp = reinterpret_cast<fftw_complex_of<REAL>*>(val);
         
       seed_complex_random_numbers(val_comp, shp, grid_increment, seed);
       
-      fftw_execute(c2r);
-      std::array<int, 3> padded_shp = {shp[0],  shp[1],  2*(shp[2]/2 + 1)}; 
-      int pad =  padded_shp[2] - shp[2];
-      remove_padding(val, shp, pad);
-      // normalize, add mean and exponentiate
-      int gs = grid_size(shp);
-      for (int s = 0; s < gs; ++s)
-        val[s] = std::exp(val[s]/std::sqrt(gs) + log_mean);  
+      execute_c2r(val, shp);
+      exponentiate_slab(val, out, shp[0], grid_strides(shp, strides), shp);
 }
 
+template <typename REAL>
+void LogNormalScalarField::exponentiate_slab(const REAL* val, REAL* out, const int n, const std::array<std::ptrdiff_t, 3> &st, const std::array<int, 3> &shp) {
+      // normalize, add mean and exponentiate, while removing the padding
+      const int padded_z = 2*(shp[2]/2 + 1);
+      const double norm = 1. / std::sqrt(grid_size(shp));
+      for_each_grid_line({n, shp[1], shp[2]}, [&](const int i, const int j) {
+        const REAL *v = val + (static_cast<size_t>(i)*shp[1] + j)*padded_z;
+        REAL *o = out + i*st[0] + j*st[1];
+        for (int k = 0; k < shp[2]; ++k) {
+          o[k*st[2]] = std::exp(v[k]*norm + log_mean);
+        }
+      });
+}
+
+void LogNormalScalarField::finish_slab(const double* val, double* out, const int /*i0*/, const int n, const std::array<int, 3> &shp, const std::array<double, 3> &/*rpt*/, const std::array<double, 3> &/*inc*/) {
+  exponentiate_slab(val, out, n, grid_strides(shp), shp);
+}
+
+void LogNormalScalarField::_on_grid(double* val, const std::array<int, 3> &shp, const std::array<double, 3> &/*grid_zeropoint*/, const std::array<double, 3> &grid_increment, const int seed, double* out, const std::array<std::ptrdiff_t, 3> &strides) {
+  generate_log_normal(val, shp, grid_increment, seed, out, strides);
+}
+
+#if FFTW_FLOAT_FOUND
+void LogNormalScalarField::_on_grid(float* val, const std::array<int, 3> &shp, const std::array<double, 3> &/*grid_zeropoint*/, const std::array<double, 3> &grid_increment, const int seed, float* out, const std::array<std::ptrdiff_t, 3> &strides) {
+  generate_log_normal(val, shp, grid_increment, seed, out, strides);
+}
+#endif
+
 
 double LogNormalScalarField::calculate_fourier_sigma(const double &abs_k, const double &dk) const {
   double sigma = simple_spectrum(abs_k, dk, spectral_offset, spectral_slope);
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cmath>
+
+#include "GridMemory.h"
+#include "NUFFT.h"
+
+GaussianNUFFT::GaussianNUFFT(const std::array<int, 3> &shape, const double tolerance, const int ncomp) : shape(shape), ncomp(ncomp) {
+  const double pi = 3.141592653589793;
+  // With an oversampling of two, the truncation of the kernel at width and the aliasing of the fine grid
+  // contribute errors of exp(-width^2/(4 tau)) and exp(-2 pi^2 tau), which balance at tau = sqrt(2) width/(4 pi)
+  const double tol = std::min(std::max(tolerance, 1e-15), 0.1);
+  spread = std::min(std::max(static_cast<int>(std::ceil(-std::log(tol) * std::sqrt(2.) / pi)), 2), max_width);
+  tau = std::sqrt(2.) * spread / (4. * pi);
+
+  for (int d = 0; d < 3; ++d) {
+    fine[d] = 2*shape[d];
+  }
+  fine_padded_size = static_cast<size_t>(fine[0])*fine[1]*2*(fine[2]/2 + 1);
+  grid = allocate_grid_memory(ncomp*fine_padded_size);
+
+  // The Fourier transform of the kernel (in fine voxels) at the wave number m/fine of the mode m is sqrt(4 pi tau) exp(-4 pi^2 tau (m/fine)^2)
+  const std::array<int, 3> size{shape[0], shape[1], shape[2]/2 + 1};
+  for (int d = 0; d < 3; ++d) {
+    deconvolution[d].resize(size[d]);
+    for (int i = 0; i < size[d]; ++i) {
+      const int m = (d < 2 && i >= (shape[d] + 1) / 2) ? i - shape[d] : i;
+      const double xi = static_cast<double>(m) / fine[d];
+      deconvolution[d][i] = std::exp(4. * pi * pi * tau * xi * xi) / std::sqrt(4. * pi * tau);
+      if (shape[d] % 2 == 0 && 2*i == shape[d]) {
+        deconvolution[d][i] *= 0.5;
+      }
+    }
+  }
+
+  kernel_offsets.resize(2*spread);
+  for (int a = 0; a < 2*spread; ++a) {
+    const double t = a - spread + 1;
+    kernel_offsets[a] = std::exp(-t * t / (4. * tau));
+  }
+}
+
+GaussianNUFFT::~GaussianNUFFT() {
+  free_grid_memory(grid);
+}
+
+int GaussianNUFFT::fine_indices(const int d, const int i, std::array<int, 2> &idx) const {
+  if (shape[d] % 2 == 0 && 2*i == shape[d]) {
+    idx = {i, fine[d] - i};
+    return 2;
+  }
+  idx[0] = (i >= (shape[d] + 1) / 2) ? fine[d] - (shape[d] - i) : i;
+  return 1;
+}
+
+void GaussianNUFFT::load_modes(const int c, const fftw_complex *modes, const int nthreads) {
+  double *g = fine_grid(c);
+  fftw_complex *fine_modes = reinterpret_cast<fftw_complex*>(g);
+  const int size_z = shape[2]/2 + 1;
+  const int fine_size_z = fine[2]/2 + 1;
+  const size_t fine_plane = static_cast<size_t>(fine[1])*2*fine_size_z;
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+#endif
+  for (long i = 0; i < fine[0]; ++i) {
+    std::fill(g + i*fine_plane, g + (i + 1)*fine_plane, 0.);
+  }
+
+  // the fine x planes of different modes i are disjoint, hence the planes can be filled in parallel
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static) num_threads(nthreads) if(nthreads > 1)
+#endif
+  for (long i = 0; i < shape[0]; ++i) {
+    std::array<int, 2> fi, fj;
+    const int ni = fine_indices(0, i, fi);
+    for (int j = 0; j < shape[1]; ++j) {
+      const int nj = fine_indices(1, j, fj);
+      const fftw_complex *m = modes + (static_cast<size_t>(i)*shape[1] + j)*size_z;
+      const double dxy = deconvolution[0][i] * deconvolution[1][j];
+      for (int a = 0; a < ni; ++a) {
+        for (int b = 0; b < nj; ++b) {
+          fftw_complex *f = fine_modes + (static_cast<size_t>(fi[a])*fine[1] + fj[b])*fine_size_z;
+          for (int l = 0; l < size_z; ++l) {
+            const double s = dxy * deconvolution[2][l];
+            f[l][0] = s * m[l][0];
+            f[l][1] = s * m[l][1];
+          }
+        }
+      }
+    }
+  }
+}
+
+void GaussianNUFFT::interpolate(const std::array<double, 3> &u, double *values) const {
+  const int nw = 2*spread;
+  std::array<std::array<double, 2*max_width>, 3> w;
+  std::array<std::array<int, 2*max_width>, 3> idx;
+  for (int d = 0; d < 3; ++d) {
+    double v = u[d] * fine[d] / shape[d];
+    v -= std::floor(v / fine[d]) * fine[d];
+    const int q0 = std::min(static_cast<int>(v), fine[d] - 1);
+    const double delta = v - q0;
+    // Fast Gaussian gridding: the weight of the fine voxel q0 + t is exp(-(delta - t)^2/(4 tau))
+    // = exp(-delta^2/(4 tau)) exp(delta t/(2 tau)) exp(-t^2/(4 tau)), i.e. two exponentials per axis and position
+    const double e2 = std::exp(delta / (2. * tau));
+    double p = std::exp(-delta * delta / (4. * tau) - delta * (spread - 1) / (2. * tau));
+    for (int a = 0; a < nw; ++a) {
+      w[d][a] = p * kernel_offsets[a];
+      p *= e2;
+      const int q = (q0 + a - spread + 1) % fine[d];
+      idx[d][a] = q < 0 ? q + fine[d] : q;
+    }
+  }
+
+  const size_t fine_z = 2*(fine[2]/2 + 1);
+  std::fill(values, values + ncomp, 0.);
+  for (int a = 0; a < nw; ++a) {
+    for (int b = 0; b < nw; ++b) {
+      const double wab = w[0][a] * w[1][b];
+      const size_t line = (static_cast<size_t>(idx[0][a])*fine[1] + idx[1][b])*fine_z;
+      for (int c = 0; c < ncomp; ++c) {
+        const double *g = grid + c*fine_padded_size + line;
+        double s = 0.;
+        for (int e = 0; e < nw; ++e) {
+          s += w[2][e] * g[idx[2][e]];
+        }
+        values[c] += wab * s;
+      }
+    }
+  }
+}
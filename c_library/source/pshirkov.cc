@@ -2,21 +2,22 @@
 #include "units.h"
 #include "Pshirkov.h"
 
-vector PshirkovMagneticField::_at_position(const double &x, const double &y, const double &z, const PshirkovMagneticField &p) const
+template <typename T>
+vector_t<T> PshirkovMagneticField::_at_position(const double &x, const double &y, const double &z, const PshirkovMagneticField &p) const
 {
 	const double r = std::sqrt(x * x + y * y); // radius in cylindrical coordinates
 	const double phi = atan2(y, x);
-	vector b{{0.0, 0.0, 0.0}};
+	vector_t<T> b{{0.0, 0.0, 0.0}};
 
 	if ((x == 0.) && (y == 0.)) {
 		return b;
 	}
 
-	auto pitch = p.pitch * M_PI / 180;
+	auto pitch = T(p.pitch) * M_PI / 180;
 
 	auto cos_pitch = cos(pitch);
 	auto sin_pitch = sin(pitch);
-	auto PHI = cos_pitch / sin_pitch * log(1. + p.d / p.R_sun) - M_PI / 2;
+	auto PHI = cos_pitch / sin_pitch * log(1. + T(p.d) / T(p.R_sun)) - M_PI / 2;
 	auto cos_PHI = cos(PHI);
 
 	// disk field
@@ -42,10 +43,10 @@ vector PshirkovMagneticField::_at_position(const double &x, const double &y, con
 		b[1] = sin_pitch * sin_theta + cos_pitch * cos_theta;
 	// ADAPTED CRPROPA COMMENT: flipped in eq above magnetic field direction, as B_{theta} and B_{phi} refering to 180 degree rotated field
 
-		auto bMag = cos(theta - cos_pitch / sin_pitch * log(r / p.R_sun) + PHI);  // eq. 3 / 4
+		auto bMag = cos(theta - cos_pitch / sin_pitch * log(r / T(p.R_sun)) + PHI);  // eq. 3 / 4
 		if ((p.useASS) and (bMag < 0))
 			bMag *= -1.;
-		bMag *= p.B0_D * p.R_sun / std::max(r, p.R_c) / cos_PHI * exp(-fabs(z) / p.z0_D);  // eq. 5, eq. 4
+		bMag *= T(p.B0_D) * T(p.R_sun) / std::max(r, p.R_c) / cos_PHI * exp(-fabs(z) / T(p.z0_D));  // eq. 5, eq. 4
 		b[0] *= bMag;
 		b[1] *= bMag;
 		b[2] *= bMag; // does not do anything as b[2] was zero
@@ -53,9 +54,9 @@ vector PshirkovMagneticField::_at_position(const double &x, const double &y, con
 
 	// halo field
 	if (p.useHalo) {
-		auto bMag = (z > 0 ? p.B0_Hn : - p.B0_Hs);
-		auto z1 = (fabs(z) < p.z0_H ? p.z11_H : p.z12_H);
-		bMag *= r / p.R0_H * exp(1 - r / p.R0_H) / (1 + pow((fabs(z) - p.z0_H) / z1, 2.));
+		auto bMag = (z > 0 ? T(p.B0_Hn) : - T(p.B0_Hs));
+		auto z1 = (fabs(z) < T(p.z0_H) ? T(p.z11_H) : T(p.z12_H));
+		bMag *= r / T(p.R0_H) * exp(1 - r / T(p.R0_H)) / (1 + pow((fabs(z) - T(p.z0_H)) / z1, 2.));
 	// CRPROPA COMMENT:
 		// equation (8) in paper: theta uses now the conventional azimuth definition in contrast to equation (3)
 		// cos(phi) = pos.x / r (phi going counter-clockwise)
@@ -72,11 +73,18 @@ vector PshirkovMagneticField::_at_position(const double &x, const double &y, con
 
 Eigen::MatrixXd PshirkovMagneticField::_jac(const double &x, const double &y, const double &z, PshirkovMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, PshirkovMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.pitch, p.d, p.R_sun, p.z0_D, p.B0_D, p.z0_H, p.R0_H, p.B0_Hn, p.B0_Hs, p.z11_H, p.z12_H), ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number PshirkovMagneticField::*>> parameters{
+      {"pitch", &PshirkovMagneticField::pitch}, {"d", &PshirkovMagneticField::d},
+      {"R_sun", &PshirkovMagneticField::R_sun}, {"z0_D", &PshirkovMagneticField::z0_D},
+      {"B0_D", &PshirkovMagneticField::B0_D}, {"z0_H", &PshirkovMagneticField::z0_H},
+      {"R0_H", &PshirkovMagneticField::R0_H}, {"B0_Hn", &PshirkovMagneticField::B0_Hn},
+      {"B0_Hs", &PshirkovMagneticField::B0_Hs}, {"z11_H", &PshirkovMagneticField::z11_H},
+      {"z12_H", &PshirkovMagneticField::z12_H}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
 #endif
+
+template vector_t<double> PshirkovMagneticField::_at_position<double>(const double &, const double &, const double &, const PshirkovMagneticField &) const;
+template class RegularVectorFieldModel<PshirkovMagneticField>;
@@ -3,31 +3,16 @@
 
 #include "RandomScalarField.h"
 
-RandomScalarField::RandomScalarField(std::array<int, 3>  shape, std::array<double, 3>  reference_point, std::array<double, 3>  increment) : RandomField<number, double*>(shape, reference_point, increment) {
-  //accumulate wisdom
-  double* grid_eval = allocate_memory(shape);
-  fftw_complex* grid_eval_comp = reinterpret_cast<fftw_complex*>(grid_eval);
-  fftw_plan r2c_temp = fftw_plan_dft_r2c_3d(shape[0], shape[1], shape[2], grid_eval, grid_eval_comp, FFTW_MEASURE);
-  fftw_plan c2r_temp = fftw_plan_dft_c2r_3d(shape[0], shape[1], shape[2], grid_eval_comp, grid_eval, FFTW_MEASURE);
-  //save wisdom
-  const char *filename = "ImagineModelsRandomScalarField";
-  int fftw_export_wisdom_to_filename(*filename);
-  //destroy plans, but wisdom will be kept!
-  has_fftw_wisdom = true;
-  fftw_destroy_plan(c2r_temp);
-  fftw_destroy_plan(r2c_temp); 
-  fftw_free(grid_eval);
-};
+RandomScalarField::RandomScalarField(std::array<int, 3>  shape, std::array<double, 3>  reference_point, std::array<double, 3>  increment) : RandomField<double, double*>(shape, reference_point, increment) {};
 
 RandomScalarField::~RandomScalarField() {
-//delete wisdom
-  destroy_plans();
-  fftw_forget_wisdom();
-  #ifdef _OPENMP
-    fftw_cleanup_threads();
-  #else
-    fftw_cleanup();
-  #endif
+  // the fftw plans are owned by the plan cache, and may be in use by other fields
+  if (workspace != nullptr) {
+    free_memory(workspace);
+  }
+#if FFTW_FLOAT_FOUND
+  free_grid_memory(workspace_float);
+#endif
 };
 
 double* RandomScalarField::allocate_memory(const std::array<int, 3> shp) {
@@ -38,107 +23,235 @@ double* RandomScalarField::allocate_memory(const std::array<int, 3> shp) {
   else {
     newshp2 = shp[2] + 2;
   }
-  double* grid_eval = (double*) fftw_alloc_real(shp[0]*shp[1]*newshp2);
+  double* grid_eval = allocate_grid_memory(static_cast<size_t>(shp[0])*shp[1]*newshp2);
   return grid_eval;  
 };  
 
 void RandomScalarField::free_memory(double* grid_eval) {
-  fftw_free(grid_eval);
+  free_grid_memory(grid_eval);
 }
 
-fftw_complex* RandomScalarField::construct_plans(double* grid_eval, const std::array<int, 3> shp) {
-  fftw_complex* grid_eval_comp = reinterpret_cast<fftw_complex*>(grid_eval);
-  if (has_fftw_wisdom) {
-    const char *filename = "ImagineModelsRandomFieldScalar"; // FIX this, currently overwrites
-    int fftw_im_wisdom_to_filename(*filename);
-  }
-  r2c = fftw_plan_dft_r2c_3d(shp[0], shp[1], shp[2], grid_eval, grid_eval_comp, FFTW_ESTIMATE);
-  c2r = fftw_plan_dft_c2r_3d(shp[0], shp[1], shp[2], grid_eval_comp, grid_eval,  FFTW_ESTIMATE);
-  created_fftw_plans = true;
-  return grid_eval_comp;
+double* RandomScalarField::on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+  // the field is generated in the (padded) workspace, the returned grid is unpadded
+  double* grid_eval = allocate_grid_memory(grid_size(shp));
+  on_grid_into(grid_eval, shp, rpt, inc, seed);
+  return grid_eval;
+}
+
+double* RandomScalarField::on_grid(const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  return on_grid(internal_shape, internal_ref_point, internal_increment, seed);
 }
 
-void RandomScalarField::destroy_plans() {
-  if (created_fftw_plans) {
-    fftw_destroy_plan(c2r);
-    fftw_destroy_plan(r2c);
+double* RandomScalarField::get_workspace(const std::array<int, 3> &shp) {
+  if (workspace == nullptr || workspace_shape != shp) {
+    if (workspace != nullptr) {
+      free_memory(workspace);
+    }
+    workspace = allocate_memory(shp);
+    workspace_shape = shp;
   }
+  return workspace;
 }
 
-double* RandomScalarField::on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
-  double* grid_eval = allocate_memory(shp);
-  _on_grid(grid_eval, shp, rpt, inc, seed);
-  return grid_eval;
+void RandomScalarField::on_grid_into(double* grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
+  // the fft needs a padded array, so the field is generated in the workspace and written to the output in the last pass
+  _on_grid(get_workspace(shp), shp, rpt, inc, seed, grid_eval, strides);
 }
 
-double* RandomScalarField::on_grid(const int seed) {
+void RandomScalarField::on_grid_into(double* grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
   if (not initialized_with_grid) 
     throw GridException();
-  double* grid_eval = allocate_memory(internal_shape);
-  const char *filename = "ImagineModelsRandomScalarField";
-  int fftw_import_wisdom_from_filename(*filename);
-  _on_grid(grid_eval, internal_shape, internal_ref_point, internal_increment, seed);
+  on_grid_into(grid_eval, internal_shape, internal_ref_point, internal_increment, seed, strides);
+}
+
+#if FFTW_FLOAT_FOUND
+float* RandomScalarField::on_grid_float(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+  float* grid_eval = allocate_float_grid_memory(grid_size(shp));
+  on_grid_into(grid_eval, shp, rpt, inc, seed);
   return grid_eval;
 }
 
+float* RandomScalarField::on_grid_float(const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  return on_grid_float(internal_shape, internal_ref_point, internal_increment, seed);
+}
+
+float* RandomScalarField::get_workspace_float(const std::array<int, 3> &shp) {
+  if (workspace_float == nullptr || workspace_float_shape != shp) {
+    free_grid_memory(workspace_float);
+    workspace_float = allocate_float_grid_memory(static_cast<size_t>(shp[0])*shp[1]*2*(shp[2]/2 + 1));
+    workspace_float_shape = shp;
+  }
+  return workspace_float;
+}
+
+void RandomScalarField::on_grid_into(float* grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
+  _on_grid(get_workspace_float(shp), shp, rpt, inc, seed, grid_eval, strides);
+}
+
+void RandomScalarField::on_grid_into(float* grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  on_grid_into(grid_eval, internal_shape, internal_ref_point, internal_increment, seed, strides);
+}
+#endif
+
 double* RandomScalarField::profile_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rfp, const std::array<double, 3> &inc) {
   double* grid_eval;
   size_t arr_sz = shp[0]*shp[1]*shp[2];
-  grid_eval = new double[arr_sz];
-  evaluate_function_on_grid<number, double*>(grid_eval, shp, rfp, inc,
+  grid_eval = allocate_grid_memory(arr_sz);
+  evaluate_function_on_grid<double, double*>(grid_eval, shp, rfp, inc,
                                     [this](double xx, double yy, double zz)
                                     { return spatial_profile(xx, yy, zz); });
   return grid_eval;
 } 
 
 double* RandomScalarField::random_numbers_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed) {
-    double* val = allocate_memory(shp);
-    fftw_complex* val_comp = construct_plans(val, shp); 
-    int gs = grid_size(shp);
-    double sqrt_gs = std::sqrt(gs);
-    std::array<int, 3> padded_shp = {shp[0],  shp[1],  2*(shp[2]/2 + 1)}; 
-    int padded_size = grid_size(padded_shp);
-    int pad =  padded_shp[2] - shp[2];
-
-    seed_complex_random_numbers(val_comp, shp, inc, seed);
-    fftw_execute(c2r);
-    for (int s = 0; s < padded_size; ++s)  {
-        (val)[s] /= sqrt_gs;  
-    }
-    remove_padding(val, shp, pad);
-    
-    return val;
+  // as generate_on_grid, without the spatial profile
+  double* val = get_workspace(shp);
+  double* out = allocate_grid_memory(grid_size(shp));
+  const double norm = 1. / std::sqrt(grid_size(shp));
+
+  seed_complex_random_numbers(reinterpret_cast<fftw_complex*>(val), shp, inc, seed);
+  execute_c2r(val, shp);
+  profile_slab(val, out, 0, shp[0], grid_strides(shp), norm, shp, {0., 0., 0.}, inc, nullptr, false);
+  return out;
 }
 
-void RandomScalarField::_on_grid(double* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+template <typename REAL>
+void RandomScalarField::generate_on_grid(REAL* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, REAL* out, const std::array<std::ptrdiff_t, 3> &strides) {
 
-  fftw_complex* val_comp = construct_plans(val, shp); 
-  std::array<int, 3> padded_shp = {shp[0],  shp[1],  2*(shp[2]/2 + 1)}; 
-  int gs = grid_size(shp);
-  double sqrt_gs = std::sqrt(gs);
-  int padded_size = grid_size(padded_shp);
-  int pad =  padded_shp[2] - shp[2];
+  fftw_complex_of<REAL>* val_comp = reinterpret_cast<fftw_complex_of<REAL>*>(val);
+  const double norm = 1. / std::sqrt(grid_size(shp));
+  ++stats.realizations;
   // Step 1: draw random numbers with variance 1, possibly correlated
 
   seed_complex_random_numbers(val_comp, shp, inc, seed);
-  fftw_execute(c2r);
-  
+  execute_c2r(val, shp);
   
-  // Step 2: apply spatial amplitude, possibly introduce anisotropy depending on regular field.
-  if (!no_profile) {
-    auto apply_profile = [&](double &rand_val, const double xx, const double yy, const double zz) {
-        
-      double sp = spatial_profile(xx, yy, zz);
-      // apply profile
-      rand_val *= sp;
-      return rand_val;      
-    };
-  
-    apply_function_to_field<double*, double>(val, padded_shp, rpt, inc, apply_profile);
+  // Step 2: apply spatial amplitude and normalization, and remove the padding, in one pass over the grid
+  const RealizationCache *cache = cached(shp, rpt, inc);
+  profile_slab(val, out, 0, shp[0], grid_strides(shp, strides), norm, shp, rpt, inc, cache != nullptr ? cache->profile : nullptr);
+}
+
+template <typename REAL>
+void RandomScalarField::profile_slab(const REAL* val, REAL* out, const int i0, const int n, const std::array<std::ptrdiff_t, 3> &st, const double norm, 
+                                     const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const double *profile, const bool apply_profile) const {
+  const int padded_z = 2*(shp[2]/2 + 1);
+  for_each_grid_line({n, shp[1], shp[2]}, [&](const int ii, const int j) {
+    const REAL *v = val + (static_cast<size_t>(ii)*shp[1] + j)*padded_z;
+    REAL *o = out + ii*st[0] + j*st[1];
+    if (no_profile or not apply_profile) {
+      for (int k = 0; k < shp[2]; ++k) {
+        o[k*st[2]] = v[k] * norm;
+      }
+    }
+    else if (profile != nullptr) {
+      const double *sp = profile + (static_cast<size_t>(ii)*shp[1] + j)*shp[2];
+      for (int k = 0; k < shp[2]; ++k) {
+        o[k*st[2]] = v[k] * sp[k] * norm;
+      }
+    }
+    else {
+      const double xx = rpt[0] + (i0 + ii)*inc[0];
+      const double yy = rpt[1] + j*inc[1];
+      for (int k = 0; k < shp[2]; ++k) {
+        o[k*st[2]] = v[k] * spatial_profile(xx, yy, rpt[2] + k*inc[2]) * norm;
+      }
+    }
+  });
+}
+
+void RandomScalarField::finish_slab(const double* val, double* out, const int i0, const int n, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) {
+  profile_slab(val, out, i0, n, grid_strides(shp), 1. / std::sqrt(grid_size(shp)), shp, rpt, inc, nullptr);
+}
+
+void RandomScalarField::on_grid_to_file(const std::string &path, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+  const int size_z = shp[2]/2 + 1;
+  const size_t padded_plane = static_cast<size_t>(shp[1])*2*size_z;
+  const size_t plane = static_cast<size_t>(shp[1])*shp[2];
+  MappedGridFile spectrum(path + ".spectrum", shp[0]*padded_plane, true);
+  MappedGridFile field(path, grid_size(shp));
+  const int nj = out_of_core_lines(shp, 1);
+  const int ni = out_of_core_planes(shp, 1);
+  double* block = allocate_grid_memory(static_cast<size_t>(shp[0])*nj*2*size_z);
+  double* slab = allocate_grid_memory(ni*padded_plane);
+  try {
+    // Pass 1: draw the modes of a block of y lines and transform them along x
+    for (int j0 = 0; j0 < shp[1]; j0 += nj) {
+      const int n = std::min(nj, shp[1] - j0);
+      seed_line_block(block, shp, inc, seed, j0, n);
+      execute_c2c_lines(block, n*size_z, FFTW_BACKWARD, shp);
+      copy_line_block(spectrum.data(), block, shp, j0, n, true);
+    }
+    // Pass 2: transform a slab of x planes over (y, z), and apply the spatial profile and the normalization
+    for (int i0 = 0; i0 < shp[0]; i0 += ni) {
+      const int n = std::min(ni, shp[0] - i0);
+      std::copy(spectrum.data() + i0*padded_plane, spectrum.data() + (i0 + n)*padded_plane, slab);
+      execute_c2r_planes(slab, n, shp);
+      finish_slab(slab, field.data() + i0*plane, i0, n, shp, rpt, inc);
+    }
   }
+  catch (...) {
+    free_grid_memory(block);
+    free_grid_memory(slab);
+    throw;
+  }
+  free_grid_memory(block);
+  free_grid_memory(slab);
+}
 
-  for (int s = 0; s < padded_size; ++s)  {
-    (val)[s] /= sqrt_gs;  
+void RandomScalarField::on_grid_to_file(const std::string &path, const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  on_grid_to_file(path, internal_shape, internal_ref_point, internal_increment, seed);
+}
+
+void RandomScalarField::at_positions(const double *x, const double *y, const double *z, const size_t n, double* out, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+  // the modes are drawn into the workspace, and spread onto the fine grid of the non-uniform FFT
+  double* val = get_workspace(shp);
+  seed_complex_random_numbers(reinterpret_cast<fftw_complex*>(val), shp, inc, seed);
+  GaussianNUFFT nufft(shp, nufft_tolerance);
+  nufft.load_modes(0, reinterpret_cast<const fftw_complex*>(val), grid_thread_count());
+  execute_nufft(nufft);
+  ++stats.realizations;
+
+  const double norm = 1. / std::sqrt(grid_size(shp));
+  evaluate_function_at_positions<double, double*>(out, x, y, z, n, [&](double xx, double yy, double zz) {
+    double g;
+    nufft.interpolate({(xx - rpt[0]) / inc[0], (yy - rpt[1]) / inc[1], (zz - rpt[2]) / inc[2]}, &g);
+    return finish_point(g * norm, xx, yy, zz);
+  });
+}
+
+void RandomScalarField::at_positions(const double *x, const double *y, const double *z, const size_t n, double* out, const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  at_positions(x, y, z, n, out, internal_shape, internal_ref_point, internal_increment, seed);
+}
+
+double* RandomScalarField::on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const int seed) {
+  const std::array<std::vector<double>, 3> pos = grid_positions(grid_x, grid_y, grid_z);
+  double* grid_eval = allocate_grid_memory(pos[0].size());
+  try {
+    at_positions(pos[0].data(), pos[1].data(), pos[2].data(), pos[0].size(), grid_eval, seed);
+  }
+  catch (...) {
+    free_grid_memory(grid_eval);
+    throw;
   }
-  remove_padding(val, shp, pad);
+  return grid_eval;
+}
+
+void RandomScalarField::_on_grid(double* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, double* out, const std::array<std::ptrdiff_t, 3> &strides) {
+  generate_on_grid(val, shp, rpt, inc, seed, out, strides);
+}
+
+#if FFTW_FLOAT_FOUND
+void RandomScalarField::_on_grid(float* val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, float* out, const std::array<std::ptrdiff_t, 3> &strides) {
+  generate_on_grid(val, shp, rpt, inc, seed, out, strides);
 }
+#endif
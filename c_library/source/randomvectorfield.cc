@@ -1,37 +1,18 @@
 #include <cmath>
 #include <iostream>
+#include <stdexcept>
 
 #include "RandomVectorField.h"
 
 // Non trivial constructor
-RandomVectorField::RandomVectorField(std::array<int, 3>  shape, std::array<double, 3>  reference_point, std::array<double, 3>  increment) : RandomField(shape, reference_point, increment) {
-    int newshp2;
-    if (shape[2] % 2) {
-      newshp2 = shape[2] + 1;
-    }
-    else {
-      newshp2 = shape[2] + 2;
-    }
-    double* val_temp = (double*) fftw_alloc_real(shape[0]*shape[1]*newshp2);
-    fftw_complex* val_temp_comp = reinterpret_cast<fftw_complex*>(val_temp);
-    fftw_plan r2c_temp = fftw_plan_dft_r2c_3d(shape[0], shape[1], shape[2], val_temp, val_temp_comp, FFTW_MEASURE);
-    fftw_plan c2r_temp = fftw_plan_dft_c2r_3d(shape[0], shape[1], shape[2], val_temp_comp, val_temp,  FFTW_MEASURE);
-    const char *filename = "ImagineModelsRandomVectorField";
-    int fftw_export_wisdom_to_filename(*filename);
-    has_fftw_wisdom = true;
-    fftw_free(val_temp);
-    fftw_destroy_plan(c2r_temp);
-    fftw_destroy_plan(r2c_temp); // plans are destroyed but wisdom is saved!
-}
+RandomVectorField::RandomVectorField(std::array<int, 3>  shape, std::array<double, 3>  reference_point, std::array<double, 3>  increment) : RandomField(shape, reference_point, increment) {}
 
 RandomVectorField::~RandomVectorField() {
-  destroy_plans();
-  fftw_forget_wisdom();
-  #ifdef _OPENMP
-    fftw_cleanup_threads();
-  #else
-    fftw_cleanup();
-  #endif
+  // the fftw plans are owned by the plan cache, and may be in use by other fields
+  free_grid_memory(workspace[0]);
+#if FFTW_FLOAT_FOUND
+  free_grid_memory(workspace_float[0]);
+#endif
 };
 
 std::array<double*, 3> RandomVectorField::allocate_memory(std::array<int, 3> shp) {
@@ -44,222 +25,700 @@ std::array<double*, 3> RandomVectorField::allocate_memory(std::array<int, 3> shp
       newshp2 = shp[2] + 2;
     }
     for (int i=0; i < ndim; ++i) {
-      grid_eval[i] = (double*) fftw_alloc_real(shp[0]*shp[1]*newshp2);
+      grid_eval[i] = allocate_grid_memory(static_cast<size_t>(shp[0])*shp[1]*newshp2);
       }
     return grid_eval;  
 }
 
 void RandomVectorField::free_memory(std::array<double*, 3> grid_eval) {
     for (int i=0; i < ndim; ++i) { 
-      fftw_free(grid_eval[i]);
+      free_grid_memory(grid_eval[i]);
     }
 }
 
 
-std::array<fftw_complex*, 3> RandomVectorField::construct_plans(std::array<double*, 3> grid_eval, std::array<int, 3> shp) {
-    std::array<fftw_complex*, 3> grid_eval_comp;
-      for (int i=0; i < ndim; ++i) {
-        grid_eval_comp[i] = reinterpret_cast<fftw_complex*>(grid_eval[i]);
-        r2c[i] = fftw_plan_dft_r2c_3d(shp[0], shp[1], shp[2], grid_eval[i], grid_eval_comp[i], FFTW_ESTIMATE);
-        c2r[i] = fftw_plan_dft_c2r_3d(shp[0], shp[1], shp[2], grid_eval_comp[i], grid_eval[i],  FFTW_ESTIMATE);
-      }
-      created_fftw_plans = true;
-    return grid_eval_comp;
+std::array<double*, 3> RandomVectorField::on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+    // the field is generated in the (padded) workspace, the returned grids are unpadded
+    std::array<double*, 3> grid_eval;
+    for (int i=0; i < ndim; ++i) {
+      grid_eval[i] = allocate_grid_memory(grid_size(shp));
+    }
+    on_grid_into(grid_eval, shp, rpt, inc, seed);
+    return grid_eval;
+  }
+
+std::array<double*, 3> RandomVectorField::on_grid(const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  return on_grid(internal_shape, internal_ref_point, internal_increment, seed);
 }
 
-void RandomVectorField::destroy_plans() {
-    if (created_fftw_plans) {
-      for (int i=0; i < ndim; ++i) {
-        fftw_destroy_plan(c2r[i]);
-        fftw_destroy_plan(r2c[i]);
-      }
+std::array<double*, 3> RandomVectorField::get_workspace(const std::array<int, 3> &shp) {
+  if (workspace[0] == nullptr || workspace_shape != shp) {
+    free_grid_memory(workspace[0]);
+    const size_t padded_size = static_cast<size_t>(shp[0])*shp[1]*2*(shp[2]/2 + 1);
+    double* block = allocate_grid_memory(ndim*padded_size);
+    for (int i=0; i < ndim; ++i) {
+      workspace[i] = block + i*padded_size;
     }
+    workspace_shape = shp;
+  }
+  return workspace;
 }
 
-std::array<double*, 3> RandomVectorField::on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
-    std::array<double*, 3> grid_eval = allocate_memory(shp);
-    _on_grid(grid_eval, shp, rpt, inc, seed);
-    return grid_eval;
+#if FFTW_FLOAT_FOUND
+std::array<float*, 3> RandomVectorField::get_workspace_float(const std::array<int, 3> &shp) {
+  if (workspace_float[0] == nullptr || workspace_float_shape != shp) {
+    free_grid_memory(workspace_float[0]);
+    const size_t padded_size = static_cast<size_t>(shp[0])*shp[1]*2*(shp[2]/2 + 1);
+    float* block = allocate_float_grid_memory(ndim*padded_size);
+    for (int i=0; i < ndim; ++i) {
+      workspace_float[i] = block + i*padded_size;
+    }
+    workspace_float_shape = shp;
   }
+  return workspace_float;
+}
+#endif
 
-std::array<double*, 3> RandomVectorField::on_grid(const int seed) {
+template <typename REAL>
+bool RandomVectorField::contiguous_components(const std::array<REAL*, 3> &val, const std::array<int, 3> &shp) const {
+  const std::ptrdiff_t padded_size = static_cast<std::ptrdiff_t>(shp[0])*shp[1]*2*(shp[2]/2 + 1);
+  return val[1] - val[0] == padded_size && val[2] - val[1] == padded_size;
+}
+
+template <typename REAL>
+void RandomVectorField::execute_r2c_components(std::array<REAL*, 3> val, const std::array<int, 3> &shp) const {
+  if (contiguous_components(val, shp)) {
+    execute_r2c_many(val[0], 3, shp);
+    return;
+  }
+  for (int i =0; i<3; ++i) {
+    execute_r2c(val[i], shp);
+  }
+}
+
+template <typename REAL>
+void RandomVectorField::execute_c2r_components(std::array<REAL*, 3> val, const std::array<int, 3> &shp) const {
+  if (contiguous_components(val, shp)) {
+    execute_c2r_many(val[0], 3, shp);
+    return;
+  }
+  for (int i =0; i<3; ++i) {
+    execute_c2r(val[i], shp);
+  }
+}
+
+void RandomVectorField::fill_realization_cache(RealizationCache &cache) {
+  RandomField::fill_realization_cache(cache);
+  const bool has_grid = anisotropy_grid && anisotropy_grid->matches(cache.shape, cache.reference_point, cache.increment);
+  if (!no_profile && apply_anisotropy && !has_grid) {
+    const std::array<int, 3> &shp = cache.shape;
+    for (int i=0; i < ndim; ++i) {
+      cache.direction[i] = allocate_grid_memory(grid_size(shp));
+    }
+    evaluate_function_on_grid<vector_t<double>, std::array<double*, 3>>(cache.direction, shp, cache.reference_point, cache.increment,
+                                    [this](double xx, double yy, double zz)
+                                    { return anisotropy_direction(xx, yy, zz); });
+  }
+}
+
+const std::array<double*, 3> *RandomVectorField::anisotropy_directions(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const RealizationCache *cache) const {
+  if (anisotropy_grid && anisotropy_grid->matches(shp, rpt, inc)) {
+    return &anisotropy_grid->direction;
+  }
+  if (cache != nullptr && cache->direction[0] != nullptr) {
+    return &cache->direction;
+  }
+  return nullptr;
+}
+
+void RandomVectorField::set_anisotropy_grid(const std::array<const double*, 3> &direction, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) {
+  auto grid = std::make_shared<AnisotropyGrid>(shp, rpt, inc);
+  const size_t gs = grid_size(shp);
+  for (int i=0; i < ndim; ++i) {
+    std::copy(direction[i], direction[i] + gs, grid->direction[i]);
+  }
+  anisotropy_grid = grid;
+}
+
+void RandomVectorField::set_anisotropy_grid(RegularVectorField &regular_field, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc) {
+  auto grid = std::make_shared<AnisotropyGrid>(shp, rpt, inc);
+  regular_field.on_grid_into(grid->direction, shp, rpt, inc);
+  anisotropy_grid = grid;
+}
+
+void RandomVectorField::set_anisotropy_grid(RegularVectorField &regular_field) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  set_anisotropy_grid(regular_field, internal_shape, internal_ref_point, internal_increment);
+}
+
+void RandomVectorField::on_grid_into(std::array<double*, 3> grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
+  // the fft needs padded arrays, so the field is generated in the workspace and written to the output in the last pass
+  _on_grid(get_workspace(shp), shp, rpt, inc, seed, grid_eval, strides);
+}
+
+void RandomVectorField::on_grid_into(std::array<double*, 3> grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
   if (not initialized_with_grid) 
     throw GridException();
-  std::array<double*, 3> grid_eval = allocate_memory(internal_shape);
-  const char *filename = "ImagineModelsRandomVectorField";
-  int fftw_import_wisdom_from_filename(*filename);
-  _on_grid(grid_eval, internal_shape, internal_ref_point, internal_increment, seed);
+  on_grid_into(grid_eval, internal_shape, internal_ref_point, internal_increment, seed, strides);
+}
+
+#if FFTW_FLOAT_FOUND
+std::array<float*, 3> RandomVectorField::on_grid_float(const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+  std::array<float*, 3> grid_eval;
+  for (int i=0; i < ndim; ++i) {
+    grid_eval[i] = allocate_float_grid_memory(grid_size(shp));
+  }
+  on_grid_into(grid_eval, shp, rpt, inc, seed);
   return grid_eval;
 }
 
+std::array<float*, 3> RandomVectorField::on_grid_float(const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  return on_grid_float(internal_shape, internal_ref_point, internal_increment, seed);
+}
+
+void RandomVectorField::on_grid_into(std::array<float*, 3> grid_eval, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
+  _on_grid(get_workspace_float(shp), shp, rpt, inc, seed, grid_eval, strides);
+}
+
+void RandomVectorField::on_grid_into(std::array<float*, 3> grid_eval, const int seed, const std::array<std::ptrdiff_t, 3> &strides) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  on_grid_into(grid_eval, internal_shape, internal_ref_point, internal_increment, seed, strides);
+}
+#endif
+
 double* RandomVectorField::profile_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &rfp, const std::array<double, 3> &inc) {
   double* grid_eval;
   size_t arr_sz = shp[0]*shp[1]*shp[2];
-  grid_eval = new double[arr_sz];
-  evaluate_function_on_grid<number, double*>(grid_eval, shp, rfp, inc,
+  grid_eval = allocate_grid_memory(arr_sz);
+  evaluate_function_on_grid<double, double*>(grid_eval, shp, rfp, inc,
                                     [this](double xx, double yy, double zz)
                                     { return spatial_profile(xx, yy, zz); });
   return grid_eval;
 } 
 std::array<double*, 3> RandomVectorField::random_numbers_on_grid(const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed) {
-    std::array<double*, 3> val = allocate_memory(shp);
-    std::array<fftw_complex*, 3> val_comp = construct_plans(val, shp); 
-    int gs = grid_size(shp);
-    double sqrt_gs = std::sqrt(gs);
-    auto gen_int = std::mt19937(seed);
-    std::uniform_int_distribution<int> uni(0, 1215752192);
-    std::array<int, 3> padded_shp = {shp[0],  shp[1],  2*(shp[2]/2 + 1)}; 
-    int padded_size = grid_size(padded_shp);
-    int pad =  padded_shp[2] - shp[2];
+  // as the standard engine of generate_on_grid, without the spatial profile and the anisotropy
+  std::array<double*, 3> val = get_workspace(shp);
+  std::array<double*, 3> out;
+  const std::array<int, 3> sub_seeds = component_seeds(seed);
+  const double norm = 1. / std::sqrt(grid_size(shp));
 
-    for (int i =0; i<3; ++i) {
-      int sub_seed = uni(gen_int); 
-      seed_complex_random_numbers(val_comp[i], shp, inc, sub_seed);
-      fftw_execute(c2r[i]);
-      for (int s = 0; s < padded_size; ++s)  {
-        (val[i])[s] /= sqrt_gs;  
-      }
-      remove_padding(val[i], shp, pad);
-    }
-    return val;
+  for (int i =0; i<3; ++i) {
+    out[i] = allocate_grid_memory(grid_size(shp));
+    seed_complex_random_numbers(reinterpret_cast<fftw_complex*>(val[i]), shp, inc, sub_seeds[i]);
+  }
+  execute_c2r_components(val, shp);
+  normalize_components(val, out, grid_strides(shp), norm, shp);
+  return out;
 }
 
-void RandomVectorField::_on_grid(std::array<double*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
-
-  std::array<fftw_complex*, 3> val_comp = construct_plans(val, shp); 
-  std::array<int, 3> padded_shp = {shp[0],  shp[1],  2*(shp[2]/2 + 1)}; 
-  int gs = grid_size(shp);   
-  int padded_size = grid_size(padded_shp);
-  int pad =  padded_shp[2] - shp[2];
+std::array<int, 3> RandomVectorField::component_seeds(const int seed) const {
   auto gen_int = std::mt19937(seed);
   std::uniform_int_distribution<int> uni(0, 1215752192);
-  double sqrt_gs = std::sqrt(gs);
+  std::array<int, 3> sub_seeds;
+  for (int i =0; i<3; ++i) {
+    sub_seeds[i] = uni(gen_int);
+  }
+  return sub_seeds;
+}
 
-  // Step 1: draw random numbers with variance 1, possibly correlated
+template <typename REAL>
+void RandomVectorField::generate_on_grid(std::array<REAL*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, std::array<REAL*, 3> out, const std::array<std::ptrdiff_t, 3> &strides) {
 
-  for (int i =0; i<3; ++i) {
-    int sub_seed = uni(gen_int); 
-    seed_complex_random_numbers(val_comp[i], shp, inc, sub_seed);
-    fftw_execute(c2r[i]);
-    //for (int s = 0; s < padded_size; ++s)  {
-    //    (val[i])[s] /= sqrt_gs;  
-    //  }
-    //remove_padding(val[i], shp, pad);
+  typedef fftw_complex_of<REAL> complex_type;
+  std::array<complex_type*, 3> val_comp{reinterpret_cast<complex_type*>(val[0]), reinterpret_cast<complex_type*>(val[1]), reinterpret_cast<complex_type*>(val[2])};
+  const double gs = grid_size(shp);   
+  const std::array<int, 3> sub_seeds = component_seeds(seed);
+  const std::array<uint64_t, 3> keys{static_cast<uint32_t>(sub_seeds[0]), static_cast<uint32_t>(sub_seeds[1]), static_cast<uint32_t>(sub_seeds[2])};
+  ++stats.realizations;
+
+  const RealizationCache *cache = cached(shp, rpt, inc);
+  const double *profile = cache != nullptr ? cache->profile : nullptr;
+  const std::array<double*, 3> *direction = anisotropy_directions(shp, rpt, inc, cache);
+  const std::array<std::ptrdiff_t, 3> st = grid_strides(shp, strides);
+
+  const bool fused_engine = (engine == VectorFieldEngine::modulated_noise) or (engine == VectorFieldEngine::spectral and clean_divergence);
+  if (fused_engine and legacy_random_numbers) {
+    throw std::invalid_argument("Only the standard engine of random vector fields supports legacy_random_numbers.");
   }
-  
-  // Step 2: apply spatial amplitude, possibly introduce anisotropy depending on regular field.
-  if (!no_profile) {
-    auto apply_profile = [&](std::array<double, 3> &b_rand_val, const double xx, const double yy, const double zz) {
-        
-      double sp = spatial_profile(xx, yy, zz);
-      // apply profile
-      b_rand_val[0] *= sp;
-      b_rand_val[1] *= sp;
-      b_rand_val[2] *= sp;
-
-
-      if (apply_anisotropy) {
-        vector b_reg_val = anisotropy_direction(xx, yy, zz);
-        double b_reg_x = static_cast<double>(b_reg_val[0]); 
-        double b_reg_y = static_cast<double>(b_reg_val[1]);
-        double b_reg_z = static_cast<double>(b_reg_val[2]);
-
-        double b_reg_length = std::sqrt(std::pow(b_reg_x, 2) + std::pow(b_reg_y, 2) + std::pow(b_reg_z, 2));
-
-        if (b_reg_length > 1e-10) { // non zero regular field, -> prefered anisotropy
-          
-          b_reg_x /= b_reg_length;
-          b_reg_y /= b_reg_length;
-          b_reg_z /= b_reg_length;
-          const double rho2 = anisotropy_rho * anisotropy_rho;
-          const double rhonorm = 1. / std::sqrt(0.33333333 * rho2 + 0.66666667 / rho2);
-          double reg_dot_rand  = b_reg_x*b_rand_val[0] + b_reg_y*b_rand_val[1] + b_reg_z*b_rand_val[2];
-
-          for (int ii=0; ii==3; ++ii) {
-            double b_rand_par = b_rand_val[ii] / reg_dot_rand;
-            double b_rand_perp = b_rand_val[ii]  - b_rand_par;
-            b_rand_val[ii] = (b_rand_par * anisotropy_rho + b_rand_perp / anisotropy_rho) * rhonorm;
-          } 
-        }
+
+  if (engine == VectorFieldEngine::modulated_noise) {
+    // Step 1: white noise in real space, with the spatial amplitude and the anisotropy
+    for_each_grid_line(shp, [&](const int i, const int j) {
+      seed_white_noise_line(val, i, j, shp, keys);
+      if (!no_profile) {
+        profile_line(val, val, i, j, 0, {0, 0, 1}, 1., shp, rpt, inc, profile, direction);
       }
-      return b_rand_val;
-    };
-    apply_function_to_field<std::array<double*, 3>, std::array<double, 3>>(val, padded_shp, rpt, inc, apply_profile);
+    });
+    // Step 2: correlate the noise, with the projection of the divergence in the same pass
+    execute_r2c_components(val, shp);
+    shape_modes(val_comp, shp, inc, nullptr);
+    execute_c2r_components(val, shp);
+    // the modes of the white noise have a variance of gs/2 per real and imaginary part, instead of 1
+    normalize_components(val, out, st, std::sqrt(2.) / gs, shp);
+    return;
   }
-  // Step 3 (optional): divergence cleaning using Gram Schmidt process
-  if (clean_divergence) {
-  
+
+  // Step 1: draw random numbers with variance 1, possibly correlated. 
+  // The spectral engine projects out the divergence while drawing the modes.
+
+  if (fused_engine) {
+    shape_modes(val_comp, shp, inc, &keys);
+  }
+  else {
     for (int i =0; i<3; ++i) {
-      fftw_execute(r2c[i]);
+      seed_complex_random_numbers(val_comp[i], shp, inc, sub_seeds[i]);
+    }
+  }
+  execute_c2r_components(val, shp);
+  
+  // Step 2: apply spatial amplitude, possibly introduce anisotropy depending on regular field. 
+  // Step 3 (optional): divergence cleaning using Gram Schmidt process
+  // Without divergence cleaning (or if already cleaned), step 2 is fused with the normalization and the removal of the padding into one pass over the grid.
+  if (clean_divergence and not fused_engine) {
+    if (!no_profile) {
+      for_each_grid_line(shp, [&](const int i, const int j) {
+        profile_line(val, val, i, j, 0, {0, 0, 1}, 1., shp, rpt, inc, profile, direction);
+      });
     }
+    execute_r2c_components(val, shp);
     divergence_cleaner(val_comp[0], val_comp[1], val_comp[2], shp, inc);
-    
-    for (int i =0; i<3; ++i) {
-      fftw_execute(c2r[i]);
-      for (int s = 0; s < padded_size; ++s)  {
-        (val[i])[s] /= (gs*sqrt_gs);  
+    execute_c2r_components(val, shp);
+    normalize_components(val, out, st, 1. / (gs*std::sqrt(gs)), shp);
+  }
+  else {
+    const double norm = 1. / std::sqrt(gs);
+    for_each_grid_line(shp, [&](const int i, const int j) {
+      profile_line(val, out, i, j, 0, st, norm, shp, rpt, inc, profile, direction);
+    });
+  }
+}
+
+template <typename REAL>
+void RandomVectorField::normalize_components(const std::array<REAL*, 3> &val, const std::array<REAL*, 3> &out, const std::array<std::ptrdiff_t, 3> &st, const double norm, const std::array<int, 3> &shp) const {
+  const int padded_z = 2*(shp[2]/2 + 1);
+  for_each_grid_line(shp, [&](const int i, const int j) {
+    const size_t n_padded = (static_cast<size_t>(i)*shp[1] + j)*padded_z;
+    for (int d = 0; d < 3; ++d) {
+      const REAL *v = val[d] + n_padded;
+      REAL *o = out[d] + i*st[0] + j*st[1];
+      for (int k = 0; k < shp[2]; ++k) {
+        o[k*st[2]] = v[k] * norm;
+      }
+    }
+  });
+}
+
+template <typename REAL>
+void RandomVectorField::seed_white_noise_line(const std::array<REAL*, 3> &val, const int i, const int j, const std::array<int, 3> &shp, const std::array<uint64_t, 3> &keys) const {
+  const size_t n_padded = (static_cast<size_t>(i)*shp[1] + j)*2*(shp[2]/2 + 1);
+  const uint64_t counter = (static_cast<uint64_t>(i)*shp[1] + j)*((shp[2] + 1)/2);
+  for (int d = 0; d < 3; ++d) {
+    REAL *v = val[d] + n_padded;
+    for (int k = 0; k < shp[2]; k += 2) {
+      const std::array<double, 2> g = Philox4x32::normal_pair(keys[d], counter + k/2);
+      v[k] = g[0];
+      // for an odd number of voxels, the last number lands in the padding
+      v[k + 1] = g[1];
+    }
+  }
+}
+
+template <typename COMPLEX>
+void RandomVectorField::shape_modes(const std::array<COMPLEX*, 3> &modes, const std::array<int, 3> &shp, const std::array<double, 3> &inc, const std::array<uint64_t, 3> *keys) {
+  const int size_z = shp[2]/2 + 1;
+  std::shared_ptr<const FourierSigmaTable> table;
+  if (apply_spectrum) {
+    table = fourier_sigma_table(shp, inc);
+  }
+  const FourierWaveNumbers wave_numbers(shp, inc);
+  const std::array<std::vector<double>, 3> &k = wave_numbers.k;
+  for_each_grid_line({shp[0], shp[1], size_z}, [&](const int i, const int j) {
+    const size_t idx_line = (static_cast<size_t>(i) * shp[1] + j) * size_z;
+    const std::array<COMPLEX*, 3> v{modes[0] + idx_line, modes[1] + idx_line, modes[2] + idx_line};
+    if (keys != nullptr) {
+      for (int d = 0; d < 3; ++d) {
+        for (int l = 0; l < size_z; ++l) {
+          const std::array<double, 2> g = Philox4x32::normal_pair((*keys)[d], idx_line + l);
+          v[d][l][0] = g[0];
+          v[d][l][1] = g[1];
+        }
+      }
+    }
+    const double *sigma = table ? table->line(i, j) : nullptr;
+    if (clean_divergence) {
+      divergence_clean_line(v[0], v[1], v[2], size_z, k[0][i], k[1][j], k[2].data(), sigma);
+    }
+    else if (sigma != nullptr) {
+      for (int d = 0; d < 3; ++d) {
+        for (int l = 0; l < size_z; ++l) {
+          v[d][l][0] *= sigma[l];
+          v[d][l][1] *= sigma[l];
+        }
       }
-      remove_padding(val[i], shp, pad);
     }
+  });
+  // the projection is even in the wave numbers of FourierWaveNumbers (also on the Nyquist planes of even axes), 
+  // hence the mirror modes stay conjugate to each other and the symmetrization can follow it
+  for (int d = 0; d < 3; ++d) {
+    if (keys != nullptr) {
+      hermitian_symmetrize(modes[d], shp);
+    }
+    modes[d][0][0] = 0.;
+    modes[d][0][1] = 0.;
+  }
+}
+
+void RandomVectorField::on_grid_to_file(const std::string &path, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+  const int size_z = shp[2]/2 + 1;
+  const size_t padded_plane = static_cast<size_t>(shp[1])*2*size_z;
+  const size_t padded_size = shp[0]*padded_plane;
+  const size_t plane = static_cast<size_t>(shp[1])*shp[2];
+  const size_t gs = grid_size(shp);
+  MappedGridFile spectrum_file(path + ".spectrum", 3*padded_size, true);
+  MappedGridFile field_file(path, 3*gs);
+  const std::array<double*, 3> spectrum{spectrum_file.data(), spectrum_file.data() + padded_size, spectrum_file.data() + 2*padded_size};
+  const std::array<double*, 3> field{field_file.data(), field_file.data() + gs, field_file.data() + 2*gs};
+
+  // the sub seeds of the components, as in _on_grid
+  const std::array<int, 3> sub_seeds = component_seeds(seed);
+
+  const int nj = out_of_core_lines(shp, 3);
+  const int ni = out_of_core_planes(shp, 3);
+  const size_t block_size = static_cast<size_t>(shp[0])*nj*2*size_z;
+  const size_t slab_size = ni*padded_plane;
+  double* block_memory = allocate_grid_memory(3*block_size);
+  double* slab_memory = allocate_grid_memory(3*slab_size);
+  const std::array<double*, 3> block{block_memory, block_memory + block_size, block_memory + 2*block_size};
+  const std::array<double*, 3> slab{slab_memory, slab_memory + slab_size, slab_memory + 2*slab_size};
+
+  const std::array<double*, 3> *direction = anisotropy_directions(shp, rpt, inc, nullptr);
+  // transforms a slab of x planes back to real space
+  auto inverse_slab = [&](const int i0, const int n) {
+    for (int d = 0; d < 3; ++d) {
+      std::copy(spectrum[d] + i0*padded_plane, spectrum[d] + (i0 + n)*padded_plane, slab[d]);
+      execute_c2r_planes(slab[d], n, shp);
+    }
+  };
+
+  try {
+    // Pass 1: draw the modes of a block of y lines and transform them along x
+    for (int j0 = 0; j0 < shp[1]; j0 += nj) {
+      const int n = std::min(nj, shp[1] - j0);
+      for (int d = 0; d < 3; ++d) {
+        seed_line_block(block[d], shp, inc, sub_seeds[d], j0, n);
+        execute_c2c_lines(block[d], n*size_z, FFTW_BACKWARD, shp);
+        copy_line_block(spectrum[d], block[d], shp, j0, n, true);
+      }
+    }
+
+    // Pass 2: transform a slab of x planes over (y, z) and apply the spatial profile and the anisotropy. 
+    // Without divergence cleaning, this is the final field, otherwise the slab is transformed forward again
+    const std::array<std::ptrdiff_t, 3> st = grid_strides(shp);
+    for (int i0 = 0; i0 < shp[0]; i0 += ni) {
+      const int n = std::min(ni, shp[0] - i0);
+      inverse_slab(i0, n);
+      // the precomputed anisotropy directions of the slab
+      std::array<double*, 3> slab_direction;
+      const std::array<double*, 3> *d_ptr = nullptr;
+      if (direction != nullptr) {
+        slab_direction = offset_grid(*direction, i0*plane);
+        d_ptr = &slab_direction;
+      }
+      if (clean_divergence) {
+        if (!no_profile) {
+          for_each_grid_line({n, shp[1], shp[2]}, [&](const int ii, const int j) {
+            profile_line(slab, slab, i0 + ii, j, i0, {0, 0, 1}, 1., shp, rpt, inc, nullptr, d_ptr);
+          });
+        }
+        for (int d = 0; d < 3; ++d) {
+          execute_r2c_planes(slab[d], n, shp);
+          std::copy(slab[d], slab[d] + n*padded_plane, spectrum[d] + i0*padded_plane);
+        }
+      }
+      else {
+        const std::array<double*, 3> out = offset_grid(field, i0*plane);
+        const double norm = 1. / std::sqrt(gs);
+        for_each_grid_line({n, shp[1], shp[2]}, [&](const int ii, const int j) {
+          profile_line(slab, out, i0 + ii, j, i0, st, norm, shp, rpt, inc, nullptr, d_ptr);
+        });
+      }
+    }
+
+    if (clean_divergence) {
+      // Pass 3: transform a block of y lines along x, project out the divergence and transform back
+      const FourierWaveNumbers wave_numbers(shp, inc);
+      const std::array<std::vector<double>, 3> &k = wave_numbers.k;
+      for (int j0 = 0; j0 < shp[1]; j0 += nj) {
+        const int n = std::min(nj, shp[1] - j0);
+        for (int d = 0; d < 3; ++d) {
+          copy_line_block(spectrum[d], block[d], shp, j0, n, false);
+          execute_c2c_lines(block[d], n*size_z, FFTW_FORWARD, shp);
+        }
+        std::array<fftw_complex*, 3> modes{reinterpret_cast<fftw_complex*>(block[0]), reinterpret_cast<fftw_complex*>(block[1]), reinterpret_cast<fftw_complex*>(block[2])};
+        for_each_grid_line({shp[0], n, size_z}, [&](const int i, const int jj) {
+          const size_t idx = (static_cast<size_t>(i)*n + jj)*size_z;
+          divergence_clean_line(modes[0] + idx, modes[1] + idx, modes[2] + idx, size_z, k[0][i], k[1][j0 + jj], k[2].data());
+        });
+        for (int d = 0; d < 3; ++d) {
+          execute_c2c_lines(block[d], n*size_z, FFTW_BACKWARD, shp);
+          copy_line_block(spectrum[d], block[d], shp, j0, n, true);
+        }
+      }
+
+      // Pass 4: transform a slab of x planes over (y, z) and normalize
+      const double norm = 1. / (gs*std::sqrt(gs));
+      for (int i0 = 0; i0 < shp[0]; i0 += ni) {
+        const int n = std::min(ni, shp[0] - i0);
+        inverse_slab(i0, n);
+        for_each_grid_line({n, shp[1], shp[2]}, [&](const int ii, const int j) {
+          const size_t n_padded = (static_cast<size_t>(ii)*shp[1] + j)*2*size_z;
+          const size_t m = (static_cast<size_t>(i0 + ii)*shp[1] + j)*shp[2];
+          for (int d = 0; d < 3; ++d) {
+            for (int k = 0; k < shp[2]; ++k) {
+              field[d][m + k] = slab[d][n_padded + k] * norm;
+            }
+          }
+        });
+      }
+    }
+  }
+  catch (...) {
+    free_grid_memory(block_memory);
+    free_grid_memory(slab_memory);
+    throw;
+  }
+  free_grid_memory(block_memory);
+  free_grid_memory(slab_memory);
+}
+
+void RandomVectorField::on_grid_to_file(const std::string &path, const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  on_grid_to_file(path, internal_shape, internal_ref_point, internal_increment, seed);
+}
+
+void RandomVectorField::at_positions(const double *x, const double *y, const double *z, const size_t n, std::array<double*, 3> out, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed) {
+  // the final modes of the realization (as generate_on_grid draws them for the engine) are computed in the workspace, 
+  // and spread onto the fine grids of the non-uniform FFT
+  const std::array<double*, 3> val = get_workspace(shp);
+  const std::array<fftw_complex*, 3> modes{reinterpret_cast<fftw_complex*>(val[0]), reinterpret_cast<fftw_complex*>(val[1]), reinterpret_cast<fftw_complex*>(val[2])};
+  const std::array<int, 3> sub_seeds = component_seeds(seed);
+  const std::array<uint64_t, 3> keys{static_cast<uint32_t>(sub_seeds[0]), static_cast<uint32_t>(sub_seeds[1]), static_cast<uint32_t>(sub_seeds[2])};
+  const double gs = grid_size(shp);
+
+  const bool fused_engine = (engine == VectorFieldEngine::modulated_noise) or (engine == VectorFieldEngine::spectral and clean_divergence);
+  if (fused_engine and legacy_random_numbers) {
+    throw std::invalid_argument("Only the standard engine of random vector fields supports legacy_random_numbers.");
+  }
+
+  // The engines which apply the profile and the anisotropy before the (last) correlation in Fourier space do so on the grid, 
+  // otherwise they are applied at the positions
+  const bool profile_on_grid = (engine == VectorFieldEngine::modulated_noise) or (engine == VectorFieldEngine::standard and clean_divergence);
+  const RealizationCache *cache = profile_on_grid ? cached(shp, rpt, inc) : nullptr;
+  const double *profile = cache != nullptr ? cache->profile : nullptr;
+  const std::array<double*, 3> *direction = profile_on_grid ? anisotropy_directions(shp, rpt, inc, cache) : nullptr;
+  double norm = 1. / std::sqrt(gs);
+
+  if (engine == VectorFieldEngine::modulated_noise) {
+    for_each_grid_line(shp, [&](const int i, const int j) {
+      seed_white_noise_line(val, i, j, shp, keys);
+      if (!no_profile) {
+        profile_line(val, val, i, j, 0, {0, 0, 1}, 1., shp, rpt, inc, profile, direction);
+      }
+    });
+    execute_r2c_components(val, shp);
+    shape_modes(modes, shp, inc, nullptr);
+    norm = std::sqrt(2.) / gs;
+  }
+  else if (fused_engine) {
+    shape_modes(modes, shp, inc, &keys);
   }
   else {
-    for (int i =0; i<3; ++i) {
-      double sqrt_gs = std::sqrt(gs);
-      for (int s = 0; s < padded_size; ++s)  {
-        (val[i])[s] /= sqrt_gs;  
+    for (int d = 0; d < 3; ++d) {
+      seed_complex_random_numbers(modes[d], shp, inc, sub_seeds[d]);
+    }
+    if (clean_divergence) {
+      execute_c2r_components(val, shp);
+      if (!no_profile) {
+        for_each_grid_line(shp, [&](const int i, const int j) {
+          profile_line(val, val, i, j, 0, {0, 0, 1}, 1., shp, rpt, inc, profile, direction);
+        });
+      }
+      execute_r2c_components(val, shp);
+      divergence_cleaner(modes[0], modes[1], modes[2], shp, inc);
+      norm = 1. / (gs*std::sqrt(gs));
+    }
+  }
+  GaussianNUFFT nufft(shp, nufft_tolerance, 3);
+  for (int d = 0; d < 3; ++d) {
+    nufft.load_modes(d, modes[d], grid_thread_count());
+  }
+  execute_nufft(nufft);
+  ++stats.realizations;
+
+  const vector_t<double> no_direction{{0., 0., 0.}};
+  evaluate_function_at_positions<vector_t<double>, std::array<double*, 3>>(out, x, y, z, n, [&](double xx, double yy, double zz) {
+    std::array<double, 3> b_rand_val;
+    nufft.interpolate({(xx - rpt[0]) / inc[0], (yy - rpt[1]) / inc[1], (zz - rpt[2]) / inc[2]}, b_rand_val.data());
+    if (!no_profile and !profile_on_grid) {
+      apply_profile(b_rand_val, spatial_profile(xx, yy, zz), apply_anisotropy ? anisotropy_direction(xx, yy, zz) : no_direction);
+    }
+    return vector_t<double>{{b_rand_val[0] * norm, b_rand_val[1] * norm, b_rand_val[2] * norm}};
+  });
+}
+
+void RandomVectorField::at_positions(const double *x, const double *y, const double *z, const size_t n, std::array<double*, 3> out, const int seed) {
+  if (not initialized_with_grid) 
+    throw GridException();
+  at_positions(x, y, z, n, out, internal_shape, internal_ref_point, internal_increment, seed);
+}
+
+std::array<double*, 3> RandomVectorField::on_grid(const std::vector<double> &grid_x, const std::vector<double> &grid_y, const std::vector<double> &grid_z, const int seed) {
+  const std::array<std::vector<double>, 3> pos = grid_positions(grid_x, grid_y, grid_z);
+  std::array<double*, 3> grid_eval;
+  for (int i=0; i < ndim; ++i) {
+    grid_eval[i] = allocate_grid_memory(pos[0].size());
+  }
+  try {
+    at_positions(pos[0].data(), pos[1].data(), pos[2].data(), pos[0].size(), grid_eval, seed);
+  }
+  catch (...) {
+    for (int i=0; i < ndim; ++i) {
+      free_grid_memory(grid_eval[i]);
+    }
+    throw;
+  }
+  return grid_eval;
+}
+
+void RandomVectorField::_on_grid(std::array<double*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, std::array<double*, 3> out, const std::array<std::ptrdiff_t, 3> &strides) {
+  generate_on_grid(val, shp, rpt, inc, seed, out, strides);
+}
+
+#if FFTW_FLOAT_FOUND
+void RandomVectorField::_on_grid(std::array<float*, 3> val, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, const int seed, std::array<float*, 3> out, const std::array<std::ptrdiff_t, 3> &strides) {
+  generate_on_grid(val, shp, rpt, inc, seed, out, strides);
+}
+#endif
+
+template <typename REAL>
+void RandomVectorField::profile_line(const std::array<REAL*, 3> &val, const std::array<REAL*, 3> &out, const int i, const int j, const int i0, const std::array<std::ptrdiff_t, 3> &st, const double norm, const std::array<int, 3> &shp, const std::array<double, 3> &rpt, const std::array<double, 3> &inc, 
+                                     const double *profile, const std::array<double*, 3> *direction) const {
+  const size_t n_padded = (static_cast<size_t>(i - i0)*shp[1] + j)*2*(shp[2]/2 + 1);
+  const size_t n = (static_cast<size_t>(i - i0)*shp[1] + j)*shp[2];
+  const std::ptrdiff_t m = (i - i0)*st[0] + j*st[1];
+  const double xx = rpt[0] + i*inc[0];
+  const double yy = rpt[1] + j*inc[1];
+  const vector_t<double> no_direction{{0., 0., 0.}};
+  for (int k = 0; k < shp[2]; ++k) {
+    std::array<double, 3> b_rand_val = {val[0][n_padded + k], val[1][n_padded + k], val[2][n_padded + k]};
+    if (!no_profile) {
+      const double zz = rpt[2] + k*inc[2];
+      const double sp = profile != nullptr ? profile[n + k] : spatial_profile(xx, yy, zz);
+      if (!apply_anisotropy) {
+        apply_profile(b_rand_val, sp, no_direction);
+      }
+      else if (direction != nullptr) {
+        const vector_t<double> b_reg_val{{(*direction)[0][n + k], (*direction)[1][n + k], (*direction)[2][n + k]}};
+        apply_profile(b_rand_val, sp, b_reg_val);
+      }
+      else {
+        apply_profile(b_rand_val, sp, anisotropy_direction(xx, yy, zz));
       }
-      remove_padding(val[i], shp, pad);
+    }
+    const std::ptrdiff_t o = (out[0] == val[0]) ? static_cast<std::ptrdiff_t>(n_padded + k) : m + k*st[2];
+    out[0][o] = b_rand_val[0] * norm;
+    out[1][o] = b_rand_val[1] * norm;
+    out[2][o] = b_rand_val[2] * norm;
+  }
+}
+
+void RandomVectorField::apply_profile(std::array<double, 3> &b_rand_val, const double sp, const vector_t<double> &b_reg_val) const {
+  // apply profile
+  b_rand_val[0] *= sp;
+  b_rand_val[1] *= sp;
+  b_rand_val[2] *= sp;
+
+  if (apply_anisotropy) {
+    double b_reg_x = static_cast<double>(b_reg_val[0]); 
+    double b_reg_y = static_cast<double>(b_reg_val[1]);
+    double b_reg_z = static_cast<double>(b_reg_val[2]);
+
+    double b_reg_length = std::sqrt(std::pow(b_reg_x, 2) + std::pow(b_reg_y, 2) + std::pow(b_reg_z, 2));
+
+    if (b_reg_length > 1e-10) { // non zero regular field, -> prefered anisotropy
+      
+      b_reg_x /= b_reg_length;
+      b_reg_y /= b_reg_length;
+      b_reg_z /= b_reg_length;
+      const double rho2 = anisotropy_rho * anisotropy_rho;
+      const double rhonorm = 1. / std::sqrt(0.33333333 * rho2 + 0.66666667 / rho2);
+      double reg_dot_rand  = b_reg_x*b_rand_val[0] + b_reg_y*b_rand_val[1] + b_reg_z*b_rand_val[2];
+      const std::array<double, 3> b_reg_unit{b_reg_x, b_reg_y, b_reg_z};
+
+      // split into the components parallel and perpendicular to the regular field, and stretch them by rho and 1/rho
+      for (int ii=0; ii<3; ++ii) {
+        double b_rand_par = b_reg_unit[ii] * reg_dot_rand;
+        double b_rand_perp = b_rand_val[ii]  - b_rand_par;
+        b_rand_val[ii] = (b_rand_par * anisotropy_rho + b_rand_perp / anisotropy_rho) * rhonorm;
+      } 
     }
   }
 }
 
 // this function is adapted from https://github.com/hammurabi-dev/hammurabiX/blob/master/source/field/b/brnd_jf12.cc
 // original author: https://github.com/gioacchinowang
-void RandomVectorField::divergence_cleaner(fftw_complex* bx, fftw_complex* by, fftw_complex* bz,  const std::array<int, 3> &shp, const std::array<double, 3> &inc) const {
-    double lx = shp[0]*inc[0];
-    double ly = shp[1]*inc[1];
-    double lz = shp[2]*inc[2];
-  
-    #ifdef _OPENMP
-      #pragma omp parallel for schedule(static)
-    #endif
-      for (int i = 0; i < shp[0]; ++i) {
-        double kx = i / lx;
-        if (i >= (shp[0] + 1) / 2)
-          kx -= 1. /  inc[0];
-          // it's faster to calculate indices manually
-        const int idx_lv1 = i * shp[1] * shp[2];
-        for (int j = 0; j < shp[1]; ++j) {
-          double ky = j /  ly;
-          if (j >= (shp[1] + 1) / 2)
-            ky -= 1. /  inc[1];
-          const int idx_lv2 = idx_lv1 + j * shp[2];
-          for (int l = 0; l < (int)shp[2]/2 + 1; ++l) {
-            // 0th term is fixed to zero in allocation
-            if (i == 0 and j == 0 and l == 0)
-              continue;
-            double kz = l /  lz;
-            const int idx = idx_lv2 + l;
-            double k_length = 0;
-            double b_length = 0;
-            double b_dot_k = 0;
-            std::array<double, 3> k{kx, ky, kz};
-            std::array<double, 3> b{(*bx)[idx], (*by)[idx], (*bz)[idx]};
-            b_length = static_cast<double>(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
-            k_length = static_cast<double>(k[0]*k[0] + k[1]*k[1] + k[2]*k[2]);
-
-            if (k_length == 0 or b_length == 0) {
-              continue;
-              }
-            k_length = std::sqrt(k_length);
-            b_dot_k = (b[0]*k[0] + b[1]*k[1] + b[2]*k[2]);
-
-            const double bk_over_k = b_dot_k / k_length;
-            // multiply \sqrt(3) for preserving spectral power statistically
-            (*bx)[idx] = 1.73205081 * ((*bx)[idx] - k[0] * bk_over_k);
-            (*by)[idx] = 1.73205081 * ((*by)[idx] - k[1] * bk_over_k);
-            (*bz)[idx] = 1.73205081 * ((*bz)[idx] - k[2] * bk_over_k);
-          } // l
-        } // j
-      } // i
-    }
\ No newline at end of file
+template <typename COMPLEX>
+void RandomVectorField::divergence_cleaner(COMPLEX* bx, COMPLEX* by, COMPLEX* bz,  const std::array<int, 3> &shp, const std::array<double, 3> &inc) const {
+  divergence_clean_modes(bx, by, bz, shp, FourierWaveNumbers(shp, inc));
+}
+
+template <typename COMPLEX>
+void RandomVectorField::divergence_clean_modes(COMPLEX* bx, COMPLEX* by, COMPLEX* bz, const std::array<int, 3> &shp, const FourierWaveNumbers &wave_numbers) const {
+  const int size_z = shp[2]/2 + 1;
+  const std::array<std::vector<double>, 3> &k = wave_numbers.k;
+  for_each_grid_line({shp[0], shp[1], size_z}, [&](const int i, const int j) {
+    const size_t idx = (static_cast<size_t>(i) * shp[1] + j) * size_z;
+    divergence_clean_line(bx + idx, by + idx, bz + idx, size_z, k[0][i], k[1][j], k[2].data());
+  });
+}
+
+template <typename COMPLEX>
+void RandomVectorField::divergence_clean_line(COMPLEX* bx, COMPLEX* by, COMPLEX* bz, const int size_z, const double kx, const double ky, const double *kz, const double *scale) const {
+  const double kxy2 = kx*kx + ky*ky;
+  auto project = [&](auto scale_of) {
+    for (int l = 0; l < size_z; ++l) {
+      const double k_length2 = kxy2 + kz[l]*kz[l];
+      // the monopole (k = 0) is kept as it is, selected arithmetically to keep the loop free of branches
+      const double is_monopole = (k_length2 == 0.);
+      const double inv_k_length2 = (1. - is_monopole) / (k_length2 + is_monopole);
+      // the projection keeps two of the three (statistically equal) components of the mode, 
+      // multiply by \sqrt(3/2) for preserving the spectral power statistically
+      const double factor = (1.22474487 - 0.22474487 * is_monopole) * scale_of(l);
+      // remove the component parallel to k, of the real and the imaginary part
+      const double bk_re = (bx[l][0]*kx + by[l][0]*ky + bz[l][0]*kz[l]) * inv_k_length2;
+      const double bk_im = (bx[l][1]*kx + by[l][1]*ky + bz[l][1]*kz[l]) * inv_k_length2;
+      bx[l][0] = factor * (bx[l][0] - kx * bk_re);
+      by[l][0] = factor * (by[l][0] - ky * bk_re);
+      bz[l][0] = factor * (bz[l][0] - kz[l] * bk_re);
+      bx[l][1] = factor * (bx[l][1] - kx * bk_im);
+      by[l][1] = factor * (by[l][1] - ky * bk_im);
+      bz[l][1] = factor * (bz[l][1] - kz[l] * bk_im);
+    }
+  };
+  if (scale != nullptr) {
+    project([scale](const int l) { return scale[l]; });
+  }
+  else {
+    project([](const int) { return 1.; });
+  }
+}
+
+template void RandomVectorField::divergence_cleaner<fftw_complex>(fftw_complex* bx, fftw_complex* by, fftw_complex* bz,  const std::array<int, 3> &shp, const std::array<double, 3> &inc) const;
+template void RandomVectorField::divergence_cleaner<fftwf_complex>(fftwf_complex* bx, fftwf_complex* by, fftwf_complex* bz,  const std::array<int, 3> &shp, const std::array<double, 3> &inc) const;
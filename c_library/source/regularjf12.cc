@@ -4,7 +4,8 @@
 #include "units.h"
 #include "RegularJF12.h"
 
-vector JF12MagneticField::_at_position(const double &x, const double &y, const double &z, const JF12MagneticField &p) const
+template <typename T>
+vector_t<T> JF12MagneticField::_at_position(const double &x, const double &y, const double &z, const JF12MagneticField &p) const
 {
   const double r{sqrt(x * x + y * y)};
   const double rho{
@@ -14,7 +15,7 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
   // define boundaries for where magnetic field is zero (outside of galaxy)
   if (r > Rmax || rho < rho_GC)
   {
-    return vector{{0., 0., 0.}};
+    return vector_t<T>{{0., 0., 0.}};
   }
 
   //------------------------------------------------------------------------------
@@ -24,24 +25,24 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
   const double B0 = (rmin / r); //
   // the logistic equation, to be multiplied to the toroidal halo field and
   // (1-zprofile) multiplied to the disk:
-  const auto zprofile{1. / (1 + exp(-2. / p.w_disk * (std::abs(z) - p.h_disk)))};
+  const auto zprofile{1. / (1 + exp(-2. / T(p.w_disk) * (std::abs(z) - T(p.h_disk))))};
 
   // printf("%g, %g \n", z, zprofile);
-  number B_cyl[3] = {0, 0, 0}; // the disk field in cylindrical coordinates
+  T B_cyl[3] = {0, 0, 0}; // the disk field in cylindrical coordinates
 
   if ((r > rcent)) // disk field zero elsewhere
   {
     if (r < rmin)
     { // circular field in molecular ring
-      B_cyl[1] = B0 * p.b_ring * (1 - zprofile);
+      B_cyl[1] = B0 * T(p.b_ring) * (1 - zprofile);
     }
     else
     {
       // use flux conservation to calculate the field strength in the 8th spiral
       // arm
-      number bv_B[8] = {p.b_arm_1, p.b_arm_2, p.b_arm_3, p.b_arm_4,
-                        p.b_arm_5, p.b_arm_6, p.b_arm_7, 0.};
-      number b8 = 0.;
+      T bv_B[8] = {T(p.b_arm_1), T(p.b_arm_2), T(p.b_arm_3), T(p.b_arm_4),
+                        T(p.b_arm_5), T(p.b_arm_6), T(p.b_arm_7), 0.};
+      T b8 = 0.;
 
       for (int i = 0; i < 7; i++)
       {
@@ -51,7 +52,7 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
 
       // iteratively figure out which spiral arm the current coordinates (r.phi)
       // correspond to
-      number b_disk = 0.;
+      T b_disk = 0.;
       double r_negx =
           r * exp(-1 / tan(M_PI / 180. * (90 - inc)) * (phi - M_PI));
 
@@ -80,23 +81,23 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
   ////TOROIDAL HALO COMPONENT
 
   if (do_halo) {
-    number b1, rh;
-    number B_h = 0.;
+    T b1, rh;
+    T B_h = 0.;
 
     if (z >= 0)
     { // North
-      b1 = p.Bn;
-      rh = p.rn; // transition radius between inner-outer region
+      b1 = T(p.Bn);
+      rh = T(p.rn); // transition radius between inner-outer region
     }
     else
     { // South
-      b1 = p.Bs;
-      rh = p.rs;
+      b1 = T(p.Bs);
+      rh = T(p.rs);
     }
 
-    B_h = b1 * (1. - 1. / (1. + exp(-2. / p.wh * (r - rh)))) *
-          exp(-(std::abs(z)) / (p.z0)); // vertical exponential fall-off
-    const number B_cyl_h[3] = {0., B_h * zprofile, 0.};
+    B_h = b1 * (1. - 1. / (1. + exp(-2. / T(p.wh) * (r - rh)))) *
+          exp(-(std::abs(z)) / (T(p.z0))); // vertical exponential fall-off
+    const T B_cyl_h[3] = {0., B_h * zprofile, 0.};
     // add fields together
     B_cyl[0] += B_cyl_h[0];
     B_cyl[1] += B_cyl_h[1];
@@ -107,9 +108,9 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
   // X- FIELD
 
   if (do_X) {
-    number Xtheta = 0.;
-    number rp_X = 0.; // the mid-plane radius for the field line that pass through r
-    number B_X = 0.;
+    T Xtheta = 0.;
+    T rp_X = 0.; // the mid-plane radius for the field line that pass through r
+    T B_X = 0.;
     double r_sign = 1.; // +1 for north, -1 for south
     if (z < 0)
     {
@@ -118,11 +119,11 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
 
     // dividing line between region with constant elevation angle, and the
     // interior:
-    number rc_X = p.rpc_X + std::abs(z) / tan(p.Xtheta_const * M_PI /180.);
+    T rc_X = T(p.rpc_X) + std::abs(z) / tan(T(p.Xtheta_const) * M_PI /180.);
     if (r < rc_X)
     { // interior region, with varying elevation angle
-      rp_X = r * p.rpc_X / rc_X;
-      B_X = p.B0_X * pow(p.rpc_X / rc_X, 2.) * exp(-rp_X / p.r0_X);
+      rp_X = r * T(p.rpc_X) / rc_X;
+      B_X = T(p.B0_X) * pow(T(p.rpc_X) / rc_X, 2.) * exp(-rp_X / T(p.r0_X));
       Xtheta = atan(std::abs(z) /
                     (r - rp_X)); // modified elevation angle in interior region
       if (z == 0.)
@@ -132,13 +133,13 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
     }
     else
     { // exterior region with constant elevation angle
-      Xtheta = p.Xtheta_const * M_PI /180.;
+      Xtheta = T(p.Xtheta_const) * M_PI /180.;
       rp_X = r - std::abs(z) / tan(Xtheta);
-      B_X = p.B0_X * rp_X / r * exp(-rp_X / p.r0_X);
+      B_X = T(p.B0_X) * rp_X / r * exp(-rp_X / T(p.r0_X));
     }
 
     // X-field in cylindrical coordinates
-    number B_cyl_X[3] = {B_X * cos(Xtheta) * r_sign, 0., B_X * sin(Xtheta)};
+    T B_cyl_X[3] = {B_X * cos(Xtheta) * r_sign, 0., B_X * sin(Xtheta)};
     // add fields together
     B_cyl[0] += B_cyl_X[0];
     B_cyl[1] += B_cyl_X[1];
@@ -149,7 +150,7 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
 
 
   // convert field to cartesian coordinates
-  vector B_cart{{0.0, 0.0, 0.0}};
+  vector_t<T> B_cart{{0.0, 0.0, 0.0}};
   B_cart[0] = B_cyl[0] * cos(phi) - B_cyl[1] * sin(phi);
   B_cart[1] = B_cyl[0] * sin(phi) + B_cyl[1] * cos(phi);
   B_cart[2] = B_cyl[2];
@@ -160,15 +161,21 @@ vector JF12MagneticField::_at_position(const double &x, const double &y, const d
 
 Eigen::MatrixXd JF12MagneticField::_jac(const double &x, const double &y, const double &z, JF12MagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, JF12MagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.b_arm_1, p.b_arm_2, p.b_arm_3, p.b_arm_4, p.b_arm_5, p.b_arm_6, p.b_arm_7,
-                                                p.b_ring, p.h_disk, p.w_disk,
-                                                p.Bn, p.Bs, p.rn, p.rs, p.wh, p.z0,
-                                                p.B0_X, p.Xtheta_const, p.rpc_X, p.r0_X),
-                                        ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number JF12MagneticField::*>> parameters{
+      {"b_arm_1", &JF12MagneticField::b_arm_1}, {"b_arm_2", &JF12MagneticField::b_arm_2},
+      {"b_arm_3", &JF12MagneticField::b_arm_3}, {"b_arm_4", &JF12MagneticField::b_arm_4},
+      {"b_arm_5", &JF12MagneticField::b_arm_5}, {"b_arm_6", &JF12MagneticField::b_arm_6},
+      {"b_arm_7", &JF12MagneticField::b_arm_7}, {"b_ring", &JF12MagneticField::b_ring},
+      {"h_disk", &JF12MagneticField::h_disk}, {"w_disk", &JF12MagneticField::w_disk}, {"Bn", &JF12MagneticField::Bn},
+      {"Bs", &JF12MagneticField::Bs}, {"rn", &JF12MagneticField::rn}, {"rs", &JF12MagneticField::rs},
+      {"wh", &JF12MagneticField::wh}, {"z0", &JF12MagneticField::z0}, {"B0_X", &JF12MagneticField::B0_X},
+      {"Xtheta_const", &JF12MagneticField::Xtheta_const}, {"rpc_X", &JF12MagneticField::rpc_X},
+      {"r0_X", &JF12MagneticField::r0_X}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
-#endif
\ No newline at end of file
+#endif
+
+template vector_t<double> JF12MagneticField::_at_position<double>(const double &, const double &, const double &, const JF12MagneticField &) const;
+template class RegularVectorFieldModel<JF12MagneticField>;
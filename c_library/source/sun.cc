@@ -5,7 +5,8 @@
 #include "helpers.h"
 
 // Sun et al. A&A V.477 2008 ASS+RING model magnetic field
-vector SunMagneticField::_at_position(const double &x, const double &y, const double &z, const SunMagneticField &p) const
+template <typename T>
+vector_t<T> SunMagneticField::_at_position(const double &x, const double &y, const double &z, const SunMagneticField &p) const
 {
 
   double r = sqrt(x * x + y * y);
@@ -34,39 +35,39 @@ vector SunMagneticField::_at_position(const double &x, const double &y, const do
 
   // now we set D1 (eq. 7)
   // ------------------------------------------------------------
-  number D1;
-  if (r > p.b_Rc)
+  T D1;
+  if (r > T(p.b_Rc))
   {
-    D1 = p.b_B0 * exp(-((r - p.b_Rsun) / p.b_R0) - (std::abs(z) / p.b_z0));
+    D1 = T(p.b_B0) * exp(-((r - T(p.b_Rsun)) / T(p.b_R0)) - (std::abs(z) / T(p.b_z0)));
   }
   else // if(r <= b_Rc)
   {
-    D1 = p.b_Bc;
+    D1 = T(p.b_Bc);
   }
   // ------------------------------------------------------------
 
-  auto p_ang = p.b_p * M_PI / 180.;
-  vector B_cyl{{D1 * D2 * sin(p_ang),  // eq. 6
+  auto p_ang = T(p.b_p) * M_PI / 180.;
+  vector_t<T> B_cyl{{D1 * D2 * sin(p_ang),  // eq. 6
                 -D1 * D2 * cos(p_ang),
                 0.}};
 
   // [ORIGINAL HAMMURABI COMMENT]  Taking into account the halo field
-  number halo_field;
+  T halo_field;
 
   // [ORIGINAL HAMMURABI COMMENT]  for better overview
-  number b3H_z1_actual;
-  if (std::abs(z) < p.bH_z0)
+  T b3H_z1_actual;
+  if (std::abs(z) < T(p.bH_z0))
   {
-    b3H_z1_actual = p.bH_z1a;
+    b3H_z1_actual = T(p.bH_z1a);
   }
   else
   {
-    b3H_z1_actual = p.bH_z1b;
+    b3H_z1_actual = T(p.bH_z1b);
   }
-  auto hf_piece1 = (b3H_z1_actual * b3H_z1_actual) / (b3H_z1_actual * b3H_z1_actual + (std::abs(z) - p.bH_z0) * (std::abs(z) - p.bH_z0));
-  auto hf_piece2 = exp(-(r - p.bH_R0) / (p.bH_R0));
+  auto hf_piece1 = (b3H_z1_actual * b3H_z1_actual) / (b3H_z1_actual * b3H_z1_actual + (std::abs(z) - T(p.bH_z0)) * (std::abs(z) - T(p.bH_z0)));
+  auto hf_piece2 = exp(-(r - T(p.bH_R0)) / (T(p.bH_R0)));
 
-  halo_field = p.bH_B0 * hf_piece1 * (r / p.bH_R0) * hf_piece2;  // eq. 10
+  halo_field = T(p.bH_B0) * hf_piece1 * (r / T(p.bH_R0)) * hf_piece2;  // eq. 10
 
   // [ORIGINAL HAMMURABI COMMENT] Flip north.  Not sure how Sun did this. This is his code with no
   // flip though the paper says it's flipped but without this mod,
@@ -78,9 +79,9 @@ vector SunMagneticField::_at_position(const double &x, const double &y, const do
 
   B_cyl[1] += halo_field;
 
-  vector B_vec3;
+  vector_t<T> B_vec3;
 
-  B_vec3 = Cyl2Cart<vector>(phi, B_cyl);
+  B_vec3 = Cyl2Cart<vector_t<T>>(phi, B_cyl);
 
   return B_vec3;
 }
@@ -89,11 +90,16 @@ vector SunMagneticField::_at_position(const double &x, const double &y, const do
 
 Eigen::MatrixXd SunMagneticField::_jac(const double &x, const double &y, const double &z, SunMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, SunMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.b_B0, p.b_Bc, p.b_R0, p.b_Rc, p.b_z0, p.b_Rsun, p.bH_B0, p.bH_R0, p.bH_z0, p.bH_z1a, p.bH_z1b), ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number SunMagneticField::*>> parameters{
+      {"b_B0", &SunMagneticField::b_B0}, {"b_Bc", &SunMagneticField::b_Bc}, {"b_R0", &SunMagneticField::b_R0},
+      {"b_Rc", &SunMagneticField::b_Rc}, {"b_z0", &SunMagneticField::b_z0}, {"b_Rsun", &SunMagneticField::b_Rsun},
+      {"bH_B0", &SunMagneticField::bH_B0}, {"bH_R0", &SunMagneticField::bH_R0}, {"bH_z0", &SunMagneticField::bH_z0},
+      {"bH_z1a", &SunMagneticField::bH_z1a}, {"bH_z1b", &SunMagneticField::bH_z1b}, {"b_p", &SunMagneticField::b_p}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
-#endif
\ No newline at end of file
+#endif
+
+template vector_t<double> SunMagneticField::_at_position<double>(const double &, const double &, const double &, const SunMagneticField &) const;
+template class RegularVectorFieldModel<SunMagneticField>;
@@ -3,9 +3,10 @@
 
 // Terral, Ferriere 2017 - Constraints from Faraday rotation on the magnetic field structure in the galactic halo, DOI: 10.1051/0004-6361/201629572, arXiv:1611.10222, implementation adapted from CRPRopa
 
-vector TFMagneticField::_at_position(const double &x, const double &y, const double &z, const TFMagneticField &p) const
+template <typename T>
+vector_t<T> TFMagneticField::_at_position(const double &x, const double &y, const double &z, const TFMagneticField &p) const
 {
-    //vector B_cart{{0., 0., 0.}};
+    //vector_t<T> B_cart{{0., 0., 0.}};
     const double r = sqrt(x * x + y * y);
     double phi = M_PI - std::atan2(y, x);
 
@@ -14,10 +15,10 @@ vector TFMagneticField::_at_position(const double &x, const double &y, const dou
     // double sinPhi = pos.y / r;
     double sinPhi = sin(phi);
 
-    vector df = getDiskField(r, z, phi, sinPhi, cosPhi, p);
-    vector hf = getHaloField(r, z, phi, sinPhi, cosPhi, p);
+    vector_t<T> df = getDiskField<T>(r, z, phi, sinPhi, cosPhi, p);
+    vector_t<T> hf = getHaloField<T>(r, z, phi, sinPhi, cosPhi, p);
 
-    vector B_cart = addVector<vector>({df, hf});
+    vector_t<T> B_cart = addVector<vector_t<T>>({df, hf});
     return B_cart;
 }
 
@@ -25,44 +26,50 @@ vector TFMagneticField::_at_position(const double &x, const double &y, const dou
 
 Eigen::MatrixXd TFMagneticField::_jac(const double &x, const double &y, const double &z, TFMagneticField &p) const
 {
-    vector out;
-    Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, TFMagneticField &_p)
-                                          { return _p._at_position(_x, _y, _z, _p); },
-                                          ad::wrt(p.a_disk, p.z1_disk, p.r1_disk, p.B1_disk, p.L_disk, p.phi_star_disk, p.H_disk, p.a_halo, p.z1_halo, p.B1_halo, p.L_halo, p.phi_star_halo, p.p_0, p.H_p, p.L_p), ad::at(x, y, z, p), out);
-    return _filter_diff(_deriv);
+    static const std::vector<std::pair<std::string, number TFMagneticField::*>> parameters{
+            {"a_disk", &TFMagneticField::a_disk}, {"z1_disk", &TFMagneticField::z1_disk},
+            {"r1_disk", &TFMagneticField::r1_disk}, {"B1_disk", &TFMagneticField::B1_disk},
+            {"L_disk", &TFMagneticField::L_disk}, {"phi_star_disk", &TFMagneticField::phi_star_disk},
+            {"H_disk", &TFMagneticField::H_disk}, {"a_halo", &TFMagneticField::a_halo},
+            {"z1_halo", &TFMagneticField::z1_halo}, {"B1_halo", &TFMagneticField::B1_halo},
+            {"L_halo", &TFMagneticField::L_halo}, {"phi_star_halo", &TFMagneticField::phi_star_halo},
+            {"p_0", &TFMagneticField::p_0}, {"H_p", &TFMagneticField::H_p}, {"L_p", &TFMagneticField::L_p}};
+    return p._active_jacobian(parameters, [&]()
+                              { return p._at_position<number>(x, y, z, p); });
 }
 
 #endif
 
-vector TFMagneticField::getDiskField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const
+template <typename T>
+vector_t<T> TFMagneticField::getDiskField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const
 {
-    vector B_cart{{0., 0., 0.}};
-    number B_r = 0;
-    number B_phi = 0;
-    number B_z = 0;
-
-    auto psd = p.phi_star_disk * M_PI / 180;
-    auto psh = p.phi_star_halo * M_PI / 180;
-    auto p_0 = p.p_0 * M_PI / 180;
+    vector_t<T> B_cart{{0., 0., 0.}};
+    T B_r = 0;
+    T B_phi = 0;
+    T B_z = 0;
+
+    auto psd = T(p.phi_star_disk) * M_PI / 180;
+    auto psh = T(p.phi_star_halo) * M_PI / 180;
+    auto p_0 = T(p.p_0) * M_PI / 180;
     auto cot_p0 = cos(p_0) / sin(p_0);
 
     if (activeDiskModel == "Ad1")
     { // ==========================================================
-        if (r > r1_disk)
+        if (r > T(p.r1_disk))
         {
-            auto z1_disk_z = (1. + a_disk * r1_disk * r1_disk) / (1. + a_disk * r * r); // z1_disk / z, eq. 4
+            auto z1_disk_z = (1. + T(p.a_disk) * T(p.r1_disk) * T(p.r1_disk)) / (1. + T(p.a_disk) * r * r); // z1_disk / z, eq. 4
             // B components in (r, phi, z)
-            auto B_r0 = radialFieldScale(B1_disk, psd, z1_disk_z * z, phi, r, z, cot_p0, p);
-            B_r = (r1_disk / r) * z1_disk_z * B_r0;
-            B_z = 2 * a_disk * r1_disk * z1_disk_z * z / (1 + a_disk * r * r) * B_r0;
-            B_phi = azimuthalFieldComponent(r, z, B_r, B_z, cot_p0, p);
+            auto B_r0 = radialFieldScale<T>(T(p.B1_disk), psd, z1_disk_z * z, phi, r, z, cot_p0, p);
+            B_r = (T(p.r1_disk) / r) * z1_disk_z * B_r0;
+            B_z = 2 * T(p.a_disk) * T(p.r1_disk) * z1_disk_z * z / (1 + T(p.a_disk) * r * r) * B_r0;
+            B_phi = azimuthalFieldComponent<T>(r, z, B_r, B_z, cot_p0, p);
         }
         else
         {
             // within r = r1_disk, the field lines are straight in direction g_phi + phi_star_disk
             // and thus z = z1
-            auto phi1_disk = shiftedWindingFunction(p.r1_disk, z, cot_p0, p) + psd;
-            auto B_amp = B1_disk * exp(-fabs(z) / H_disk);
+            auto phi1_disk = shiftedWindingFunction<T>(T(p.r1_disk), z, cot_p0, p) + psd;
+            auto B_amp = T(p.B1_disk) * exp(-fabs(z) / T(p.H_disk));
             B_r = cos(phi1_disk - phi) * B_amp;
             B_phi = sin(phi1_disk - phi) * B_amp;
         }
@@ -72,20 +79,20 @@ vector TFMagneticField::getDiskField(const double &r, const double &z, const dou
         // for model Bd1, best fit for n = 2
         if (r > epsilon)
         {
-            auto r1_disk_r = p.r1_disk / r;
+            auto r1_disk_r = T(p.r1_disk) / r;
             auto z1_disk_z = 5. / (r1_disk_r * r1_disk_r + 4. / sqrt(r1_disk_r)); // z1_disk / z -> remove z dependancy
-            auto B_r0 = radialFieldScale(p.B1_disk, psd, z1_disk_z * z, phi, r, z, cot_p0, p);
+            auto B_r0 = radialFieldScale<T>(T(p.B1_disk), psd, z1_disk_z * z, phi, r, z, cot_p0, p);
             B_r = r1_disk_r * z1_disk_z * B_r0;
             B_z = -0.4 * r1_disk_r / r * z1_disk_z * z1_disk_z * z * (r1_disk_r * r1_disk_r - 1. / sqrt(r1_disk_r)) * B_r0;
         }
         else
         {
-            auto z1_disk_z = 5. * r * r / (p.r1_disk * p.r1_disk); // z1_disk / z -> remove z dependancy
-            auto B_r0 = radialFieldScale(p.B1_disk, psd, z1_disk_z * z, phi, r, z, cot_p0, p);
-            B_r = 5. * r / p.r1_disk * B_r0;
-            B_z = -10. * z / p.r1_disk * B_r0;
+            auto z1_disk_z = 5. * r * r / (T(p.r1_disk) * T(p.r1_disk)); // z1_disk / z -> remove z dependancy
+            auto B_r0 = radialFieldScale<T>(T(p.B1_disk), psd, z1_disk_z * z, phi, r, z, cot_p0, p);
+            B_r = 5. * r / T(p.r1_disk) * B_r0;
+            B_z = -10. * z / T(p.r1_disk) * B_r0;
         }
-        B_phi = azimuthalFieldComponent(r, z, B_r, B_z, cot_p0, p);
+        B_phi = azimuthalFieldComponent<T>(r, z, B_r, B_z, cot_p0, p);
     }
     else if (activeDiskModel == "Dd1")
     { // ===================================================
@@ -94,24 +101,24 @@ vector TFMagneticField::getDiskField(const double &r, const double &z, const dou
         double z_abs = fabs(z);
         if (z_abs > p.epsilon)
         {
-            auto z1_disk_z = p.z1_disk / z_abs;
+            auto z1_disk_z = T(p.z1_disk) / z_abs;
             auto r1_disk_r = 1.5 / (sqrt(z1_disk_z) + 0.5 / z1_disk_z); // r1_disk / r
-            auto F_r = r1_disk_r * r <= p.L_disk ? 1. : exp(1. - r1_disk_r * r / p.L_disk);
+            auto F_r = r1_disk_r * r <= T(p.L_disk) ? 1. : exp(1. - r1_disk_r * r / T(p.L_disk));
             // simplication of the equation in the cosinus
-            auto B_z0 = z_sign * p.B1_disk * F_r * cos(phi - shiftedWindingFunction(r, z, cot_p0, p) - psd);
+            auto B_z0 = z_sign * T(p.B1_disk) * F_r * cos(phi - shiftedWindingFunction<T>(r, z, cot_p0, p) - psd);
             B_r = -0.5 / 1.5 * r1_disk_r * r1_disk_r * r1_disk_r * r / z_abs * (sqrt(z1_disk_z) - 1 / z1_disk_z) * B_z0;
             B_z = z_sign * r1_disk_r * r1_disk_r * B_z0;
         }
         else
         {
-            auto z_z1_disk = z_abs / p.z1_disk;
-            auto r1_disk_r = 1.5 * sqrt(z_abs / p.z1_disk); // r1_disk / r
-            auto F_r = r1_disk_r * r <= p.L_disk ? 1. : exp(1. - r1_disk_r * r / p.L_disk);
-            auto B_z0 = z_sign * p.B1_disk * F_r * cos(phi - shiftedWindingFunction(r, z, cot_p0, p) - psd);
-            B_r = -1.125 * r / p.z1_disk * (1 - 2.5 * z_z1_disk * sqrt(z_z1_disk)) * B_z0;
+            auto z_z1_disk = z_abs / T(p.z1_disk);
+            auto r1_disk_r = 1.5 * sqrt(z_abs / T(p.z1_disk)); // r1_disk / r
+            auto F_r = r1_disk_r * r <= T(p.L_disk) ? 1. : exp(1. - r1_disk_r * r / T(p.L_disk));
+            auto B_z0 = z_sign * T(p.B1_disk) * F_r * cos(phi - shiftedWindingFunction<T>(r, z, cot_p0, p) - psd);
+            B_r = -1.125 * r / T(p.z1_disk) * (1 - 2.5 * z_z1_disk * sqrt(z_z1_disk)) * B_z0;
             B_z = z_sign * r1_disk_r * r1_disk_r * B_z0;
         }
-        B_phi = azimuthalFieldComponent(r, z, B_r, B_z, cot_p0, p);
+        B_phi = azimuthalFieldComponent<T>(r, z, B_r, B_z, cot_p0, p);
     }
 
     // Convert to (x, y, z) components
@@ -121,36 +128,37 @@ vector TFMagneticField::getDiskField(const double &r, const double &z, const dou
     return B_cart;
 }
 
-vector TFMagneticField::getHaloField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const
+template <typename T>
+vector_t<T> TFMagneticField::getHaloField(const double &r, const double &z, const double &phi, const double &sinPhi, const double &cosPhi, const TFMagneticField &p) const
 {
     int m;
-    vector B_cart{{0., 0., 0.}};
-    auto r1_halo_r = (1. + p.a_halo * p.z1_halo * p.z1_halo) / (1. + p.a_halo * z * z);
+    vector_t<T> B_cart{{0., 0., 0.}};
+    auto r1_halo_r = (1. + T(p.a_halo) * T(p.z1_halo) * T(p.z1_halo)) / (1. + T(p.a_halo) * z * z);
     // B components in (r, phi, z)
-    number B_z0;
+    T B_z0;
 
-    auto psd = p.phi_star_disk * M_PI / 180;
-    auto psh = p.phi_star_halo * M_PI / 180;
-    auto p_0 = p.p_0 * M_PI / 180;
+    auto psd = T(p.phi_star_disk) * M_PI / 180;
+    auto psh = T(p.phi_star_halo) * M_PI / 180;
+    auto p_0 = T(p.p_0) * M_PI / 180;
     auto cot_p0 = cos(p_0) / sin(p_0);
 
     if (activeHaloModel == "C0")
     { // m = 0
-        B_z0 = B1_halo * exp(-r1_halo_r * r / L_halo);
+        B_z0 = T(p.B1_halo) * exp(-r1_halo_r * r / T(p.L_halo));
     }
     else if (activeHaloModel == "C1")
     { // m = 1
         // simplication of the equation in the cosinus
-        auto phi_prime = phi - shiftedWindingFunction(r, z, cot_p0, p) - psd;
-        B_z0 = B1_halo * exp(-r1_halo_r * r / L_halo) * cos(phi_prime);
+        auto phi_prime = phi - shiftedWindingFunction<T>(r, z, cot_p0, p) - psd;
+        B_z0 = T(p.B1_halo) * exp(-r1_halo_r * r / T(p.L_halo)) * cos(phi_prime);
     }
 
     // Contrary to article, Br has been rewriten to a little bit by replacing
     // (2 * a * r1**3 * z) / (r**2) by (2 * a * r1**2 * z) / (r * (1+a*z**2))
     // but that is strictly equivalent except we can reintroduce the z1 in the expression via r1
-    auto B_r = 2 * p.a_halo * r1_halo_r * r1_halo_r * r * z / (1. + a_halo * z * z) * B_z0;
+    auto B_r = 2 * T(p.a_halo) * r1_halo_r * r1_halo_r * r * z / (1. + T(p.a_halo) * z * z) * B_z0;
     auto B_z = r1_halo_r * r1_halo_r * B_z0;
-    auto B_phi = azimuthalFieldComponent(r, z, B_r, B_z, cot_p0, p);
+    auto B_phi = azimuthalFieldComponent<T>(r, z, B_r, B_z, cot_p0, p);
 
     // Convert to (x, y, z) components
     B_cart[0] = -(B_r * cosPhi - B_phi * sinPhi); // flip x-component at the end
@@ -160,31 +168,35 @@ vector TFMagneticField::getHaloField(const double &r, const double &z, const dou
     return B_cart;
 }
 
-number TFMagneticField::azimuthalFieldComponent(const double &r, const double &z, const number &B_r, const number &B_z, const number &cp0, const TFMagneticField &p) const
+template <typename T>
+T TFMagneticField::azimuthalFieldComponent(const double &r, const double &z, const T &B_r, const T &B_z, const T &cp0, const TFMagneticField &p) const
 {
-    auto r_ = r / p.L_p;
+    auto r_ = r / T(p.L_p);
     auto rscale = r > p.epsilon ? r_ * exp(-r_) / (1 - exp(-r_)) : 1 - r_ / 2. - r_ * r_ / 12.;
-    auto B_phi = cp0 / zscale(z, p) * rscale * B_r;
-    B_phi = B_phi - 2 * z * r / (p.H_p * p.H_p) / zscale(z, p) * shiftedWindingFunction(r, z, cp0, p) * B_z;
+    auto B_phi = cp0 / zscale<T>(z, p) * rscale * B_r;
+    B_phi = B_phi - 2 * z * r / (T(p.H_p) * T(p.H_p)) / zscale<T>(z, p) * shiftedWindingFunction<T>(r, z, cp0, p) * B_z;
     return B_phi;
 }
 
-number TFMagneticField::radialFieldScale(const number &B1, const number &phi_star, const number &z1, const double &phi, const double &r, const double &z, const number &cp0, const TFMagneticField &p) const
+template <typename T>
+T TFMagneticField::radialFieldScale(const T &B1, const T &phi_star, const T &z1, const double &phi, const double &r, const double &z, const T &cp0, const TFMagneticField &p) const
 {
     // simplication of the equation in the cosinus
-    auto phi_prime = phi - shiftedWindingFunction(r, z, cp0, p) - phi_star;
+    auto phi_prime = phi - shiftedWindingFunction<T>(r, z, cp0, p) - phi_star;
     // This term occures is parameterizations of models A and B always bisymmetric (m = 1)
-    return B1 * exp(-abs(z1) / p.H_disk) * cos(phi_prime);
+    return B1 * exp(-abs(z1) / T(p.H_disk)) * cos(phi_prime);
 }
 
-number TFMagneticField::shiftedWindingFunction(const number &r, const double &z, const number &cp0, const TFMagneticField &p) const
+template <typename T>
+T TFMagneticField::shiftedWindingFunction(const T &r, const double &z, const T &cp0, const TFMagneticField &p) const
 {
-    return cp0 * log(1 - exp(-r / p.L_p) + p.epsilon) / zscale(z, p);
+    return cp0 * log(1 - exp(-r / T(p.L_p)) + p.epsilon) / zscale<T>(z, p);
 }
 
-number TFMagneticField::zscale(const double &z, const TFMagneticField &p) const
+template <typename T>
+T TFMagneticField::zscale(const double &z, const TFMagneticField &p) const
 {
-    return 1 + z * z / p.H_p / p.H_p;
+    return 1 + z * z / T(p.H_p) / T(p.H_p);
 }
 
 void TFMagneticField::set_params(std::string dtype, std::string htype)
@@ -298,3 +310,6 @@ void TFMagneticField::set_params(std::string dtype, std::string htype)
 
     L_p = 50;
 }
+
+template vector_t<double> TFMagneticField::_at_position<double>(const double &, const double &, const double &, const TFMagneticField &) const;
+template class RegularVectorFieldModel<TFMagneticField>;
@@ -72,15 +72,16 @@ void UFMagneticField::set_parameters(const std::string &model_choice)
 }
 
 
-vector UFMagneticField::_at_position(const double &x, const double &y, const double &z, const UFMagneticField &p) const
+template <typename T>
+vector_t<T> UFMagneticField::_at_position(const double &x, const double &y, const double &z, const UFMagneticField &p) const
 {
-  vector B_cart{{0., 0., 0.}};
+  vector_t<T> B_cart{{0., 0., 0.}};
   double squared_length = pow(x, 2) + pow(y, 2) + pow(z, 2);
   if (squared_length > pow(p.fMaxRadius, 2))
     return B_cart;
   else {
-    const auto diskField = GetDiskField(x, y, z, p);
-    const auto haloField = GetHaloField(x, y, z, p);
+    const auto diskField = GetDiskField<T>(x, y, z, p);
+    const auto haloField = GetHaloField<T>(x, y, z, p);
     for (size_t l = 0; l < 3; l++) {
       B_cart[l] = diskField[l] + haloField[l];
     }
@@ -88,25 +89,27 @@ vector UFMagneticField::_at_position(const double &x, const double &y, const dou
   }
 }
 
-vector UFMagneticField::GetDiskField(const double &x, const double &y, const double &z, const UFMagneticField &p)
+template <typename T>
+vector_t<T> UFMagneticField::GetDiskField(const double &x, const double &y, const double &z, const UFMagneticField &p)
   const
 {
   if (p.activeModel == "spur")
-    return GetSpurField(x, y, z, p);
+    return GetSpurField<T>(x, y, z, p);
   else
-    return GetSpiralField(x, y, z, p);
+    return GetSpiralField<T>(x, y, z, p);
 }
 
 
-vector UFMagneticField::GetHaloField(const double &x, const double &y, const double &z, const UFMagneticField &p)
+template <typename T>
+vector_t<T> UFMagneticField::GetHaloField(const double &x, const double &y, const double &z, const UFMagneticField &p)
   const
 {
   if (p.activeModel == "twistX")
-    return GetTwistedHaloField(x, y, z, p);
+    return GetTwistedHaloField<T>(x, y, z, p);
   else {
-    vector B_cart_halo{{0., 0., 0.}};
-    const auto poloidalHaloField = GetPoloidalHaloField(x, y, z, p);
-    const auto toroidalHaloField = GetToroidalHaloField(x, y, z, p);
+    vector_t<T> B_cart_halo{{0., 0., 0.}};
+    const auto poloidalHaloField = GetPoloidalHaloField<T>(x, y, z, p);
+    const auto toroidalHaloField = GetToroidalHaloField<T>(x, y, z, p);
     for (size_t l = 0; l < 3; l++) {
       B_cart_halo[l] = toroidalHaloField[l] + poloidalHaloField[l];
     }
@@ -116,23 +119,24 @@ vector UFMagneticField::GetHaloField(const double &x, const double &y, const dou
 }
 
 
-vector UFMagneticField::GetTwistedHaloField(const double x, const double y, const double z, const UFMagneticField &p)
+template <typename T>
+vector_t<T> UFMagneticField::GetTwistedHaloField(const double x, const double y, const double z, const UFMagneticField &p)
   const
 {
   const double r = sqrt(x*x + y*y);
   const double cosPhi = r > std::numeric_limits<double>::min() ? x / r : 1;
   const double sinPhi = r > std::numeric_limits<double>::min() ? y / r : 0;
 
-  vector bXCart = GetPoloidalHaloField(x, y, z, p);
-  vector bXCartTmp{{bXCart[0], bXCart[1], bXCart[2]}};
-  vector bXCyl = Cart2Cyl(bXCartTmp, cosPhi, sinPhi);
+  vector_t<T> bXCart = GetPoloidalHaloField<T>(x, y, z, p);
+  vector_t<T> bXCartTmp{{bXCart[0], bXCart[1], bXCart[2]}};
+  vector_t<T> bXCyl = Cart2Cyl(bXCartTmp, cosPhi, sinPhi);
 
-  number bZ = bXCyl[2];
-  number bR = bXCyl[0];
+  T bZ = bXCyl[2];
+  T bR = bXCyl[0];
 
-  number bPhi = 0;
+  T bPhi = 0;
 
-  if (p.fTwistingTime != 0 && r != 0) {
+  if (T(p.fTwistingTime) != 0 && r != 0) {
     // radial rotation curve parameters (fit to Reid et al 2014)
     const double v0 = -240 * astro::kilometer/astro::second;
     const double r0 = 1.6; // kpc
@@ -152,49 +156,51 @@ vector UFMagneticField::GetTwistedHaloField(const double x, const double y, cons
     const double deltaR = v0 * ((1-fr)/r0 - fr/r) * gz;
 
     // Eq.(45)
-    bPhi = (bZ * deltaZ + bR * deltaR) * p.fTwistingTime;
+    bPhi = (bZ * deltaZ + bR * deltaR) * T(p.fTwistingTime);
 
   }
-  vector bCylX{{bR, bPhi , bZ}};
-  return Cyl2Cart<vector>(bCylX, cosPhi, sinPhi);
+  vector_t<T> bCylX{{bR, bPhi , bZ}};
+  return Cyl2Cart<vector_t<T>>(bCylX, cosPhi, sinPhi);
 }
 
-vector UFMagneticField::GetToroidalHaloField(const double x, const double y, const double z, const UFMagneticField &p)
+template <typename T>
+vector_t<T> UFMagneticField::GetToroidalHaloField(const double x, const double y, const double z, const UFMagneticField &p)
   const
 {
   const double r2 = x*x + y*y;
   const double r = sqrt(r2);
   const double absZ = abs(z);
 
-  number b0 = z >= 0 ? p.fToroidalBN : p.fToroidalBS;
-  number rh = p.fToroidalR;
-  number z0 = p.fToroidalZ;
-  number fwh = p.fToroidalW;
-  //number sigmoidR = Sigmoid<number>(r, rh, fwh);
-  number sigmoidR = 1 / (1 + exp(-(r-rh)/fwh));
-  //number sigmoidZ = Sigmoid<number>(absZ, p.fDiskH, p.fDiskW);
-  number sigmoidZ = 1 / (1 + exp(-(absZ-p.fDiskH)/p.fDiskW));
+  T b0 = z >= 0 ? T(p.fToroidalBN) : T(p.fToroidalBS);
+  T rh = T(p.fToroidalR);
+  T z0 = T(p.fToroidalZ);
+  T fwh = T(p.fToroidalW);
+  //T sigmoidR = Sigmoid<T>(r, rh, fwh);
+  T sigmoidR = 1 / (1 + exp(-(r-rh)/fwh));
+  //T sigmoidZ = Sigmoid<T>(absZ, T(p.fDiskH), T(p.fDiskW));
+  T sigmoidZ = 1 / (1 + exp(-(absZ-T(p.fDiskH))/T(p.fDiskW)));
 
   // Eq. (21)
-  number bPhi = b0 * (1. - sigmoidR) * sigmoidZ * exp(-absZ/z0);
+  T bPhi = b0 * (1. - sigmoidR) * sigmoidZ * exp(-absZ/z0);
 
-  vector bCyl{{0., bPhi, 0.}};
+  vector_t<T> bCyl{{0., bPhi, 0.}};
   const double cosPhi = r > std::numeric_limits<double>::min() ? x / r : 1;
   const double sinPhi = r > std::numeric_limits<double>::min() ? y / r : 0;
-  return Cyl2Cart<vector>(bCyl, cosPhi, sinPhi);
+  return Cyl2Cart<vector_t<T>>(bCyl, cosPhi, sinPhi);
 }
 
-vector UFMagneticField::GetPoloidalHaloField(const double x, const double y, const double z, const UFMagneticField &p)
+template <typename T>
+vector_t<T> UFMagneticField::GetPoloidalHaloField(const double x, const double y, const double z, const UFMagneticField &p)
   const
 {
   const double r2 = x*x + y*y;
   const double r = std::sqrt(r2);
 
-  number c = pow(p.fPoloidalA/p.fPoloidalZ, p.fPoloidalP);
-  number a0p = pow(p.fPoloidalA, p.fPoloidalP);
-  number rp = pow(r, p.fPoloidalP);
-  number abszp = pow(abs(z), p.fPoloidalP);
-  number cabszp = c*abszp;
+  T c = pow(T(p.fPoloidalA)/T(p.fPoloidalZ), T(p.fPoloidalP));
+  T a0p = pow(T(p.fPoloidalA), T(p.fPoloidalP));
+  T rp = pow(r, T(p.fPoloidalP));
+  T abszp = pow(abs(z), T(p.fPoloidalP));
+  T cabszp = c*abszp;
 
   /*
     since $\sqrt{a^2 + b} - a$ is numerical unstable for $b\ll a$,
@@ -202,11 +208,11 @@ vector UFMagneticField::GetPoloidalHaloField(const double x, const double y, con
     + b} + a} = \frac{b}{\sqrt{a^2 + b} + a}$}
   */
 
-  number t0 = a0p + cabszp - rp;
-  number t1 = sqrt(pow(t0, 2) + 4*a0p*rp);
-  number ap = 2*a0p*rp / (t1  + t0);
+  T t0 = a0p + cabszp - rp;
+  T t1 = sqrt(pow(t0, 2) + 4*a0p*rp);
+  T ap = 2*a0p*rp / (t1  + t0);
 
-  number a = 0;
+  T a = 0;
   if (ap < 0) {
     if (r > std::numeric_limits<double>::min()) {
       // this should never happen
@@ -216,104 +222,106 @@ vector UFMagneticField::GetPoloidalHaloField(const double x, const double y, con
       a = 0;
   }
   else
-    a = pow(ap, 1/p.fPoloidalP);
+    a = pow(ap, 1/T(p.fPoloidalP));
 
   // Eq.(29) and Eq.(32)
-  number radialDependence =
+  T radialDependence =
     p.activeModel == "base" ?
-    exp(-a/p.fPoloidalR) :
-    //1 - Sigmoid<number>(a, p.fPoloidalR, p.fPoloidalW);
-    1 - 1 / (1 + exp(-(a-p.fPoloidalR)/p.fPoloidalW));
+    exp(-a/T(p.fPoloidalR)) :
+    //1 - Sigmoid<T>(a, T(p.fPoloidalR), T(p.fPoloidalW));
+    1 - 1 / (1 + exp(-(a-T(p.fPoloidalR))/T(p.fPoloidalW)));
 
   // Eq.(28)
-  number Bzz = p.fPoloidalB * radialDependence;
+  T Bzz = T(p.fPoloidalB) * radialDependence;
 
   // (r/a)
-  number rOverA =  1 / pow(2*a0p / (t1  + t0), 1/p.fPoloidalP);
+  T rOverA =  1 / pow(2*a0p / (t1  + t0), 1/T(p.fPoloidalP));
 
   // Eq.(35) for p=n
   const double signZ = z < 0 ? -1 : 1;
-  number Br =
-    Bzz * c * a / rOverA * signZ * pow(abs(z), p.fPoloidalP - 1) / t1;
+  T Br =
+    Bzz * c * a / rOverA * signZ * pow(abs(z), T(p.fPoloidalP) - 1) / t1;
 
   // Eq.(36) for p=n
-  number Bz = Bzz * pow(rOverA, p.fPoloidalP-2) * (ap + a0p) / t1;
+  T Bz = Bzz * pow(rOverA, T(p.fPoloidalP)-2) * (ap + a0p) / t1;
 
   if (r < std::numeric_limits<double>::min())
-    return vector{{0., 0., Bz}};
+    return vector_t<T>{{0., 0., Bz}};
   else {
-    vector bCylX{{Br, 0 , Bz}};
+    vector_t<T> bCylX{{Br, 0 , Bz}};
     const double cosPhi =  x / r;
     const double sinPhi =  y / r;
-    return Cyl2Cart<vector>(bCylX, cosPhi, sinPhi);
+    return Cyl2Cart<vector_t<T>>(bCylX, cosPhi, sinPhi);
   }
 }
 
-vector UFMagneticField::GetSpurField(const double x, const double y, const double z, const UFMagneticField &p)
+template <typename T>
+vector_t<T> UFMagneticField::GetSpurField(const double x, const double y, const double z, const UFMagneticField &p)
   const
 {
   // reference approximately at solar radius
   const double rRef = 8.2; //kpc
 
-  auto fSinPitch = sin(p.fDiskPitch);
-  auto fCosPitch = cos(p.fDiskPitch);
-  auto fTanPitch = tan(p.fDiskPitch);
+  auto fSinPitch = sin(T(p.fDiskPitch));
+  auto fCosPitch = cos(T(p.fDiskPitch));
+  auto fTanPitch = tan(T(p.fDiskPitch));
   // cylindrical coordinates
   const double r2 = x*x + y*y;
   const double r = sqrt(r2);
   if (r < std::numeric_limits<double>::min())
-    return vector{{0, 0, 0}};
+    return vector_t<T>{{0, 0, 0}};
 
   double phi = atan2(y, x);
   if (phi < 0)
     phi += num::twopi;
 
-  number phiRef = p.fDiskPhase1;
+  T phiRef = T(p.fDiskPhase1);
   int iBest = -2;
-  number bestDist = -1;
+  T bestDist = -1;
   for (int i = -1; i <= 1; ++i) {
-    number pphi = phi - phiRef + i*num::twopi;
-    number rr = rRef*exp(pphi * fTanPitch);
+    T pphi = phi - phiRef + i*num::twopi;
+    T rr = rRef*exp(pphi * fTanPitch);
     if (bestDist < 0 || abs(r-rr) < bestDist) {
       bestDist =  abs(r-rr);
       iBest = i;
     }
   }
   if (iBest == 0) {
-    number phi0 = phi - log(r/rRef) / fTanPitch;
+    T phi0 = phi - log(r/rRef) / fTanPitch;
 
     // Eq. (16)
-    //number deltaPhi0 = DeltaPhi<number, number, number>(phiRef, phi0);
-    number deltaPhi0 = acos(cos(phi0)*cos(phiRef) + sin(phi0)*sin(phiRef));
-    number delta = deltaPhi0 / p.fSpurWidth;
-    number B = p.fDiskB1 * exp(-0.5*pow(delta, 2));
+    //T deltaPhi0 = DeltaPhi<T, T, T>(phiRef, phi0);
+    T deltaPhi0 = acos(cos(phi0)*cos(phiRef) + sin(phi0)*sin(phiRef));
+    T delta = deltaPhi0 / T(p.fSpurWidth);
+    T B = T(p.fDiskB1) * exp(-0.5*pow(delta, 2));
 
     // Eq. (18)
     const double wS = 5*num::rad;
-    number phiC = p.fSpurCenter;
-    //number deltaPhiC = DeltaPhi<number, number, number>(phiC, phi);
-    number deltaPhiC = acos(cos(phi)*cos(phiC) + sin(phi)*sin(phiC));
-    number lC = p.fSpurLength;
-    //number gS = 1 - Sigmoid<number>(abs(deltaPhiC), lC, wS);
-    number gS = 1 - 1 / (1 + exp(-(abs(deltaPhiC)-lC)/wS));
+    T phiC = T(p.fSpurCenter);
+    //T deltaPhiC = DeltaPhi<T, T, T>(phiC, phi);
+    T deltaPhiC = acos(cos(phi)*cos(phiC) + sin(phi)*sin(phiC));
+    T lC = T(p.fSpurLength);
+    //T gS = 1 - Sigmoid<T>(abs(deltaPhiC), lC, wS);
+    T gS = 1 - 1 / (1 + exp(-(abs(deltaPhiC)-lC)/wS));
 
     // Eq. (13)
-    //number hd = 1 - Sigmoid<number>(abs(z), p.fDiskH, p.fDiskW);
-    number hd = 1 - 1 / (1 + exp(-(abs(z)-p.fDiskH)/p.fDiskW));
+    //T hd = 1 - Sigmoid<T>(abs(z), T(p.fDiskH), T(p.fDiskW));
+    T hd = 1 - 1 / (1 + exp(-(abs(z)-T(p.fDiskH))/T(p.fDiskW)));
 
     // Eq. (17)
-    number bS = rRef/r * B * hd * gS;
-    vector bCyl{{bS * fSinPitch, bS * fCosPitch, 0.}};
+    T bS = rRef/r * B * hd * gS;
+    vector_t<T> bCyl{{bS * fSinPitch, bS * fCosPitch, 0.}};
     const double cosPhi = x / r;
     const double sinPhi = y / r;
-    return Cyl2Cart<vector>(bCyl, cosPhi, sinPhi);
+    return Cyl2Cart<vector_t<T>>(bCyl, cosPhi, sinPhi);
   }
   else
-    return vector{{0, 0, 0}};
+    return vector_t<T>{{0, 0, 0}};
 
 }
 
-vector UFMagneticField::GetSpiralField(const double x, const double y, const double z, const UFMagneticField &p)
+template <typename T>
+vector_t<T> UFMagneticField::GetSpiralField(const double x, const double y, const double z, const UFMagneticField &p)
   const
 {
   // reference radius
@@ -325,21 +333,21 @@ vector UFMagneticField::GetSpiralField(const double x, const double y, const dou
   const double rOuter = 20; // kpc
   const double wOuter = 0.5; // kpc
 
-  auto fSinPitch = sin(p.fDiskPitch);
-  auto fCosPitch = cos(p.fDiskPitch);
-  auto fTanPitch = tan(p.fDiskPitch);
+  auto fSinPitch = sin(T(p.fDiskPitch));
+  auto fCosPitch = cos(T(p.fDiskPitch));
+  auto fTanPitch = tan(T(p.fDiskPitch));
 
   // cylindrical coordinates
   const double r2 = x*x + y*y;
   if (r2 == 0)
-    return vector{{0, 0, 0}};
+    return vector_t<T>{{0, 0, 0}};
 
   const double r = std::sqrt(r2);
   const double phi = std::atan2(y, x);
 
   // Eq.(13)
-  //number hdz = 1 - Sigmoid(abs(z), fDiskH, fDiskW);
-  number hdz = 1 - 1 / (1 + exp(-(abs(z)-p.fDiskH)/p.fDiskW));
+  //T hdz = 1 - Sigmoid(abs(z), fDiskH, fDiskW);
+  T hdz = 1 - 1 / (1 + exp(-(abs(z)-T(p.fDiskH))/T(p.fDiskW)));
 
   // Eq.(14) times rRef divided by r
   //const double rFacI = Sigmoid(r, rInner, wInner);
@@ -352,36 +360,47 @@ vector UFMagneticField::GetSpiralField(const double x, const double y, const dou
   const double gdrTimesRrefByR = rRef * rFac * rFacO * rFacI;
 
   // Eq. (12)
-  number phi0 = phi - log(r/rRef) / fTanPitch;
+  T phi0 = phi - log(r/rRef) / fTanPitch;
 
   // Eq. (10)
-  number b =
-    fDiskB1 * cos(1 * (phi0 - p.fDiskPhase1)) +
-    fDiskB2 * cos(2 * (phi0 - p.fDiskPhase2)) +
-    fDiskB3 * cos(3 * (phi0 - p.fDiskPhase3));
+  T b =
+    T(p.fDiskB1) * cos(1 * (phi0 - T(p.fDiskPhase1))) +
+    T(p.fDiskB2) * cos(2 * (phi0 - T(p.fDiskPhase2))) +
+    T(p.fDiskB3) * cos(3 * (phi0 - T(p.fDiskPhase3)));
 
   // Eq. (11)
-  number fac = hdz * gdrTimesRrefByR;
-  vector bCyl{{ b * fac * fSinPitch,
+  T fac = hdz * gdrTimesRrefByR;
+  vector_t<T> bCyl{{ b * fac * fSinPitch,
       b * fac * fCosPitch,
       0.}};
 
   const double cosPhi = x / r;
   const double sinPhi = y / r;
-  return Cyl2Cart<vector>(bCyl, cosPhi, sinPhi);
+  return Cyl2Cart<vector_t<T>>(bCyl, cosPhi, sinPhi);
 }
 
 #if autodiff_FOUND
 
 Eigen::MatrixXd UFMagneticField::_jac(const double &x, const double &y, const double &z, UFMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, UFMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.fPoloidalA, p.fDiskB1, p.fDiskB2, p.fDiskB3, p.fDiskH, p.fDiskPhase1, p.fDiskPhase2, p.fDiskPhase3, p.fDiskPitch, p.fDiskW, p.fPoloidalB,p.fPoloidalP, p.fPoloidalR, p.fPoloidalW, p.fPoloidalZ, p.fStriation, p.fToroidalBN, p.fToroidalBS, p.fToroidalR, p.fToroidalW, p.fToroidalZ, p.fSpurCenter, p.fSpurLength, p.fSpurWidth, p.fTwistingTime
-                                        
-                                        ), ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number UFMagneticField::*>> parameters{
+      {"fPoloidalA", &UFMagneticField::fPoloidalA}, {"fDiskB1", &UFMagneticField::fDiskB1},
+      {"fDiskB2", &UFMagneticField::fDiskB2}, {"fDiskB3", &UFMagneticField::fDiskB3}, {"fDiskH", &UFMagneticField::fDiskH},
+      {"fDiskPhase1", &UFMagneticField::fDiskPhase1}, {"fDiskPhase2", &UFMagneticField::fDiskPhase2},
+      {"fDiskPhase3", &UFMagneticField::fDiskPhase3}, {"fDiskPitch", &UFMagneticField::fDiskPitch},
+      {"fDiskW", &UFMagneticField::fDiskW}, {"fPoloidalB", &UFMagneticField::fPoloidalB},
+      {"fPoloidalP", &UFMagneticField::fPoloidalP}, {"fPoloidalR", &UFMagneticField::fPoloidalR},
+      {"fPoloidalW", &UFMagneticField::fPoloidalW}, {"fPoloidalZ", &UFMagneticField::fPoloidalZ},
+      {"fStriation", &UFMagneticField::fStriation}, {"fToroidalBN", &UFMagneticField::fToroidalBN},
+      {"fToroidalBS", &UFMagneticField::fToroidalBS}, {"fToroidalR", &UFMagneticField::fToroidalR},
+      {"fToroidalW", &UFMagneticField::fToroidalW}, {"fToroidalZ", &UFMagneticField::fToroidalZ},
+      {"fSpurCenter", &UFMagneticField::fSpurCenter}, {"fSpurLength", &UFMagneticField::fSpurLength},
+      {"fSpurWidth", &UFMagneticField::fSpurWidth}, {"fTwistingTime", &UFMagneticField::fTwistingTime}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
-#endif
\ No newline at end of file
+#endif
+
+template vector_t<double> UFMagneticField::_at_position<double>(const double &, const double &, const double &, const UFMagneticField &) const;
+template class RegularVectorFieldModel<UFMagneticField>;
@@ -7,9 +7,10 @@
 
 // https://iopscience.iop.org/article/10.1086/513699, implementation from Hammurabi (old)
 
-vector WMAPMagneticField::_at_position(const double &x, const double &y, const double &z, const WMAPMagneticField &p) const { 
+template <typename T>
+vector_t<T> WMAPMagneticField::_at_position(const double &x, const double &y, const double &z, const WMAPMagneticField &p) const { 
     
-    vector B_vec3{{0, 0, 0}};
+    vector_t<T> B_vec3{{0, 0, 0}};
     double r = sqrt(x*x + y*y);
 
     if (r > b_r_max || r < b_r_min) { 
@@ -18,15 +19,15 @@ vector WMAPMagneticField::_at_position(const double &x, const double &y, const d
 
 	double phi = atan2(y, x);
 
-    auto psi_r = p.b_psi0*(M_PI/180.) + p.b_psi1*(M_PI/180.) * log(r/p.b_r0);
-    auto xsi_z = p.b_xsi0*(M_PI/180.) * tanh(z/p.b_z0);
+    auto psi_r = T(p.b_psi0)*(M_PI/180.) + T(p.b_psi1)*(M_PI/180.) * log(r/T(p.b_r0));
+    auto xsi_z = T(p.b_xsi0)*(M_PI/180.) * tanh(z/T(p.b_z0));
     
-    vector B_cyl{{p.b_b0 * sin(psi_r) * cos(xsi_z),   // eq. 9
-                  p.b_b0 * cos(psi_r) * cos(xsi_z), 
-                  p.b_b0 * sin(xsi_z) }
+    vector_t<T> B_cyl{{T(p.b_b0) * sin(psi_r) * cos(xsi_z),   // eq. 9
+                  T(p.b_b0) * cos(psi_r) * cos(xsi_z), 
+                  T(p.b_b0) * sin(xsi_z) }
                 };
 
-    B_vec3 = Cyl2Cart<vector>(phi, B_cyl);
+    B_vec3 = Cyl2Cart<vector_t<T>>(phi, B_cyl);
     
     // Antisymmetric, swap the signs.  The way my pitch angle is defined,
     // it seems this has to be swapped this way.  <------ hammurabi comment
@@ -43,11 +44,15 @@ vector WMAPMagneticField::_at_position(const double &x, const double &y, const d
 
 Eigen::MatrixXd WMAPMagneticField::_jac(const double &x, const double &y, const double &z, WMAPMagneticField &p) const
 {
-  vector out;
-  Eigen::MatrixXd _deriv = ad::jacobian([&](double _x, double _y, double _z, WMAPMagneticField &_p)
-                                        { return _p._at_position(_x, _y, _z, _p); },
-                                        ad::wrt(p.b_Rsun, p.b_b0, p.b_z0, p.b_r0, p.b_psi0, p.b_psi1, p.b_xsi0), ad::at(x, y, z, p), out);
-  return _filter_diff(_deriv);
+  static const std::vector<std::pair<std::string, number WMAPMagneticField::*>> parameters{
+      {"b_Rsun", &WMAPMagneticField::b_Rsun}, {"b_b0", &WMAPMagneticField::b_b0}, {"b_z0", &WMAPMagneticField::b_z0},
+      {"b_r0", &WMAPMagneticField::b_r0}, {"b_psi0", &WMAPMagneticField::b_psi0},
+      {"b_psi1", &WMAPMagneticField::b_psi1}, {"b_xsi0", &WMAPMagneticField::b_xsi0}};
+  return p._active_jacobian(parameters, [&]()
+                            { return p._at_position<number>(x, y, z, p); });
 }
 
-#endif
\ No newline at end of file
+#endif
+
+template vector_t<double> WMAPMagneticField::_at_position<double>(const double &, const double &, const double &, const WMAPMagneticField &) const;
+template class RegularVectorFieldModel<WMAPMagneticField>;
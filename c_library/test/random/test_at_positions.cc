@@ -0,0 +1,77 @@
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "RandomVectorField.h"
+#include "GridMemory.h"
+
+// A vector field with a spatial profile and an anisotropy which vary across the grid
+class VaryingVectorField : public RandomVectorField {
+public:
+    using RandomVectorField::RandomVectorField;
+
+    double spatial_profile(const double &x, const double &y, const double &z) const override {
+        return 1. + 0.5*x*x + 0.3*y - z;
+    }
+
+    vector_t<double> anisotropy_direction(const double &x, const double &y, const double &z) const override {
+        return {{1., x - 0.2*y, 0.5*z}};
+    }
+
+    double calculate_fourier_sigma(const double &abs_k, const double &dk) const override {
+        return simple_spectrum(abs_k, dk, 1., 2.);
+    }
+};
+
+// At the voxels of the grid, at_positions equals on_grid of the same seed, for every engine
+void test_voxels() {
+    const std::array<int, 3> shp {{7, 6, 5}};
+    const std::array<double, 3> rpt {{-1., -2., -0.5}};
+    const std::array<double, 3> inc {{0.5, 0.7, 0.3}};
+    const size_t gs = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+    std::vector<double> x, y, z;
+    for (int i = 0; i < shp[0]; ++i) {
+        for (int j = 0; j < shp[1]; ++j) {
+            for (int k = 0; k < shp[2]; ++k) {
+                x.push_back(rpt[0] + i*inc[0]);
+                y.push_back(rpt[1] + j*inc[1]);
+                z.push_back(rpt[2] + k*inc[2]);
+            }
+        }
+    }
+
+    for (VectorFieldEngine engine : {VectorFieldEngine::standard, VectorFieldEngine::spectral, VectorFieldEngine::modulated_noise}) {
+        for (bool clean : {false, true}) {
+            for (bool anisotropy : {false, true}) {
+                VaryingVectorField field(shp, rpt, inc);
+                field.engine = engine;
+                field.clean_divergence = clean;
+                field.apply_anisotropy = anisotropy;
+                field.anisotropy_rho = 2.;
+                field.nufft_tolerance = 1e-10;
+                std::array<double*, 3> grid = field.on_grid(11);
+                std::vector<double> bx(gs), by(gs), bz(gs);
+                field.at_positions(x.data(), y.data(), z.data(), gs, {bx.data(), by.data(), bz.data()}, 11);
+
+                const std::array<const double*, 3> points {{bx.data(), by.data(), bz.data()}};
+                double scale = 0.;
+                for (int d = 0; d < 3; ++d) {
+                    for (size_t m = 0; m < gs; ++m) {
+                        scale = std::max(scale, std::abs(grid[d][m]));
+                    }
+                }
+                for (int d = 0; d < 3; ++d) {
+                    for (size_t m = 0; m < gs; ++m) {
+                        assert (std::abs(points[d][m] - grid[d][m]) <= 1e-8 * scale);
+                    }
+                    free_grid_memory(grid[d]);
+                }
+            }
+        }
+    }
+}
+
+
+int main() {
+    test_voxels();
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "RandomVectorField.h"
+#include "GridMemory.h"
+
+// A vector field with a constant or a varying spatial profile and anisotropy direction
+class ProfiledVectorField : public RandomVectorField {
+public:
+    using RandomVectorField::RandomVectorField;
+
+    bool varying = false;
+
+    double spatial_profile(const double &x, const double &y, const double &z) const override {
+        return varying ? 1. + 0.5*x*x + 0.3*y - z : 1.;
+    }
+
+    vector_t<double> anisotropy_direction(const double &x, const double &y, const double &z) const override {
+        return varying ? vector_t<double>{{1., x - 0.2*y, 0.5*z}} : vector_t<double>{{1., 0.5, 0.}};
+    }
+
+    double calculate_fourier_sigma(const double &abs_k, const double &dk) const override {
+        return simple_spectrum(abs_k, dk, 1., 2.);
+    }
+};
+
+// The modes of a component, in the layout of the in-place r2c transform
+double* modes_of(const double *grid, const std::array<int, 3> &shp) {
+    const int padded_z = 2*(shp[2]/2 + 1);
+    double* modes = allocate_grid_memory(static_cast<size_t>(shp[0])*shp[1]*padded_z);
+    fftw_plan r2c = fftw_plan_dft_r2c_3d(shp[0], shp[1], shp[2], modes, reinterpret_cast<fftw_complex*>(modes), FFTW_ESTIMATE);
+    for (int i = 0; i < shp[0]; ++i) {
+        for (int j = 0; j < shp[1]; ++j) {
+            const size_t line = static_cast<size_t>(i)*shp[1] + j;
+            std::copy(grid + line*shp[2], grid + (line + 1)*shp[2], modes + line*padded_z);
+        }
+    }
+    fftw_execute_dft_r2c(r2c, modes, reinterpret_cast<fftw_complex*>(modes));
+    fftw_destroy_plan(r2c);
+    return modes;
+}
+
+const std::array<double, 3> rpt {{-1., -2., -0.5}};
+const std::array<double, 3> inc {{0.5, 0.7, 0.3}};
+
+// After the cleaning, k.b = 0 for every mode, on odd and even axes. The spectral engine applies the profile and the anisotropy after the projection,
+// hence is checked with a constant profile and without anisotropy
+void test_projection() {
+    const std::vector<std::array<int, 3>> shapes {{{7, 5, 9}}, {{5, 7, 3}}, {{6, 5, 4}}, {{8, 6, 10}}};
+    for (const std::array<int, 3> &shp : shapes) {
+        const int size_z = shp[2]/2 + 1;
+        const FourierWaveNumbers wave_numbers(shp, inc);
+        for (VectorFieldEngine engine : {VectorFieldEngine::standard, VectorFieldEngine::spectral, VectorFieldEngine::modulated_noise}) {
+            for (bool varying : {false, true}) {
+                if (varying and engine == VectorFieldEngine::spectral) {
+                    continue;
+                }
+                ProfiledVectorField field(shp, rpt, inc);
+                field.engine = engine;
+                field.clean_divergence = true;
+                field.apply_anisotropy = (engine != VectorFieldEngine::spectral);
+                field.anisotropy_rho = 2.;
+                field.varying = varying;
+                std::array<double*, 3> grid = field.on_grid(3);
+                std::array<fftw_complex*, 3> modes;
+                for (int d = 0; d < 3; ++d) {
+                    modes[d] = reinterpret_cast<fftw_complex*>(modes_of(grid[d], shp));
+                    free_grid_memory(grid[d]);
+                }
+
+                double scale = 0.;
+                for (int d = 0; d < 3; ++d) {
+                    for (size_t m = 0; m < static_cast<size_t>(shp[0])*shp[1]*size_z; ++m) {
+                        scale = std::max(scale, std::hypot(modes[d][m][0], modes[d][m][1]));
+                    }
+                }
+                for (int i = 0; i < shp[0]; ++i) {
+                    for (int j = 0; j < shp[1]; ++j) {
+                        for (int l = 0; l < size_z; ++l) {
+                            const size_t m = (static_cast<size_t>(i)*shp[1] + j)*size_z + l;
+                            const std::array<double, 3> k {{wave_numbers.k[0][i], wave_numbers.k[1][j], wave_numbers.k[2][l]}};
+                            const double k_length = std::sqrt(k[0]*k[0] + k[1]*k[1] + k[2]*k[2]);
+                            for (int c = 0; c < 2; ++c) {
+                                const double kb = k[0]*modes[0][m][c] + k[1]*modes[1][m][c] + k[2]*modes[2][m][c];
+                                assert (std::abs(kb) <= 1e-10 * k_length * scale);
+                            }
+                        }
+                    }
+                }
+                for (int d = 0; d < 3; ++d) {
+                    free_grid_memory(reinterpret_cast<double*>(modes[d]));
+                }
+            }
+        }
+    }
+}
+
+// The cleaning keeps the variance of the field: the projection removes a third of the power of a mode, and the factor sqrt(3/2) restores it
+void test_variance() {
+    const std::array<int, 3> shp {{15, 13, 17}};
+    const size_t gs = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+    for (VectorFieldEngine engine : {VectorFieldEngine::standard, VectorFieldEngine::spectral}) {
+        double power = 0.;
+        double cleaned_power = 0.;
+        for (int seed = 1; seed <= 4; ++seed) {
+            for (bool clean : {false, true}) {
+                ProfiledVectorField field(shp, rpt, inc);
+                field.engine = engine;
+                field.apply_spectrum = false;
+                field.clean_divergence = clean;
+                std::array<double*, 3> grid = field.on_grid(seed);
+                for (int d = 0; d < 3; ++d) {
+                    for (size_t m = 0; m < gs; ++m) {
+                        (clean ? cleaned_power : power) += grid[d][m]*grid[d][m];
+                    }
+                    free_grid_memory(grid[d]);
+                }
+            }
+        }
+        assert (std::abs(cleaned_power / power - 1.) < 0.03);
+    }
+}
+
+
+int main() {
+    test_projection();
+    test_variance();
+}
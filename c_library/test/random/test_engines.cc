@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "RandomVectorField.h"
+#include "GridMemory.h"
+
+// A vector field with a constant spatial profile
+class ConstantVectorField : public RandomVectorField {
+public:
+    using RandomVectorField::RandomVectorField;
+
+    double spatial_profile(const double &x, const double &y, const double &z) const override {
+        return 2.;
+    }
+
+    double calculate_fourier_sigma(const double &abs_k, const double &dk) const override {
+        return simple_spectrum(abs_k, dk, 1., 2.);
+    }
+};
+
+const std::array<double, 3> rpt {{-1., -2., -0.5}};
+const std::array<double, 3> inc {{0.5, 0.7, 0.3}};
+
+// With a constant profile and without anisotropy, the standard and the spectral engine draw the same field up to rounding,
+// also on even axes (whose Nyquist modes the projection keeps Hermitian)
+void test_standard_spectral() {
+    const std::vector<std::array<int, 3>> shapes {{{7, 5, 9}}, {{6, 5, 4}}, {{7, 5, 8}}, {{6, 5, 9}}, {{8, 6, 10}}, {{4, 1, 6}}};
+    for (const std::array<int, 3> &shp : shapes) {
+        const size_t gs = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+        for (bool clean : {false, true}) {
+            std::array<std::array<double*, 3>, 2> grids;
+            for (int e = 0; e < 2; ++e) {
+                ConstantVectorField field(shp, rpt, inc);
+                field.engine = (e == 0) ? VectorFieldEngine::standard : VectorFieldEngine::spectral;
+                field.clean_divergence = clean;
+                grids[e] = field.on_grid(7);
+            }
+            double scale = 0.;
+            for (int d = 0; d < 3; ++d) {
+                for (size_t m = 0; m < gs; ++m) {
+                    scale = std::max(scale, std::abs(grids[0][d][m]));
+                }
+            }
+            for (int d = 0; d < 3; ++d) {
+                for (size_t m = 0; m < gs; ++m) {
+                    assert (std::abs(grids[0][d][m] - grids[1][d][m]) <= 1e-10 * scale);
+                }
+                free_grid_memory(grids[0][d]);
+                free_grid_memory(grids[1][d]);
+            }
+        }
+    }
+}
+
+// The modulated noise engine draws another realization, with the variance of the standard engine.
+// Without the spectrum all modes contribute alike, so that a few realizations pin the variance down to a percent
+void test_modulated_variance() {
+    const std::array<int, 3> shp {{15, 13, 17}};
+    const size_t gs = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+    for (bool clean : {false, true}) {
+        std::array<double, 2> power {{0., 0.}};
+        for (int seed = 1; seed <= 4; ++seed) {
+            for (int e = 0; e < 2; ++e) {
+                ConstantVectorField field(shp, rpt, inc);
+                field.engine = (e == 0) ? VectorFieldEngine::standard : VectorFieldEngine::modulated_noise;
+                field.apply_spectrum = false;
+                field.clean_divergence = clean;
+                std::array<double*, 3> grid = field.on_grid(seed);
+                for (int d = 0; d < 3; ++d) {
+                    for (size_t m = 0; m < gs; ++m) {
+                        power[e] += grid[d][m]*grid[d][m];
+                    }
+                    free_grid_memory(grid[d]);
+                }
+            }
+        }
+        assert (std::abs(power[1] / power[0] - 1.) < 0.03);
+    }
+}
+
+
+int main() {
+    test_standard_spectral();
+    test_modulated_variance();
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "GaussianScalar.h"
+#include "GridMemory.h"
+#include "NUFFT.h"
+
+// The Fourier series of the modes (layout of the in-place r2c transform of shp) at the position u (in voxels), summed directly.
+// Modes at the Nyquist frequency of an even x or y axis contribute half at +N/2 and half at -N/2, the conjugate half of the z axis
+// is accounted for by doubling the modes 0 < l < N/2. Also returns the sum of the absolute values of the terms in scale.
+double direct_sum(const fftw_complex *modes, const std::array<int, 3> &shp, const std::array<double, 3> &u, double &scale) {
+    const int size_z = shp[2]/2 + 1;
+    auto frequencies = [&](const int d, const int i) {
+        std::vector<std::pair<int, double>> f;
+        if (d < 2 && shp[d] % 2 == 0 && 2*i == shp[d]) {
+            f.push_back({i, 0.5});
+            f.push_back({-i, 0.5});
+        }
+        else {
+            f.push_back({(d < 2 && 2*i > shp[d]) ? i - shp[d] : i, 1.});
+        }
+        return f;
+    };
+    double sum = 0.;
+    scale = 0.;
+    for (int i = 0; i < shp[0]; ++i) {
+        for (int j = 0; j < shp[1]; ++j) {
+            for (int l = 0; l < size_z; ++l) {
+                const fftw_complex &m = modes[(static_cast<size_t>(i)*shp[1] + j)*size_z + l];
+                const std::complex<double> c(m[0], m[1]);
+                const double w = (l == 0 || 2*l == shp[2]) ? 1. : 2.;
+                for (const std::pair<int, double> &a : frequencies(0, i)) {
+                    for (const std::pair<int, double> &b : frequencies(1, j)) {
+                        const double phase = 2*M_PI*(a.first*u[0]/shp[0] + b.first*u[1]/shp[1] + l*u[2]/shp[2]);
+                        sum += w*a.second*b.second*std::real(c*std::polar(1., phase));
+                        scale += w*a.second*b.second*std::abs(c);
+                    }
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+// The non-uniform FFT equals the direct sum to the tolerance, on odd, even and size-1 axes (with the split Nyquist modes),
+// and equals the c2r transform of the modes at the voxels
+void test_direct_sum() {
+    const std::array<double, 3> inc {{0.5, 0.7, 0.3}};
+    const std::vector<std::array<int, 3>> shapes {{{6, 5, 4}}, {{7, 8, 9}}, {{4, 1, 6}}, {{1, 6, 1}}, {{5, 1, 2}}};
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(-7., 7.);
+    for (const std::array<int, 3> &shp : shapes) {
+        const size_t n_modes = static_cast<size_t>(shp[0])*shp[1]*(shp[2]/2 + 1);
+        GaussianScalarField field;
+        field.apply_spectrum = false;
+        double* modes_memory = allocate_grid_memory(2*n_modes);
+        fftw_complex* modes = reinterpret_cast<fftw_complex*>(modes_memory);
+        field.seed_complex_random_numbers(modes, shp, inc, 5);
+
+        for (double tolerance : {1e-4, 1e-8, 1e-12}) {
+            GaussianNUFFT nufft(shp, tolerance);
+            nufft.load_modes(0, modes, 2);
+            const std::array<int, 3> &fine = nufft.fine_shape();
+            fftw_plan c2r = fftw_plan_dft_c2r_3d(fine[0], fine[1], fine[2], reinterpret_cast<fftw_complex*>(nufft.fine_grid()), nufft.fine_grid(), FFTW_ESTIMATE);
+            fftw_execute_dft_c2r(c2r, reinterpret_cast<fftw_complex*>(nufft.fine_grid()), nufft.fine_grid());
+            fftw_destroy_plan(c2r);
+
+            std::vector<std::array<double, 3>> positions;
+            for (int s = 0; s < 40; ++s) {
+                positions.push_back({{uniform(rng), uniform(rng), uniform(rng)}});
+            }
+            // voxels, and halfway between them (where the Nyquist modes contribute most)
+            positions.push_back({{0., 0., 0.}});
+            positions.push_back({{shp[0] - 1., shp[1] - 1., shp[2] - 1.}});
+            positions.push_back({{0.5, 0.5, 0.5}});
+            for (const std::array<double, 3> &u : positions) {
+                double scale;
+                const double reference = direct_sum(modes, shp, u, scale);
+                double value;
+                nufft.interpolate(u, &value);
+                assert (std::abs(value - reference) <= 10. * tolerance * scale);
+            }
+        }
+
+        // at the voxels, the series is the (unnormalized) c2r transform of the modes
+        GaussianNUFFT nufft(shp, 1e-12);
+        nufft.load_modes(0, modes, 1);
+        const std::array<int, 3> &fine = nufft.fine_shape();
+        fftw_plan fine_c2r = fftw_plan_dft_c2r_3d(fine[0], fine[1], fine[2], reinterpret_cast<fftw_complex*>(nufft.fine_grid()), nufft.fine_grid(), FFTW_ESTIMATE);
+        fftw_execute_dft_c2r(fine_c2r, reinterpret_cast<fftw_complex*>(nufft.fine_grid()), nufft.fine_grid());
+        fftw_destroy_plan(fine_c2r);
+        double* grid = allocate_grid_memory(2*n_modes);
+        fftw_plan c2r = fftw_plan_dft_c2r_3d(shp[0], shp[1], shp[2], reinterpret_cast<fftw_complex*>(grid), grid, FFTW_ESTIMATE);
+        std::copy(modes_memory, modes_memory + 2*n_modes, grid);
+        fftw_execute_dft_c2r(c2r, reinterpret_cast<fftw_complex*>(grid), grid);
+        fftw_destroy_plan(c2r);
+        const int padded_z = 2*(shp[2]/2 + 1);
+        double scale;
+        direct_sum(modes, shp, {{0., 0., 0.}}, scale);
+        for (int i = 0; i < shp[0]; ++i) {
+            for (int j = 0; j < shp[1]; ++j) {
+                for (int k = 0; k < shp[2]; ++k) {
+                    double value;
+                    nufft.interpolate({{static_cast<double>(i), static_cast<double>(j), static_cast<double>(k)}}, &value);
+                    assert (std::abs(value - grid[(static_cast<size_t>(i)*shp[1] + j)*padded_z + k]) <= 1e-10 * scale);
+                }
+            }
+        }
+        free_grid_memory(grid);
+        free_grid_memory(modes_memory);
+    }
+}
+
+
+int main() {
+    test_direct_sum();
+}
@@ -0,0 +1,90 @@
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "GaussianScalar.h"
+#include "EnsslinSteininger.h"
+#include "GridMemory.h"
+
+const std::string path = "test_out_of_core.bin";
+
+std::vector<double> read_grid(const size_t n) {
+    std::vector<double> values(n);
+    std::ifstream file(path, std::ios::binary);
+    file.read(reinterpret_cast<char*>(values.data()), n*sizeof(double));
+    assert (file.good());
+    return values;
+}
+
+bool is_close(double a, double b, double scale) {
+    return std::abs(a - b) <= 1e-10 * scale;
+}
+
+// Buffers of a single y line / x plane, of a few lines / planes, and of the whole grid
+const std::vector<size_t> memory_sizes {1, 2000, size_t(1) << 30};
+
+const std::vector<std::array<int, 3>> shapes {{{6, 5, 4}}, {{7, 6, 5}}, {{4, 8, 3}}};
+
+// The out-of-core realization equals the one of on_grid, whatever the size of its buffers
+void test_scalar() {
+    const std::array<double, 3> rpt {{-1., -2., -0.5}};
+    const std::array<double, 3> inc {{0.5, 0.7, 0.3}};
+    for (const std::array<int, 3> &shp : shapes) {
+        const size_t gs = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+        for (size_t memory : memory_sizes) {
+            GaussianScalarField field(shp, rpt, inc);
+            field.out_of_core_memory = memory;
+            double* grid = field.on_grid(5);
+            field.on_grid_to_file(path, 5);
+            const std::vector<double> file = read_grid(gs);
+            double scale = 0.;
+            for (size_t m = 0; m < gs; ++m) {
+                scale = std::max(scale, std::abs(grid[m]));
+            }
+            for (size_t m = 0; m < gs; ++m) {
+                assert (is_close(file[m], grid[m], scale));
+            }
+            free_grid_memory(grid);
+        }
+    }
+}
+
+void test_vector() {
+    const std::array<double, 3> rpt {{-4., -3., -0.5}};
+    const std::array<double, 3> inc {{1.1, 0.9, 0.3}};
+    for (const std::array<int, 3> &shp : shapes) {
+        const size_t gs = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+        for (size_t memory : memory_sizes) {
+            for (bool clean : {false, true}) {
+                ESRandomField field(shp, rpt, inc);
+                field.out_of_core_memory = memory;
+                field.clean_divergence = clean;
+                std::array<double*, 3> grid = field.on_grid(11);
+                field.on_grid_to_file(path, 11);
+                // the components one after the other
+                const std::vector<double> file = read_grid(3*gs);
+                double scale = 0.;
+                for (int c = 0; c < 3; ++c) {
+                    for (size_t m = 0; m < gs; ++m) {
+                        scale = std::max(scale, std::abs(grid[c][m]));
+                    }
+                }
+                for (int c = 0; c < 3; ++c) {
+                    for (size_t m = 0; m < gs; ++m) {
+                        assert (is_close(file[c*gs + m], grid[c][m], scale));
+                    }
+                    free_grid_memory(grid[c]);
+                }
+            }
+        }
+    }
+}
+
+
+int main() {
+    test_scalar();
+    test_vector();
+    std::remove(path.c_str());
+}
@@ -0,0 +1,41 @@
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+#include "Philox.h"
+
+
+// Known answers of Philox4x32-10 (kat_vectors of the Random123 library)
+void test_known_answers() {
+    assert ((Philox4x32::generate({0, 0, 0, 0}, {0, 0}) == Philox4x32::counter_type{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    assert ((Philox4x32::generate({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}) == Philox4x32::counter_type{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    assert ((Philox4x32::generate({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}) == Philox4x32::counter_type{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+// The normal numbers are a pure function of key and counter, and are standard normal
+void test_normal_pairs() {
+    const uint64_t key = 1234;
+    assert (Philox4x32::normal_pair(key, 77) == Philox4x32::normal_pair(key, 77));
+    assert (Philox4x32::normal_pair(key, 77) != Philox4x32::normal_pair(key, 78));
+    assert (Philox4x32::normal_pair(key, 77) != Philox4x32::normal_pair(key + 1, 77));
+
+    const int n = 200000;
+    double sum = 0.;
+    double sum2 = 0.;
+    for (uint64_t c = 0; c < n; ++c) {
+        const std::array<double, 2> g = Philox4x32::normal_pair(key, c);
+        assert (std::isfinite(g[0]) && std::isfinite(g[1]));
+        sum += g[0] + g[1];
+        sum2 += g[0]*g[0] + g[1]*g[1];
+    }
+    const double mean = sum / (2*n);
+    const double var = sum2 / (2*n) - mean*mean;
+    assert (std::abs(mean) < 0.01);
+    assert (std::abs(var - 1.) < 0.01);
+}
+
+
+int main() {
+    test_known_answers();
+    test_normal_pairs();
+}
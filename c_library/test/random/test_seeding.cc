@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "GaussianScalar.h"
+#include "GridMemory.h"
+
+
+// Fourier modes of a seed, drawn on the given number of threads
+fftw_complex* seeded_modes(GaussianScalarField &field, const std::array<int, 3> &shp, const std::array<double, 3> &inc, const int seed, const int threads) {
+    field.grid_threads = threads;
+    field.grid_tile = {{1, 1}};
+    const size_t n_modes = static_cast<size_t>(shp[0])*shp[1]*(shp[2]/2 + 1);
+    fftw_complex* modes = reinterpret_cast<fftw_complex*>(allocate_grid_memory(2*n_modes));
+    field.seed_complex_random_numbers(modes, shp, inc, seed);
+    return modes;
+}
+
+// The modes depend only on the seed and the grid, not on the number of threads (bit-identical)
+void test_thread_independence() {
+    const std::array<double, 3> inc {{0.3, 0.5, 0.2}};
+    for (const std::array<int, 3> &shp : {std::array<int, 3>{{16, 12, 10}}, std::array<int, 3>{{9, 7, 5}}, std::array<int, 3>{{1, 6, 1}}}) {
+        const size_t bytes = sizeof(fftw_complex)*shp[0]*shp[1]*(shp[2]/2 + 1);
+        GaussianScalarField field;
+        fftw_complex* serial = seeded_modes(field, shp, inc, 42, 1);
+        for (int threads : {2, 3, 8}) {
+            fftw_complex* parallel = seeded_modes(field, shp, inc, 42, threads);
+            assert (std::memcmp(serial, parallel, bytes) == 0);
+            free_grid_memory(reinterpret_cast<double*>(parallel));
+        }
+        fftw_complex* other = seeded_modes(field, shp, inc, 43, 1);
+        assert (shp[0]*shp[1]*shp[2] == 1 || std::memcmp(serial, other, bytes) != 0);
+        free_grid_memory(reinterpret_cast<double*>(other));
+        free_grid_memory(reinterpret_cast<double*>(serial));
+    }
+}
+
+// The real z planes (z = 0 and the Nyquist plane) are exactly Hermitian symmetric, every line equals the line drawn on its own
+// (as by the out-of-core generation), and the modes survive the round trip through the real transform unchanged
+void test_hermitian_symmetry() {
+    const std::array<double, 3> inc {{0.3, 0.5, 0.2}};
+    const std::vector<std::array<int, 3>> shapes {{{9, 7, 5}}, {{8, 6, 4}}, {{1, 6, 1}}, {{5, 1, 4}}, {{1, 1, 2}}, {{4, 3, 1}}};
+    for (const std::array<int, 3> &shp : shapes) {
+        const int size_z = shp[2]/2 + 1;
+        const size_t n_modes = static_cast<size_t>(shp[0])*shp[1]*size_z;
+        const size_t gs = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+        for (bool spectrum : {true, false}) {
+            GaussianScalarField field;
+            field.apply_spectrum = spectrum;
+            fftw_complex* modes = seeded_modes(field, shp, inc, 42, 3);
+
+            const std::array<int, 2> planes{0, shp[2]/2};
+            const int n_planes = (shp[2] % 2 == 0) ? 2 : 1;
+            for (int i = 0; i < shp[0]; ++i) {
+                for (int j = 0; j < shp[1]; ++j) {
+                    const int mi = (shp[0] - i) % shp[0];
+                    const int mj = (shp[1] - j) % shp[1];
+                    for (int p = 0; p < n_planes; ++p) {
+                        const fftw_complex &v = modes[(static_cast<size_t>(i)*shp[1] + j)*size_z + planes[p]];
+                        const fftw_complex &m = modes[(static_cast<size_t>(mi)*shp[1] + mj)*size_z + planes[p]];
+                        assert (v[0] == m[0] && v[1] == -m[1]);
+                    }
+                }
+            }
+            assert (modes[0][0] == 0. && modes[0][1] == 0.);
+
+            std::vector<fftw_complex> line(size_z);
+            auto sigma_of = [&](const int si, const int sj, const int l) {
+                return spectrum ? field.mode_sigma(std::min(si, shp[0] - si), std::min(sj, shp[1] - sj), l, shp, inc) : 1.;
+            };
+            for (int i = 0; i < shp[0]; ++i) {
+                for (int j = 0; j < shp[1]; ++j) {
+                    field.seed_mode_line(line.data(), i, j, shp, 42, sigma_of);
+                    assert (std::memcmp(line.data(), modes + (static_cast<size_t>(i)*shp[1] + j)*size_z, size_z*sizeof(fftw_complex)) == 0);
+                }
+            }
+
+            // c2r keeps only the Hermitian part of the real planes, hence r2c(c2r(modes)) / gs reproduces Hermitian modes
+            double* grid = allocate_grid_memory(2*n_modes);
+            fftw_complex* grid_comp = reinterpret_cast<fftw_complex*>(grid);
+            std::copy(modes[0], modes[0] + 2*n_modes, grid);
+            fftw_plan c2r = fftw_plan_dft_c2r_3d(shp[0], shp[1], shp[2], grid_comp, grid, FFTW_ESTIMATE);
+            fftw_plan r2c = fftw_plan_dft_r2c_3d(shp[0], shp[1], shp[2], grid, grid_comp, FFTW_ESTIMATE);
+            fftw_execute_dft_c2r(c2r, grid_comp, grid);
+            fftw_execute_dft_r2c(r2c, grid, grid_comp);
+            double scale = 0.;
+            for (size_t m = 0; m < n_modes; ++m) {
+                scale = std::max(scale, std::abs(modes[m][0]) + std::abs(modes[m][1]));
+            }
+            for (size_t m = 0; m < n_modes; ++m) {
+                assert (std::abs(grid_comp[m][0]/gs - modes[m][0]) <= 1e-12*scale);
+                assert (std::abs(grid_comp[m][1]/gs - modes[m][1]) <= 1e-12*scale);
+            }
+            fftw_destroy_plan(c2r);
+            fftw_destroy_plan(r2c);
+            free_grid_memory(grid);
+            free_grid_memory(reinterpret_cast<double*>(modes));
+        }
+    }
+}
+
+
+int main() {
+    test_thread_independence();
+    test_hermitian_symmetry();
+}
@@ -3,14 +3,17 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <cmath>
+#include <stdexcept>
 
 #include "RegularModels.h"
+#include "UngerFarrar.h"
 
 #define assertm(exp, msg) assert(((void)msg, exp))
 
 
 void _check_array_equality_from_pointer(std::array<double*, 3> a, std::array<double*, 3> b , size_t &n) {
-    for (int d = 0; d==3; ++d) {
+    for (int d = 0; d < 3; ++d) {
         std::vector<double>  arr_a(a[d], a[d] + n);
         std::vector<double>  arr_b(b[d], b[d] + n);
         assert (arr_a == arr_b); 
@@ -48,9 +51,247 @@ void test_grid(std::map <std::string, std::shared_ptr<RegularVectorField>> model
 
 }
 
-     
 
 
+void test_threads(std::map <std::string, std::shared_ptr<RegularVectorField>> models, 
+                  std::array<int, 3> shape, std::array<double, 3> refpoint, std::array<double, 3> increment) {
+    size_t n = shape[0]*shape[1]*shape[2];
+    for (auto const& [name, model] : models) {
+        model->grid_threads = 1;
+        std::array<double*, 3> eval_serial = model->on_grid(shape, refpoint, increment); 
+        model->grid_threads = 4;
+        model->grid_tile = {2, 3};
+        std::array<double*, 3> eval_parallel = model->on_grid(shape, refpoint, increment); 
+        _check_array_equality_from_pointer(eval_serial, eval_parallel, n);
+    }
+}
+
+void test_grid_vs_position(std::map <std::string, std::shared_ptr<RegularVectorField>> models, 
+                           std::array<int, 3> shape, std::array<double, 3> refpoint, std::array<double, 3> increment) {
+    // on_grid runs the model specific (devirtualized) loop, at_position the virtual interface
+    for (auto const& [name, model] : models) {
+        std::array<double*, 3> eval_grid = model->on_grid(shape, refpoint, increment); 
+        for (int i = 0; i < shape[0]; ++i) {
+            for (int j = 0; j < shape[1]; ++j) {
+                for (int k = 0; k < shape[2]; ++k) {
+                    vector_t<double> v = model->at_position(refpoint[0] + i*increment[0], refpoint[1] + j*increment[1], refpoint[2] + k*increment[2]);
+                    size_t idx = (i*shape[1] + j)*shape[2] + k;
+                    for (int d = 0; d < 3; ++d) {
+                        assert (eval_grid[d][idx] == static_cast<double>(v[d]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void test_grid_into(std::map <std::string, std::shared_ptr<RegularVectorField>> models, 
+                    std::array<int, 3> shape, std::array<double, 3> refpoint, std::array<double, 3> increment) {
+    size_t n = shape[0]*shape[1]*shape[2];
+    std::vector<double> out_x(n), out_y(n), out_z(n);
+    std::array<double*, 3> out{{out_x.data(), out_y.data(), out_z.data()}};
+    // Fortran ordered output
+    std::array<std::ptrdiff_t, 3> strides{{1, shape[0], shape[0]*shape[1]}};
+    for (auto const& [name, model] : models) {
+        std::array<double*, 3> eval_grid = model->on_grid(shape, refpoint, increment); 
+        model->on_grid_into(out, shape, refpoint, increment);
+        _check_array_equality_from_pointer(eval_grid, out, n);
+        model->on_grid_into(out, shape, refpoint, increment, strides);
+        for (int i = 0; i < shape[0]; ++i) {
+            for (int j = 0; j < shape[1]; ++j) {
+                for (int k = 0; k < shape[2]; ++k) {
+                    size_t idx = (i*shape[1] + j)*shape[2] + k;
+                    size_t idx_f = (k*shape[1] + j)*shape[0] + i;
+                    for (int d = 0; d < 3; ++d) {
+                        assert (eval_grid[d][idx] == out[d][idx_f]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+// Single precision grids are the rounded double precision grids, also when evaluated in several slabs
+void _check_float_grid(std::array<double*, 3> eval_grid, std::array<float*, 3> eval_float, size_t n) {
+    for (int d = 0; d < 3; ++d) {
+        for (size_t m = 0; m < n; ++m) {
+            assert (std::abs(eval_float[d][m] - eval_grid[d][m]) <= 1e-6*std::max(1., std::abs(eval_grid[d][m])));
+        }
+    }
+}
+
+void test_grid_float(std::map <std::string, std::shared_ptr<RegularVectorField>> models, 
+                     std::array<int, 3> shape, std::array<double, 3> refpoint, std::array<double, 3> increment,
+                     std::vector<double> grid_x, std::vector<double> grid_y, std::vector<double> grid_z) {
+    size_t n = shape[0]*shape[1]*shape[2];
+    size_t irreg_n = grid_x.size()*grid_y.size()*grid_z.size();
+    std::vector<float> out_x(n), out_y(n), out_z(n);
+    std::array<float*, 3> out{{out_x.data(), out_y.data(), out_z.data()}};
+    std::array<std::ptrdiff_t, 3> strides{{1, shape[0], shape[0]*shape[1]}};
+    for (auto const& [name, model] : models) {
+        std::array<double*, 3> eval_grid = model->on_grid(shape, refpoint, increment); 
+        std::array<float*, 3> eval_float = model->on_grid_float(shape, refpoint, increment); 
+        _check_float_grid(eval_grid, eval_float, n);
+        model->on_grid_into(out, shape, refpoint, increment, strides);
+        for (int i = 0; i < shape[0]; ++i) {
+            for (int j = 0; j < shape[1]; ++j) {
+                for (int k = 0; k < shape[2]; ++k) {
+                    size_t idx = (i*shape[1] + j)*shape[2] + k;
+                    size_t idx_f = (k*shape[1] + j)*shape[0] + i;
+                    for (int d = 0; d < 3; ++d) {
+                        assert (eval_float[d][idx] == out[d][idx_f]);
+                    }
+                }
+            }
+        }
+        std::array<double*, 3> eval_irregular = model->on_grid(grid_x, grid_y, grid_z); 
+        std::array<float*, 3> eval_irregular_float = model->on_grid_float(grid_x, grid_y, grid_z); 
+        _check_float_grid(eval_irregular, eval_irregular_float, irreg_n);
+        for (int d = 0; d < 3; ++d) {
+            free_grid_memory(eval_grid[d]);
+            free_grid_memory(eval_float[d]);
+            free_grid_memory(eval_irregular[d]);
+            free_grid_memory(eval_irregular_float[d]);
+        }
+    }
+}
+
+
+// Re-evaluation from the linear parameter basis agrees with a full evaluation after the linear parameters have been changed
+void test_linear_basis(std::map <std::string, std::shared_ptr<RegularVectorField>> models, 
+                       std::array<int, 3> shape, std::array<double, 3> refpoint, std::array<double, 3> increment) {
+    size_t n = shape[0]*shape[1]*shape[2];
+    for (auto const& [name, model] : models) {
+        assert (!model->has_linear_basis());
+        model->build_linear_basis(shape, refpoint, increment);
+        assert (model->has_linear_basis());
+        std::vector<std::pair<std::string, number*>> parameters = model->linear_parameters();
+        for (size_t a = 0; a < parameters.size(); ++a) {
+            *parameters[a].second = 1.5 - 0.7*a;
+        }
+        std::array<double*, 3> eval_grid = model->on_grid(shape, refpoint, increment); 
+        std::array<double*, 3> basis_grid = model->on_linear_basis(); 
+        for (int d = 0; d < 3; ++d) {
+            for (size_t m = 0; m < n; ++m) {
+                assert (std::abs(eval_grid[d][m] - basis_grid[d][m]) <= 1e-12*std::max(1., std::abs(eval_grid[d][m])));
+            }
+        }
+        model->clear_linear_basis();
+        assert (!model->has_linear_basis());
+        for (int d = 0; d < 3; ++d) {
+            free_grid_memory(eval_grid[d]);
+            free_grid_memory(basis_grid[d]);
+        }
+    }
+}
+
+// The basis is rejected once a nonlinear parameter differs from its value at build_linear_basis, also in copies sharing the basis
+void test_stale_linear_basis(std::array<int, 3> shape, std::array<double, 3> refpoint, std::array<double, 3> increment) {
+    JF12MagneticField model;
+    model.build_linear_basis(shape, refpoint, increment);
+    JF12MagneticField copy = model;
+    copy.h_disk = 0.5;
+    bool thrown = false;
+    try {
+        copy.on_linear_basis();
+    } catch (LinearBasisException &) {
+        thrown = true;
+    }
+    assert (thrown);
+
+    model.b_arm_2 = 1.;
+    std::array<double*, 3> basis_grid = model.on_linear_basis();
+    for (int d = 0; d < 3; ++d) {
+        free_grid_memory(basis_grid[d]);
+    }
+    model.do_X = false;
+    thrown = false;
+    try {
+        model.on_linear_basis();
+    } catch (LinearBasisException &) {
+        thrown = true;
+    }
+    assert (thrown);
+}
+
+#if autodiff_FOUND
+void test_derivative_on_grid(std::array<int, 3> shape, std::array<double, 3> refpoint, std::array<double, 3> increment) {
+    JF12MagneticField model;
+    model.active_diff = {"b_arm_1", "Bn", "h_disk"};
+    model.grid_threads = 4;
+    double* jac_grid = model.derivative_on_grid(shape, refpoint, increment);
+    assert (model.n_active_diff() == 3);
+    const size_t gsz = model.grid_size(shape);
+    for (int i = 0; i < shape[0]; ++i) {
+        for (int j = 0; j < shape[1]; ++j) {
+            for (int k = 0; k < shape[2]; ++k) {
+                Eigen::MatrixXd jac = model.derivative(refpoint[0] + i*increment[0], refpoint[1] + j*increment[1], refpoint[2] + k*increment[2]);
+                const size_t n = (static_cast<size_t>(i)*shape[1] + j)*shape[2] + k;
+                for (int a = 0; a < 3; ++a) {
+                    for (int c = 0; c < 3; ++c) {
+                        const double v = jac_grid[(a*3 + c)*gsz + n];
+                        assert (v == jac(c, a));
+                    }
+                }
+            }
+        }
+    }
+
+    // the adjoint gradient is the contraction of the Jacobian grid with the adjoint, independent of the number of threads
+    std::vector<double> adjoint(3*gsz);
+    for (size_t n = 0; n < adjoint.size(); ++n) {
+        adjoint[n] = (n % 7 == 0) ? 0. : std::sin(0.1*n);
+    }
+    std::array<const double*, 3> adj{adjoint.data(), adjoint.data() + gsz, adjoint.data() + 2*gsz};
+    Eigen::VectorXd grad = model.gradient_on_grid(adj, shape, refpoint, increment);
+    model.grid_threads = 1;
+    Eigen::VectorXd grad_serial = model.gradient_on_grid(adj, shape, refpoint, increment);
+    assert (grad.size() == 3);
+    for (int a = 0; a < 3; ++a) {
+        double expected = 0.;
+        for (int c = 0; c < 3; ++c) {
+            for (size_t n = 0; n < gsz; ++n) {
+                if (adj[c][n] != 0.) {
+                    expected += jac_grid[(a*3 + c)*gsz + n]*adj[c][n];
+                }
+            }
+        }
+        assert (grad(a) == grad_serial(a));
+        assert (std::abs(grad(a) - expected) <= 1e-10*std::max(1., std::abs(expected)));
+    }
+    free_grid_memory(jac_grid);
+}
+#endif
+
+
+// a model whose evaluation fails for some positions (as a python subclass raising an exception)
+class FailingScalarField : public RegularScalarField {
+public:
+    using RegularScalarField::RegularScalarField;
+    double at_position(const double &x, const double &y, const double &z) const override {
+        if (x > 3.) {
+            throw std::runtime_error("evaluation failed");
+        }
+        return x + y + z;
+    }
+};
+
+void test_exceptions_from_threads() {
+    // exceptions thrown on any thread reach the caller
+    FailingScalarField model;
+    model.grid_threads = 4;
+    model.grid_tile = {{1, 1}};
+    bool thrown = false;
+    try {
+        double *grid = model.on_grid(std::array<int, 3>{{10, 10, 10}}, std::array<double, 3>{{0., 0., 0.}}, std::array<double, 3>{{1., 1., 1.}});
+        free_grid_memory(grid);
+    } catch (std::runtime_error &) {
+        thrown = true;
+    }
+    assert (thrown);
+}
+
 int main() {
 
 
@@ -87,6 +328,25 @@ int main() {
 
 
     test_grid(models_w_empty_constructor, models_w_regular_constructor, models_w_irregular_constructor, shape, refpoint, increment, grid_x, grid_y, grid_z);
+
+    // A larger grid, spanning several tiles of the parallel evaluation
+    const std::array<int, 3> shape_threads {{17, 13, 11}};
+    const std::array<double, 3> refpoint_threads {{-20., -15., -3.}};
+    const std::array<double, 3> increment_threads {{2.5, 2.5, 0.6}};
+    test_threads(models_w_empty_constructor, shape_threads, refpoint_threads, increment_threads);
+    test_grid_vs_position(models_w_empty_constructor, shape_threads, refpoint_threads, increment_threads);
+    test_grid_into(models_w_empty_constructor, shape_threads, refpoint_threads, increment_threads);
+    test_grid_float(models_w_empty_constructor, shape_threads, refpoint_threads, increment_threads, grid_x, grid_y, grid_z);
+    // planes larger than one slab
+    test_grid_float(models_w_empty_constructor, {{3, 520, 510}}, refpoint_threads, {{2.5, 0.06, 0.02}}, grid_x, grid_y, grid_z);
+    models_w_empty_constructor["UF"] = std::shared_ptr<UFMagneticField> (new UFMagneticField());
+    test_linear_basis(models_w_empty_constructor, shape_threads, refpoint_threads, increment_threads);
+    test_stale_linear_basis(shape_threads, refpoint_threads, increment_threads);
+    test_exceptions_from_threads();
+#if autodiff_FOUND
+    // shifted, so that the grid does not contain the galactic axis (where the JF12 derivatives are not defined)
+    test_derivative_on_grid(shape_threads, {{-19.7, -14.6, -3.}}, increment_threads);
+#endif
 }
 
 
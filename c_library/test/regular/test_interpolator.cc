@@ -0,0 +1,170 @@
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "RegularModels.h"
+#include "GridMemory.h"
+#include "GridInterpolator.h"
+
+const std::array<int, 3> shape {{11, 7, 9}};
+const std::array<double, 3> refpoint {{-4., 0.1, -0.3}};
+const std::array<double, 3> increment {{0.5, 0.3, 1.}};
+
+bool is_close(double a, double b, double tol = 1e-10) {
+    return std::abs(a - b) <= tol * (1. + std::abs(b));
+}
+
+template <typename FUNC>
+std::vector<double> tabulated(FUNC &&f) {
+    std::vector<double> grid(shape[0]*shape[1]*shape[2]);
+    for (int i = 0; i < shape[0]; ++i) {
+        for (int j = 0; j < shape[1]; ++j) {
+            for (int k = 0; k < shape[2]; ++k) {
+                grid[(i*shape[1] + j)*shape[2] + k] = f(refpoint[0] + i*increment[0], refpoint[1] + j*increment[1], refpoint[2] + k*increment[2]);
+            }
+        }
+    }
+    return grid;
+}
+
+// positions inside the grid, at least margin voxels away from its faces
+std::array<std::vector<double>, 3> positions(const int n, const double margin) {
+    std::array<std::vector<double>, 3> pos;
+    for (int d = 0; d < 3; ++d) {
+        const double lo = refpoint[d] + margin*increment[d];
+        const double hi = refpoint[d] + (shape[d] - 1 - margin)*increment[d];
+        for (int s = 0; s < n; ++s) {
+            pos[d].push_back(lo + (hi - lo) * std::fmod(0.618034*(s + 1)*(d + 1), 1.));
+        }
+    }
+    return pos;
+}
+
+void test_voxels() {
+    // both kernels reproduce the grid at its voxels, whatever the brick size
+    auto f = [](double x, double y, double z) { return std::sin(x) + y*z; };
+    const std::vector<double> grid = tabulated(f);
+    for (InterpolationKernel kernel : {InterpolationKernel::trilinear, InterpolationKernel::tricubic}) {
+        for (int brick : {1, 3, 8}) {
+            GridInterpolator interp(grid.data(), shape, refpoint, increment, kernel, GridBoundary::clamp, brick);
+            for (int i = 0; i < shape[0]; ++i) {
+                for (int j = 0; j < shape[1]; ++j) {
+                    for (int k = 0; k < shape[2]; ++k) {
+                        const double v = interp.at_position(refpoint[0] + i*increment[0], refpoint[1] + j*increment[1], refpoint[2] + k*increment[2]);
+                        assert (is_close(v, grid[(i*shape[1] + j)*shape[2] + k]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void test_polynomials() {
+    // trilinear is exact for (tri)linear fields, tricubic for quadratic ones (away from the faces of the grid)
+    auto linear = [](double x, double y, double z) { return 1. + 2.*x - 0.5*y + 3.*z + 0.1*x*y*z; };
+    auto quadratic = [](double x, double y, double z) { return 1. + x*x - 2.*y*z + 0.5*z*z + x; };
+    const std::vector<double> lin_grid = tabulated(linear);
+    const std::vector<double> quad_grid = tabulated(quadratic);
+    GridInterpolator trilinear(lin_grid.data(), shape, refpoint, increment, InterpolationKernel::trilinear);
+    GridInterpolator tricubic(quad_grid.data(), shape, refpoint, increment, InterpolationKernel::tricubic, GridBoundary::clamp, 4);
+
+    const auto pos = positions(200, 0.);
+    const auto inner = positions(200, 1.);
+    for (size_t s = 0; s < pos[0].size(); ++s) {
+        assert (is_close(trilinear.at_position(pos[0][s], pos[1][s], pos[2][s]), linear(pos[0][s], pos[1][s], pos[2][s])));
+        assert (is_close(tricubic.at_position(inner[0][s], inner[1][s], inner[2][s]), quadratic(inner[0][s], inner[1][s], inner[2][s])));
+    }
+
+    // outside of the grid, the values at the faces are taken
+    const double x_far = refpoint[0] + 100.;
+    const double x_face = refpoint[0] + (shape[0] - 1)*increment[0];
+    assert (is_close(trilinear.at_position(x_far, 0.5, 1.), trilinear.at_position(x_face, 0.5, 1.)));
+}
+
+void test_periodic() {
+    auto f = [](double x, double y, double z) { return std::cos(x) * (1. + y) - z; };
+    const std::vector<double> grid = tabulated(f);
+    for (InterpolationKernel kernel : {InterpolationKernel::trilinear, InterpolationKernel::tricubic}) {
+        GridInterpolator interp(grid.data(), shape, refpoint, increment, kernel, GridBoundary::periodic, 4);
+        const auto pos = positions(50, 0.);
+        for (size_t s = 0; s < pos[0].size(); ++s) {
+            const double v = interp.at_position(pos[0][s], pos[1][s], pos[2][s]);
+            assert (is_close(interp.at_position(pos[0][s] + shape[0]*increment[0], pos[1][s] - 2*shape[1]*increment[1], pos[2][s]), v));
+            assert (is_close(interp.at_position(pos[0][s], pos[1][s], pos[2][s] - 3*shape[2]*increment[2]), v));
+        }
+        // between the last and the first voxel, the grid wraps around
+        const double x_last = refpoint[0] + (shape[0] - 1)*increment[0];
+        const double v_first = interp.at_position(refpoint[0], refpoint[1], refpoint[2]);
+        const double v_last = interp.at_position(x_last, refpoint[1], refpoint[2]);
+        if (kernel == InterpolationKernel::trilinear) {
+            assert (is_close(interp.at_position(x_last + 0.5*increment[0], refpoint[1], refpoint[2]), 0.5*(v_first + v_last)));
+        }
+    }
+}
+
+void test_batched() {
+    // the batched evaluation equals the evaluation of single positions, for scalar and vector grids
+    HelixMagneticField model;
+    std::array<double*, 3> field = model.on_grid(shape, refpoint, increment);
+    const auto pos = positions(3000, -2.);
+    const size_t n = pos[0].size();
+    for (InterpolationKernel kernel : {InterpolationKernel::trilinear, InterpolationKernel::tricubic}) {
+        GridInterpolator vec(field, shape, refpoint, increment, kernel, GridBoundary::clamp, 5);
+        GridInterpolator scalar(field[1], shape, refpoint, increment, kernel, GridBoundary::periodic);
+        assert (vec.components() == 3 && scalar.components() == 1);
+
+        std::vector<double> bx(n), by(n), bz(n), s(n);
+        vec.at_positions(pos[0].data(), pos[1].data(), pos[2].data(), n, {bx.data(), by.data(), bz.data()});
+        scalar.at_positions(pos[0].data(), pos[1].data(), pos[2].data(), n, s.data(), 2);
+        for (size_t i = 0; i < n; ++i) {
+            const std::array<double, 3> b = vec.vector_at_position(pos[0][i], pos[1][i], pos[2][i]);
+            assert (b[0] == bx[i] && b[1] == by[i] && b[2] == bz[i]);
+            assert (s[i] == scalar.at_position(pos[0][i], pos[1][i], pos[2][i]));
+        }
+
+        bool thrown = false;
+        try {
+            vec.at_positions(pos[0].data(), pos[1].data(), pos[2].data(), n, s.data());
+        } catch (std::invalid_argument &) {
+            thrown = true;
+        }
+        assert (thrown);
+    }
+    for (int d = 0; d < 3; ++d) {
+        free_grid_memory(field[d]);
+    }
+}
+
+void test_tabulate() {
+    // a tabulated model equals the model at the voxels, and approximates it in between
+    JF12MagneticField model;
+    const std::array<int, 3> shp {{40, 40, 10}};
+    const std::array<double, 3> rpt {{-10., -10., -1.}};
+    const std::array<double, 3> inc {{0.5, 0.5, 0.2}};
+    std::shared_ptr<GridInterpolator> table = model.tabulate(shp, rpt, inc, InterpolationKernel::tricubic);
+    std::array<double*, 3> field = model.on_grid(shp, rpt, inc);
+    for (int i : {3, 17, 39}) {
+        for (int k : {0, 5, 9}) {
+            const std::array<double, 3> b = table->vector_at_position(rpt[0] + i*inc[0], rpt[1] + 11*inc[1], rpt[2] + k*inc[2]);
+            for (int d = 0; d < 3; ++d) {
+                assert (is_close(b[d], field[d][(i*shp[1] + 11)*shp[2] + k]));
+            }
+        }
+    }
+    for (int d = 0; d < 3; ++d) {
+        free_grid_memory(field[d]);
+    }
+    assert (table->memory_size() > 0);
+}
+
+
+int main() {
+    test_voxels();
+    test_polynomials();
+    test_periodic();
+    test_batched();
+    test_tabulate();
+}
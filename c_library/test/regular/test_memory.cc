@@ -0,0 +1,101 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "RegularModels.h"
+#include "GridMemory.h"
+
+
+void test_alignment() {
+    for (size_t n : {1, 3, 17, 1000, 300000}) {
+        double* ptr = allocate_grid_memory(n);
+        assert (reinterpret_cast<std::uintptr_t>(ptr) % grid_memory_alignment == 0);
+        // the memory has to be writable over its full size
+        for (size_t i = 0; i < n; ++i) {
+            ptr[i] = i;
+        }
+        free_grid_memory(ptr);
+    }
+}
+
+void test_pool() {
+    clear_grid_memory_pool();
+    assert (grid_memory_pool_size() == 0);
+    double* a = allocate_grid_memory(1000);
+    free_grid_memory(a);
+    assert (grid_memory_pool_size() > 0);
+    // a block of the same size is taken from the pool
+    double* b = allocate_grid_memory(1000);
+    assert (a == b);
+    assert (grid_memory_pool_size() == 0);
+    free_grid_memory(b);
+
+    // no pooling beyond the limit
+    set_grid_memory_pool_limit(0);
+    assert (grid_memory_pool_size() == 0);
+    double* c = allocate_grid_memory(1000);
+    free_grid_memory(c);
+    assert (grid_memory_pool_size() == 0);
+    set_grid_memory_pool_limit(size_t(1) << 30);
+}
+
+void test_grid_reuse() {
+    // repeated evaluations on the same grid reuse the memory of released grids
+    const std::array<int, 3> shape {{8, 7, 6}};
+    const std::array<double, 3> refpoint {{-4., 0.1, -0.3}};
+    const std::array<double, 3> increment {{2.1, 0.3, 1.}};
+    HelixMagneticField model;
+    std::array<double*, 3> first = model.on_grid(shape, refpoint, increment);
+    std::vector<double> values(first[1], first[1] + 8*7*6);
+    for (int d = 0; d < 3; ++d) {
+        free_grid_memory(first[d]);
+    }
+    std::array<double*, 3> second = model.on_grid(shape, refpoint, increment);
+    for (int d = 0; d < 3; ++d) {
+        assert (reinterpret_cast<std::uintptr_t>(second[d]) % grid_memory_alignment == 0);
+    }
+    assert (std::vector<double>(second[1], second[1] + 8*7*6) == values);
+    for (int d = 0; d < 3; ++d) {
+        free_grid_memory(second[d]);
+    }
+    assert (grid_memory_pool_size() > 0);
+}
+
+void test_mapped_file() {
+    // the grid is written to the file, in native byte order
+    const std::string path = "test_mapped_grid.bin";
+    {
+        MappedGridFile grid(path, 1000);
+        assert (grid.size() == 1000);
+        for (size_t i = 0; i < grid.size(); ++i) {
+            grid.data()[i] = 0.5*i;
+        }
+    }
+    std::vector<double> values(1000);
+    std::ifstream file(path, std::ios::binary);
+    file.read(reinterpret_cast<char*>(values.data()), 1000*sizeof(double));
+    assert (file.gcount() == 1000*sizeof(double));
+    for (size_t i = 0; i < values.size(); ++i) {
+        assert (values[i] == 0.5*i);
+    }
+    file.close();
+    std::remove(path.c_str());
+
+    // temporary files are removed with the grid
+    {
+        MappedGridFile scratch(path, 10, true);
+        scratch.data()[9] = 1.;
+    }
+    assert (!std::ifstream(path).good());
+}
+
+
+int main() {
+    test_alignment();
+    test_pool();
+    test_grid_reuse();
+    test_mapped_file();
+}
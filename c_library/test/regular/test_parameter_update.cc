@@ -3,8 +3,10 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <cmath>
 
 #include "RegularModels.h"
+#include "UngerFarrar.h"
 
 void test_parameter_update() {
     UniformMagneticField umf = UniformMagneticField();
@@ -12,19 +14,76 @@ void test_parameter_update() {
     assert (umf.by == 0.);
     assert (umf.bz == 0.);
 
-    vector zeros{{0., 0., 0.}};
+    vector_t<double> zeros{{0., 0., 0.}};
     
     assert (umf.at_position(2.4, 2.1, -.2) == zeros);
     
     umf.bx = -3.2; 
     
     assert (umf.bx == -3.2); 
-    vector updated{{-3.2, 0., 0.}};
+    vector_t<double> updated{{-3.2, 0., 0.}};
     
     assert (umf.at_position(2.4, 2.1, -.2) == updated);
 
 }
 
+#if autodiff_FOUND
+// at_position runs on plain doubles, derivative on dual numbers: both have to describe the same function
+void test_derivative_consistency() {
+    HelixMagneticField hmf = HelixMagneticField();
+    const double x = 2.4, y = 2.1, z = -.2, h = 1e-6;
+
+    Eigen::MatrixXd jac = hmf.derivative(x, y, z);
+    vector_t<double> b0 = hmf.at_position(x, y, z);
+    hmf.ampx += h;
+    vector_t<double> b1 = hmf.at_position(x, y, z);
+    for (int i = 0; i < 3; ++i) {
+        assert (std::abs((b1[i] - b0[i]) / h - jac(i, 0)) < 1e-5);
+    }
+
+    // only the active parameters are differentiated
+    hmf.active_diff = {"ampy"};
+    Eigen::MatrixXd jac_y = hmf.derivative(x, y, z);
+    assert (jac_y.cols() == 1);
+    for (int i = 0; i < 3; ++i) {
+        assert (jac_y(i, 0) == jac(i, 1));
+    }
+}
+
+// The columns of derivative follow the order in which the model declares its parameters, whatever the order of the names in active_diff
+void test_derivative_order() {
+    UFMagneticField uf = UFMagneticField();
+    const double x = -5.3, y = 2.1, z = .4;
+    const std::vector<std::string> declared{"fPoloidalA", "fDiskB1", "fDiskB2", "fDiskB3", "fDiskH", "fDiskPhase1", "fDiskPhase2", "fDiskPhase3", 
+        "fDiskPitch", "fDiskW", "fPoloidalB", "fPoloidalP", "fPoloidalR", "fPoloidalW", "fPoloidalZ", "fStriation", "fToroidalBN", "fToroidalBS", 
+        "fToroidalR", "fToroidalW", "fToroidalZ", "fSpurCenter", "fSpurLength", "fSpurWidth", "fTwistingTime"};
+
+    Eigen::MatrixXd jac = uf.derivative(x, y, z);
+    assert (jac.cols() == static_cast<long>(declared.size()));
+    for (size_t j = 0; j < declared.size(); ++j) {
+        uf.active_diff = {declared[j]};
+        Eigen::MatrixXd column = uf.derivative(x, y, z);
+        for (int i = 0; i < 3; ++i) {
+            assert (column(i, 0) == jac(i, j));
+        }
+    }
+
+    // fPoloidalA comes before fDiskB1, although the names are sorted the other way round in active_diff
+    uf.active_diff = {"fDiskB1", "fPoloidalA"};
+    Eigen::MatrixXd jac_2 = uf.derivative(x, y, z);
+    assert (jac_2.cols() == 2);
+    assert (jac.col(0).norm() > 0. && jac.col(1).norm() > 0.);
+    for (int i = 0; i < 3; ++i) {
+        assert (jac_2(i, 0) == jac(i, 0));
+        assert (jac_2(i, 1) == jac(i, 1));
+    }
+}
+#endif
+
 int main() {
     test_parameter_update();
+#if autodiff_FOUND
+    test_derivative_consistency();
+    test_derivative_order();
+#endif
 }
\ No newline at end of file
@@ -3,24 +3,25 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <stdexcept>
 
 #include "RegularModels.h"
 
-void test_at_position(std::map<std::string, std::map<std::array<double, 3>, vector>> val_pos_map,
+void test_at_position(std::map<std::string, std::map<std::array<double, 3>, vector_t<double>>> val_pos_map,
                       std::map <std::string, std::shared_ptr<RegularVectorField>> model_dict
                       ) {
     auto model_iter = model_dict.begin();
 
 
     while (model_iter != model_dict.end()) {
-        std::map<std::array<double, 3>, vector> val_pos_map_this_model = val_pos_map[(model_iter->first)];
+        std::map<std::array<double, 3>, vector_t<double>> val_pos_map_this_model = val_pos_map[(model_iter->first)];
         auto val_pos_iter = val_pos_map_this_model.begin();
         while (val_pos_iter != val_pos_map_this_model.end()) {
           double x = (val_pos_iter->first)[0];
           double y = (val_pos_iter->first)[1];
           double z = (val_pos_iter->first)[2];
 
-          vector mval = (*(model_iter->second)).at_position(x, y, z);
+          vector_t<double> mval = (*(model_iter->second)).at_position(x, y, z);
           /*std::string assertion_msg1 = "Assert failed with model " + model_iter->first + " and at position " + std::to_string(x) + " " + std::to_string(y) + " " + std::to_string(z);
           std::string assertion_msg2 = "Assert failed with model eval " + std::to_string(mval[0]) + " " + std::to_string(mval[1]) + " " + std::to_string(mval[2]);
           std::string assertion_msg3 = "But should be " + std::to_string((val_pos_iter->second)[0]) + " " + std::to_string((val_pos_iter->second)[1]) + " " + std::to_string((val_pos_iter->second)[2]);
@@ -34,28 +35,76 @@ void test_at_position(std::map<std::string, std::map<std::array<double, 3>, vect
     }
 }
 
+void test_at_positions(std::map <std::string, std::shared_ptr<RegularVectorField>> model_dict) {
+    const std::vector<double> x {{0., 2., -4.5, 8.1, 12., -0.3, 19.}};
+    const std::vector<double> y {{0., 6., 0.1, -3., 2.2, 0.4, 1.}};
+    const std::vector<double> z {{-0.2, 0.8, 0.2, 0., 1., -2., 0.1}};
+    size_t n = x.size();
+
+    for (auto const& [name, model] : model_dict) {
+        std::vector<double> bx(n), by(n), bz(n);
+        model->at_positions(x.data(), y.data(), z.data(), n, {bx.data(), by.data(), bz.data()});
+        for (size_t s = 0; s < n; ++s) {
+            vector_t<double> v = model->at_position(x[s], y[s], z[s]);
+            assert (bx[s] == static_cast<double>(v[0]));
+            assert (by[s] == static_cast<double>(v[1]));
+            assert (bz[s] == static_cast<double>(v[2]));
+        }
+    }
+}
+
+// a model whose evaluation fails for some positions (as a python subclass raising an exception)
+class FailingVectorField : public RegularVectorField {
+public:
+    using RegularVectorField::RegularVectorField;
+    vector_t<double> at_position(const double &x, const double &y, const double &z) const override {
+        if (x > 3.) {
+            throw std::runtime_error("evaluation failed");
+        }
+        return vector_t<double>{{x, y, z}};
+    }
+};
+
+void test_exceptions_from_threads() {
+    // exceptions thrown on any thread reach the caller of at_positions
+    FailingVectorField model;
+    model.grid_threads = 4;
+    const size_t n = 5000;
+    std::vector<double> x(n), y(n, 1.), z(n, 2.), bx(n), by(n), bz(n);
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = 4. * i / n;
+    }
+    bool thrown = false;
+    try {
+        model.at_positions(x.data(), y.data(), z.data(), n, {bx.data(), by.data(), bz.data()});
+    } catch (std::runtime_error &) {
+        thrown = true;
+    }
+    assert (thrown);
+}
+
 int main() {
     // Define some positions in Galactic cartesian coordinates (units are kpc)
-    vector zv{{0., 0., 0.}};
+    vector_t<double> zv{{0., 0., 0.}};
 
-    vector z1{{0., 0., 1.}};
+    vector_t<double> z1{{0., 0., 1.}};
 
-    std::map<std::array<double, 3>, vector> jf_12_map;
+    std::map<std::array<double, 3>, vector_t<double>> jf_12_map;
     jf_12_map[{0., 0., 0.}] = zv; // Galactic center
     jf_12_map[{.1, .3, .4}] = zv; // Within inner boundary
     jf_12_map[{0., 0., 0.}] = zv; // outside outer boundary 
 
 
-    std::map<std::array<double, 3>, vector> jaffe_map;
+    std::map<std::array<double, 3>, vector_t<double>> jaffe_map;
     jaffe_map[{0., 0., 0.}] = zv; // Galactic center
     jaffe_map[{0., 0., 1.}] = zv; // Galactic center
 
-    std::map<std::array<double, 3>, vector> pshirkov_map;
+    std::map<std::array<double, 3>, vector_t<double>> pshirkov_map;
     pshirkov_map[{0., 0., 0.}] = zv; // Galactic center
 
-    std::map<std::array<double, 3>, vector> helix_map;
+    std::map<std::array<double, 3>, vector_t<double>> helix_map;
 
-    std::map<std::string, std::map<std::array<double, 3>, vector>> val_pos_map;
+    std::map<std::string, std::map<std::array<double, 3>, vector_t<double>>> val_pos_map;
     val_pos_map["JF12"] = jf_12_map;
     val_pos_map["Jaffe"] = jaffe_map;
     val_pos_map["Helix"] = helix_map;
@@ -69,5 +118,7 @@ int main() {
     models["Pshirkov"] = std::shared_ptr<PshirkovMagneticField> (new PshirkovMagneticField());
 
     test_at_position(val_pos_map, models);
+    test_at_positions(models);
+    test_exceptions_from_threads();
 
 }
\ No newline at end of file
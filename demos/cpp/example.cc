@@ -64,9 +64,9 @@ void print_ev_grid_no_grid(std::map <std::string, std::shared_ptr<VECTORFIELD>>
       std::cout << "\n";
       ++model_iter;
     }
-    //delete b_grid[0];
-    //delete b_grid[1];
-    //delete b_grid[2];
+    //free_grid_memory(b_grid[0]);
+    //free_grid_memory(b_grid[1]);
+    //free_grid_memory(b_grid[2]);
   }
 
 template void print_ev_grid_no_grid<RegularVectorField>(std::map <std::string, std::shared_ptr<RegularVectorField>> md, std::array<double, 3> siz); 
@@ -130,9 +130,9 @@ void print_ev_grid_irreg(std::map <std::string, std::shared_ptr<RegularVectorFie
           }
       std::cout << "\n";
       ++model_iter;
-      delete b_grid[0];
-      delete b_grid[1];
-      delete b_grid[2];
+      free_grid_memory(b_grid[0]);
+      free_grid_memory(b_grid[1]);
+      free_grid_memory(b_grid[2]);
     }
   }
 
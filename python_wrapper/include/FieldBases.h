@@ -15,14 +15,126 @@ using namespace pybind11::literals;
 
 void FieldBases(py::module_ &m) {
     
-    py::class_<Field<vector, std::array<double*, 3>>,  PyVectorFieldBase>(m, "VectorFieldBase");
+    py::class_<Field<vector_t<double>, std::array<double*, 3>>,  PyVectorFieldBase>(m, "VectorFieldBase")
+        .def_readwrite("grid_threads", &Field<vector_t<double>, std::array<double*, 3>>::grid_threads)
+        .def_readwrite("grid_tile", &Field<vector_t<double>, std::array<double*, 3>>::grid_tile);
 
-    py::class_<Field<number, double*>,  PyScalarFieldBase>(m, "ScalarFieldBase");
+    py::class_<Field<double, double*>,  PyScalarFieldBase>(m, "ScalarFieldBase")
+        .def_readwrite("grid_threads", &Field<double, double*>::grid_threads)
+        .def_readwrite("grid_tile", &Field<double, double*>::grid_tile);
+
+    py::enum_<InterpolationKernel>(m, "InterpolationKernel")
+        .value("trilinear", InterpolationKernel::trilinear)
+        .value("tricubic", InterpolationKernel::tricubic);
+
+    py::enum_<GridBoundary>(m, "GridBoundary")
+        .value("clamp", GridBoundary::clamp)
+        .value("periodic", GridBoundary::periodic);
+
+    // grid is a scalar grid of shape (nx, ny, nz), or a vector grid of shape (3, nx, ny, nz)
+    py::class_<GridInterpolator, std::shared_ptr<GridInterpolator>>(m, "GridInterpolator")
+        .def(py::init([](const py::array_t<double, py::array::c_style | py::array::forcecast> &grid, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, 
+                         const InterpolationKernel kernel, const GridBoundary boundary, const int brick_size) {
+            if (grid.ndim() == 3) {
+              const std::array<int, 3> shape{(int)grid.shape(0), (int)grid.shape(1), (int)grid.shape(2)};
+              return std::make_shared<GridInterpolator>(grid.data(), shape, reference_point, increment, kernel, boundary, brick_size);
+            }
+            if (grid.ndim() == 4 && grid.shape(0) == 3) {
+              const std::array<int, 3> shape{(int)grid.shape(1), (int)grid.shape(2), (int)grid.shape(3)};
+              const size_t sz = static_cast<size_t>(shape[0])*shape[1]*shape[2];
+              double *data = const_cast<double*>(grid.data());
+              return std::make_shared<GridInterpolator>(std::array<double*, 3>{data, data + sz, data + 2*sz}, shape, reference_point, increment, kernel, boundary, brick_size);
+            }
+            throw py::value_error("grid must have the shape (nx, ny, nz) or (3, nx, ny, nz)");}),
+          "grid"_a, py::kw_only(), py::arg("reference_point"), py::arg("increment"), py::arg("kernel") = InterpolationKernel::trilinear, 
+          py::arg("boundary") = GridBoundary::clamp, py::arg("brick_size") = 8)
+        .def_property_readonly("components", &GridInterpolator::components)
+        .def_property_readonly("shape", &GridInterpolator::shape)
+        .def_property_readonly("reference_point", &GridInterpolator::reference_point)
+        .def_property_readonly("increment", &GridInterpolator::increment)
+        .def_property_readonly("kernel", &GridInterpolator::kernel)
+        .def_property_readonly("boundary", &GridInterpolator::boundary)
+        .def("memory_size", &GridInterpolator::memory_size)
+        .def("at_positions", [](const GridInterpolator &self, const py::array_t<double, py::array::c_style | py::array::forcecast> &x, const py::array_t<double, py::array::c_style | py::array::forcecast> &y, const py::array_t<double, py::array::c_style | py::array::forcecast> &z, const int nthreads) -> py::object {
+          const size_t n = x.size();
+          if (static_cast<size_t>(y.size()) != n || static_cast<size_t>(z.size()) != n) {
+            throw py::value_error("x, y and z must have the same size");
+          }
+          std::vector<py::ssize_t> shp(x.shape(), x.shape() + x.ndim());
+          if (self.components() == 1) {
+            py::array_t<double> arr(shp);
+            {
+              py::gil_scoped_release release;
+              self.at_positions(x.data(), y.data(), z.data(), n, arr.mutable_data(), nthreads);
+            }
+            return arr;
+          }
+          py::array_t<double> bx(shp);
+          py::array_t<double> by(shp);
+          py::array_t<double> bz(shp);
+          std::array<double*, 3> out{bx.mutable_data(), by.mutable_data(), bz.mutable_data()};
+          {
+            py::gil_scoped_release release;
+            self.at_positions(x.data(), y.data(), z.data(), n, out, nthreads);
+          }
+          py::list li;
+          li.append(bx);
+          li.append(by);
+          li.append(bz);
+          return li;},
+          "x"_a, "y"_a, "z"_a, "nthreads"_a = 0);
 
     #if FFTW_FOUND
-        py::class_<RandomField<vector, std::array<double*, 3>>,  PyVectorRandomFieldBase>(m, "VectorRandomFieldBase");
+        py::enum_<FFTWPlanningRigor>(m, "FFTWPlanningRigor")
+            .value("estimate", FFTWPlanningRigor::estimate)
+            .value("measure", FFTWPlanningRigor::measure)
+            .value("patient", FFTWPlanningRigor::patient);
+
+        py::class_<GenerationStats>(m, "GenerationStats")
+            .def_readonly("realizations", &GenerationStats::realizations)
+            .def_readonly("transforms", &GenerationStats::transforms)
+            .def("transforms_per_realization", &GenerationStats::transforms_per_realization);
+
+        m.def("clear_fftw_plan_cache", &clear_fftw_plan_cache);
+        m.def("fftw_plan_cache_size", &fftw_plan_cache_size);
+        m.def("fftw_threads_available", &fftw_threads_available);
+        m.def("fftw_float_available", &fftw_float_available);
+        m.def("set_fftw_wisdom_file", &set_fftw_wisdom_file, "path"_a);
+        m.def("fftw_wisdom_file", &fftw_wisdom_file);
+        m.def("generate_fftw_wisdom", &generate_fftw_wisdom, "shapes"_a, "rigor"_a = FFTWPlanningRigor::measure, "nthreads"_a = 1, "components"_a = std::vector<int>{1, 3},
+              py::call_guard<py::gil_scoped_release>());
+
+        py::class_<RandomField<vector_t<double>, std::array<double*, 3>>,  PyVectorRandomFieldBase>(m, "VectorRandomFieldBase")
+            .def_readwrite("legacy_random_numbers", &RandomField<vector_t<double>, std::array<double*, 3>>::legacy_random_numbers)
+            .def_readwrite("fftw_planning_rigor", &RandomField<vector_t<double>, std::array<double*, 3>>::fftw_planning_rigor)
+            .def_readwrite("fftw_threads", &RandomField<vector_t<double>, std::array<double*, 3>>::fftw_threads)
+            .def_readwrite("nufft_tolerance", &RandomField<vector_t<double>, std::array<double*, 3>>::nufft_tolerance)
+            .def("fftw_thread_count", &RandomField<vector_t<double>, std::array<double*, 3>>::fftw_thread_count)
+            .def("generation_stats", &RandomField<vector_t<double>, std::array<double*, 3>>::generation_stats, py::return_value_policy::copy)
+            .def("reset_generation_stats", &RandomField<vector_t<double>, std::array<double*, 3>>::reset_generation_stats)
+            .def("interpolate_realization", &RandomField<vector_t<double>, std::array<double*, 3>>::interpolate_realization, "seed"_a, "kernel"_a = InterpolationKernel::trilinear, "brick_size"_a = 8,
+                 py::call_guard<py::gil_scoped_release>())
+            .def("set_interpolator", [](RandomField<vector_t<double>, std::array<double*, 3>> &self, std::shared_ptr<GridInterpolator> interpolator) {
+              self.set_interpolator(interpolator);}, "interpolator"_a)
+            .def("get_interpolator", [](RandomField<vector_t<double>, std::array<double*, 3>> &self) {
+              return std::const_pointer_cast<GridInterpolator>(self.get_interpolator());})
+            .def("clear_interpolator", &RandomField<vector_t<double>, std::array<double*, 3>>::clear_interpolator);
 
-        py::class_<RandomField<number, double*>,  PyScalarRandomFieldBase>(m, "ScalarRandomFieldBase");
+        py::class_<RandomField<double, double*>,  PyScalarRandomFieldBase>(m, "ScalarRandomFieldBase")
+            .def_readwrite("legacy_random_numbers", &RandomField<double, double*>::legacy_random_numbers)
+            .def_readwrite("fftw_planning_rigor", &RandomField<double, double*>::fftw_planning_rigor)
+            .def_readwrite("fftw_threads", &RandomField<double, double*>::fftw_threads)
+            .def_readwrite("nufft_tolerance", &RandomField<double, double*>::nufft_tolerance)
+            .def("fftw_thread_count", &RandomField<double, double*>::fftw_thread_count)
+            .def("generation_stats", &RandomField<double, double*>::generation_stats, py::return_value_policy::copy)
+            .def("reset_generation_stats", &RandomField<double, double*>::reset_generation_stats)
+            .def("interpolate_realization", &RandomField<double, double*>::interpolate_realization, "seed"_a, "kernel"_a = InterpolationKernel::trilinear, "brick_size"_a = 8,
+                 py::call_guard<py::gil_scoped_release>())
+            .def("set_interpolator", [](RandomField<double, double*> &self, std::shared_ptr<GridInterpolator> interpolator) {
+              self.set_interpolator(interpolator);}, "interpolator"_a)
+            .def("get_interpolator", [](RandomField<double, double*> &self) {
+              return std::const_pointer_cast<GridInterpolator>(self.get_interpolator());})
+            .def("clear_interpolator", &RandomField<double, double*>::clear_interpolator);
     #endif
 
 }
@@ -1,10 +1,23 @@
 #ifndef ARRAY_CONVERTERS_H
 #define ARRAY_CONVERTERS_H
 
+#include <string>
+#include <type_traits>
+
+#include "GridMemory.h"
 
 namespace py = pybind11;
 using namespace pybind11::literals;
 
+// Calls func without holding the GIL. The grid loops of the library run on several threads, which acquire the GIL 
+// whenever they call a method overridden in python (at_position, spatial_profile, ...), 
+// hence the evaluation must not be started with the GIL held.
+template <typename FUNC>
+inline auto without_gil(FUNC &&func) -> decltype(func()) {
+  py::gil_scoped_release release;
+  return func();
+}
+
 
 // helper functions to avoid making a copy when returning a py::array_t
 // based on
@@ -23,29 +36,171 @@ inline py::array_t<typename Sequence::value_type> as_pyarray(Sequence &&seq) {
   return py::array(size, data, capsule);
 }
 
-inline py::array_t<double> from_pointer_to_pyarray(double* data, size_t arr_size_x, size_t arr_size_y, size_t arr_size_z) {
+// wraps grids allocated by the library (double or float) into numpy arrays, which release the memory when they are garbage collected
+template <typename T>
+inline py::array_t<T> from_pointer_to_pyarray(T* data, size_t arr_size_x, size_t arr_size_y, size_t arr_size_z) {
   
   py::capsule capsule(data, [](void *f) {
-      std::unique_ptr<double>(reinterpret_cast<double*>(f));
+      free_grid_memory(reinterpret_cast<T*>(f));
       });
 
   size_t arr_size = arr_size_x*arr_size_y*arr_size_z;
-  py::array_t<double> arr = py::array(arr_size, data, capsule);
+  py::array_t<T> arr = py::array(arr_size, data, capsule);
 
   return arr.reshape({arr_size_x, arr_size_y, arr_size_z});
 }
 
 
-inline py::list from_pointer_array_to_list_pyarray(std::array<double*, 3> seq, size_t arr_size_x, size_t arr_size_y, size_t arr_size_z) {
+// wraps a grid allocated by the library into a C-contiguous numpy array of arbitrary shape (e.g. for derivative_on_grid)
+template <typename T>
+inline py::array_t<T> from_pointer_to_pyarray(T* data, const std::vector<py::ssize_t> &shape) {
+  
+  py::capsule capsule(data, [](void *f) {
+      free_grid_memory(reinterpret_cast<T*>(f));
+      });
+
+  return py::array_t<T>(shape, data, capsule);
+}
+
+
+template <typename T>
+inline py::list from_pointer_array_to_list_pyarray(std::array<T*, 3> seq, size_t arr_size_x, size_t arr_size_y, size_t arr_size_z) {
 
   py::list li;
 
   for (int i = 0; i<3; ++i) {
-    py::array_t<double> arr = from_pointer_to_pyarray(std::move(seq[i]), arr_size_x, arr_size_y, arr_size_z);
+    py::array_t<T> arr = from_pointer_to_pyarray(seq[i], arr_size_x, arr_size_y, arr_size_z);
 
     li.append(arr);
   }
   return li;
 }
 
+
+// on_grid returns single precision grids if dtype is numpy.float32, or if out is given as float32 array(s) (and dtype is not given).
+inline bool single_precision_requested(const py::object &out, const py::object &dtype) {
+  if (!dtype.is_none()) {
+    const py::dtype dt = py::dtype::from_args(dtype);
+    if (dt.equal(py::dtype::of<float>())) {
+      return true;
+    }
+    if (dt.equal(py::dtype::of<double>())) {
+      return false;
+    }
+    throw std::invalid_argument("dtype needs to be float64 or float32.");
+  }
+  if (out.is_none()) {
+    return false;
+  }
+  if (py::isinstance<py::array>(out)) {
+    return py::isinstance<py::array_t<float>>(out);
+  }
+  if (py::isinstance<py::sequence>(out) && py::len(out) > 0) {
+    py::object first = out.cast<py::sequence>()[0];
+    return py::isinstance<py::array_t<float>>(first);
+  }
+  return false;
+}
+
+template <typename T>
+inline std::string dtype_name() {
+  return std::is_same<T, float>::value ? "float32" : "float64";
+}
+
+
+// helper functions for the out= arguments, checking that a user provided numpy array can hold a grid of the given shape.
+// The strides of the array are returned in elements (as expected by the on_grid_into functions of the c++ library).
+template <typename T = double>
+inline std::array<std::ptrdiff_t, 3> grid_strides_from_pyarray(const py::array &arr, const std::array<int, 3> &shp, const py::ssize_t offset = 0) {
+  if (!py::isinstance<py::array_t<T>>(arr)) {
+    throw std::invalid_argument("out needs to be a numpy array of dtype " + dtype_name<T>() + ".");
+  }
+  if (!arr.writeable()) {
+    throw std::invalid_argument("out needs to be writeable.");
+  }
+  if (arr.ndim() != 3 + offset) {
+    throw std::invalid_argument("out has the wrong number of dimensions.");
+  }
+  std::array<std::ptrdiff_t, 3> strides;
+  for (int d = 0; d < 3; ++d) {
+    if (arr.shape(d + offset) != shp[d]) {
+      throw std::invalid_argument("The shape of out does not match the shape of the grid.");
+    }
+    if (arr.strides(d + offset) % static_cast<py::ssize_t>(sizeof(T)) != 0) {
+      throw std::invalid_argument("The strides of out need to be multiples of the item size.");
+    }
+    strides[d] = arr.strides(d + offset) / static_cast<py::ssize_t>(sizeof(T));
+  }
+  // zero strides are reserved for the default layout in the c++ library, and would be a broadcasted array anyway
+  if (strides[0] == 0 || strides[1] == 0 || strides[2] == 0) {
+    throw std::invalid_argument("out must not be a broadcasted array.");
+  }
+  return strides;
+}
+
+template <typename T = double>
+inline T* grid_buffer_from_pyarray(py::array &arr, const std::array<int, 3> &shp, std::array<std::ptrdiff_t, 3> &strides) {
+  strides = grid_strides_from_pyarray<T>(arr, shp);
+  return static_cast<T*>(arr.mutable_data());
+}
+
+// For vector fields, out is either a sequence of three arrays with the same memory layout or a single array of shape (3, nx, ny, nz).
+template <typename T = double>
+inline std::array<T*, 3> grid_buffers_from_pyobject(py::object &out, const std::array<int, 3> &shp, std::array<std::ptrdiff_t, 3> &strides) {
+  std::array<T*, 3> buffers;
+  if (py::isinstance<py::array>(out)) {
+    py::array arr = out.cast<py::array>();
+    strides = grid_strides_from_pyarray<T>(arr, shp, 1);
+    if (arr.shape(0) != 3) {
+      throw std::invalid_argument("The first axis of out needs to have length 3.");
+    }
+    std::ptrdiff_t component_stride = arr.strides(0) / static_cast<py::ssize_t>(sizeof(T));
+    T* data = static_cast<T*>(arr.mutable_data());
+    for (int d = 0; d < 3; ++d) {
+      buffers[d] = data + d*component_stride;
+    }
+    return buffers;
+  }
+  py::sequence seq = out.cast<py::sequence>();
+  if (seq.size() != 3) {
+    throw std::invalid_argument("out needs to contain three arrays.");
+  }
+  for (int d = 0; d < 3; ++d) {
+    py::array arr = seq[d].cast<py::array>();
+    std::array<std::ptrdiff_t, 3> st = grid_strides_from_pyarray<T>(arr, shp);
+    if (d > 0 && st != strides) {
+      throw std::invalid_argument("All arrays in out need to have the same memory layout.");
+    }
+    strides = st;
+    buffers[d] = static_cast<T*>(arr.mutable_data());
+  }
+  return buffers;
+}
+
+// input grids, e.g. the adjoint grids for gradient_on_grid: (nx, ny, nz) for scalar fields, (3, nx, ny, nz) for vector fields, C-contiguous
+inline void check_adjoint_shape(const py::array &arr, const std::array<int, 3> &shp, const py::ssize_t offset, const std::string &name = "adjoint") {
+  if (arr.ndim() != 3 + offset) {
+    throw std::invalid_argument(name + " has the wrong number of dimensions.");
+  }
+  for (int d = 0; d < 3; ++d) {
+    if (arr.shape(d + offset) != shp[d]) {
+      throw std::invalid_argument("The shape of " + name + " does not match the shape of the grid.");
+    }
+  }
+}
+
+inline const double* adjoint_buffer_from_pyarray(const py::array_t<double, py::array::c_style | py::array::forcecast> &arr, const std::array<int, 3> &shp) {
+  check_adjoint_shape(arr, shp, 0);
+  return arr.data();
+}
+
+inline std::array<const double*, 3> adjoint_buffers_from_pyarray(const py::array_t<double, py::array::c_style | py::array::forcecast> &arr, const std::array<int, 3> &shp, const std::string &name = "adjoint") {
+  check_adjoint_shape(arr, shp, 1, name);
+  if (arr.shape(0) != 3) {
+    throw std::invalid_argument("The first axis of " + name + " needs to have length 3.");
+  }
+  const size_t gsz = static_cast<size_t>(shp[0])*shp[1]*shp[2];
+  return {arr.data(), arr.data() + gsz, arr.data() + 2*gsz};
+}
+
 #endif
\ No newline at end of file
@@ -9,25 +9,158 @@
 namespace py = pybind11;
 using namespace pybind11::literals;
 
+// on_grid_many: the realizations are either passed one at a time to callback(index, realization) (a copy, None is returned), 
+// or stacked along a new first axis, into the C-contiguous array out of shape (n, nx, ny, nz) for scalar fields 
+// or (3, n, nx, ny, nz) for vector fields, if given.
+inline py::object realizations_to_python(RandomScalarField &self, const std::vector<int> &seeds, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, py::object &out, py::object &callback) {
+  const std::vector<py::ssize_t> realization_shape{shape[0], shape[1], shape[2]};
+  const size_t gs = static_cast<size_t>(shape[0])*shape[1]*shape[2];
+  if (!callback.is_none()) {
+    without_gil([&]() {
+      self.on_grid_many(seeds, shape, reference_point, increment, [&](const size_t n, double* val) {
+        py::gil_scoped_acquire acquire;
+        py::array_t<double> arr(realization_shape);
+        std::copy(val, val + gs, arr.mutable_data());
+        callback(n, arr);
+      });
+    });
+    return py::none();
+  }
+  const std::vector<py::ssize_t> stacked_shape{static_cast<py::ssize_t>(seeds.size()), shape[0], shape[1], shape[2]};
+  if (!out.is_none()) {
+    if (!py::isinstance<py::array_t<double, py::array::c_style>>(out)) {
+      throw std::invalid_argument("out needs to be a C-contiguous numpy array of dtype float64.");
+    }
+    py::array arr = out.cast<py::array>();
+    if (arr.ndim() != 4 || !std::equal(stacked_shape.begin(), stacked_shape.end(), arr.shape())) {
+      throw std::invalid_argument("The shape of out does not match (number of seeds, nx, ny, nz).");
+    }
+    double* data = static_cast<double*>(arr.mutable_data());
+    without_gil([&]() { self.on_grid_many_into(data, seeds, shape, reference_point, increment); });
+    return out;
+  }
+  double* f = allocate_grid_memory(seeds.size()*gs);
+  py::array_t<double> arr = from_pointer_to_pyarray(f, stacked_shape);
+  without_gil([&]() { self.on_grid_many_into(f, seeds, shape, reference_point, increment); });
+  return arr;
+}
+
+inline py::object realizations_to_python(RandomVectorField &self, const std::vector<int> &seeds, const std::array<int, 3> &shape, const std::array<double, 3> &reference_point, const std::array<double, 3> &increment, py::object &out, py::object &callback) {
+  const std::vector<py::ssize_t> realization_shape{shape[0], shape[1], shape[2]};
+  const size_t gs = static_cast<size_t>(shape[0])*shape[1]*shape[2];
+  if (!callback.is_none()) {
+    without_gil([&]() {
+      self.on_grid_many(seeds, shape, reference_point, increment, [&](const size_t n, std::array<double*, 3> val) {
+        py::gil_scoped_acquire acquire;
+        py::list li;
+        for (int d = 0; d < 3; ++d) {
+          py::array_t<double> arr(realization_shape);
+          std::copy(val[d], val[d] + gs, arr.mutable_data());
+          li.append(arr);
+        }
+        callback(n, li);
+      });
+    });
+    return py::none();
+  }
+  const std::vector<py::ssize_t> stacked_shape{static_cast<py::ssize_t>(seeds.size()), shape[0], shape[1], shape[2]};
+  if (!out.is_none()) {
+    if (!py::isinstance<py::array_t<double, py::array::c_style>>(out)) {
+      throw std::invalid_argument("out needs to be a C-contiguous numpy array of dtype float64.");
+    }
+    py::array arr = out.cast<py::array>();
+    if (arr.ndim() != 5 || arr.shape(0) != 3 || !std::equal(stacked_shape.begin(), stacked_shape.end(), arr.shape() + 1)) {
+      throw std::invalid_argument("The shape of out does not match (3, number of seeds, nx, ny, nz).");
+    }
+    double* data = static_cast<double*>(arr.mutable_data());
+    const size_t component_size = seeds.size()*gs;
+    without_gil([&]() { self.on_grid_many_into({data, data + component_size, data + 2*component_size}, seeds, shape, reference_point, increment); });
+    return out;
+  }
+  std::array<double*, 3> f;
+  py::list li;
+  for (int d = 0; d < 3; ++d) {
+    f[d] = allocate_grid_memory(seeds.size()*gs);
+    li.append(from_pointer_to_pyarray(f[d], stacked_shape));
+  }
+  without_gil([&]() { self.on_grid_many_into(f, seeds, shape, reference_point, increment); });
+  return li;
+}
+
+// single precision random fields need the float version of FFTW
+inline void check_single_precision_available() {
+  if (!fftw_float_available()) {
+    throw std::invalid_argument("Single precision random fields need the single precision FFTW library (fftw3f).");
+  }
+}
+
 void RandomFieldBases(py::module_ &m) {
+    py::enum_<VectorFieldEngine>(m, "VectorFieldEngine")
+        .value("standard", VectorFieldEngine::standard)
+        .value("spectral", VectorFieldEngine::spectral)
+        .value("modulated_noise", VectorFieldEngine::modulated_noise);
+
     // Random Vector Base Class
-    py::class_<RandomVectorField, RandomField<vector, std::array<double*, 3>>, PyRandomVectorField>(m, "RandomVectorField")
+    py::class_<RandomVectorField, RandomField<vector_t<double>, std::array<double*, 3>>, PyRandomVectorField>(m, "RandomVectorField")
       .def(py::init<>())
       .def(py::init<std::array<int, 3> &, std::array<double, 3> &, std::array<double, 3> &>())
 
-      .def("on_grid", [](RandomVectorField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment, int seed)  {
-          std::array<double*, 3> f = self.on_grid(shape, reference_point, increment, seed);
+      .def("on_grid", [](RandomVectorField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment, int seed, py::object out, py::object dtype) -> py::object {
+          if (single_precision_requested(out, dtype)) {
+            check_single_precision_available();
+#if FFTW_FLOAT_FOUND
+            if (!out.is_none()) {
+              std::array<std::ptrdiff_t, 3> strides;
+              std::array<float*, 3> buffers = grid_buffers_from_pyobject<float>(out, shape, strides);
+              without_gil([&]() { self.on_grid_into(buffers, shape, reference_point, increment, seed, strides); });
+              return out;
+            }
+            return from_pointer_array_to_list_pyarray(without_gil([&]() { return self.on_grid_float(shape, reference_point, increment, seed); }), shape[0], shape[1], shape[2]);
+#endif
+          }
+          if (!out.is_none()) {
+            std::array<std::ptrdiff_t, 3> strides;
+            std::array<double*, 3> buffers = grid_buffers_from_pyobject(out, shape, strides);
+            without_gil([&]() { self.on_grid_into(buffers, shape, reference_point, increment, seed, strides); });
+            return out;
+          }
+          std::array<double*, 3> f = without_gil([&]() { return self.on_grid(shape, reference_point, increment, seed); });
           size_t sx = shape[0]; 
           size_t sy = shape[1];
           size_t sz = shape[2];
           
           auto lis = from_pointer_array_to_list_pyarray(f, sx, sy, sz);
           return lis;},
-          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"),  "seed"_a, 
+          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"),  "seed"_a, py::arg("out") = py::none(), py::arg("dtype") = py::none(),
           py::return_value_policy::take_ownership)
 
-        .def("on_grid", [](RandomVectorField &self, int seed)  {
-          std::array<double*, 3> f = self.on_grid(seed);
+        .def("on_grid", [](RandomVectorField &self, int seed, py::object out, py::object dtype) -> py::object {
+          if (single_precision_requested(out, dtype)) {
+            check_single_precision_available();
+#if FFTW_FLOAT_FOUND
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            if (!out.is_none()) {
+              std::array<std::ptrdiff_t, 3> strides;
+              std::array<float*, 3> buffers = grid_buffers_from_pyobject<float>(out, self.internal_shape, strides);
+              without_gil([&]() { self.on_grid_into(buffers, seed, strides); });
+              return out;
+            }
+            std::array<float*, 3> f = without_gil([&]() { return self.on_grid_float(seed); });
+            return from_pointer_array_to_list_pyarray(f, self.internal_shape[0], self.internal_shape[1], self.internal_shape[2]);
+#endif
+          }
+          if (!out.is_none()) {
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            std::array<std::ptrdiff_t, 3> strides;
+            std::array<double*, 3> buffers = grid_buffers_from_pyobject(out, self.internal_shape, strides);
+            without_gil([&]() { self.on_grid_into(buffers, seed, strides); });
+            return out;
+          }
+          std::array<double*, 3> f = without_gil([&]() { return self.on_grid(seed); });
           size_t sx = self.internal_shape[0];
           size_t sy = self.internal_shape[1];
           size_t sz = self.internal_shape[2]; 
@@ -35,11 +168,91 @@ void RandomFieldBases(py::module_ &m) {
           auto arr = from_pointer_array_to_list_pyarray(f, sx, sy, sz);
 
           return arr;}, 
-          "seed"_a, 
+          "seed"_a, py::kw_only(), py::arg("out") = py::none(), py::arg("dtype") = py::none(),
           py::return_value_policy::take_ownership)
 
+        .def("on_grid_many", [](RandomVectorField &self, const std::vector<int> &seeds, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment, py::object out, py::object callback) -> py::object {
+          return realizations_to_python(self, seeds, shape, reference_point, increment, out, callback);},
+          "seeds"_a, py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::arg("out") = py::none(), py::arg("callback") = py::none())
+
+        .def("on_grid_many", [](RandomVectorField &self, const std::vector<int> &seeds, py::object out, py::object callback) -> py::object {
+          if (!self.has_internal_grid()) {
+            throw GridException();
+          }
+          return realizations_to_python(self, seeds, self.internal_shape, self.internal_ref_point, self.internal_increment, out, callback);},
+          "seeds"_a, py::kw_only(), py::arg("out") = py::none(), py::arg("callback") = py::none())
+
+        // out-of-core evaluation, the field is written to the file path (float64, C order), e.g. to be read with numpy.memmap
+        .def("on_grid_to_file", py::overload_cast<const std::string &, const std::array<int, 3> &, const std::array<double, 3> &, const std::array<double, 3> &, const int>(&RandomVectorField::on_grid_to_file),
+          "path"_a, "shape"_a, "reference_point"_a, "increment"_a, "seed"_a, py::call_guard<py::gil_scoped_release>())
+
+        .def("on_grid_to_file", py::overload_cast<const std::string &, const int>(&RandomVectorField::on_grid_to_file), "path"_a, "seed"_a, 
+             py::call_guard<py::gil_scoped_release>())
+
+        .def_readwrite("out_of_core_memory", &RandomVectorField::out_of_core_memory)
+
+        // evaluation of the realization on the internal grid at the voxels of an irregular grid, or at arbitrary positions, by a non-uniform FFT
+        .def("on_grid", [](RandomVectorField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z, int seed) {
+          std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+          std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+          std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+          std::array<double*, 3> f = without_gil([&]() { return self.on_grid(grid_x_vec, grid_y_vec, grid_z_vec, seed); });
+          return from_pointer_array_to_list_pyarray(f, grid_x_vec.size(), grid_y_vec.size(), grid_z_vec.size());},
+          py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), "seed"_a, py::return_value_policy::take_ownership)
+
+        .def("at_positions", [](RandomVectorField &self, const py::array_t<double, py::array::c_style | py::array::forcecast> &x, const py::array_t<double, py::array::c_style | py::array::forcecast> &y, const py::array_t<double, py::array::c_style | py::array::forcecast> &z, int seed) {
+          const size_t n = x.size();
+          if (static_cast<size_t>(y.size()) != n || static_cast<size_t>(z.size()) != n) {
+            throw py::value_error("x, y and z must have the same size");
+          }
+          std::array<double*, 3> f{allocate_grid_memory(n), allocate_grid_memory(n), allocate_grid_memory(n)};
+          py::list li;
+          for (int i = 0; i < 3; ++i) {
+            li.append(from_pointer_to_pyarray(f[i], {static_cast<py::ssize_t>(n)}));
+          }
+          without_gil([&]() { self.at_positions(x.data(), y.data(), z.data(), n, f, seed); });
+          return li;},
+          "x"_a, "y"_a, "z"_a, "seed"_a)
+
+        // the realization kept by interpolate_realization
+        .def("at_position", [](RandomVectorField &self, double x, double y, double z) {
+          vector_t<double> f = self.at_position(x, y, z);
+          return std::make_tuple(f[0], f[1], f[2]);},
+          "x"_a, "y"_a, "z"_a)
+
+        .def("at_positions", [](RandomVectorField &self, const py::array_t<double, py::array::c_style | py::array::forcecast> &x, const py::array_t<double, py::array::c_style | py::array::forcecast> &y, const py::array_t<double, py::array::c_style | py::array::forcecast> &z) {
+          const size_t n = x.size();
+          if (static_cast<size_t>(y.size()) != n || static_cast<size_t>(z.size()) != n) {
+            throw py::value_error("x, y and z must have the same size");
+          }
+          std::array<double*, 3> f{allocate_grid_memory(n), allocate_grid_memory(n), allocate_grid_memory(n)};
+          py::list li;
+          for (int i = 0; i < 3; ++i) {
+            li.append(from_pointer_to_pyarray(f[i], {static_cast<py::ssize_t>(n)}));
+          }
+          {
+            py::gil_scoped_release release;
+            self.at_positions(x.data(), y.data(), z.data(), n, f);
+          }
+          return li;},
+          "x"_a, "y"_a, "z"_a)
+
+        .def_readwrite("engine", &RandomVectorField::engine)
+
+        .def("set_anisotropy_grid", [](RandomVectorField &self, const py::array_t<double, py::array::c_style | py::array::forcecast> &direction, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
+          self.set_anisotropy_grid(adjoint_buffers_from_pyarray(direction, shape, "direction"), shape, reference_point, increment);},
+          "direction"_a, py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"))
+
+        .def("set_anisotropy_grid", py::overload_cast<RegularVectorField &, const std::array<int, 3> &, const std::array<double, 3> &, const std::array<double, 3> &>(&RandomVectorField::set_anisotropy_grid),
+          "regular_field"_a, py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"))
+
+        .def("set_anisotropy_grid", py::overload_cast<RegularVectorField &>(&RandomVectorField::set_anisotropy_grid), "regular_field"_a)
+
+        .def("has_anisotropy_grid", &RandomVectorField::has_anisotropy_grid)
+        .def("clear_anisotropy_grid", &RandomVectorField::clear_anisotropy_grid)
+
         .def("random_numbers_on_grid", [](RandomVectorField &self, std::array<int, 3> &shape, std::array<double, 3>  &increment, const int seed) {
-          std::array<double*, 3> val = self.random_numbers_on_grid(shape, increment, seed); 
+          std::array<double*, 3> val = without_gil([&]() { return self.random_numbers_on_grid(shape, increment, seed); }); 
           size_t sx = shape[0];
           size_t sy = shape[1];
           size_t sz = shape[2];
@@ -50,7 +263,7 @@ void RandomFieldBases(py::module_ &m) {
         py::return_value_policy::take_ownership)
 
         .def("profile_on_grid", [](RandomVectorField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
-          double* f = self.profile_on_grid(shape, reference_point, increment); 
+          double* f = without_gil([&]() { return self.profile_on_grid(shape, reference_point, increment); }); 
           size_t sx = shape[0];
           size_t sy = shape[1];
           size_t sz = shape[2];
@@ -61,12 +274,32 @@ void RandomFieldBases(py::module_ &m) {
         py::return_value_policy::take_ownership);
 
 // Random Scalar Base Class
-    py::class_<RandomScalarField, RandomField<number, double*>, PyRandomScalarField>(m, "RandomScalarField")
+    py::class_<RandomScalarField, RandomField<double, double*>, PyRandomScalarField>(m, "RandomScalarField")
       .def(py::init<>())
       .def(py::init<std::array<int, 3> &, std::array<double, 3> &, std::array<double, 3> &>())
 
-      .def("on_grid", [](RandomScalarField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment, int seed)  {
-          double* f = self.on_grid(shape, reference_point, increment, seed);
+      .def("on_grid", [](RandomScalarField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment, int seed, py::object out, py::object dtype) -> py::object {
+          if (single_precision_requested(out, dtype)) {
+            check_single_precision_available();
+#if FFTW_FLOAT_FOUND
+            if (!out.is_none()) {
+              py::array arr = out.cast<py::array>();
+              std::array<std::ptrdiff_t, 3> strides;
+              float* buffer = grid_buffer_from_pyarray<float>(arr, shape, strides);
+              without_gil([&]() { self.on_grid_into(buffer, shape, reference_point, increment, seed, strides); });
+              return out;
+            }
+            return from_pointer_to_pyarray(without_gil([&]() { return self.on_grid_float(shape, reference_point, increment, seed); }), shape[0], shape[1], shape[2]);
+#endif
+          }
+          if (!out.is_none()) {
+            py::array arr = out.cast<py::array>();
+            std::array<std::ptrdiff_t, 3> strides;
+            double* buffer = grid_buffer_from_pyarray(arr, shape, strides);
+            without_gil([&]() { self.on_grid_into(buffer, shape, reference_point, increment, seed, strides); });
+            return out;
+          }
+          double* f = without_gil([&]() { return self.on_grid(shape, reference_point, increment, seed); });
           size_t sx = shape[0];
           size_t sy = shape[1];
           size_t sz = shape[2];
@@ -74,11 +307,38 @@ void RandomFieldBases(py::module_ &m) {
           auto arr = from_pointer_to_pyarray(std::move(f), sx, sy, sz);
 
           return arr;},
-          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"),  "seed"_a, 
+          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"),  "seed"_a, py::arg("out") = py::none(), py::arg("dtype") = py::none(),
           py::return_value_policy::take_ownership)
 
-     .def("on_grid", [](RandomScalarField &self, int seed)  {
-          double* f = self.on_grid(seed);
+     .def("on_grid", [](RandomScalarField &self, int seed, py::object out, py::object dtype) -> py::object {
+          if (single_precision_requested(out, dtype)) {
+            check_single_precision_available();
+#if FFTW_FLOAT_FOUND
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            if (!out.is_none()) {
+              py::array arr = out.cast<py::array>();
+              std::array<std::ptrdiff_t, 3> strides;
+              float* buffer = grid_buffer_from_pyarray<float>(arr, self.internal_shape, strides);
+              without_gil([&]() { self.on_grid_into(buffer, seed, strides); });
+              return out;
+            }
+            float* f = without_gil([&]() { return self.on_grid_float(seed); });
+            return from_pointer_to_pyarray(f, self.internal_shape[0], self.internal_shape[1], self.internal_shape[2]);
+#endif
+          }
+          if (!out.is_none()) {
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            py::array arr = out.cast<py::array>();
+            std::array<std::ptrdiff_t, 3> strides;
+            double* buffer = grid_buffer_from_pyarray(arr, self.internal_shape, strides);
+            without_gil([&]() { self.on_grid_into(buffer, seed, strides); });
+            return out;
+          }
+          double* f = without_gil([&]() { return self.on_grid(seed); });
           size_t sx = self.internal_shape[0];
           size_t sy = self.internal_shape[1];
           size_t sz = self.internal_shape[2]; // catches fftw zeropad (uneven)
@@ -87,11 +347,70 @@ void RandomFieldBases(py::module_ &m) {
           
           //py::array_t<double> arr = py::array(f.size(), f.data());  // produces a copy!
           return arr;}, 
-          "seed"_a, 
+          "seed"_a, py::kw_only(), py::arg("out") = py::none(), py::arg("dtype") = py::none(),
           py::return_value_policy::take_ownership)
 
+      .def("on_grid_many", [](RandomScalarField &self, const std::vector<int> &seeds, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment, py::object out, py::object callback) -> py::object {
+          return realizations_to_python(self, seeds, shape, reference_point, increment, out, callback);},
+          "seeds"_a, py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::arg("out") = py::none(), py::arg("callback") = py::none())
+
+      .def("on_grid_many", [](RandomScalarField &self, const std::vector<int> &seeds, py::object out, py::object callback) -> py::object {
+          if (!self.has_internal_grid()) {
+            throw GridException();
+          }
+          return realizations_to_python(self, seeds, self.internal_shape, self.internal_ref_point, self.internal_increment, out, callback);},
+          "seeds"_a, py::kw_only(), py::arg("out") = py::none(), py::arg("callback") = py::none())
+
+      // out-of-core evaluation, the field is written to the file path (float64, C order), e.g. to be read with numpy.memmap
+      .def("on_grid_to_file", py::overload_cast<const std::string &, const std::array<int, 3> &, const std::array<double, 3> &, const std::array<double, 3> &, const int>(&RandomScalarField::on_grid_to_file),
+          "path"_a, "shape"_a, "reference_point"_a, "increment"_a, "seed"_a, py::call_guard<py::gil_scoped_release>())
+
+      .def("on_grid_to_file", py::overload_cast<const std::string &, const int>(&RandomScalarField::on_grid_to_file), "path"_a, "seed"_a, 
+             py::call_guard<py::gil_scoped_release>())
+
+      .def_readwrite("out_of_core_memory", &RandomScalarField::out_of_core_memory)
+
+      // evaluation of the realization on the internal grid at the voxels of an irregular grid, or at arbitrary positions, by a non-uniform FFT
+      .def("on_grid", [](RandomScalarField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z, int seed) {
+          std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+          std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+          std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+          double* f = without_gil([&]() { return self.on_grid(grid_x_vec, grid_y_vec, grid_z_vec, seed); });
+          return from_pointer_to_pyarray(f, grid_x_vec.size(), grid_y_vec.size(), grid_z_vec.size());},
+          py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), "seed"_a, py::return_value_policy::take_ownership)
+
+      .def("at_positions", [](RandomScalarField &self, const py::array_t<double, py::array::c_style | py::array::forcecast> &x, const py::array_t<double, py::array::c_style | py::array::forcecast> &y, const py::array_t<double, py::array::c_style | py::array::forcecast> &z, int seed) {
+          const size_t n = x.size();
+          if (static_cast<size_t>(y.size()) != n || static_cast<size_t>(z.size()) != n) {
+            throw py::value_error("x, y and z must have the same size");
+          }
+          py::array_t<double> arr = from_pointer_to_pyarray(allocate_grid_memory(n), {static_cast<py::ssize_t>(n)});
+          double *out = arr.mutable_data();
+          without_gil([&]() { self.at_positions(x.data(), y.data(), z.data(), n, out, seed); });
+          return arr;},
+          "x"_a, "y"_a, "z"_a, "seed"_a)
+
+      // the realization kept by interpolate_realization
+      .def("at_position", [](RandomScalarField &self, double x, double y, double z) {
+          return self.at_position(x, y, z);},
+          "x"_a, "y"_a, "z"_a)
+
+      .def("at_positions", [](RandomScalarField &self, const py::array_t<double, py::array::c_style | py::array::forcecast> &x, const py::array_t<double, py::array::c_style | py::array::forcecast> &y, const py::array_t<double, py::array::c_style | py::array::forcecast> &z) {
+          const size_t n = x.size();
+          if (static_cast<size_t>(y.size()) != n || static_cast<size_t>(z.size()) != n) {
+            throw py::value_error("x, y and z must have the same size");
+          }
+          py::array_t<double> arr = from_pointer_to_pyarray(allocate_grid_memory(n), {static_cast<py::ssize_t>(n)});
+          double *out = arr.mutable_data();
+          {
+            py::gil_scoped_release release;
+            self.at_positions(x.data(), y.data(), z.data(), n, out);
+          }
+          return arr;},
+          "x"_a, "y"_a, "z"_a)
+
       .def("random_numbers_on_grid", [](RandomScalarField &self, std::array<int, 3> &shape, std::array<double, 3>  &increment, const int seed) {
-        double* val = self.random_numbers_on_grid(shape, increment, seed); 
+        double* val = without_gil([&]() { return self.random_numbers_on_grid(shape, increment, seed); }); 
         size_t sx = shape[0];
         size_t sy = shape[1];
         size_t sz = shape[2];
@@ -101,7 +420,7 @@ void RandomFieldBases(py::module_ &m) {
       py::return_value_policy::take_ownership)
 
       .def("profile_on_grid", [](RandomScalarField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
-        double* f = self.profile_on_grid(shape, reference_point, increment); 
+        double* f = without_gil([&]() { return self.profile_on_grid(shape, reference_point, increment); }); 
         size_t sx = shape[0];
         size_t sy = shape[1];
         size_t sz = shape[2];
@@ -17,10 +17,10 @@ using Array3PointerType = std::array<double*, 3>; // Only for PYBIND11_OVERRIDE_
 // These classes are necessary to override virtual functions when binding abstract c++ classes
 
 
-class PyScalarRandomFieldBase: public RandomField<number, double*> {
+class PyScalarRandomFieldBase: public RandomField<double, double*> {
 public:
-    using RandomField<number, double*>:: RandomField; // Inherit constructors
-    number at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(number, RandomField, at_position, x, y, z); }
+    using RandomField<double, double*>:: RandomField; // Inherit constructors
+    double at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE(double, RandomField, at_position, x, y, z); }
 
     double* on_grid(int seed) override {PYBIND11_OVERRIDE_PURE(double*, RandomField, on_grid, seed); }
     
@@ -42,10 +42,10 @@ public:
 };
 
 
-class PyVectorRandomFieldBase: public RandomField<vector, std::array<double*, 3>> {
+class PyVectorRandomFieldBase: public RandomField<vector_t<double>, std::array<double*, 3>> {
 public:
-    using RandomField<vector, std::array<double*, 3>>:: RandomField; // Inherit constructors
-    vector at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(vector, Field, at_position, x, y, z); }
+    using RandomField<vector_t<double>, std::array<double*, 3>>:: RandomField; // Inherit constructors
+    vector_t<double> at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE(vector_t<double>, RandomField, at_position, x, y, z); }
 
     std::array<double*, 3> on_grid(int seed) override {PYBIND11_OVERRIDE_PURE(Array3PointerType, RandomField, on_grid, seed); }
     
@@ -71,13 +71,13 @@ public:
 class PyRandomVectorField: public RandomVectorField {
 public:
     using RandomVectorField:: RandomVectorField; // Inherit constructors
-    vector at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(vector, RandomVectorField, at_position, x, y, z); }
+    vector_t<double> at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE(vector_t<double>, RandomVectorField, at_position, x, y, z); }
 
     double spatial_profile(const double &x, const double &y, const double &z) const override{PYBIND11_OVERRIDE_PURE(double, RandomVectorField, spatial_profile, x, y, z); }
 
     double calculate_fourier_sigma(const double &abs_k, const double &dk) const override{PYBIND11_OVERRIDE_PURE(double, RandomVectorField, calculate_fourier_sigma, abs_k, dk); }
 
-    void _on_grid(std::array<double*, 3> grid_eval, const std::array<int, 3>& shape, const std::array<double, 3>& reference_point, const std::array<double, 3>& increment, const int seed) override {PYBIND11_OVERRIDE_PURE(void, RandomVectorField, on_grid, grid_eval, shape, reference_point, increment, seed); }
+    void _on_grid(std::array<double*, 3> grid_eval, const std::array<int, 3>& shape, const std::array<double, 3>& reference_point, const std::array<double, 3>& increment, const int seed, std::array<double*, 3> out, const std::array<std::ptrdiff_t, 3>& strides) override {PYBIND11_OVERRIDE_PURE(void, RandomVectorField, on_grid, grid_eval, shape, reference_point, increment, seed, out, strides); }
 
     std::array<double*, 3> on_grid(int seed) override {PYBIND11_OVERRIDE(Array3PointerType, RandomVectorField, on_grid, seed); }
 
@@ -88,13 +88,13 @@ public:
 class PyRandomScalarField: public RandomScalarField {
 public:
     using RandomScalarField:: RandomScalarField; // Inherit constructors
-    number at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(number, RandomScalarField, at_position, x, y, z); }
+    double at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE(double, RandomScalarField, at_position, x, y, z); }
 
     double spatial_profile(const double &x, const double &y, const double &z) const override{PYBIND11_OVERRIDE_PURE(double, RandomScalarField, spatial_profile, x, y, z); }
 
     double calculate_fourier_sigma(const double &abs_k, const double &dk) const override{PYBIND11_OVERRIDE_PURE(double, RandomScalarField, calculate_fourier_sigma, abs_k, dk); }
 
-    void _on_grid(double* grid_eval, const std::array<int, 3>& shape, const std::array<double, 3>& reference_point, const std::array<double, 3>& increment, const int seed) override {PYBIND11_OVERRIDE_PURE(void, RandomScalarField, on_grid,  grid_eval, shape, reference_point, increment, seed); }
+    void _on_grid(double* grid_eval, const std::array<int, 3>& shape, const std::array<double, 3>& reference_point, const std::array<double, 3>& increment, const int seed, double* out, const std::array<std::ptrdiff_t, 3>& strides) override {PYBIND11_OVERRIDE_PURE(void, RandomScalarField, on_grid,  grid_eval, shape, reference_point, increment, seed, out, strides); }
 
     double* on_grid(const int seed) override {PYBIND11_OVERRIDE(double*, RandomScalarField, on_grid, seed); }
 
@@ -10,81 +10,408 @@ namespace py = pybind11;
 using namespace pybind11::literals;
 
 void RegularFieldBases(py::module_ &m) {
-        py::class_<RegularVectorField, Field<vector, std::array<double*, 3>>, PyRegularVectorField>(m, "RegularVectorField")
+        py::class_<RegularVectorField, Field<vector_t<double>, std::array<double*, 3>>, PyRegularVectorField>(m, "RegularVectorField")
         .def(py::init<>())
         .def(py::init<std::vector<double> &, std::vector<double> &, std::vector<double> &>())
         .def(py::init<std::array<int, 3> &, std::array<double, 3> &, std::array<double, 3> &>())
 
-        .def("on_grid", [](RegularVectorField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z)  {
+        .def("on_grid", [](RegularVectorField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z, py::object out, py::object dtype) -> py::object {
             size_t sx = grid_x.size();
             size_t sy = grid_y.size();
             size_t sz = grid_z.size();
             std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + sx}; 
             std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + sy}; 
             std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + sz}; 
-            std::array<double*, 3> f = self.on_grid(grid_x_vec, grid_y_vec, grid_z_vec);
+            const bool single = single_precision_requested(out, dtype);
+            if (!out.is_none()) {
+              std::array<std::ptrdiff_t, 3> strides;
+              if (single) {
+                std::array<float*, 3> buffers = grid_buffers_from_pyobject<float>(out, {(int)sx, (int)sy, (int)sz}, strides);
+                without_gil([&]() { self.on_grid_into(buffers, grid_x_vec, grid_y_vec, grid_z_vec, strides); });
+                return out;
+              }
+              std::array<double*, 3> buffers = grid_buffers_from_pyobject(out, {(int)sx, (int)sy, (int)sz}, strides);
+              without_gil([&]() { self.on_grid_into(buffers, grid_x_vec, grid_y_vec, grid_z_vec, strides); });
+              return out;
+            }
+            if (single) {
+              return from_pointer_array_to_list_pyarray(without_gil([&]() { return self.on_grid_float(grid_x_vec, grid_y_vec, grid_z_vec); }), sx, sy, sz);
+            }
+            std::array<double*, 3> f = without_gil([&]() { return self.on_grid(grid_x_vec, grid_y_vec, grid_z_vec); });
             auto li = from_pointer_array_to_list_pyarray(f, sx, sy, sz);
             //py::array_t<double> arr = py::array(f.size(), f.data());  // produces a copy!
             return li;},
-            py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::return_value_policy::take_ownership)
+            py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::kw_only(), py::arg("out") = py::none(), py::arg("dtype") = py::none(), py::return_value_policy::take_ownership)
 
 
-        .def("on_grid", [](RegularVectorField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment)  {
-          std::array<double*, 3> f = self.on_grid(shape, reference_point, increment);
+        .def("on_grid", [](RegularVectorField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment, py::object out, py::object dtype) -> py::object {
+          const bool single = single_precision_requested(out, dtype);
+          if (!out.is_none()) {
+            std::array<std::ptrdiff_t, 3> strides;
+            if (single) {
+              std::array<float*, 3> buffers = grid_buffers_from_pyobject<float>(out, shape, strides);
+              without_gil([&]() { self.on_grid_into(buffers, shape, reference_point, increment, strides); });
+              return out;
+            }
+            std::array<double*, 3> buffers = grid_buffers_from_pyobject(out, shape, strides);
+            without_gil([&]() { self.on_grid_into(buffers, shape, reference_point, increment, strides); });
+            return out;
+          }
+          if (single) {
+            return from_pointer_array_to_list_pyarray(without_gil([&]() { return self.on_grid_float(shape, reference_point, increment); }), shape[0], shape[1], shape[2]);
+          }
+          std::array<double*, 3> f = without_gil([&]() { return self.on_grid(shape, reference_point, increment); });
           size_t sx = shape[0];
           size_t sy = shape[1];
           size_t sz = shape[2];
           auto arr = from_pointer_array_to_list_pyarray(f, sx, sy, sz);
           //py::array_t<double> arr = py::array(f.size(), f.data());  // produces a copy!
           return arr;}, 
-          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::return_value_policy::take_ownership)
+          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::arg("out") = py::none(), py::arg("dtype") = py::none(), py::return_value_policy::take_ownership)
 
-        .def("on_grid", [](RegularVectorField &self)  {
-          std::array<double*, 3> f = self.on_grid();
+        .def("on_grid", [](RegularVectorField &self, py::object out, py::object dtype) -> py::object {
+          const bool single = single_precision_requested(out, dtype);
+          if (!out.is_none()) {
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            std::array<std::ptrdiff_t, 3> strides;
+            if (single) {
+              std::array<float*, 3> buffers = grid_buffers_from_pyobject<float>(out, self.internal_shape, strides);
+              without_gil([&]() { self.on_grid_into(buffers, strides); });
+              return out;
+            }
+            std::array<double*, 3> buffers = grid_buffers_from_pyobject(out, self.internal_shape, strides);
+            without_gil([&]() { self.on_grid_into(buffers, strides); });
+            return out;
+          }
+          if (single) {
+            std::array<float*, 3> f = without_gil([&]() { return self.on_grid_float(); });
+            return from_pointer_array_to_list_pyarray(f, self.internal_shape[0], self.internal_shape[1], self.internal_shape[2]);
+          }
+          std::array<double*, 3> f = without_gil([&]() { return self.on_grid(); });
           size_t sx = self.internal_shape[0];
           size_t sy = self.internal_shape[1];
           size_t sz = self.internal_shape[2];
           auto arr = from_pointer_array_to_list_pyarray(f, sx, sy, sz);
           //py::array_t<double> arr = py::array(f.size(), f.data());  // produces a copy!
-          return arr;}, py::return_value_policy::take_ownership);
+          return arr;}, py::kw_only(), py::arg("out") = py::none(), py::arg("dtype") = py::none(), py::return_value_policy::take_ownership)
+
+        .def("linear_parameters", &RegularVectorField::linear_parameter_names)
+
+        .def("build_linear_basis", [](RegularVectorField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z) {
+            std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+            std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+            std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+            py::gil_scoped_release release;
+            self.build_linear_basis(grid_x_vec, grid_y_vec, grid_z_vec);},
+            py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert())
+
+        .def("build_linear_basis", [](RegularVectorField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
+            py::gil_scoped_release release;
+            self.build_linear_basis(shape, reference_point, increment);},
+            py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"))
+
+        .def("build_linear_basis", [](RegularVectorField &self) {
+            py::gil_scoped_release release;
+            self.build_linear_basis();})
+
+        .def("has_linear_basis", &RegularVectorField::has_linear_basis)
+        .def("clear_linear_basis", &RegularVectorField::clear_linear_basis)
+
+        .def("on_linear_basis", [](RegularVectorField &self, py::object out) -> py::object {
+          const std::array<int, 3> shp = self.linear_basis_shape();
+          if (!out.is_none()) {
+            std::array<std::ptrdiff_t, 3> strides;
+            std::array<double*, 3> buffers = grid_buffers_from_pyobject(out, shp, strides);
+            without_gil([&]() { self.on_linear_basis_into(buffers, strides); });
+            return out;
+          }
+          std::array<double*, 3> f = without_gil([&]() { return self.on_linear_basis(); });
+          return from_pointer_array_to_list_pyarray(f, shp[0], shp[1], shp[2]);},
+          py::kw_only(), py::arg("out") = py::none(), py::return_value_policy::take_ownership)
+
+#if autodiff_FOUND
+        .def("derivative_on_grid", [](RegularVectorField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z) {
+            std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+            std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+            std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+            double* f;
+            {
+              py::gil_scoped_release release;
+              f = self.derivative_on_grid(grid_x_vec, grid_y_vec, grid_z_vec);
+            }
+            return from_pointer_to_pyarray(f, {(py::ssize_t)self.n_active_diff(), 3, grid_x.size(), grid_y.size(), grid_z.size()});},
+            py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::return_value_policy::take_ownership)
+
+        .def("derivative_on_grid", [](RegularVectorField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
+            double* f;
+            {
+              py::gil_scoped_release release;
+              f = self.derivative_on_grid(shape, reference_point, increment);
+            }
+            return from_pointer_to_pyarray(f, {(py::ssize_t)self.n_active_diff(), 3, shape[0], shape[1], shape[2]});},
+            py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::return_value_policy::take_ownership)
+
+        .def("derivative_on_grid", [](RegularVectorField &self) {
+            double* f;
+            {
+              py::gil_scoped_release release;
+              f = self.derivative_on_grid();
+            }
+            std::array<int, 3> shape = self.internal_shape;
+            return from_pointer_to_pyarray(f, {(py::ssize_t)self.n_active_diff(), 3, shape[0], shape[1], shape[2]});},
+            py::return_value_policy::take_ownership)
+
+        .def("gradient_on_grid", [](RegularVectorField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &adjoint, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z) {
+            std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+            std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+            std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+            auto adj = adjoint_buffers_from_pyarray(adjoint, {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()});
+            py::gil_scoped_release release;
+            return self.gradient_on_grid(adj, grid_x_vec, grid_y_vec, grid_z_vec);},
+            py::arg("adjoint"), py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::return_value_policy::move)
+
+        .def("gradient_on_grid", [](RegularVectorField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &adjoint, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
+            auto adj = adjoint_buffers_from_pyarray(adjoint, shape);
+            py::gil_scoped_release release;
+            return self.gradient_on_grid(adj, shape, reference_point, increment);},
+            py::arg("adjoint"), py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::return_value_policy::move)
+
+        .def("gradient_on_grid", [](RegularVectorField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &adjoint) {
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            std::array<int, 3> shape = self.internal_shape;
+            auto adj = adjoint_buffers_from_pyarray(adjoint, shape);
+            py::gil_scoped_release release;
+            return self.gradient_on_grid(adj);},
+            py::arg("adjoint"), py::return_value_policy::move)
+#endif
+
+        .def("tabulate", &RegularVectorField::tabulate, py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), 
+             py::arg("kernel") = InterpolationKernel::trilinear, py::arg("brick_size") = 8, py::call_guard<py::gil_scoped_release>())
+
+        .def("at_positions", [](RegularVectorField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &x,  py::array_t<double, py::array::c_style | py::array::forcecast>  &y, py::array_t<double, py::array::c_style | py::array::forcecast>  &z)  {
+          size_t n = static_cast<size_t>(x.size());
+          if (static_cast<size_t>(y.size()) != n || static_cast<size_t>(z.size()) != n) {
+            throw std::invalid_argument("x, y and z need to have the same number of elements.");
+          }
+          std::vector<py::ssize_t> shp(x.shape(), x.shape() + x.ndim());
+          py::array_t<double> bx(shp);
+          py::array_t<double> by(shp);
+          py::array_t<double> bz(shp);
+          std::array<double*, 3> out{bx.mutable_data(), by.mutable_data(), bz.mutable_data()};
+          {
+            py::gil_scoped_release release;
+            self.at_positions(x.data(), y.data(), z.data(), n, out);
+          }
+          py::list li;
+          li.append(bx);
+          li.append(by);
+          li.append(bz);
+          return li;},
+          "x"_a, "y"_a, "z"_a);
         
 
 // Regular Scalar Base Class
-    py::class_<RegularScalarField, Field<number, double*>, PyRegularScalarField>(m, "RegularScalarField")
+    py::class_<RegularScalarField, Field<double, double*>, PyRegularScalarField>(m, "RegularScalarField")
         .def(py::init<>())
         .def(py::init<std::vector<double> &, std::vector<double> &, std::vector<double> &>())
         .def(py::init<std::array<int, 3> &, std::array<double, 3> &, std::array<double, 3> &>())
 
-        .def("on_grid", [](RegularScalarField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z)  {
+        .def("on_grid", [](RegularScalarField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z, py::object out, py::object dtype) -> py::object {
           size_t sx = grid_x.size();
           size_t sy = grid_y.size();
           size_t sz = grid_z.size();
           std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + sx}; 
           std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + sy}; 
           std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + sz}; 
-          double* f = self.on_grid(grid_x_vec, grid_y_vec, grid_z_vec);
+          const bool single = single_precision_requested(out, dtype);
+          if (!out.is_none()) {
+            py::array arr = out.cast<py::array>();
+            std::array<std::ptrdiff_t, 3> strides;
+            if (single) {
+              float* buffer = grid_buffer_from_pyarray<float>(arr, {(int)sx, (int)sy, (int)sz}, strides);
+              without_gil([&]() { self.on_grid_into(buffer, grid_x_vec, grid_y_vec, grid_z_vec, strides); });
+              return out;
+            }
+            double* buffer = grid_buffer_from_pyarray(arr, {(int)sx, (int)sy, (int)sz}, strides);
+            without_gil([&]() { self.on_grid_into(buffer, grid_x_vec, grid_y_vec, grid_z_vec, strides); });
+            return out;
+          }
+          if (single) {
+            return from_pointer_to_pyarray(without_gil([&]() { return self.on_grid_float(grid_x_vec, grid_y_vec, grid_z_vec); }), sx, sy, sz);
+          }
+          double* f = without_gil([&]() { return self.on_grid(grid_x_vec, grid_y_vec, grid_z_vec); });
           auto arr = from_pointer_to_pyarray(std::move(f), sx, sy, sz);
           //arr.resize({sx, sy, sz});
           return arr;},
-          py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::return_value_policy::take_ownership)
+          py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::kw_only(), py::arg("out") = py::none(), py::arg("dtype") = py::none(), py::return_value_policy::take_ownership)
         
-        .def("on_grid", [](RegularScalarField &self, std::array<int, 3>  shape, std::array<double, 3>  reference_point, std::array<double, 3>  increment)  {
-          double* f = self.on_grid(shape, reference_point, increment);
+        .def("on_grid", [](RegularScalarField &self, std::array<int, 3>  shape, std::array<double, 3>  reference_point, std::array<double, 3>  increment, py::object out, py::object dtype) -> py::object {
+          const bool single = single_precision_requested(out, dtype);
+          if (!out.is_none()) {
+            py::array arr = out.cast<py::array>();
+            std::array<std::ptrdiff_t, 3> strides;
+            if (single) {
+              float* buffer = grid_buffer_from_pyarray<float>(arr, shape, strides);
+              without_gil([&]() { self.on_grid_into(buffer, shape, reference_point, increment, strides); });
+              return out;
+            }
+            double* buffer = grid_buffer_from_pyarray(arr, shape, strides);
+            without_gil([&]() { self.on_grid_into(buffer, shape, reference_point, increment, strides); });
+            return out;
+          }
+          if (single) {
+            return from_pointer_to_pyarray(without_gil([&]() { return self.on_grid_float(shape, reference_point, increment); }), shape[0], shape[1], shape[2]);
+          }
+          double* f = without_gil([&]() { return self.on_grid(shape, reference_point, increment); });
           size_t sx = shape[0];
           size_t sy = shape[1];
           size_t sz = shape[2];
           auto arr = from_pointer_to_pyarray(std::move(f), sx, sy, sz);
           return arr;},
-          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), 
+          py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::arg("out") = py::none(), py::arg("dtype") = py::none(),
           py::return_value_policy::take_ownership)
 
 
-        .def("on_grid", [](RegularScalarField &self)  {
-          double* f = self.on_grid();
+        .def("on_grid", [](RegularScalarField &self, py::object out, py::object dtype) -> py::object {
+          const bool single = single_precision_requested(out, dtype);
+          if (!out.is_none()) {
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            py::array arr = out.cast<py::array>();
+            std::array<std::ptrdiff_t, 3> strides;
+            if (single) {
+              float* buffer = grid_buffer_from_pyarray<float>(arr, self.internal_shape, strides);
+              without_gil([&]() { self.on_grid_into(buffer, strides); });
+              return out;
+            }
+            double* buffer = grid_buffer_from_pyarray(arr, self.internal_shape, strides);
+            without_gil([&]() { self.on_grid_into(buffer, strides); });
+            return out;
+          }
+          if (single) {
+            float* f = without_gil([&]() { return self.on_grid_float(); });
+            return from_pointer_to_pyarray(f, self.internal_shape[0], self.internal_shape[1], self.internal_shape[2]);
+          }
+          double* f = without_gil([&]() { return self.on_grid(); });
           size_t sx = self.internal_shape[0];
           size_t sy = self.internal_shape[1];
           size_t sz = self.internal_shape[2];
           auto arr = from_pointer_to_pyarray(std::move(f), sx, sy, sz);
-          return arr;}, py::return_value_policy::take_ownership);
+          return arr;}, py::kw_only(), py::arg("out") = py::none(), py::arg("dtype") = py::none(), py::return_value_policy::take_ownership)
+
+        .def("linear_parameters", &RegularScalarField::linear_parameter_names)
+
+        .def("build_linear_basis", [](RegularScalarField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z) {
+            std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+            std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+            std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+            py::gil_scoped_release release;
+            self.build_linear_basis(grid_x_vec, grid_y_vec, grid_z_vec);},
+            py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert())
+
+        .def("build_linear_basis", [](RegularScalarField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
+            py::gil_scoped_release release;
+            self.build_linear_basis(shape, reference_point, increment);},
+            py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"))
+
+        .def("build_linear_basis", [](RegularScalarField &self) {
+            py::gil_scoped_release release;
+            self.build_linear_basis();})
+
+        .def("has_linear_basis", &RegularScalarField::has_linear_basis)
+        .def("clear_linear_basis", &RegularScalarField::clear_linear_basis)
+
+        .def("on_linear_basis", [](RegularScalarField &self, py::object out) -> py::object {
+          const std::array<int, 3> shp = self.linear_basis_shape();
+          if (!out.is_none()) {
+            py::array arr = out.cast<py::array>();
+            std::array<std::ptrdiff_t, 3> strides;
+            double* buffer = grid_buffer_from_pyarray(arr, shp, strides);
+            without_gil([&]() { self.on_linear_basis_into(buffer, strides); });
+            return out;
+          }
+          double* f = without_gil([&]() { return self.on_linear_basis(); });
+          return from_pointer_to_pyarray(std::move(f), shp[0], shp[1], shp[2]);},
+          py::kw_only(), py::arg("out") = py::none(), py::return_value_policy::take_ownership)
+
+#if autodiff_FOUND
+        .def("derivative_on_grid", [](RegularScalarField &self, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z) {
+            std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+            std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+            std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+            double* f;
+            {
+              py::gil_scoped_release release;
+              f = self.derivative_on_grid(grid_x_vec, grid_y_vec, grid_z_vec);
+            }
+            return from_pointer_to_pyarray(f, {(py::ssize_t)self.n_active_diff(), grid_x.size(), grid_y.size(), grid_z.size()});},
+            py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::return_value_policy::take_ownership)
+
+        .def("derivative_on_grid", [](RegularScalarField &self, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
+            double* f;
+            {
+              py::gil_scoped_release release;
+              f = self.derivative_on_grid(shape, reference_point, increment);
+            }
+            return from_pointer_to_pyarray(f, {(py::ssize_t)self.n_active_diff(), shape[0], shape[1], shape[2]});},
+            py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::return_value_policy::take_ownership)
+
+        .def("derivative_on_grid", [](RegularScalarField &self) {
+            double* f;
+            {
+              py::gil_scoped_release release;
+              f = self.derivative_on_grid();
+            }
+            std::array<int, 3> shape = self.internal_shape;
+            return from_pointer_to_pyarray(f, {(py::ssize_t)self.n_active_diff(), shape[0], shape[1], shape[2]});},
+            py::return_value_policy::take_ownership)
+
+        .def("gradient_on_grid", [](RegularScalarField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &adjoint, py::array_t<double> &grid_x,  py::array_t<double>  &grid_y, py::array_t<double>  &grid_z) {
+            std::vector<double> grid_x_vec{grid_x.data(), grid_x.data() + grid_x.size()}; 
+            std::vector<double> grid_y_vec{grid_y.data(), grid_y.data() + grid_y.size()}; 
+            std::vector<double> grid_z_vec{grid_z.data(), grid_z.data() + grid_z.size()}; 
+            auto adj = adjoint_buffer_from_pyarray(adjoint, {(int)grid_x.size(), (int)grid_y.size(), (int)grid_z.size()});
+            py::gil_scoped_release release;
+            return self.gradient_on_grid(adj, grid_x_vec, grid_y_vec, grid_z_vec);},
+            py::arg("adjoint"), py::arg("grid_x").noconvert(), py::arg("grid_y").noconvert(), py::arg("grid_z").noconvert(), py::return_value_policy::move)
+
+        .def("gradient_on_grid", [](RegularScalarField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &adjoint, std::array<int, 3> &shape,  std::array<double, 3>  &reference_point, std::array<double, 3>  &increment) {
+            auto adj = adjoint_buffer_from_pyarray(adjoint, shape);
+            py::gil_scoped_release release;
+            return self.gradient_on_grid(adj, shape, reference_point, increment);},
+            py::arg("adjoint"), py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), py::return_value_policy::move)
+
+        .def("gradient_on_grid", [](RegularScalarField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &adjoint) {
+            if (!self.has_internal_grid()) {
+              throw GridException();
+            }
+            std::array<int, 3> shape = self.internal_shape;
+            auto adj = adjoint_buffer_from_pyarray(adjoint, shape);
+            py::gil_scoped_release release;
+            return self.gradient_on_grid(adj);},
+            py::arg("adjoint"), py::return_value_policy::move)
+#endif
+
+        .def("tabulate", &RegularScalarField::tabulate, py::kw_only(), py::arg("shape").noconvert(), py::arg("reference_point"), py::arg("increment"), 
+             py::arg("kernel") = InterpolationKernel::trilinear, py::arg("brick_size") = 8, py::call_guard<py::gil_scoped_release>())
+
+        .def("at_positions", [](RegularScalarField &self, py::array_t<double, py::array::c_style | py::array::forcecast> &x,  py::array_t<double, py::array::c_style | py::array::forcecast>  &y, py::array_t<double, py::array::c_style | py::array::forcecast>  &z)  {
+          size_t n = static_cast<size_t>(x.size());
+          if (static_cast<size_t>(y.size()) != n || static_cast<size_t>(z.size()) != n) {
+            throw std::invalid_argument("x, y and z need to have the same number of elements.");
+          }
+          std::vector<py::ssize_t> shp(x.shape(), x.shape() + x.ndim());
+          py::array_t<double> arr(shp);
+          {
+            py::gil_scoped_release release;
+            self.at_positions(x.data(), y.data(), z.data(), n, arr.mutable_data());
+          }
+          return arr;},
+          "x"_a, "y"_a, "z"_a);
 }
 #endif
\ No newline at end of file
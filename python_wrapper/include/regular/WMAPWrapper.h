@@ -35,7 +35,7 @@ void WMAP(py::module_ &m) {
 #endif
         .def("at_position", [](WMAPMagneticField &self, double x, double y, double z)  
             {
-                vector f = self.at_position(x, y, z);
+                vector_t<double> f = self.at_position(x, y, z);
                 return std::make_tuple(f[0], f[1], f[2]);
             },
             "x"_a, "y"_a, "z"_a, py::return_value_policy::take_ownership);
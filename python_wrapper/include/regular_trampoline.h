@@ -13,10 +13,10 @@ using Array3PointerType = std::array<double*, 3>; // Only for PYBIND11_OVERRIDE_
 
 // These classes are necessary to override virtual functions when binding abstract c++ classes
 
-class PyScalarFieldBase: public Field<number, double*> {
+class PyScalarFieldBase: public Field<double, double*> {
 public:
-    using Field<number, double*>:: Field; // Inherit constructors
-    number at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(number, Field, at_position, x, y, z); }
+    using Field<double, double*>:: Field; // Inherit constructors
+    double at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(double, Field, at_position, x, y, z); }
 
     double* on_grid(int seed) override {PYBIND11_OVERRIDE_PURE(double*, Field, on_grid, seed); }
     
@@ -32,10 +32,10 @@ public:
 };
 
 
-class PyVectorFieldBase: public Field<vector, std::array<double*, 3>> {
+class PyVectorFieldBase: public Field<vector_t<double>, std::array<double*, 3>> {
 public:
-    using Field<vector, std::array<double*, 3>>:: Field; // Inherit constructors
-    vector at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(vector, Field, at_position, x, y, z); }
+    using Field<vector_t<double>, std::array<double*, 3>>:: Field; // Inherit constructors
+    vector_t<double> at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(vector_t<double>, Field, at_position, x, y, z); }
 
     std::array<double*, 3> on_grid(int seed) override {PYBIND11_OVERRIDE_PURE(Array3PointerType, Field, on_grid, seed); }
     
@@ -54,7 +54,7 @@ public:
 class PyRegularVectorField: public RegularVectorField {
 public:
     using RegularVectorField:: RegularVectorField; // Inherit constructors
-    vector at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(vector, RegularVectorField, at_position, x, y, z); }
+    vector_t<double> at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(vector_t<double>, RegularVectorField, at_position, x, y, z); }
 
     std::array<double*, 3> on_grid(int seed) override {PYBIND11_OVERRIDE(Array3PointerType, RegularVectorField, on_grid, seed); }
     
@@ -68,7 +68,7 @@ public:
 class PyRegularScalarField : public RegularScalarField {
 public:
     using RegularScalarField:: RegularScalarField; // Inherit constructors
-    number at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(number, RegularScalarField, at_position, x, y, z); }
+    double at_position(const double& x, const double& y, const double& z) const override {PYBIND11_OVERRIDE_PURE(double, RegularScalarField, at_position, x, y, z); }
     
     double* on_grid(int seed) override {PYBIND11_OVERRIDE_PURE(double*, RegularScalarField, on_grid, seed); }
 
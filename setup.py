@@ -63,6 +63,10 @@ class CMakeBuild(build_ext):
         use_fftw = os.environ.get("USE_FFTW", "")
         if len(use_fftw) > 1:
             cmake_args.append("-DUSE_FFTW={}".format(use_fftw))
+
+        use_openmp = os.environ.get("USE_OPENMP", "")
+        if len(use_openmp) > 1:
+            cmake_args.append("-DUSE_OPENMP={}".format(use_openmp))
         
         build_args = []
         # Adding CMake arguments set as environment variable
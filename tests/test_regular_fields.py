@@ -107,4 +107,61 @@ def test_parameter_update():
     
     assert umf.bx == -3.2 
     
-    assert umf.at_position(2.4, 2.1, -.2) == [-3.2, 0., 0]
\ No newline at end of file
+    assert umf.at_position(2.4, 2.1, -.2) == [-3.2, 0., 0]
+
+def test_at_positions():
+    # the batched evaluation has to agree with point-wise evaluation
+    x = np.asarray([0., 2., -4.5, 8.1, 12.])
+    y = np.asarray([0., 6., 0.1, -3., 2.2])
+    z = np.asarray([-0.2, 0.8, 0.2, 0., 1.])
+    for model_string in regular_models:
+        mo = getattr(img, model_string)()
+        b_field = mo.at_positions(x, y, z)
+        for s in range(len(x)):
+            pos = mo.at_position(x[s], y[s], z[s])
+            for j in range(3):
+                assert b_field[j][s] == pos[j]
+
+
+def test_grid_out():
+    # evaluating into preallocated (also non-contiguous) arrays has to agree with on_grid
+    for model_string in regular_models:
+        mo = getattr(img, model_string)(shape, zeropoint, increment)
+        b_field = mo.on_grid()
+        out = np.empty((3, *shape))
+        assert mo.on_grid(out=out) is out
+        out_f = [np.empty(shape, order='F') for j in range(3)]
+        mo.on_grid(shape=shape, reference_point=zeropoint, increment=increment, out=out_f)
+        for j in range(3):
+            assert np.array_equal(b_field[j], out[j], equal_nan=True)
+            assert np.array_equal(b_field[j], out_f[j], equal_nan=True)
+        with pytest.raises(ValueError):
+            mo.on_grid(out=np.empty((3, 2, 2, 2)))
+
+
+class PythonVectorField(img.RegularVectorField):
+    # at_position overridden in python, called by the (threaded) grid loops of the library
+
+    def at_position(self, x, y, z):
+        if x > 100.:
+            raise ValueError('outside of the model')
+        return [x, 2.*y, z*y]
+
+
+def test_python_subclass_on_grid():
+    # the grid loops run on several threads, which take the GIL in turn to call at_position
+    mo = PythonVectorField(shape, zeropoint, increment)
+    for threads in [1, 4]:
+        mo.grid_threads = threads
+        b_field = mo.on_grid()
+        b_field_irregular = mo.on_grid(grid_x, grid_y, grid_z)
+        for i in range(shape[0]):
+            for j in range(shape[1]):
+                for k in range(shape[2]):
+                    pos = mo.at_position(zeropoint[0] + i*increment[0], zeropoint[1] + j*increment[1], zeropoint[2] + k*increment[2])
+                    for d in range(3):
+                        assert b_field[d][i, j, k] == pos[d]
+        assert b_field_irregular[1][0, 2, 1] == 2.*grid_y[2]
+        # exceptions raised in python on a worker thread reach the caller
+        with pytest.raises(ValueError):
+            mo.on_grid(shape=shape, reference_point=[99., 0., 0.], increment=[1., 1., 1.])